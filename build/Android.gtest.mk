@@ -18,6 +18,7 @@ LOCAL_PATH := art
 
 TEST_COMMON_SRC_FILES := \
 	compiler/dex/arena_allocator_test.cc \
+	compiler/dex/dex_to_dex_compiler_test.cc \
 	compiler/driver/compiler_driver_test.cc \
 	compiler/elf_writer_test.cc \
 	compiler/image_test.cc \
@@ -28,6 +29,8 @@ TEST_COMMON_SRC_FILES := \
 	compiler/utils/dedupe_set_test.cc \
 	compiler/utils/arm/managed_register_arm_test.cc \
 	compiler/utils/x86/managed_register_x86_test.cc \
+	dex2oat/dex2oat_test.cc \
+	runtime/alloc_sampler_test.cc \
 	runtime/barrier_test.cc \
 	runtime/base/bit_vector_test.cc \
 	runtime/base/histogram_test.cc \
@@ -48,11 +51,15 @@ TEST_COMMON_SRC_FILES := \
 	runtime/gc/heap_test.cc \
 	runtime/gc/space/space_test.cc \
 	runtime/gtest_test.cc \
+	runtime/hprof/hprof_test.cc \
 	runtime/indenter_test.cc \
 	runtime/indirect_reference_table_test.cc \
 	runtime/intern_table_test.cc \
+	runtime/interpreter/interpreter_cache_test.cc \
+	runtime/interpreter/interpreter_test.cc \
 	runtime/jni_internal_test.cc \
 	runtime/mem_map_test.cc \
+	runtime/page_in_profile_test.cc \
 	runtime/mirror/dex_cache_test.cc \
 	runtime/mirror/object_test.cc \
 	runtime/reference_table_test.cc \
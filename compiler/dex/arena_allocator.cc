@@ -20,7 +20,9 @@
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "thread-inl.h"
+#include "utils.h"
 #include <memcheck/memcheck.h>
+#include <sys/mman.h>
 
 namespace art {
 
@@ -81,9 +83,34 @@ void Arena::Reset() {
   }
 }
 
+size_t Arena::Release() {
+  if (bytes_allocated_ == 0) {
+    // Untouched since it was last reset or released.
+    return 0;
+  }
+  // The kernel maps released pages to zero pages on their next access. Partial pages at either
+  // end stay mapped and are zeroed by hand.
+  uint8_t* release_begin = std::min(AlignUp(Begin(), kPageSize), End());
+  uint8_t* release_end = std::max(AlignDown(End(), kPageSize), release_begin);
+  uint8_t* used_end = Begin() + bytes_allocated_;
+  memset(Begin(), 0, std::min(release_begin, used_end) - Begin());
+  if (used_end > release_end) {
+    memset(release_end, 0, used_end - release_end);
+  }
+  if (release_begin != release_end) {
+    madvise(release_begin, release_end - release_begin, MADV_DONTNEED);
+  }
+  bytes_allocated_ = 0;
+  return release_end - release_begin;
+}
+
 ArenaPool::ArenaPool()
     : lock_("Arena pool lock"),
-      free_arenas_(nullptr) {
+      free_arenas_(nullptr),
+      arena_bytes_(0),
+      peak_arena_bytes_(0),
+      released_bytes_(0),
+      largest_method_(nullptr, 0) {
 }
 
 ArenaPool::~ArenaPool() {
@@ -106,6 +133,9 @@ Arena* ArenaPool::AllocArena(size_t size) {
   }
   if (ret == nullptr) {
     ret = new Arena(size);
+    MutexLock lock(self, lock_);
+    arena_bytes_ += ret->Size();
+    peak_arena_bytes_ = std::max(peak_arena_bytes_, arena_bytes_);
   }
   ret->Reset();
   return ret;
@@ -123,6 +153,57 @@ void ArenaPool::FreeArena(Arena* arena) {
   }
 }
 
+size_t ArenaPool::Trim() {
+  MutexLock lock(Thread::Current(), lock_);
+  size_t released = 0;
+  for (Arena* arena = free_arenas_; arena != nullptr; arena = arena->next_) {
+    released += arena->Release();
+  }
+  released_bytes_ += released;
+  return released;
+}
+
+void ArenaPool::RecordUsage(MethodReference method, size_t bytes_used,
+                            const std::vector<std::pair<const char*, size_t> >& phase_bytes) {
+  MutexLock lock(Thread::Current(), lock_);
+  if (bytes_used > method_usage_.max_bytes) {
+    largest_method_ = method;
+  }
+  method_usage_.Add(bytes_used);
+  for (size_t i = 0; i < phase_bytes.size(); ++i) {
+    const char* phase = phase_bytes[i].first;
+    size_t j = 0;
+    while (j < phase_usage_.size() && phase_usage_[j].first != phase &&
+           strcmp(phase_usage_[j].first, phase) != 0) {
+      ++j;
+    }
+    if (j == phase_usage_.size()) {
+      phase_usage_.push_back(std::make_pair(phase, Usage()));
+    }
+    phase_usage_[j].second.Add(phase_bytes[i].second);
+  }
+}
+
+void ArenaPool::DumpMemStats(std::ostream& os) {
+  MutexLock lock(Thread::Current(), lock_);
+  os << "Arenas: " << PrettySize(arena_bytes_) << " allocated, peak "
+     << PrettySize(peak_arena_bytes_) << ", " << PrettySize(released_bytes_)
+     << " released by trimming\n";
+  if (method_usage_.count == 0) {
+    return;
+  }
+  os << "Arena use per method: average "
+     << PrettySize(method_usage_.total_bytes / method_usage_.count)
+     << ", max " << PrettySize(method_usage_.max_bytes) << " compiling "
+     << PrettyMethod(largest_method_.dex_method_index, *largest_method_.dex_file) << "\n";
+  for (size_t i = 0; i < phase_usage_.size(); ++i) {
+    const Usage& usage = phase_usage_[i].second;
+    os << "  " << phase_usage_[i].first << ": average "
+       << PrettySize(usage.total_bytes / usage.count)
+       << ", max " << PrettySize(usage.max_bytes) << "\n";
+  }
+}
+
 size_t ArenaAllocator::BytesAllocated() const {
   size_t total = 0;
   for (int i = 0; i < kNumAllocKinds; i++) {
@@ -137,6 +218,7 @@ ArenaAllocator::ArenaAllocator(ArenaPool* pool)
     end_(nullptr),
     ptr_(nullptr),
     arena_head_(nullptr),
+    previous_arenas_bytes_used_(0),
     num_allocations_(0),
     running_on_valgrind_(RUNNING_ON_VALGRIND) {
   memset(&alloc_stats_[0], 0, sizeof(alloc_stats_));
@@ -185,6 +267,7 @@ ArenaAllocator::~ArenaAllocator() {
 
 void ArenaAllocator::ObtainNewArenaForAllocation(size_t allocation_size) {
   UpdateBytesAllocated();
+  previous_arenas_bytes_used_ += ptr_ - begin_;
   Arena* new_arena = pool_->AllocArena(std::max(Arena::kDefaultSize, allocation_size));
   new_arena->next_ = arena_head_;
   arena_head_ = new_arena;
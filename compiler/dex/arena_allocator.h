@@ -20,9 +20,15 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <algorithm>
+#include <iosfwd>
+#include <utility>
+#include <vector>
+
 #include "base/mutex.h"
 #include "compiler_enums.h"
 #include "mem_map.h"
+#include "method_reference.h"
 
 namespace art {
 
@@ -36,6 +42,9 @@ class Arena {
   explicit Arena(size_t size = kDefaultSize);
   ~Arena();
   void Reset();
+  // Zeroes the arena and returns its whole pages to the kernel. Returns the number of bytes
+  // released.
+  size_t Release();
   uint8_t* Begin() {
     return memory_;
   }
@@ -67,12 +76,47 @@ class ArenaPool {
  public:
   ArenaPool();
   ~ArenaPool();
-  Arena* AllocArena(size_t size);
-  void FreeArena(Arena* arena);
+  Arena* AllocArena(size_t size) LOCKS_EXCLUDED(lock_);
+  void FreeArena(Arena* arena) LOCKS_EXCLUDED(lock_);
+
+  // Releases the memory of idle arenas, which stay pooled for reuse. Returns the number of bytes
+  // released.
+  size_t Trim() LOCKS_EXCLUDED(lock_);
+
+  // Records the arena usage of compiling a method: bytes_used bytes in total, of which
+  // phase_bytes[i].second while in the phase named phase_bytes[i].first. Phase names are
+  // expected to be string literals.
+  void RecordUsage(MethodReference method, size_t bytes_used,
+                   const std::vector<std::pair<const char*, size_t> >& phase_bytes)
+      LOCKS_EXCLUDED(lock_);
+
+  void DumpMemStats(std::ostream& os) LOCKS_EXCLUDED(lock_);
 
  private:
+  struct Usage {
+    Usage() : count(0), total_bytes(0), max_bytes(0) {}
+
+    void Add(size_t bytes) {
+      ++count;
+      total_bytes += bytes;
+      max_bytes = std::max(max_bytes, bytes);
+    }
+
+    size_t count;
+    uint64_t total_bytes;
+    size_t max_bytes;
+  };
+
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   Arena* free_arenas_ GUARDED_BY(lock_);
+  // Size of the arenas allocated and not yet deleted, and its peak.
+  size_t arena_bytes_ GUARDED_BY(lock_);
+  size_t peak_arena_bytes_ GUARDED_BY(lock_);
+  uint64_t released_bytes_ GUARDED_BY(lock_);
+  Usage method_usage_ GUARDED_BY(lock_);
+  MethodReference largest_method_ GUARDED_BY(lock_);
+  std::vector<std::pair<const char*, Usage> > phase_usage_ GUARDED_BY(lock_);
+
   DISALLOW_COPY_AND_ASSIGN(ArenaPool);
 };
 
@@ -125,7 +169,12 @@ class ArenaAllocator {
 
   void* AllocValgrind(size_t bytes, ArenaAllocKind kind);
   void ObtainNewArenaForAllocation(size_t allocation_size);
+  // Bytes allocated by kind, only counted if kCountAllocations.
   size_t BytesAllocated() const;
+  // Bytes allocated so far, always counted.
+  size_t BytesUsed() const {
+    return previous_arenas_bytes_used_ + (ptr_ - begin_);
+  }
   void DumpMemStats(std::ostream& os) const;
 
  private:
@@ -136,6 +185,8 @@ class ArenaAllocator {
   uint8_t* end_;
   uint8_t* ptr_;
   Arena* arena_head_;
+  // Bytes allocated from the arenas before arena_head_.
+  size_t previous_arenas_bytes_used_;
   size_t num_allocations_;
   size_t alloc_stats_[kNumAllocKinds];  // Bytes used by various allocation kinds.
   bool running_on_valgrind_;
@@ -30,4 +30,35 @@ TEST(ArenaAllocator, Test) {
   EXPECT_EQ(2U, bv.GetStorageSize());
 }
 
+TEST(ArenaAllocator, BytesUsed) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  EXPECT_EQ(0U, arena.BytesUsed());
+  arena.Alloc(10, ArenaAllocator::kAllocMisc);
+  EXPECT_EQ(12U, arena.BytesUsed());
+  // Doesn't fit in the first arena.
+  arena.Alloc(Arena::kDefaultSize, ArenaAllocator::kAllocMisc);
+  EXPECT_EQ(12U + Arena::kDefaultSize, arena.BytesUsed());
+}
+
+TEST(ArenaAllocator, TrimReleasesIdleArenas) {
+  ArenaPool pool;
+  {
+    ArenaAllocator arena(&pool);
+    uint8_t* memory = reinterpret_cast<uint8_t*>(arena.Alloc(Arena::kDefaultSize,
+                                                             ArenaAllocator::kAllocMisc));
+    memset(memory, 0xff, Arena::kDefaultSize);
+  }
+  EXPECT_GT(pool.Trim(), 0U);
+  // Nothing left to release.
+  EXPECT_EQ(0U, pool.Trim());
+  // The released arena is reused, and zeroed.
+  ArenaAllocator arena(&pool);
+  uint8_t* memory = reinterpret_cast<uint8_t*>(arena.Alloc(Arena::kDefaultSize,
+                                                           ArenaAllocator::kAllocMisc));
+  for (size_t i = 0; i < Arena::kDefaultSize; ++i) {
+    ASSERT_EQ(0U, memory[i]);
+  }
+}
+
 }  // namespace art
@@ -50,6 +50,8 @@ struct CompilationUnit {
   void StartTimingSplit(const char* label);
   void NewTimingSplit(const char* label);
   void EndTiming();
+  // Attributes arena memory allocated from now on to the phase named label.
+  void StartArenaPhase(const char* label);
 
   /*
    * Fields needed/generated by common frontend and generally used throughout
@@ -95,6 +97,10 @@ struct CompilationUnit {
   UniquePtr<MIRGraph> mir_graph;   // MIR container.
   UniquePtr<Backend> cg;           // Target-specific codegen.
   TimingLogger timings;
+
+  // Arena bytes allocated in each phase, reported to the arena pool when compilation ends.
+  std::vector<std::pair<const char*, size_t> > arena_phase_bytes;
+  size_t arena_phase_start;
 };
 
 }  // namespace art
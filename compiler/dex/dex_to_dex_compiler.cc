@@ -33,6 +33,8 @@ namespace optimizer {
 const bool kEnableQuickening = true;
 // Control check-cast elision.
 const bool kEnableCheckCastEllision = true;
+// Controls fusion of common instruction pairs into interpreter superinstructions.
+const bool kEnableSuperInstructions = true;
 
 class DexCompiler {
  public:
@@ -83,6 +85,12 @@ class DexCompiler {
   void CompileInvokeVirtual(Instruction* inst, uint32_t dex_pc,
                             Instruction::Code new_opcode, bool is_range);
 
+  // Fuses an instruction with the one following it when the pair has an interpreter
+  // superinstruction (see Instruction::UnfusedOpcode). Only the opcode of the first
+  // instruction changes: the second one is left in place so that it can still be a branch
+  // target and so that everything but the interpreter can ignore the fusion.
+  void CompileSuperInstruction(Instruction* inst, uint32_t dex_pc);
+
   CompilerDriver& driver_;
   const DexCompilationUnit& unit_;
   const DexToDexCompilationLevel dex_to_dex_compilation_level_;
@@ -108,8 +116,14 @@ void DexCompiler::Compile() {
         inst = CompileCheckCast(inst, dex_pc);
         break;
 
+      case Instruction::CONST_4:
+      case Instruction::AGET:
+        CompileSuperInstruction(inst, dex_pc);
+        break;
+
       case Instruction::IGET:
         CompileInstanceFieldAccess(inst, dex_pc, Instruction::IGET_QUICK, false);
+        CompileSuperInstruction(inst, dex_pc);
         break;
 
       case Instruction::IGET_WIDE:
@@ -118,6 +132,7 @@ void DexCompiler::Compile() {
 
       case Instruction::IGET_OBJECT:
         CompileInstanceFieldAccess(inst, dex_pc, Instruction::IGET_OBJECT_QUICK, false);
+        CompileSuperInstruction(inst, dex_pc);
         break;
 
       case Instruction::IPUT:
@@ -269,6 +284,60 @@ void DexCompiler::CompileInvokeVirtual(Instruction* inst,
   }
 }
 
+void DexCompiler::CompileSuperInstruction(Instruction* inst, uint32_t dex_pc) {
+  if (!kEnableSuperInstructions || !PerformOptimizations()) {
+    return;
+  }
+  const DexFile::CodeItem* code_item = unit_.GetCodeItem();
+  if (dex_pc + inst->SizeInCodeUnits() >= code_item->insns_size_in_code_units_) {
+    return;
+  }
+  Instruction::Code next_opcode = inst->Next()->Opcode();
+  Instruction::Code new_opcode;
+  switch (inst->Opcode()) {
+    case Instruction::IGET_QUICK:
+      if (next_opcode == Instruction::IF_EQZ) {
+        new_opcode = Instruction::IGET_QUICK_IF_EQZ;
+      } else if (next_opcode == Instruction::IF_NEZ) {
+        new_opcode = Instruction::IGET_QUICK_IF_NEZ;
+      } else {
+        return;
+      }
+      break;
+    case Instruction::IGET_OBJECT_QUICK:
+      if (next_opcode == Instruction::IF_EQZ) {
+        new_opcode = Instruction::IGET_OBJECT_QUICK_IF_EQZ;
+      } else if (next_opcode == Instruction::IF_NEZ) {
+        new_opcode = Instruction::IGET_OBJECT_QUICK_IF_NEZ;
+      } else {
+        return;
+      }
+      break;
+    case Instruction::CONST_4:
+      if (next_opcode != Instruction::ADD_INT) {
+        return;
+      }
+      new_opcode = Instruction::CONST_4_ADD_INT;
+      break;
+    case Instruction::AGET:
+      if (next_opcode != Instruction::ADD_INT) {
+        return;
+      }
+      new_opcode = Instruction::AGET_ADD_INT;
+      break;
+    default:
+      // Not quickened, or no superinstruction starts with this opcode.
+      return;
+  }
+  DCHECK_EQ(Instruction::UnfusedOpcode(new_opcode), inst->Opcode());
+  VLOG(compiler) << "Fusing " << Instruction::Name(inst->Opcode())
+                 << " and " << Instruction::Name(next_opcode)
+                 << " into " << Instruction::Name(new_opcode)
+                 << " at dex pc " << StringPrintf("0x%x", dex_pc) << " in method "
+                 << PrettyMethod(unit_.GetDexMethodIndex(), GetDexFile(), true);
+  inst->SetOpcode(new_opcode);
+}
+
 }  // namespace optimizer
 }  // namespace art
 
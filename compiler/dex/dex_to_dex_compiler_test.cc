@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "common_test.h"
+#include "dex_instruction.h"
+#include "driver/compiler_driver.h"
+#include "mirror/art_field-inl.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/dex_cache.h"
+
+extern "C" void ArtCompileDEX(art::CompilerDriver& compiler,
+                              const art::DexFile::CodeItem* code_item,
+                              uint32_t access_flags, art::InvokeType invoke_type,
+                              uint16_t class_def_idx, uint32_t method_idx, jobject class_loader,
+                              const art::DexFile& dex_file,
+                              art::DexToDexCompilationLevel dex_to_dex_compilation_level);
+
+namespace art {
+
+class DexToDexCompilerTest : public CommonTest {
+ protected:
+  void SetUpAllFields() {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader_ = LoadDex("AllFields");
+    SirtRef<mirror::ClassLoader> class_loader(soa.Self(),
+                                              soa.Decode<mirror::ClassLoader*>(class_loader_));
+    mirror::Class* klass = class_linker_->FindClass("LAllFields;", class_loader);
+    ASSERT_TRUE(klass != NULL);
+    dex_file_ = klass->GetDexCache()->GetDexFile();
+    class_def_idx_ = klass->GetDexClassDefIndex();
+    // The code is compiled as if it were that of the constructor.
+    mirror::ArtMethod* method = klass->FindDirectMethod("<init>", "()V");
+    ASSERT_TRUE(method != NULL);
+    method_idx_ = method->GetDexMethodIndex();
+    access_flags_ = method->GetAccessFlags();
+    mirror::ArtField* int_field = klass->FindDeclaredInstanceField("iI", "I");
+    ASSERT_TRUE(int_field != NULL);
+    int_field_idx_ = int_field->GetDexFieldIndex();
+    int_field_offset_ = int_field->GetOffset().Uint32Value();
+    mirror::ArtField* object_field =
+        klass->FindDeclaredInstanceField("iObject", "Ljava/lang/Object;");
+    ASSERT_TRUE(object_field != NULL);
+    object_field_idx_ = object_field->GetDexFieldIndex();
+    object_field_offset_ = object_field->GetOffset().Uint32Value();
+  }
+
+  // Returns insns after dex-to-dex compilation.
+  std::vector<uint16_t> Compile(const std::vector<uint16_t>& insns,
+                                DexToDexCompilationLevel level) {
+    // Code items are 4-byte aligned.
+    const size_t header_size = OFFSETOF_MEMBER(DexFile::CodeItem, insns_);
+    std::vector<uint32_t> code((header_size + insns.size() * sizeof(uint16_t) + 3) / 4);
+    DexFile::CodeItem* code_item = reinterpret_cast<DexFile::CodeItem*>(&code[0]);
+    code_item->registers_size_ = 5;
+    code_item->ins_size_ = 1;
+    code_item->outs_size_ = 0;
+    code_item->tries_size_ = 0;
+    code_item->debug_info_off_ = 0;
+    code_item->insns_size_in_code_units_ = insns.size();
+    memcpy(code_item->insns_, &insns[0], insns.size() * sizeof(uint16_t));
+    ArtCompileDEX(*compiler_driver_, code_item, access_flags_, kDirect, class_def_idx_,
+                  method_idx_, class_loader_, *dex_file_, level);
+    return std::vector<uint16_t>(code_item->insns_, code_item->insns_ + insns.size());
+  }
+
+  jobject class_loader_;
+  const DexFile* dex_file_;
+  uint16_t class_def_idx_;
+  uint32_t method_idx_;
+  uint32_t access_flags_;
+  uint32_t int_field_idx_;
+  uint32_t int_field_offset_;
+  uint32_t object_field_idx_;
+  uint32_t object_field_offset_;
+};
+
+TEST_F(DexToDexCompilerTest, FuseConst4AddInt) {
+  SetUpAllFields();
+  // const/4 v0, #5; add-int v1, v0, v2; return v1
+  std::vector<uint16_t> insns;
+  insns.push_back(Instruction::CONST_4 | (0 << 8) | (5 << 12));
+  insns.push_back(Instruction::ADD_INT | (1 << 8));
+  insns.push_back(0 | (2 << 8));
+  insns.push_back(Instruction::RETURN | (1 << 8));
+
+  std::vector<uint16_t> expected(insns);
+  expected[0] = Instruction::CONST_4_ADD_INT | (0 << 8) | (5 << 12);
+  EXPECT_TRUE(expected == Compile(insns, kOptimize));
+  // Fusion is an optimization.
+  EXPECT_TRUE(insns == Compile(insns, kRequired));
+
+  // const/4 v0, #5; return v0
+  insns.clear();
+  insns.push_back(Instruction::CONST_4 | (0 << 8) | (5 << 12));
+  insns.push_back(Instruction::RETURN | (0 << 8));
+  EXPECT_TRUE(insns == Compile(insns, kOptimize));
+}
+
+TEST_F(DexToDexCompilerTest, FuseAGetAddInt) {
+  SetUpAllFields();
+  // aget v0, v2, v3; add-int v1, v0, v4; return v1
+  std::vector<uint16_t> insns;
+  insns.push_back(Instruction::AGET | (0 << 8));
+  insns.push_back(2 | (3 << 8));
+  insns.push_back(Instruction::ADD_INT | (1 << 8));
+  insns.push_back(0 | (4 << 8));
+  insns.push_back(Instruction::RETURN | (1 << 8));
+
+  std::vector<uint16_t> expected(insns);
+  expected[0] = Instruction::AGET_ADD_INT | (0 << 8);
+  EXPECT_TRUE(expected == Compile(insns, kOptimize));
+
+  // aget v0, v2, v3; return v0
+  insns.erase(insns.begin() + 2, insns.begin() + 4);
+  insns[2] = Instruction::RETURN | (0 << 8);
+  EXPECT_TRUE(insns == Compile(insns, kOptimize));
+}
+
+TEST_F(DexToDexCompilerTest, FuseIGetQuickIf) {
+  SetUpAllFields();
+  struct Case {
+    Instruction::Code get_opcode;
+    Instruction::Code if_opcode;
+    Instruction::Code fused_opcode;
+  };
+  const Case cases[] = {
+    { Instruction::IGET, Instruction::IF_EQZ, Instruction::IGET_QUICK_IF_EQZ },
+    { Instruction::IGET, Instruction::IF_NEZ, Instruction::IGET_QUICK_IF_NEZ },
+    { Instruction::IGET_OBJECT, Instruction::IF_EQZ, Instruction::IGET_OBJECT_QUICK_IF_EQZ },
+    { Instruction::IGET_OBJECT, Instruction::IF_NEZ, Instruction::IGET_OBJECT_QUICK_IF_NEZ },
+  };
+  for (size_t i = 0; i < arraysize(cases); ++i) {
+    bool is_object = cases[i].get_opcode == Instruction::IGET_OBJECT;
+    // iget v0, v4, field; if v0, +3; return v1; return v1
+    std::vector<uint16_t> insns;
+    insns.push_back(cases[i].get_opcode | (0 << 8) | (4 << 12));
+    insns.push_back(is_object ? object_field_idx_ : int_field_idx_);
+    insns.push_back(cases[i].if_opcode | (0 << 8));
+    insns.push_back(3);
+    insns.push_back(Instruction::RETURN | (1 << 8));
+    insns.push_back(Instruction::RETURN | (1 << 8));
+
+    // The field access is quickened, then fused with the branch, which stays in place.
+    std::vector<uint16_t> expected(insns);
+    expected[0] = cases[i].fused_opcode | (0 << 8) | (4 << 12);
+    expected[1] = is_object ? object_field_offset_ : int_field_offset_;
+    EXPECT_TRUE(expected == Compile(insns, kOptimize)) << Instruction::Name(cases[i].fused_opcode);
+  }
+}
+
+}  // namespace art
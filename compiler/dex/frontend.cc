@@ -134,25 +134,44 @@ CompilationUnit::CompilationUnit(ArenaPool* pool)
     arena(pool),
     mir_graph(NULL),
     cg(NULL),
-    timings("QuickCompiler", true, false) {
+    timings("QuickCompiler", true, false),
+    arena_phase_start(0) {
 }
 
 CompilationUnit::~CompilationUnit() {
+  if (compiler_driver != NULL && dex_file != NULL) {
+    StartArenaPhase(NULL);
+    compiler_driver->GetArenaPool().RecordUsage(MethodReference(dex_file, method_idx),
+                                                arena.BytesUsed(), arena_phase_bytes);
+  }
 }
 
 // TODO: Add a cumulative version of logging, and combine with dex2oat --dump-timing
 void CompilationUnit::StartTimingSplit(const char* label) {
+  StartArenaPhase(label);
   if (enable_debug & (1 << kDebugTimings)) {
     timings.StartSplit(label);
   }
 }
 
 void CompilationUnit::NewTimingSplit(const char* label) {
+  StartArenaPhase(label);
   if (enable_debug & (1 << kDebugTimings)) {
     timings.NewSplit(label);
   }
 }
 
+void CompilationUnit::StartArenaPhase(const char* label) {
+  size_t bytes_used = arena.BytesUsed();
+  if (!arena_phase_bytes.empty()) {
+    arena_phase_bytes.back().second = bytes_used - arena_phase_start;
+  }
+  if (label != NULL) {
+    arena_phase_bytes.push_back(std::make_pair(label, static_cast<size_t>(0)));
+  }
+  arena_phase_start = bytes_used;
+}
+
 void CompilationUnit::EndTiming() {
   if (enable_debug & (1 << kDebugTimings)) {
     timings.EndSplit();
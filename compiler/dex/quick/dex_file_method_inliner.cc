@@ -40,6 +40,13 @@ const char* const DexFileMethodInliner::kClassCacheNames[] = {
     "F",                       // kClassCacheFloat
     "D",                       // kClassCacheDouble
     "V",                       // kClassCacheVoid
+    "[B",                      // kClassCacheByteArray
+    "[C",                      // kClassCacheCharArray
+    "[S",                      // kClassCacheShortArray
+    "[I",                      // kClassCacheIntArray
+    "[J",                      // kClassCacheLongArray
+    "[F",                      // kClassCacheFloatArray
+    "[D",                      // kClassCacheDoubleArray
     "Ljava/lang/Object;",      // kClassCacheJavaLangObject
     "Ljava/lang/String;",      // kClassCacheJavaLangString
     "Ljava/lang/Double;",      // kClassCacheJavaLangDouble
@@ -78,6 +85,20 @@ const char* const DexFileMethodInliner::kNameCacheNames[] = {
     "pokeIntNative",         // kNameCachePokeIntNative
     "pokeLongNative",        // kNameCachePokeLongNative
     "pokeShortNative",       // kNameCachePokeShortNative
+    "peekByteArray",         // kNameCachePeekByteArray
+    "peekCharArray",         // kNameCachePeekCharArray
+    "peekDoubleArray",       // kNameCachePeekDoubleArray
+    "peekFloatArray",        // kNameCachePeekFloatArray
+    "peekIntArray",          // kNameCachePeekIntArray
+    "peekLongArray",         // kNameCachePeekLongArray
+    "peekShortArray",        // kNameCachePeekShortArray
+    "pokeByteArray",         // kNameCachePokeByteArray
+    "pokeCharArray",         // kNameCachePokeCharArray
+    "pokeDoubleArray",       // kNameCachePokeDoubleArray
+    "pokeFloatArray",        // kNameCachePokeFloatArray
+    "pokeIntArray",          // kNameCachePokeIntArray
+    "pokeLongArray",         // kNameCachePokeLongArray
+    "pokeShortArray",        // kNameCachePokeShortArray
     "compareAndSwapInt",     // kNameCacheCompareAndSwapInt
     "compareAndSwapLong",    // kNameCacheCompareAndSwapLong
     "compareAndSwapObject",  // kNameCacheCompareAndSwapObject
@@ -141,6 +162,27 @@ const DexFileMethodInliner::ProtoDef DexFileMethodInliner::kProtoCacheDefs[] = {
     { kClassCacheVoid, 2, { kClassCacheLong, kClassCacheLong } },
     // kProtoCacheJS_V
     { kClassCacheVoid, 2, { kClassCacheLong, kClassCacheShort } },
+    // kProtoCacheJByteArrayII_V
+    { kClassCacheVoid, 4, { kClassCacheLong, kClassCacheByteArray, kClassCacheInt,
+        kClassCacheInt } },
+    // kProtoCacheJCharArrayIIZ_V
+    { kClassCacheVoid, 5, { kClassCacheLong, kClassCacheCharArray, kClassCacheInt,
+        kClassCacheInt, kClassCacheBoolean } },
+    // kProtoCacheJDoubleArrayIIZ_V
+    { kClassCacheVoid, 5, { kClassCacheLong, kClassCacheDoubleArray, kClassCacheInt,
+        kClassCacheInt, kClassCacheBoolean } },
+    // kProtoCacheJFloatArrayIIZ_V
+    { kClassCacheVoid, 5, { kClassCacheLong, kClassCacheFloatArray, kClassCacheInt,
+        kClassCacheInt, kClassCacheBoolean } },
+    // kProtoCacheJIntArrayIIZ_V
+    { kClassCacheVoid, 5, { kClassCacheLong, kClassCacheIntArray, kClassCacheInt,
+        kClassCacheInt, kClassCacheBoolean } },
+    // kProtoCacheJLongArrayIIZ_V
+    { kClassCacheVoid, 5, { kClassCacheLong, kClassCacheLongArray, kClassCacheInt,
+        kClassCacheInt, kClassCacheBoolean } },
+    // kProtoCacheJShortArrayIIZ_V
+    { kClassCacheVoid, 5, { kClassCacheLong, kClassCacheShortArray, kClassCacheInt,
+        kClassCacheInt, kClassCacheBoolean } },
     // kProtoCacheObjectJII_Z
     { kClassCacheBoolean, 4, { kClassCacheJavaLangObject, kClassCacheLong,
         kClassCacheInt, kClassCacheInt } },
@@ -207,6 +249,21 @@ const DexFileMethodInliner::IntrinsicDef DexFileMethodInliner::kIntrinsicMethods
     INTRINSIC(LibcoreIoMemory, PokeLongNative, JJ_V, kIntrinsicPoke, kLong),
     INTRINSIC(LibcoreIoMemory, PokeShortNative, JS_V, kIntrinsicPoke, kSignedHalf),
 
+#define MEMORY_ARRAY(type, code, size) \
+    INTRINSIC(LibcoreIoMemory, Peek ## type ## Array, J ## type ## Array ## code ## _V, \
+              kIntrinsicPeekArray, size), \
+    INTRINSIC(LibcoreIoMemory, Poke ## type ## Array, J ## type ## Array ## code ## _V, \
+              kIntrinsicPokeArray, size)
+
+    MEMORY_ARRAY(Byte, II, kSignedByte),
+    MEMORY_ARRAY(Char, IIZ, kUnsignedHalf),
+    MEMORY_ARRAY(Double, IIZ, kDouble),
+    MEMORY_ARRAY(Float, IIZ, kSingle),
+    MEMORY_ARRAY(Int, IIZ, kWord),
+    MEMORY_ARRAY(Long, IIZ, kLong),
+    MEMORY_ARRAY(Short, IIZ, kSignedHalf),
+#undef MEMORY_ARRAY
+
     INTRINSIC(SunMiscUnsafe, CompareAndSwapInt, ObjectJII_Z, kIntrinsicCas,
               kIntrinsicFlagNone),
     INTRINSIC(SunMiscUnsafe, CompareAndSwapLong, ObjectJJJ_Z, kIntrinsicCas,
@@ -346,6 +403,10 @@ bool DexFileMethodInliner::GenIntrinsic(Mir2Lir* backend, CallInfo* info) {
       return backend->GenInlinedPeek(info, static_cast<OpSize>(intrinsic.data));
     case kIntrinsicPoke:
       return backend->GenInlinedPoke(info, static_cast<OpSize>(intrinsic.data));
+    case kIntrinsicPeekArray:
+      return backend->GenInlinedMemoryArrayCopy(info, static_cast<OpSize>(intrinsic.data), false);
+    case kIntrinsicPokeArray:
+      return backend->GenInlinedMemoryArrayCopy(info, static_cast<OpSize>(intrinsic.data), true);
     case kIntrinsicCas:
       return backend->GenInlinedCas(info, intrinsic.data & kIntrinsicFlagIsLong,
                                     intrinsic.data & kIntrinsicFlagIsObject);
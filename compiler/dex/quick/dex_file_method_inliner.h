@@ -45,6 +45,8 @@ enum InlineMethodOpcode : uint16_t {
   kIntrinsicCurrentThread,
   kIntrinsicPeek,
   kIntrinsicPoke,
+  kIntrinsicPeekArray,
+  kIntrinsicPokeArray,
   kIntrinsicCas,
   kIntrinsicUnsafeGet,
   kIntrinsicUnsafePut,
@@ -183,6 +185,13 @@ class DexFileMethodInliner {
       kClassCacheFloat,
       kClassCacheDouble,
       kClassCacheVoid,
+      kClassCacheByteArray,
+      kClassCacheCharArray,
+      kClassCacheShortArray,
+      kClassCacheIntArray,
+      kClassCacheLongArray,
+      kClassCacheFloatArray,
+      kClassCacheDoubleArray,
       kClassCacheJavaLangObject,
       kClassCacheJavaLangString,
       kClassCacheJavaLangDouble,
@@ -228,6 +237,20 @@ class DexFileMethodInliner {
       kNameCachePokeIntNative,
       kNameCachePokeLongNative,
       kNameCachePokeShortNative,
+      kNameCachePeekByteArray,
+      kNameCachePeekCharArray,
+      kNameCachePeekDoubleArray,
+      kNameCachePeekFloatArray,
+      kNameCachePeekIntArray,
+      kNameCachePeekLongArray,
+      kNameCachePeekShortArray,
+      kNameCachePokeByteArray,
+      kNameCachePokeCharArray,
+      kNameCachePokeDoubleArray,
+      kNameCachePokeFloatArray,
+      kNameCachePokeIntArray,
+      kNameCachePokeLongArray,
+      kNameCachePokeShortArray,
       kNameCacheCompareAndSwapInt,
       kNameCacheCompareAndSwapLong,
       kNameCacheCompareAndSwapObject,
@@ -277,6 +300,13 @@ class DexFileMethodInliner {
       kProtoCacheJI_V,
       kProtoCacheJJ_V,
       kProtoCacheJS_V,
+      kProtoCacheJByteArrayII_V,
+      kProtoCacheJCharArrayIIZ_V,
+      kProtoCacheJDoubleArrayIIZ_V,
+      kProtoCacheJFloatArrayIIZ_V,
+      kProtoCacheJIntArrayIIZ_V,
+      kProtoCacheJLongArrayIIZ_V,
+      kProtoCacheJShortArrayIIZ_V,
       kProtoCacheObjectJII_Z,
       kProtoCacheObjectJJJ_Z,
       kProtoCacheObjectJObjectObject_Z,
@@ -1157,6 +1157,96 @@ bool Mir2Lir::GenInlinedStringCompareTo(CallInfo* info) {
   return true;
 }
 
+/*
+ * Fast libcore.io.Memory.peek<Type>Array/poke<Type>Array. The bounds of the whole transfer
+ * are checked once up front and the copy itself is done out of line by memcpy, or by the
+ * byte-swapping copy for the variants with a swap flag. A null array or an out of range
+ * request retries the real native method, which throws the appropriate exception.
+ */
+bool Mir2Lir::GenInlinedMemoryArrayCopy(CallInfo* info, OpSize size, bool is_poke) {
+  if (cu_->instruction_set == kMips) {
+    // TODO - add Mips implementation
+    return false;
+  }
+  int shift;
+  switch (size) {
+    case kSignedByte:
+      shift = 0;
+      break;
+    case kSignedHalf:
+    case kUnsignedHalf:
+      shift = 1;
+      break;
+    case kWord:
+    case kSingle:
+      shift = 2;
+      break;
+    default:
+      DCHECK(size == kLong || size == kDouble);
+      shift = 3;
+      break;
+  }
+  // Only peekByteArray/pokeByteArray come without a swap flag.
+  bool has_swap = (size != kSignedByte);
+  ThreadOffset helper = has_swap ? QUICK_ENTRYPOINT_OFFSET(pMemcpySwapped) :
+      QUICK_ENTRYPOINT_OFFSET(pMemcpy);
+
+  ClobberCallerSave();
+  LockCallTemps();  // Using fixed registers
+  // The helpers take (dst, src, byte_count[, swap_size]) and the array is the destination of
+  // a peek and the source of a poke.
+  int reg_array = is_poke ? TargetReg(kArg1) : TargetReg(kArg0);
+  int reg_address = is_poke ? TargetReg(kArg0) : TargetReg(kArg1);
+  int reg_offset = TargetReg(kArg2);
+  int reg_count = TargetReg(kArg3);
+
+  RegLocation rl_address = info->args[0];  // long address
+  rl_address.wide = 0;  // ignore high half in info->args[1]
+  RegLocation rl_array = info->args[2];
+  RegLocation rl_offset = info->args[3];
+  RegLocation rl_count = info->args[4];
+  LoadValueDirectFixed(rl_array, reg_array);
+  LoadValueDirectFixed(rl_offset, reg_offset);
+  LoadValueDirectFixed(rl_count, reg_count);
+  LIR* launch_pad = RawLIR(0, kPseudoIntrinsicRetry, WrapPointer(info));
+  intrinsic_launchpads_.Insert(launch_pad);
+  OpCmpImmBranch(kCondEq, reg_array, 0, launch_pad);
+  // Check offset <= length and count <= length - offset. The unsigned compares also send
+  // negative offsets and counts to the slow path. reg_address is free until the call.
+  LoadWordDisp(reg_array, mirror::Array::LengthOffset().Int32Value(), reg_address);
+  OpCmpBranch(kCondHi, reg_offset, reg_address, launch_pad);
+  OpRegReg(kOpSub, reg_address, reg_offset);
+  OpCmpBranch(kCondHi, reg_count, reg_address, launch_pad);
+  // Scale the element offset and count to bytes, then form the pointer to the first element.
+  if (shift != 0) {
+    OpRegRegImm(kOpLsl, reg_offset, reg_offset, shift);
+    OpRegRegImm(kOpLsl, reg_count, reg_count, shift);
+  }
+  OpRegReg(kOpAdd, reg_array, reg_offset);
+  OpRegImm(kOpAdd, reg_array, mirror::Array::DataOffset(1 << shift).Int32Value());
+  OpRegCopy(reg_offset, reg_count);
+  if (has_swap) {
+    // The swap flag is a boolean, so the shifted flag is either 0 or the element size.
+    LoadValueDirectFixed(info->args[5], reg_count);
+    if (shift != 0) {
+      OpRegRegImm(kOpLsl, reg_count, reg_count, shift);
+    }
+  }
+  LoadValueDirectFixed(rl_address, reg_address);
+  // NOTE: not a safepoint
+  if (cu_->instruction_set != kX86) {
+    int r_tgt = LoadHelper(helper);
+    OpReg(kOpBlx, r_tgt);
+  } else {
+    OpThreadMem(kOpBlx, helper);
+  }
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  launch_pad->operands[2] = WrapPointer(resume_tgt);
+  // Record that we've already inlined & null checked
+  info->opt_flags |= (MIR_INLINED | MIR_IGNORE_NULL_CHECK);
+  return true;
+}
+
 bool Mir2Lir::GenInlinedCurrentThread(CallInfo* info) {
   RegLocation rl_dest = InlineTarget(info);
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
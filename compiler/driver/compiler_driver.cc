@@ -19,6 +19,8 @@
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 #include <unistd.h>
 
@@ -28,11 +30,15 @@
 #include "dex_compilation_unit.h"
 #include "dex_file-inl.h"
 #include "dex/verified_methods_data.h"
+#include "input_oat_file.h"
+#include "memory_budget.h"
 #include "jni_internal.h"
 #include "object_utils.h"
 #include "runtime.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap.h"
+#include "gc/heap.h"
+#include "gc/space/image_space.h"
 #include "gc/space/space.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
@@ -508,13 +514,43 @@ const std::vector<uint8_t>* CompilerDriver::CreateQuickToInterpreterBridge() con
 
 void CompilerDriver::CompileAll(jobject class_loader,
                                 const std::vector<const DexFile*>& dex_files,
-                                TimingLogger& timings) {
+                                TimingLogger& timings,
+                                ThreadPool* thread_pool) {
   DCHECK(!Runtime::Current()->IsStarted());
-  UniquePtr<ThreadPool> thread_pool(new ThreadPool("Compiler driver thread pool", thread_count_ - 1));
-  PreCompile(class_loader, dex_files, *thread_pool.get(), timings);
-  Compile(class_loader, dex_files, *thread_pool.get(), timings);
+  UniquePtr<ThreadPool> own_thread_pool;
+  if (thread_pool == NULL) {
+    own_thread_pool.reset(new ThreadPool("Compiler driver thread pool", thread_count_ - 1));
+    thread_pool = own_thread_pool.get();
+  } else {
+    CHECK_EQ(thread_pool->GetThreadCount(), thread_count_ - 1);
+  }
+  PreCompile(class_loader, dex_files, *thread_pool, timings);
+  if (input_oat_file_.get() != NULL) {
+    TimingLogger::ScopedSplit split("Match input oat file", &timings);
+    // Oat files compiled without a boot image, as in tests, record a checksum of 0.
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    uint32_t image_oat_checksum =
+        heap->GetImageSpaces().empty() ? 0 : heap->GetBootImageChecksum();
+    input_oat_file_->MatchDexFiles(dex_files,
+                                   Runtime::Current()->GetCompileTimeClassPath(class_loader),
+                                   instruction_set_, instruction_set_features_,
+                                   image_oat_checksum);
+  }
+  Compile(class_loader, dex_files, *thread_pool, timings);
+  // Arenas aren't used after compilation, release their memory while the output is written.
+  arena_pool_.Trim();
+  if (input_oat_file_.get() != NULL) {
+    LOG(INFO) << "Reused " << input_oat_file_->GetReusedMethodCount() << " compiled methods from "
+        << input_oat_file_->GetLocation();
+  }
   if (dump_stats_) {
     stats_->Dump();
+    std::ostringstream oss;
+    arena_pool_.DumpMemStats(oss);
+    if (memory_budget_.get() != NULL) {
+      memory_budget_->DumpStats(oss);
+    }
+    LOG(INFO) << oss.str();
   }
 }
 
@@ -595,12 +631,12 @@ void CompilerDriver::CompileOne(const mirror::ArtMethod* method, TimingLogger& t
   self->TransitionFromSuspendedToRunnable();
 }
 
-void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
+void CompilerDriver::Prepare(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                              ThreadPool& thread_pool, TimingLogger& timings) {
   for (size_t i = 0; i != dex_files.size(); ++i) {
     const DexFile* dex_file = dex_files[i];
     CHECK(dex_file != NULL);
-    ResolveDexFile(class_loader, *dex_file, thread_pool, timings);
+    PrepareDexFile(class_loader, *dex_file, thread_pool, timings);
   }
 }
 
@@ -608,11 +644,7 @@ void CompilerDriver::PreCompile(jobject class_loader, const std::vector<const De
                                 ThreadPool& thread_pool, TimingLogger& timings) {
   LoadImageClasses(timings);
 
-  Resolve(class_loader, dex_files, thread_pool, timings);
-
-  Verify(class_loader, dex_files, thread_pool, timings);
-
-  InitializeClasses(class_loader, dex_files, thread_pool, timings);
+  Prepare(class_loader, dex_files, thread_pool, timings);
 
   UpdateImageClasses(timings);
 }
@@ -1091,7 +1123,8 @@ void CompilerDriver::GetCodeAndMethodForDirectCall(InvokeType* type, InvokeType
   *direct_code = 0;
   *direct_method = 0;
   bool use_dex_cache = false;
-  const bool compiling_boot = Runtime::Current()->GetHeap()->IsCompilingBoot();
+  // Images extending a loaded boot image compile boot classes too, their code is patched the same.
+  const bool compiling_boot = Runtime::Current()->GetHeap()->IsCompilingBoot() || IsImage();
   if (compiler_backend_ == kPortable) {
     if (sharp_type != kStatic && sharp_type != kDirect) {
       return;
@@ -1349,21 +1382,41 @@ void CompilerDriver::AddMethodPatch(const DexFile* dex_file,
                                                    literal_offset));
 }
 
+// Estimated cost of compiling a method: its number of code units, plus one for the per-method
+// overhead of methods without code.
+static size_t MethodCost(const DexFile::CodeItem* code_item) {
+  return 1 + ((code_item == NULL) ? 0 : code_item->insns_size_in_code_units_);
+}
+
+// Orders by decreasing cost, then by increasing index.
+static bool HigherCost(const std::pair<size_t, size_t>& lhs, const std::pair<size_t, size_t>& rhs) {
+  return (lhs.first != rhs.first) ? (lhs.first > rhs.first) : (lhs.second < rhs.second);
+}
+
 class ParallelCompilationManager {
  public:
   typedef void Callback(const ParallelCompilationManager* manager, size_t index);
 
+  // A range of the methods of a class, by position among its direct and virtual methods.
+  struct MethodRange {
+    size_t class_def_index;
+    size_t begin;
+    size_t end;
+  };
+
   ParallelCompilationManager(ClassLinker* class_linker,
                              jobject class_loader,
                              CompilerDriver* compiler,
                              const DexFile* dex_file,
-                             ThreadPool& thread_pool)
+                             ThreadPool& thread_pool,
+                             TimingLogger& timings)
     : index_(0),
       class_linker_(class_linker),
       class_loader_(class_loader),
       compiler_(compiler),
       dex_file_(dex_file),
-      thread_pool_(&thread_pool) {}
+      thread_pool_(&thread_pool),
+      timings_(&timings) {}
 
   ClassLinker* GetClassLinker() const {
     CHECK(class_linker_ != NULL);
@@ -1384,23 +1437,62 @@ class ParallelCompilationManager {
     return dex_file_;
   }
 
-  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
-    Thread* self = Thread::Current();
-    self->AssertNoPendingException();
-    CHECK_GT(work_units, 0U);
+  const MethodRange& GetMethodRange(size_t index) const {
+    return method_ranges_[index];
+  }
 
-    index_ = begin;
-    for (size_t i = 0; i < work_units; ++i) {
-      thread_pool_->AddTask(self, new ForAllClosure(this, end, callback));
+  // Calls callback for each index in [begin, end) on work_units workers.
+  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
+    order_.clear();
+    Run(begin, end, callback, work_units);
+  }
+
+  // Calls callback for each class def of the dex file, most expensive class first so that the
+  // largest classes don't start last and leave the other workers idle at the end.
+  void ForAllClassDefs(Callback callback, size_t work_units) {
+    const DexFile& dex_file = *GetDexFile();
+    std::vector<std::pair<size_t, size_t> > costs;
+    costs.reserve(dex_file.NumClassDefs());
+    for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+      costs.push_back(std::make_pair(ClassCost(dex_file.GetClassDef(i)), i));
     }
-    thread_pool_->StartWorkers(self);
-
-    // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
-    // thread destructor's called below perform join).
-    CHECK_NE(self->GetState(), kRunnable);
+    std::sort(costs.begin(), costs.end(), HigherCost);
+    order_.clear();
+    order_.reserve(costs.size());
+    for (size_t i = 0; i < costs.size(); ++i) {
+      order_.push_back(costs[i].second);
+    }
+    Run(0, order_.size(), callback, work_units);
+  }
 
-    // Wait for all the worker threads to finish.
-    thread_pool_->Wait(self, true, false);
+  // Calls callback with the index of each MethodRange (see GetMethodRange) covering the methods
+  // of the dex file, most expensive range first. A class costing more than a fair share of one
+  // worker's time is split into several ranges that different workers may compile.
+  void ForAllMethodRanges(Callback callback, size_t work_units) {
+    const DexFile& dex_file = *GetDexFile();
+    size_t total_cost = 0;
+    for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+      total_cost += ClassCost(dex_file.GetClassDef(i));
+    }
+    const size_t max_range_cost =
+        std::max(kMinSplitClassCost, total_cost / (work_units * kRangesPerWorker));
+    // With a single worker, splitting can't shorten the phase.
+    const size_t split_cost =
+        (work_units > 1) ? max_range_cost : std::numeric_limits<size_t>::max();
+    std::vector<std::pair<size_t, size_t> > costs;
+    method_ranges_.clear();
+    for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+      AddMethodRanges(i, split_cost, &costs);
+    }
+    std::sort(costs.begin(), costs.end(), HigherCost);
+    std::vector<MethodRange> sorted_ranges;
+    sorted_ranges.reserve(costs.size());
+    for (size_t i = 0; i < costs.size(); ++i) {
+      sorted_ranges.push_back(method_ranges_[costs[i].second]);
+    }
+    method_ranges_.swap(sorted_ranges);
+    order_.clear();
+    Run(0, method_ranges_.size(), callback, work_units);
   }
 
   size_t NextIndex() {
@@ -1408,22 +1500,31 @@ class ParallelCompilationManager {
   }
 
  private:
+  // Classes cheaper than this are never split.
+  static const size_t kMinSplitClassCost = 1000;
+  // Splitting aims for ranges no larger than 1 / kRangesPerWorker of a worker's fair share.
+  static const size_t kRangesPerWorker = 4;
+
   class ForAllClosure : public Task {
    public:
-    ForAllClosure(ParallelCompilationManager* manager, size_t end, Callback* callback)
+    ForAllClosure(ParallelCompilationManager* manager, size_t end, Callback* callback,
+                  uint64_t* busy_ns)
         : manager_(manager),
           end_(end),
-          callback_(callback) {}
+          callback_(callback),
+          busy_ns_(busy_ns) {}
 
     virtual void Run(Thread* self) {
+      uint64_t start_ns = NanoTime();
       while (true) {
         const size_t index = manager_->NextIndex();
         if (UNLIKELY(index >= end_)) {
           break;
         }
-        callback_(manager_, index);
+        callback_(manager_, manager_->order_.empty() ? index : manager_->order_[index]);
         self->AssertNoPendingException();
       }
+      *busy_ns_ = NanoTime() - start_ns;
     }
 
     virtual void Finalize() {
@@ -1434,14 +1535,84 @@ class ParallelCompilationManager {
     ParallelCompilationManager* const manager_;
     const size_t end_;
     Callback* const callback_;
+    uint64_t* const busy_ns_;
   };
 
+  // Calls callback for [begin, end), mapped through order_ unless it is empty.
+  void Run(size_t begin, size_t end, Callback callback, size_t work_units) {
+    Thread* self = Thread::Current();
+    self->AssertNoPendingException();
+    CHECK_GT(work_units, 0U);
+
+    uint64_t start_ns = NanoTime();
+    std::vector<uint64_t> busy_ns(work_units, 0);
+    index_ = begin;
+    for (size_t i = 0; i < work_units; ++i) {
+      thread_pool_->AddTask(self, new ForAllClosure(this, end, callback, &busy_ns[i]));
+    }
+    thread_pool_->StartWorkers(self);
+
+    // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
+    // thread destructor's called below perform join).
+    CHECK_NE(self->GetState(), kRunnable);
+
+    // Wait for all the worker threads to finish.
+    thread_pool_->Wait(self, true, false);
+    timings_->AddWorkerTimes(NanoTime() - start_ns, busy_ns);
+  }
+
+  size_t ClassCost(const DexFile::ClassDef& class_def) const {
+    const byte* class_data = dex_file_->GetClassData(class_def);
+    if (class_data == NULL) {
+      return 1;
+    }
+    size_t cost = 1;
+    for (ClassDataItemIterator it(*dex_file_, class_data); it.HasNext(); it.Next()) {
+      if (!it.HasNextStaticField() && !it.HasNextInstanceField()) {
+        cost += MethodCost(it.GetMethodCodeItem());
+      }
+    }
+    return cost;
+  }
+
+  // Appends the methods of a class to method_ranges_ as ranges costing at most max_range_cost,
+  // or a single method each if that is more, and their costs and indices to costs.
+  void AddMethodRanges(size_t class_def_index, size_t max_range_cost,
+                       std::vector<std::pair<size_t, size_t> >* costs) {
+    const byte* class_data = dex_file_->GetClassData(dex_file_->GetClassDef(class_def_index));
+    MethodRange range = { class_def_index, 0, 0 };
+    size_t range_cost = 1;
+    if (class_data != NULL) {
+      ClassDataItemIterator it(*dex_file_, class_data);
+      while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+        it.Next();
+      }
+      for (; it.HasNext(); it.Next()) {
+        size_t cost = MethodCost(it.GetMethodCodeItem());
+        if (range.end != range.begin && range_cost + cost > max_range_cost) {
+          costs->push_back(std::make_pair(range_cost, method_ranges_.size()));
+          method_ranges_.push_back(range);
+          range.begin = range.end;
+          range_cost = 0;
+        }
+        range.end++;
+        range_cost += cost;
+      }
+    }
+    costs->push_back(std::make_pair(range_cost, method_ranges_.size()));
+    method_ranges_.push_back(range);
+  }
+
   AtomicInteger index_;
   ClassLinker* const class_linker_;
   const jobject class_loader_;
   CompilerDriver* const compiler_;
   const DexFile* const dex_file_;
   ThreadPool* const thread_pool_;
+  TimingLogger* const timings_;
+  // The order ForAllClassDefs visits class defs in.
+  std::vector<size_t> order_;
+  std::vector<MethodRange> method_ranges_;
 
   DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
 };
@@ -1616,34 +1787,6 @@ static void ResolveType(const ParallelCompilationManager* manager, size_t type_i
   }
 }
 
-void CompilerDriver::ResolveDexFile(jobject class_loader, const DexFile& dex_file,
-                                    ThreadPool& thread_pool, TimingLogger& timings) {
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-
-  // TODO: we could resolve strings here, although the string table is largely filled with class
-  //       and method names.
-
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, thread_pool);
-  if (IsImage()) {
-    // For images we resolve all types, such as array, whereas for applications just those with
-    // classdefs are resolved by ResolveClassFieldsAndMethods.
-    timings.NewSplit("Resolve Types");
-    context.ForAll(0, dex_file.NumTypeIds(), ResolveType, thread_count_);
-  }
-
-  timings.NewSplit("Resolve MethodsAndFields");
-  context.ForAll(0, dex_file.NumClassDefs(), ResolveClassFieldsAndMethods, thread_count_);
-}
-
-void CompilerDriver::Verify(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                            ThreadPool& thread_pool, TimingLogger& timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != NULL);
-    VerifyDexFile(class_loader, *dex_file, thread_pool, timings);
-  }
-}
-
 static void VerifyClass(const ParallelCompilationManager* manager, size_t class_def_index)
     LOCKS_EXCLUDED(Locks::mutator_lock_) {
   ATRACE_CALL();
@@ -1689,14 +1832,6 @@ static void VerifyClass(const ParallelCompilationManager* manager, size_t class_
   soa.Self()->AssertNoPendingException();
 }
 
-void CompilerDriver::VerifyDexFile(jobject class_loader, const DexFile& dex_file,
-                                   ThreadPool& thread_pool, TimingLogger& timings) {
-  timings.NewSplit("Verify Dex File");
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), VerifyClass, thread_count_);
-}
-
 static const char* class_initializer_black_list[] = {
   "Landroid/app/ActivityThread;",  // Calls regex.Pattern.compile -..-> regex.Pattern.compileImpl.
   "Landroid/bluetooth/BluetoothAudioGateway;",  // Calls android.bluetooth.BluetoothAudioGateway.classInitNative().
@@ -2198,9 +2333,32 @@ static void InitializeClass(const ParallelCompilationManager* manager, size_t cl
   soa.Self()->ClearException();
 }
 
-void CompilerDriver::InitializeClasses(jobject jni_class_loader, const DexFile& dex_file,
-                                       ThreadPool& thread_pool, TimingLogger& timings) {
-  timings.NewSplit("InitializeNoClinit");
+// Resolves, verifies and initializes a class. The class linker resolves, verifies and initializes
+// superclasses and interfaces on demand, holding their class locks, so a class doesn't need to
+// wait for the rest of the dex file to reach each phase.
+static void PrepareClass(const ParallelCompilationManager* manager, size_t class_def_index)
+    LOCKS_EXCLUDED(Locks::mutator_lock_) {
+  ResolveClassFieldsAndMethods(manager, class_def_index);
+  VerifyClass(manager, class_def_index);
+  InitializeClass(manager, class_def_index);
+}
+
+void CompilerDriver::PrepareDexFile(jobject class_loader, const DexFile& dex_file,
+                                    ThreadPool& thread_pool, TimingLogger& timings) {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+
+  // TODO: we could resolve strings here, although the string table is largely filled with class
+  //       and method names.
+
+  ParallelCompilationManager context(class_linker, class_loader, this, &dex_file, thread_pool,
+                                     timings);
+  if (IsImage()) {
+    // For images we resolve all types, such as array, whereas for applications just those with
+    // classdefs are resolved by ResolveClassFieldsAndMethods.
+    timings.NewSplit("Resolve Types");
+    context.ForAll(0, dex_file.NumTypeIds(), ResolveType, thread_count_);
+  }
+
 #ifndef NDEBUG
   // Sanity check blacklist descriptors.
   if (IsImage()) {
@@ -2210,19 +2368,9 @@ void CompilerDriver::InitializeClasses(jobject jni_class_loader, const DexFile&
     }
   }
 #endif
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  ParallelCompilationManager context(class_linker, jni_class_loader, this, &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), InitializeClass, thread_count_);
-}
 
-void CompilerDriver::InitializeClasses(jobject class_loader,
-                                       const std::vector<const DexFile*>& dex_files,
-                                       ThreadPool& thread_pool, TimingLogger& timings) {
-  for (size_t i = 0; i != dex_files.size(); ++i) {
-    const DexFile* dex_file = dex_files[i];
-    CHECK(dex_file != NULL);
-    InitializeClasses(class_loader, *dex_file, thread_pool, timings);
-  }
+  timings.NewSplit("Prepare Classes");
+  context.ForAllClassDefs(PrepareClass, thread_count_);
 }
 
 void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
@@ -2234,8 +2382,10 @@ void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFi
   }
 }
 
-void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t class_def_index) {
+void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t range_index) {
   ATRACE_CALL();
+  const ParallelCompilationManager::MethodRange& range = manager->GetMethodRange(range_index);
+  const size_t class_def_index = range.class_def_index;
   jobject jclass_loader = manager->GetClassLoader();
   const DexFile& dex_file = *manager->GetDexFile();
   const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
@@ -2271,9 +2421,11 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
     it.Next();
   }
   CompilerDriver* driver = manager->GetCompiler();
+  // Position of the current method among the class's methods, to pick those within the range.
+  size_t method_pos = 0;
   // Compile direct methods
   int64_t previous_direct_method_idx = -1;
-  while (it.HasNextDirectMethod()) {
+  for (; it.HasNextDirectMethod(); ++method_pos) {
     uint32_t method_idx = it.GetMemberIndex();
     if (method_idx == previous_direct_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
@@ -2282,14 +2434,16 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
       continue;
     }
     previous_direct_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    if (method_pos >= range.begin && method_pos < range.end) {
+      driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
+                            it.GetMethodInvokeType(class_def), class_def_index,
+                            method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    }
     it.Next();
   }
   // Compile virtual methods
   int64_t previous_virtual_method_idx = -1;
-  while (it.HasNextVirtualMethod()) {
+  for (; it.HasNextVirtualMethod(); ++method_pos) {
     uint32_t method_idx = it.GetMemberIndex();
     if (method_idx == previous_virtual_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
@@ -2298,9 +2452,11 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
       continue;
     }
     previous_virtual_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    if (method_pos >= range.begin && method_pos < range.end) {
+      driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
+                            it.GetMethodInvokeType(class_def), class_def_index,
+                            method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    }
     it.Next();
   }
   DCHECK(!it.HasNext());
@@ -2310,8 +2466,8 @@ void CompilerDriver::CompileDexFile(jobject class_loader, const DexFile& dex_fil
                                     ThreadPool& thread_pool, TimingLogger& timings) {
   timings.NewSplit("Compile Dex File");
   ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
-                                     &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CompileClass, thread_count_);
+                                     &dex_file, thread_pool, timings);
+  context.ForAllMethodRanges(CompilerDriver::CompileClass, thread_count_);
 }
 
 void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
@@ -2323,6 +2479,16 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
   uint64_t start_ns = NanoTime();
 
   if ((access_flags & kAccNative) != 0) {
+    // Pick up @FastNative/@CriticalNative the same way the class linker will at runtime.
+    uint32_t optimization_flags = GetNativeMethodOptimizationFlags(dex_file, class_def_idx,
+                                                                   method_idx, access_flags);
+    if (compiler_backend_ == kPortable && (optimization_flags & kAccCriticalNative) != 0) {
+      // The portable JNI compiler only generates regular bridges, which pass a JNIEnv* and jclass.
+      LOG(WARNING) << "Compiling @CriticalNative " << PrettyMethod(method_idx, dex_file)
+                   << " as a regular native method with the portable compiler";
+      optimization_flags &= ~kAccCriticalNative;
+    }
+    access_flags |= optimization_flags;
     compiled_method = (*jni_compiler_)(*this, access_flags, method_idx, dex_file);
     CHECK(compiled_method != NULL);
   } else if ((access_flags & kAccAbstract) != 0) {
@@ -2341,9 +2507,21 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
         LOG(INFO) << "Using SEA IR to compile..." << std::endl;
       }
 #endif
-      // NOTE: if compiler declines to compile this method, it will return NULL.
-      compiled_method = (*compiler)(*this, code_item, access_flags, invoke_type, class_def_idx,
-                                    method_idx, class_loader, dex_file);
+      if (input_oat_file_.get() != NULL) {
+        compiled_method = input_oat_file_->GetCompiledMethod(*this, dex_file, class_def_idx,
+                                                             method_idx, code_item);
+      }
+      if (compiled_method == NULL) {
+        if (memory_budget_.get() != NULL) {
+          memory_budget_->StartCompilation(Thread::Current());
+        }
+        // NOTE: if compiler declines to compile this method, it will return NULL.
+        compiled_method = (*compiler)(*this, code_item, access_flags, invoke_type, class_def_idx,
+                                      method_idx, class_loader, dex_file);
+        if (memory_budget_.get() != NULL) {
+          memory_budget_->FinishCompilation(Thread::Current());
+        }
+      }
     } else if (dex_to_dex_compilation_level != kDontDexToDexCompile) {
       // TODO: add a mode to disable DEX-to-DEX compilation ?
       (*dex_to_dex_compiler_)(*this, code_item, access_flags,
@@ -2427,6 +2605,16 @@ CompiledMethod* CompilerDriver::GetCompiledMethod(MethodReference ref) const {
   return it->second;
 }
 
+void CompilerDriver::SetInputOatFile(InputOatFile* input_oat_file) {
+  CHECK(!image_) << "Boot image code has patches and can't be reused";
+  CHECK_EQ(compiler_backend_, kQuick) << "Only Quick records the size of compiled code";
+  input_oat_file_.reset(input_oat_file);
+}
+
+void CompilerDriver::SetMemoryBudget(size_t budget_bytes) {
+  memory_budget_.reset(new MemoryBudget(budget_bytes, &arena_pool_));
+}
+
 void CompilerDriver::SetBitcodeFileName(std::string const& filename) {
   typedef void (*SetBitcodeFileNameFn)(CompilerDriver&, std::string const&);
 
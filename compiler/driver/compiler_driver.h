@@ -42,6 +42,8 @@ class AOTCompilationStats;
 class ParallelCompilationManager;
 class DexCompilationUnit;
 class DexFileToMethodInlinerMap;
+class InputOatFile;
+class MemoryBudget;
 class OatWriter;
 class TimingLogger;
 class VerifiedMethodsData;
@@ -101,8 +103,11 @@ class CompilerDriver {
 
   ~CompilerDriver();
 
+  // Compiles dex_files using thread_pool, or a pool created for this call if it is NULL. A
+  // caller compiling repeatedly may pass the same pool each time to keep its workers, which must
+  // number thread_count - 1.
   void CompileAll(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                  TimingLogger& timings)
+                  TimingLogger& timings, ThreadPool* thread_pool = NULL)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   // Compile a single Method
@@ -232,6 +237,12 @@ class CompilerDriver {
 
   void SetBitcodeFileName(std::string const& filename);
 
+  // Reuses the code of unchanged methods from input_oat_file, taking ownership of it.
+  void SetInputOatFile(InputOatFile* input_oat_file);
+
+  // Throttles compilation to keep the resident set size of the process below budget_bytes.
+  void SetMemoryBudget(size_t budget_bytes);
+
   bool GetSupportBootImageFixup() const {
     return support_boot_image_fixup_;
   }
@@ -357,27 +368,14 @@ class CompilerDriver {
 
   void LoadImageClasses(TimingLogger& timings);
 
-  // Attempt to resolve all type, methods, fields, and strings
-  // referenced from code in the dex file following PathClassLoader
-  // ordering semantics.
-  void Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
+  // Resolve, verify and initialize the classes of the dex files following PathClassLoader
+  // ordering semantics. Each class goes through all three steps in a single task, rather than
+  // each step being a separate pass over the dex file.
+  void Prepare(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                ThreadPool& thread_pool, TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
-  void ResolveDexFile(jobject class_loader, const DexFile& dex_file,
+  void PrepareDexFile(jobject class_loader, const DexFile& dex_file,
                       ThreadPool& thread_pool, TimingLogger& timings)
-      LOCKS_EXCLUDED(Locks::mutator_lock_);
-
-  void Verify(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-              ThreadPool& thread_pool, TimingLogger& timings);
-  void VerifyDexFile(jobject class_loader, const DexFile& dex_file,
-                     ThreadPool& thread_pool, TimingLogger& timings)
-      LOCKS_EXCLUDED(Locks::mutator_lock_);
-
-  void InitializeClasses(jobject class_loader, const std::vector<const DexFile*>& dex_files,
-                         ThreadPool& thread_pool, TimingLogger& timings)
-      LOCKS_EXCLUDED(Locks::mutator_lock_);
-  void InitializeClasses(jobject class_loader, const DexFile& dex_file,
-                         ThreadPool& thread_pool, TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_, compiled_classes_lock_);
 
   void UpdateImageClasses(TimingLogger& timings)
@@ -396,7 +394,8 @@ class CompilerDriver {
                      DexToDexCompilationLevel dex_to_dex_compilation_level)
       LOCKS_EXCLUDED(compiled_methods_lock_);
 
-  static void CompileClass(const ParallelCompilationManager* context, size_t class_def_index)
+  // Compiles the methods of the ParallelCompilationManager::MethodRange at range_index.
+  static void CompileClass(const ParallelCompilationManager* context, size_t range_index)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   std::vector<const PatchInformation*> code_to_patch_;
@@ -436,6 +435,10 @@ class CompilerDriver {
 
   UniquePtr<AOTCompilationStats> stats_;
 
+  UniquePtr<InputOatFile> input_oat_file_;
+
+  UniquePtr<MemoryBudget> memory_budget_;
+
   bool dump_stats_;
 
   typedef void (*CompilerCallbackFn)(CompilerDriver& driver);
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "input_oat_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/stl_util.h"
+#include "compiled_method.h"
+#include "dex_file-inl.h"
+#include "dex_instruction-inl.h"
+#include "gc_map.h"
+#include "leb128.h"
+#include "oat.h"
+#include "utils.h"
+
+namespace art {
+
+static bool SameString(const DexFile& lhs, uint32_t lhs_idx, const DexFile& rhs, uint32_t rhs_idx) {
+  return strcmp(lhs.StringDataByIdx(lhs_idx), rhs.StringDataByIdx(rhs_idx)) == 0;
+}
+
+static bool SameType(const DexFile& lhs, uint32_t lhs_idx, const DexFile& rhs, uint32_t rhs_idx) {
+  if (lhs_idx == DexFile::kDexNoIndex16 || rhs_idx == DexFile::kDexNoIndex16) {
+    return lhs_idx == rhs_idx;
+  }
+  return strcmp(lhs.StringByTypeIdx(lhs_idx), rhs.StringByTypeIdx(rhs_idx)) == 0;
+}
+
+static bool SameField(const DexFile& lhs, uint32_t lhs_idx, const DexFile& rhs, uint32_t rhs_idx) {
+  const DexFile::FieldId& lhs_id = lhs.GetFieldId(lhs_idx);
+  const DexFile::FieldId& rhs_id = rhs.GetFieldId(rhs_idx);
+  return SameType(lhs, lhs_id.class_idx_, rhs, rhs_id.class_idx_) &&
+      SameType(lhs, lhs_id.type_idx_, rhs, rhs_id.type_idx_) &&
+      SameString(lhs, lhs_id.name_idx_, rhs, rhs_id.name_idx_);
+}
+
+static bool SameMethod(const DexFile& lhs, uint32_t lhs_idx, const DexFile& rhs, uint32_t rhs_idx) {
+  const DexFile::MethodId& lhs_id = lhs.GetMethodId(lhs_idx);
+  const DexFile::MethodId& rhs_id = rhs.GetMethodId(rhs_idx);
+  return SameType(lhs, lhs_id.class_idx_, rhs, rhs_id.class_idx_) &&
+      SameString(lhs, lhs_id.name_idx_, rhs, rhs_id.name_idx_) &&
+      lhs.GetMethodSignature(lhs_id) == rhs.GetMethodSignature(rhs_id);
+}
+
+// Returns true if both dex files declare the same classes, in the same order, with the same
+// superclasses, interfaces, fields and methods.
+static bool SameClassDeclarations(const DexFile& lhs, const DexFile& rhs) {
+  if (lhs.NumClassDefs() != rhs.NumClassDefs()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.NumClassDefs(); ++i) {
+    const DexFile::ClassDef& lhs_def = lhs.GetClassDef(i);
+    const DexFile::ClassDef& rhs_def = rhs.GetClassDef(i);
+    if (!SameType(lhs, lhs_def.class_idx_, rhs, rhs_def.class_idx_) ||
+        lhs_def.access_flags_ != rhs_def.access_flags_ ||
+        !SameType(lhs, lhs_def.superclass_idx_, rhs, rhs_def.superclass_idx_)) {
+      return false;
+    }
+    const DexFile::TypeList* lhs_interfaces = lhs.GetInterfacesList(lhs_def);
+    const DexFile::TypeList* rhs_interfaces = rhs.GetInterfacesList(rhs_def);
+    size_t num_interfaces = (lhs_interfaces == NULL) ? 0 : lhs_interfaces->Size();
+    if (num_interfaces != ((rhs_interfaces == NULL) ? 0 : rhs_interfaces->Size())) {
+      return false;
+    }
+    for (size_t j = 0; j < num_interfaces; ++j) {
+      if (!SameType(lhs, lhs_interfaces->GetTypeItem(j).type_idx_,
+                    rhs, rhs_interfaces->GetTypeItem(j).type_idx_)) {
+        return false;
+      }
+    }
+    const byte* lhs_class_data = lhs.GetClassData(lhs_def);
+    const byte* rhs_class_data = rhs.GetClassData(rhs_def);
+    if (lhs_class_data == NULL || rhs_class_data == NULL) {
+      if (lhs_class_data != rhs_class_data) {
+        return false;
+      }
+      continue;
+    }
+    ClassDataItemIterator lhs_it(lhs, lhs_class_data);
+    ClassDataItemIterator rhs_it(rhs, rhs_class_data);
+    if (lhs_it.NumStaticFields() != rhs_it.NumStaticFields() ||
+        lhs_it.NumInstanceFields() != rhs_it.NumInstanceFields() ||
+        lhs_it.NumDirectMethods() != rhs_it.NumDirectMethods() ||
+        lhs_it.NumVirtualMethods() != rhs_it.NumVirtualMethods()) {
+      return false;
+    }
+    for (; lhs_it.HasNext(); lhs_it.Next(), rhs_it.Next()) {
+      if (lhs_it.GetMemberAccessFlags() != rhs_it.GetMemberAccessFlags()) {
+        return false;
+      }
+      bool is_field = lhs_it.HasNextStaticField() || lhs_it.HasNextInstanceField();
+      if (is_field ? !SameField(lhs, lhs_it.GetMemberIndex(), rhs, rhs_it.GetMemberIndex())
+                   : !SameMethod(lhs, lhs_it.GetMemberIndex(), rhs, rhs_it.GetMemberIndex())) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns true if the code items have the same instructions and catch handlers, and every index
+// in the instructions names the same string, type, field or method in both dex files.
+static bool SameCode(const DexFile& lhs, const DexFile::CodeItem& lhs_code,
+                     const DexFile& rhs, const DexFile::CodeItem& rhs_code) {
+  if (lhs_code.registers_size_ != rhs_code.registers_size_ ||
+      lhs_code.ins_size_ != rhs_code.ins_size_ ||
+      lhs_code.outs_size_ != rhs_code.outs_size_ ||
+      lhs_code.tries_size_ != rhs_code.tries_size_ ||
+      lhs_code.insns_size_in_code_units_ != rhs_code.insns_size_in_code_units_ ||
+      memcmp(lhs_code.insns_, rhs_code.insns_,
+             lhs_code.insns_size_in_code_units_ * sizeof(uint16_t)) != 0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < lhs_code.tries_size_; ++i) {
+    const DexFile::TryItem* lhs_try = DexFile::GetTryItems(lhs_code, i);
+    const DexFile::TryItem* rhs_try = DexFile::GetTryItems(rhs_code, i);
+    if (lhs_try->start_addr_ != rhs_try->start_addr_ ||
+        lhs_try->insn_count_ != rhs_try->insn_count_) {
+      return false;
+    }
+    CatchHandlerIterator lhs_handlers(lhs_code, *lhs_try);
+    CatchHandlerIterator rhs_handlers(rhs_code, *rhs_try);
+    for (; lhs_handlers.HasNext(); lhs_handlers.Next(), rhs_handlers.Next()) {
+      if (!rhs_handlers.HasNext() ||
+          lhs_handlers.GetHandlerAddress() != rhs_handlers.GetHandlerAddress() ||
+          !SameType(lhs, lhs_handlers.GetHandlerTypeIndex(),
+                    rhs, rhs_handlers.GetHandlerTypeIndex())) {
+        return false;
+      }
+    }
+    if (rhs_handlers.HasNext()) {
+      return false;
+    }
+  }
+  // The instructions are identical, so both sides use the same indices.
+  for (uint32_t dex_pc = 0; dex_pc < lhs_code.insns_size_in_code_units_;) {
+    const Instruction* inst = Instruction::At(lhs_code.insns_ + dex_pc);
+    bool same = true;
+    switch (inst->GetVerifyTypeArgumentB()) {
+      case Instruction::kVerifyRegBField:
+        same = SameField(lhs, inst->VRegB(), rhs, inst->VRegB());
+        break;
+      case Instruction::kVerifyRegBMethod:
+        same = SameMethod(lhs, inst->VRegB(), rhs, inst->VRegB());
+        break;
+      case Instruction::kVerifyRegBNewInstance:
+      case Instruction::kVerifyRegBType:
+        same = SameType(lhs, inst->VRegB(), rhs, inst->VRegB());
+        break;
+      case Instruction::kVerifyRegBString:
+        same = SameString(lhs, inst->VRegB(), rhs, inst->VRegB());
+        break;
+      default:
+        break;
+    }
+    switch (inst->GetVerifyTypeArgumentC()) {
+      case Instruction::kVerifyRegCField:
+        same = same && SameField(lhs, inst->VRegC(), rhs, inst->VRegC());
+        break;
+      case Instruction::kVerifyRegCNewArray:
+      case Instruction::kVerifyRegCType:
+        same = same && SameType(lhs, inst->VRegC(), rhs, inst->VRegC());
+        break;
+      default:
+        break;
+    }
+    if (!same) {
+      return false;
+    }
+    dex_pc += inst->SizeInCodeUnits();
+  }
+  return true;
+}
+
+// Returns the position of method_idx among the methods of the class, which indexes its OatClass.
+static size_t ClassMethodIndex(const DexFile& dex_file, const DexFile::ClassDef& class_def,
+                               uint32_t method_idx) {
+  ClassDataItemIterator it(dex_file, dex_file.GetClassData(class_def));
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  size_t class_method_index = 0;
+  for (; it.HasNext(); it.Next(), ++class_method_index) {
+    if (it.GetMemberIndex() == method_idx) {
+      return class_method_index;
+    }
+  }
+  LOG(FATAL) << "Method " << PrettyMethod(method_idx, dex_file) << " not in its class";
+  return 0;
+}
+
+// Returns the code item of the method at class_method_index among the methods of the class.
+static const DexFile::CodeItem* ClassMethodCodeItem(const DexFile& dex_file,
+                                                    const DexFile::ClassDef& class_def,
+                                                    size_t class_method_index) {
+  ClassDataItemIterator it(dex_file, dex_file.GetClassData(class_def));
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  for (size_t i = 0; i < class_method_index; ++i) {
+    it.Next();
+  }
+  CHECK(it.HasNext());
+  return it.GetMethodCodeItem();
+}
+
+static size_t MappingTableSize(const uint8_t* table) {
+  const uint8_t* end = table;
+  uint32_t total_size = DecodeUnsignedLeb128(&end);
+  DecodeUnsignedLeb128(&end);  // pc_to_dex_size.
+  for (uint32_t i = 0; i < total_size; ++i) {
+    DecodeUnsignedLeb128(&end);  // Native PC.
+    DecodeUnsignedLeb128(&end);  // Dex PC.
+  }
+  return end - table;
+}
+
+static size_t VmapTableSize(const uint8_t* table) {
+  const uint8_t* end = table;
+  uint32_t size = DecodeUnsignedLeb128(&end);
+  for (uint32_t i = 0; i < size; ++i) {
+    DecodeUnsignedLeb128(&end);
+  }
+  return end - table;
+}
+
+static std::vector<uint8_t> CopyTable(const uint8_t* table, size_t (*size)(const uint8_t*)) {
+  if (table == NULL) {
+    return std::vector<uint8_t>();
+  }
+  return std::vector<uint8_t>(table, table + size(table));
+}
+
+static size_t NativeGcMapSize(const uint8_t* map) {
+  return NativePcOffsetToReferenceMap(map).SizeInBytes();
+}
+
+InputOatFile::InputOatFile(const OatFile* oat_file)
+    : oat_file_(oat_file), instruction_set_(kNone) {
+}
+
+InputOatFile::~InputOatFile() {
+  STLDeleteElements(&previous_dex_files_);
+}
+
+void InputOatFile::MatchDexFiles(const std::vector<const DexFile*>& dex_files,
+                                 const std::vector<const DexFile*>& class_path,
+                                 InstructionSet instruction_set,
+                                 const InstructionSetFeatures& instruction_set_features,
+                                 uint32_t image_oat_checksum) {
+  const OatHeader& oat_header = oat_file_->GetOatHeader();
+  if (oat_header.GetInstructionSet() != instruction_set ||
+      oat_header.GetInstructionSetFeatures() != instruction_set_features) {
+    LOG(WARNING) << "Not reusing code from " << GetLocation() << ": compiled for "
+        << oat_header.GetInstructionSet();
+    return;
+  }
+  if (oat_header.GetImageFileLocationOatChecksum() != image_oat_checksum) {
+    LOG(WARNING) << "Not reusing code from " << GetLocation()
+        << ": compiled against a different boot image";
+    return;
+  }
+  // The oat file does not record the declarations of class path dex files it does not hold.
+  for (size_t i = 0; i < class_path.size(); ++i) {
+    if (std::find(dex_files.begin(), dex_files.end(), class_path[i]) == dex_files.end()) {
+      LOG(INFO) << "Not reusing code from " << GetLocation() << ": compiled against "
+          << class_path[i]->GetLocation();
+      return;
+    }
+  }
+  if (oat_file_->GetOatDexFiles().size() != dex_files.size()) {
+    LOG(INFO) << "Not reusing code from " << GetLocation() << ": compiled with "
+        << oat_file_->GetOatDexFiles().size() << " dex files instead of " << dex_files.size();
+    return;
+  }
+  SafeMap<const DexFile*, PreviousDexFile> matches;
+  for (size_t i = 0; i < dex_files.size(); ++i) {
+    const DexFile* dex_file = dex_files[i];
+    const OatFile::OatDexFile* oat_dex_file =
+        oat_file_->GetOatDexFile(dex_file->GetLocation().c_str(), NULL, false);
+    if (oat_dex_file == NULL) {
+      LOG(INFO) << "Not reusing code from " << GetLocation() << ": "
+          << dex_file->GetLocation() << " was not compiled into it";
+      return;
+    }
+    std::string error_msg;
+    const DexFile* previous_dex_file = oat_dex_file->OpenDexFile(&error_msg);
+    if (previous_dex_file == NULL) {
+      LOG(WARNING) << "Not reusing code from " << GetLocation() << ": failed to open "
+          << dex_file->GetLocation() << ": " << error_msg;
+      return;
+    }
+    previous_dex_files_.push_back(previous_dex_file);
+    // Code of any dex file may depend on the declarations of the others.
+    if (!SameClassDeclarations(*dex_file, *previous_dex_file)) {
+      VLOG(compiler) << "Class declarations of " << dex_file->GetLocation() << " changed since "
+          << GetLocation() << " was compiled, compiling all methods";
+      return;
+    }
+    PreviousDexFile previous = { oat_dex_file, previous_dex_file };
+    matches.Put(dex_file, previous);
+  }
+  instruction_set_ = instruction_set;
+  matches_ = matches;
+}
+
+CompiledMethod* InputOatFile::GetCompiledMethod(CompilerDriver& driver, const DexFile& dex_file,
+                                                uint16_t class_def_idx, uint32_t method_idx,
+                                                const DexFile::CodeItem* code_item) {
+  SafeMap<const DexFile*, PreviousDexFile>::const_iterator it = matches_.find(&dex_file);
+  if (it == matches_.end() || code_item == NULL) {
+    return NULL;
+  }
+  const DexFile& previous_dex_file = *it->second.dex_file;
+  // The class declarations match, so the class and its methods are at the same positions.
+  size_t class_method_index = ClassMethodIndex(dex_file, dex_file.GetClassDef(class_def_idx),
+                                               method_idx);
+  const DexFile::CodeItem* previous_code_item =
+      ClassMethodCodeItem(previous_dex_file, previous_dex_file.GetClassDef(class_def_idx),
+                          class_method_index);
+  if (previous_code_item == NULL ||
+      !SameCode(dex_file, *code_item, previous_dex_file, *previous_code_item)) {
+    return NULL;
+  }
+  UniquePtr<const OatFile::OatClass> oat_class(it->second.oat_dex_file->GetOatClass(class_def_idx));
+  const OatFile::OatMethod oat_method = oat_class->GetOatMethod(class_method_index);
+  uintptr_t code = reinterpret_cast<uintptr_t>(oat_method.GetCode());
+  if (code == 0) {
+    return NULL;
+  }
+  if (instruction_set_ == kThumb2) {
+    code &= ~0x1;  // Clear the Thumb mode bit.
+  }
+  const uint8_t* code_begin = reinterpret_cast<const uint8_t*>(code);
+  std::vector<uint8_t> code_copy(code_begin, code_begin + oat_method.GetCodeSize());
+  CompiledMethod* compiled_method =
+      new CompiledMethod(driver, instruction_set_, code_copy,
+                         oat_method.GetFrameSizeInBytes(),
+                         oat_method.GetCoreSpillMask(),
+                         oat_method.GetFpSpillMask(),
+                         CopyTable(oat_method.GetMappingTable(), MappingTableSize),
+                         CopyTable(oat_method.GetVmapTable(), VmapTableSize),
+                         CopyTable(oat_method.GetNativeGcMap(), NativeGcMapSize));
+  ++reused_methods_;
+  return compiled_method;
+}
+
+}  // namespace art
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_INPUT_OAT_FILE_H_
+#define ART_COMPILER_DRIVER_INPUT_OAT_FILE_H_
+
+#include <vector>
+
+#include "atomic_integer.h"
+#include "base/macros.h"
+#include "dex_file.h"
+#include "instruction_set.h"
+#include "oat_file.h"
+#include "safe_map.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+class CompiledMethod;
+class CompilerDriver;
+
+// An oat file from an earlier compilation of the dex files being compiled. Methods that did not
+// change since then take their compiled code, mapping table, vmap table and GC map from it
+// instead of being compiled again.
+//
+// A method is unchanged when its code item is identical and every string, type, field and method
+// its instructions refer to has the same name at the same index. Compiled code also depends on
+// field offsets, vtable and IMT indices, finality and verification results, which follow from the
+// declarations of every class it was compiled against: those of the boot image, and of all the
+// dex files on the compile-time class path. The oat file records the checksum of its boot image
+// and holds the other dex files only if they were compiled into it, so methods are only reused if
+// the boot image is the same, every dex file on the class path is compiled again and was compiled
+// into the oat file, and all of them declare their classes, fields and methods exactly as before.
+class InputOatFile {
+ public:
+  // Takes ownership of oat_file.
+  explicit InputOatFile(const OatFile* oat_file);
+  ~InputOatFile();
+
+  // Pairs each of dex_files with its previous version in the oat file if code can be reused, see
+  // above. class_path is the compile-time class path of dex_files, which includes them. Must be
+  // called before GetCompiledMethod.
+  void MatchDexFiles(const std::vector<const DexFile*>& dex_files,
+                     const std::vector<const DexFile*>& class_path,
+                     InstructionSet instruction_set,
+                     const InstructionSetFeatures& instruction_set_features,
+                     uint32_t image_oat_checksum);
+
+  // Returns a copy of the code the oat file holds for the method if the method is unchanged, or
+  // NULL. Thread-safe.
+  CompiledMethod* GetCompiledMethod(CompilerDriver& driver, const DexFile& dex_file,
+                                    uint16_t class_def_idx, uint32_t method_idx,
+                                    const DexFile::CodeItem* code_item);
+
+  size_t GetReusedMethodCount() const {
+    return reused_methods_;
+  }
+
+  const std::string& GetLocation() const {
+    return oat_file_->GetLocation();
+  }
+
+ private:
+  struct PreviousDexFile {
+    const OatFile::OatDexFile* oat_dex_file;
+    const DexFile* dex_file;
+  };
+
+  UniquePtr<const OatFile> oat_file_;
+  InstructionSet instruction_set_;
+  // Dex files opened from oat_file_, owned.
+  std::vector<const DexFile*> previous_dex_files_;
+  SafeMap<const DexFile*, PreviousDexFile> matches_;
+  AtomicInteger reused_methods_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputOatFile);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_INPUT_OAT_FILE_H_
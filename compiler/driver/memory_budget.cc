@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory_budget.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "dex/arena_allocator.h"
+#include "globals.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+MemoryBudget::MemoryBudget(size_t budget_bytes, ArenaPool* arena_pool)
+    : budget_bytes_(budget_bytes),
+      arena_pool_(arena_pool),
+      lock_("Compiler memory budget lock"),
+      cond_("Compiler memory budget condition variable", lock_),
+      running_(0),
+      last_sample_ns_(0),
+      rss_bytes_(0),
+      peak_rss_bytes_(0),
+      throttled_(0) {
+  CHECK_GT(budget_bytes, 0U);
+}
+
+void MemoryBudget::StartCompilation(Thread* self) {
+  bool over_budget;
+  {
+    MutexLock mu(self, lock_);
+    over_budget = IsOverBudget();
+  }
+  if (over_budget) {
+    // Arenas of finished compilations stay in the pool, give their pages back before waiting.
+    // This takes the arena pool lock, so it can't be done while holding lock_.
+    if (arena_pool_->Trim() != 0) {
+      MutexLock mu(self, lock_);
+      last_sample_ns_ = 0;
+    }
+  }
+  MutexLock mu(self, lock_);
+  bool waited = false;
+  while (running_ != 0 && IsOverBudget()) {
+    waited = true;
+    cond_.Wait(self);
+    // A compilation finished, its memory may have been released.
+    last_sample_ns_ = 0;
+  }
+  if (waited) {
+    ++throttled_;
+  }
+  ++running_;
+}
+
+void MemoryBudget::FinishCompilation(Thread* self) {
+  MutexLock mu(self, lock_);
+  CHECK_GT(running_, 0U);
+  --running_;
+  cond_.Broadcast(self);
+}
+
+bool MemoryBudget::IsOverBudget() {
+  if (NanoTime() - last_sample_ns_ >= kSampleIntervalNs) {
+    SampleRss();
+  }
+  return rss_bytes_ >= budget_bytes_;
+}
+
+void MemoryBudget::SampleRss() {
+  last_sample_ns_ = NanoTime();
+  std::string statm;
+  if (!ReadFileToString("/proc/self/statm", &statm)) {
+    // Without a resident set size there is nothing to throttle on.
+    rss_bytes_ = 0;
+    return;
+  }
+  unsigned long size_pages;  // NOLINT(runtime/int) for sscanf.
+  unsigned long resident_pages;  // NOLINT(runtime/int) for sscanf.
+  if (sscanf(statm.c_str(), "%lu %lu", &size_pages, &resident_pages) != 2) {
+    rss_bytes_ = 0;
+    return;
+  }
+  rss_bytes_ = resident_pages * kPageSize;
+  peak_rss_bytes_ = std::max(peak_rss_bytes_, rss_bytes_);
+}
+
+void MemoryBudget::DumpStats(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Memory budget " << PrettySize(budget_bytes_) << ", peak sampled RSS "
+     << PrettySize(peak_rss_bytes_) << ", " << throttled_ << " compilations throttled\n";
+}
+
+}  // namespace art
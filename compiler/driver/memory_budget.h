@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_MEMORY_BUDGET_H_
+#define ART_COMPILER_DRIVER_MEMORY_BUDGET_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArenaPool;
+class Thread;
+
+// Limits the number of methods compiled at once so that the resident set size of the process
+// stays within a budget. While the process is over budget, idle arenas are released and new
+// compilations wait until the ones running have finished, so that compilation continues one
+// method at a time rather than failing.
+class MemoryBudget {
+ public:
+  MemoryBudget(size_t budget_bytes, ArenaPool* arena_pool);
+
+  // Blocks while the process is over budget and other compilations are running.
+  void StartCompilation(Thread* self) LOCKS_EXCLUDED(lock_);
+  void FinishCompilation(Thread* self) LOCKS_EXCLUDED(lock_);
+
+  size_t GetBudget() const {
+    return budget_bytes_;
+  }
+
+  void DumpStats(std::ostream& os) LOCKS_EXCLUDED(lock_);
+
+ private:
+  // Resident set size is sampled at most this often, reading it costs a system call and parsing.
+  static const uint64_t kSampleIntervalNs = 10 * 1000 * 1000;
+
+  bool IsOverBudget() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void SampleRss() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const size_t budget_bytes_;
+  ArenaPool* const arena_pool_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+  // Compilations between StartCompilation and FinishCompilation.
+  size_t running_ GUARDED_BY(lock_);
+  uint64_t last_sample_ns_ GUARDED_BY(lock_);
+  size_t rss_bytes_ GUARDED_BY(lock_);
+  size_t peak_rss_bytes_ GUARDED_BY(lock_);
+  // Compilations that had to wait.
+  size_t throttled_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryBudget);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_MEMORY_BUDGET_H_
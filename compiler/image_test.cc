@@ -24,8 +24,11 @@
 #include "gc/space/image_space.h"
 #include "image.h"
 #include "lock_word.h"
+#include "mirror/class-inl.h"
+#include "mirror/dex_cache.h"
 #include "mirror/object-inl.h"
 #include "signal_catcher.h"
+#include "thread_list.h"
 #include "UniquePtr.h"
 #include "utils.h"
 #include "vector_output_stream.h"
@@ -38,15 +41,13 @@ class ImageTest : public CommonTest {
     ReserveImageSpace();
     CommonTest::SetUp();
   }
-};
 
-TEST_F(ImageTest, WriteRead) {
-  ScratchFile tmp_elf;
-  {
+  // Compiles the boot class path into oat and writes a boot image for it to image.
+  void WriteBootImage(ScratchFile* oat, ScratchFile* image) {
     {
       jobject class_loader = NULL;
       ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-      TimingLogger timings("ImageTest::WriteRead", false, false);
+      TimingLogger timings("ImageTest::WriteBootImage", false, false);
       timings.StartSplit("CompileAll");
 #if defined(ART_USE_PORTABLE_COMPILER)
       // TODO: we disable this for portable so the test executes in a reasonable amount of time.
@@ -65,26 +66,193 @@ TEST_F(ImageTest, WriteRead) {
                                                 !kIsTargetBuild,
                                                 class_linker->GetBootClassPath(),
                                                 oat_writer,
-                                                tmp_elf.GetFile());
+                                                oat->GetFile());
       ASSERT_TRUE(success);
       timings.EndSplit();
     }
-  }
-  // Workound bug that mcld::Linker::emit closes tmp_elf by reopening as tmp_oat.
-  UniquePtr<File> tmp_oat(OS::OpenFileReadWrite(tmp_elf.GetFilename().c_str()));
-  ASSERT_TRUE(tmp_oat.get() != NULL);
+    // Workound bug that mcld::Linker::emit closes tmp_elf by reopening as tmp_oat.
+    UniquePtr<File> tmp_oat(OS::OpenFileReadWrite(oat->GetFilename().c_str()));
+    ASSERT_TRUE(tmp_oat.get() != NULL);
 
-  ScratchFile tmp_image;
-  const uintptr_t requested_image_base = ART_BASE_ADDRESS;
-  {
     ImageWriter writer(*compiler_driver_.get());
-    bool success_image = writer.Write(tmp_image.GetFilename(), requested_image_base,
+    bool success_image = writer.Write(image->GetFilename(), ART_BASE_ADDRESS,
                                       tmp_oat->GetPath(), tmp_oat->GetPath());
     ASSERT_TRUE(success_image);
     bool success_fixup = ElfFixup::Fixup(tmp_oat.get(), writer.GetOatDataBegin());
     ASSERT_TRUE(success_fixup);
   }
 
+  // Replaces the runtime with one that boots from image_filename, returning in the native state.
+  // A compiler runtime gets an application compiler driver, option is passed on if not NULL.
+  void RestartRuntime(const std::string& image_filename, bool compiler, const char* option) {
+    InstructionSet instruction_set = kNone;
+    InstructionSetFeatures instruction_set_features;
+    if (compiler_driver_.get() != NULL) {
+      instruction_set = compiler_driver_->GetInstructionSet();
+      instruction_set_features = compiler_driver_->GetInstructionSetFeatures();
+      instruction_set_ = instruction_set;
+      instruction_set_features_ = instruction_set_features;
+    } else {
+      instruction_set = instruction_set_;
+      instruction_set_features = instruction_set_features_;
+    }
+    // Need to delete the compiler since it has worker threads which are attached to runtime.
+    compiler_driver_.reset();
+
+    // Tear down old runtime before making a new one, clearing out misc state.
+    runtime_.reset();
+    java_lang_dex_file_ = NULL;
+
+    // Remove the reservation of the memory for use to load the image.
+    UnreserveImageSpace();
+
+    Runtime::Options options;
+    std::string image("-Ximage:");
+    image.append(image_filename);
+    options.push_back(std::make_pair(image.c_str(), reinterpret_cast<void*>(NULL)));
+    if (compiler) {
+      // Verification results of the old runtime refer to its dex files.
+      verified_methods_data_.reset(new VerifiedMethodsData);
+      method_inliner_map_.reset(new DexFileToMethodInlinerMap);
+      callbacks_.Reset(verified_methods_data_.get(), method_inliner_map_.get());
+      options.push_back(std::make_pair("compilercallbacks",
+                                       static_cast<CompilerCallbacks*>(&callbacks_)));
+    }
+    if (option != NULL) {
+      options.push_back(std::make_pair(option, reinterpret_cast<void*>(NULL)));
+    }
+
+    if (!Runtime::Create(options, false)) {
+      LOG(FATAL) << "Failed to create runtime";
+      return;
+    }
+    runtime_.reset(Runtime::Current());
+    // Runtime::Create acquired the mutator_lock_ that is normally given away when we
+    // Runtime::Start, give it away now and then switch to a more managable ScopedObjectAccess.
+    Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+    ASSERT_TRUE(runtime_.get() != NULL);
+    class_linker_ = runtime_->GetClassLinker();
+    WellKnownClasses::Init(Thread::Current()->GetJniEnv());
+    if (compiler) {
+      compiler_driver_.reset(new CompilerDriver(verified_methods_data_.get(),
+                                                method_inliner_map_.get(), kQuick,
+                                                instruction_set, instruction_set_features,
+                                                false, NULL, 2, true));
+      compiler_driver_->SetSupportBootImageFixup(false);
+    }
+  }
+
+  // Compiles the dex file of class_loader against the boot image into the oat file at
+  // oat_filename, the way dex2oat compiles an app.
+  void CompileApp(jobject class_loader, const std::string& oat_filename) {
+    TimingLogger timings("ImageTest::CompileApp", false, false);
+    const std::vector<const DexFile*>& dex_files =
+        Runtime::Current()->GetCompileTimeClassPath(class_loader);
+    compiler_driver_->CompileAll(class_loader, dex_files, timings);
+    UniquePtr<File> oat_file(OS::CreateEmptyFile(oat_filename.c_str()));
+    ASSERT_TRUE(oat_file.get() != NULL);
+    ScopedObjectAccess soa(Thread::Current());
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    OatWriter oat_writer(dex_files, heap->GetBootImageChecksum(),
+                         heap->GetBootImageOatDataBegin(),
+                         heap->GetImageSpace()->GetImageFilename(), compiler_driver_.get(),
+                         &timings);
+    ASSERT_TRUE(compiler_driver_->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild, dex_files,
+                                           oat_writer, oat_file.get()));
+  }
+
+  // Returns a new class loader, with dex_file as its compile time class path if it is not NULL.
+  jobject NewClassLoader(const DexFile* dex_file) {
+    ScopedObjectAccess soa(Thread::Current());
+    ScopedLocalRef<jobject> class_loader_local(soa.Env(),
+        soa.Env()->AllocObject(WellKnownClasses::dalvik_system_PathClassLoader));
+    jobject class_loader = soa.Env()->NewGlobalRef(class_loader_local.get());
+    if (dex_file != NULL) {
+      class_linker_->RegisterDexFile(*dex_file);
+      std::vector<const DexFile*> class_path;
+      class_path.push_back(dex_file);
+      Runtime::Current()->SetCompileTimeClassPath(class_loader, class_path);
+    }
+    return class_loader;
+  }
+
+  // Compiles dex_files, which are on the boot class path, for an image.
+  void CompileImageDexFiles(const std::vector<const DexFile*>& dex_files) {
+    TimingLogger timings("ImageTest::CompileImageDexFiles", false, false);
+    for (const DexFile* dex_file : dex_files) {
+      dex_file->EnableWrite();
+    }
+    compiler_driver_->CompileAll(NULL, dex_files, timings);
+  }
+
+  // Writes the compiled code of dex_files to the image oat file at oat_filename.
+  void WriteImageOatFile(const std::vector<const DexFile*>& dex_files,
+                         const std::string& oat_filename) {
+    TimingLogger timings("ImageTest::WriteImageOatFile", false, false);
+    UniquePtr<File> oat_file(OS::CreateEmptyFile(oat_filename.c_str()));
+    ASSERT_TRUE(oat_file.get() != NULL);
+    ScopedObjectAccess soa(Thread::Current());
+    OatWriter oat_writer(dex_files, 0, 0, "", compiler_driver_.get(), &timings);
+    ASSERT_TRUE(compiler_driver_->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild, dex_files,
+                                           oat_writer, oat_file.get()));
+  }
+
+  // Appends the test dex file name to the boot class path and loads its classes, so that they
+  // are image classes. Returns the dex file.
+  const DexFile* AppendTestDexFileToBootClassPath(const char* name) {
+    ScopedObjectAccess soa(Thread::Current());
+    const DexFile* dex_file = OpenTestDexFile(name);
+    class_linker_->AppendToBootClassPath(*dex_file);
+    for (size_t i = 0; i < dex_file->NumClassDefs(); ++i) {
+      const char* descriptor = dex_file->GetClassDescriptor(dex_file->GetClassDef(i));
+      CHECK(class_linker_->FindSystemClass(descriptor) != NULL) << descriptor;
+    }
+    return dex_file;
+  }
+
+  // Writes the images of a multi-image or boot image extension, and fixes up their oat files.
+  void WriteImages(const std::vector<std::string>& image_filenames, uintptr_t image_begin,
+                   const std::vector<std::string>& oat_filenames) {
+    ImageWriter writer(*compiler_driver_.get());
+    ASSERT_TRUE(writer.Write(image_filenames, image_begin, oat_filenames, oat_filenames));
+    for (size_t i = 0; i < oat_filenames.size(); ++i) {
+      UniquePtr<File> oat_file(OS::OpenFileReadWrite(oat_filenames[i].c_str()));
+      ASSERT_TRUE(oat_file.get() != NULL);
+      ASSERT_TRUE(ElfFixup::Fixup(oat_file.get(), writer.GetOatDataBegin(i)));
+    }
+  }
+
+  static void ReadImageHeader(const std::string& image_filename, ImageHeader* image_header) {
+    UniquePtr<File> file(OS::OpenFileForReading(image_filename.c_str()));
+    ASSERT_TRUE(file.get() != NULL);
+    ASSERT_TRUE(file->ReadFully(image_header, sizeof(*image_header)));
+    ASSERT_TRUE(image_header->IsValid());
+  }
+
+  // Checks that every reference of the heap, including the image spaces, is to a live object.
+  // Called in the native state.
+  static void VerifyHeapReferences() {
+    Thread* self = Thread::Current();
+    ThreadList* thread_list = Runtime::Current()->GetThreadList();
+    thread_list->SuspendAll();
+    {
+      WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+      EXPECT_TRUE(Runtime::Current()->GetHeap()->VerifyHeapReferences());
+    }
+    thread_list->ResumeAll();
+  }
+
+  InstructionSet instruction_set_;
+  InstructionSetFeatures instruction_set_features_;
+};
+
+TEST_F(ImageTest, WriteRead) {
+  ScratchFile tmp_elf;
+  ScratchFile tmp_image;
+  WriteBootImage(&tmp_elf, &tmp_image);
+  ASSERT_FALSE(HasFatalFailure());
+  const uintptr_t requested_image_base = ART_BASE_ADDRESS;
+
   {
     UniquePtr<File> file(OS::OpenFileForReading(tmp_image.GetFilename().c_str()));
     ASSERT_TRUE(file.get() != NULL);
@@ -106,38 +274,15 @@ TEST_F(ImageTest, WriteRead) {
   ASSERT_TRUE(compiler_driver_->GetImageClasses() != NULL);
   CompilerDriver::DescriptorSet image_classes(*compiler_driver_->GetImageClasses());
 
-  // Need to delete the compiler since it has worker threads which are attached to runtime.
-  compiler_driver_.reset();
-
-  // Tear down old runtime before making a new one, clearing out misc state.
-  runtime_.reset();
-  java_lang_dex_file_ = NULL;
-
   std::string error_msg;
   UniquePtr<const DexFile> dex(DexFile::Open(GetLibCoreDexFileName().c_str(),
                                              GetLibCoreDexFileName().c_str(),
                                              &error_msg));
   ASSERT_TRUE(dex.get() != nullptr) << error_msg;
 
-  // Remove the reservation of the memory for use to load the image.
-  UnreserveImageSpace();
-
-  Runtime::Options options;
-  std::string image("-Ximage:");
-  image.append(tmp_image.GetFilename());
-  options.push_back(std::make_pair(image.c_str(), reinterpret_cast<void*>(NULL)));
-
-  if (!Runtime::Create(options, false)) {
-    LOG(FATAL) << "Failed to create runtime";
-    return;
-  }
-  runtime_.reset(Runtime::Current());
-  // Runtime::Create acquired the mutator_lock_ that is normally given away when we Runtime::Start,
-  // give it away now and then switch to a more managable ScopedObjectAccess.
-  Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  RestartRuntime(tmp_image.GetFilename(), false, NULL);
+  ASSERT_FALSE(HasFatalFailure());
   ScopedObjectAccess soa(Thread::Current());
-  ASSERT_TRUE(runtime_.get() != NULL);
-  class_linker_ = runtime_->GetClassLinker();
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   ASSERT_TRUE(heap->HasImageSpace());
@@ -165,6 +310,258 @@ TEST_F(ImageTest, WriteRead) {
   }
 }
 
+TEST_F(ImageTest, AppImage) {
+  TEST_DISABLED_FOR_PORTABLE();
+  ScratchFile boot_oat;
+  ScratchFile boot_image;
+  WriteBootImage(&boot_oat, &boot_image);
+  ASSERT_FALSE(HasFatalFailure());
+
+  // Write an app image the way dex2oat --app-image-file does, next to the app oat file.
+  std::string oat_filename(android_data_ + "/Interfaces.odex");
+  std::string app_image_filename(android_data_ + "/Interfaces.art");
+  ASSERT_EQ(app_image_filename, gc::space::ImageSpace::GetAppImageLocation(oat_filename));
+  RestartRuntime(boot_image.GetFilename(), true, NULL);
+  ASSERT_FALSE(HasFatalFailure());
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("Interfaces");
+  }
+  CompileApp(class_loader, oat_filename);
+  ASSERT_FALSE(HasFatalFailure());
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  byte* app_image_begin = heap->GetAppImageBegin();
+  {
+    ImageWriter writer(*compiler_driver_.get());
+    ASSERT_TRUE(writer.WriteAppImage(app_image_filename, oat_filename, oat_filename));
+  }
+  uint32_t oat_checksum;
+  {
+    std::string error_msg;
+    UniquePtr<OatFile> oat_file(OatFile::Open(oat_filename, oat_filename, NULL, false,
+                                              &error_msg));
+    ASSERT_TRUE(oat_file.get() != NULL) << error_msg;
+    oat_checksum = oat_file->GetOatHeader().GetChecksum();
+
+    UniquePtr<File> file(OS::OpenFileForReading(app_image_filename.c_str()));
+    ASSERT_TRUE(file.get() != NULL);
+    ImageHeader image_header;
+    ASSERT_TRUE(file->ReadFully(&image_header, sizeof(image_header)));
+    ASSERT_TRUE(image_header.IsValid());
+    EXPECT_TRUE(image_header.IsAppImage());
+    EXPECT_EQ(app_image_begin, image_header.GetImageBegin());
+    EXPECT_EQ(oat_checksum, image_header.GetOatChecksum());
+    EXPECT_EQ(heap->GetBootImageChecksum(), image_header.GetDependencyChecksum());
+
+    // Without -XX:AppImageReservation there is nowhere to map it.
+    EXPECT_TRUE(heap->AddAppImageSpace(app_image_filename, oat_checksum, &error_msg) == NULL);
+    EXPECT_TRUE(heap->GetAppImageSpace() == NULL);
+  }
+
+  RestartRuntime(boot_image.GetFilename(), false, "-XX:AppImageReservation=16m");
+  ASSERT_FALSE(HasFatalFailure());
+  heap = Runtime::Current()->GetHeap();
+  ASSERT_EQ(app_image_begin, heap->GetAppImageBegin());
+  std::string error_msg;
+  const OatFile* oat_file = OatFile::Open(oat_filename, oat_filename, NULL, true, &error_msg);
+  ASSERT_TRUE(oat_file != NULL) << error_msg;
+  oat_file = class_linker_->RegisterOatFile(oat_file);
+  std::string dex_location(GetTestDexFileName("Interfaces"));
+  const OatFile::OatDexFile* oat_dex_file = oat_file->GetOatDexFile(dex_location.c_str(), NULL,
+                                                                    false);
+  ASSERT_TRUE(oat_dex_file != NULL);
+  UniquePtr<const DexFile> dex_file(oat_dex_file->OpenDexFile(&error_msg));
+  ASSERT_TRUE(dex_file.get() != NULL) << error_msg;
+
+  // The image is rejected while one of its classes is loaded with the class loader, before it is
+  // mapped.
+  UniquePtr<const DexFile> other_dex_file(DexFile::Open(dex_location.c_str(),
+                                                        dex_location.c_str(), &error_msg));
+  ASSERT_TRUE(other_dex_file.get() != NULL) << error_msg;
+  jobject other_class_loader = NewClassLoader(other_dex_file.get());
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    SirtRef<mirror::ClassLoader> loader(soa.Self(),
+                                        soa.Decode<mirror::ClassLoader*>(other_class_loader));
+    ASSERT_TRUE(class_linker_->FindClass("LInterfaces$I;", loader) != NULL);
+  }
+  EXPECT_FALSE(class_linker_->InstallAppImage(*dex_file, other_class_loader));
+  EXPECT_TRUE(heap->GetAppImageSpace() == NULL);
+  EXPECT_FALSE(class_linker_->IsDexFileRegistered(*dex_file));
+
+  // With a new class loader, the classes come from the image, linked against the oat file.
+  class_loader = NewClassLoader(NULL);
+  ASSERT_TRUE(class_linker_->InstallAppImage(*dex_file, class_loader));
+  gc::space::ImageSpace* app_image_space = heap->GetAppImageSpace();
+  ASSERT_TRUE(app_image_space != NULL);
+  EXPECT_EQ(app_image_begin, app_image_space->Begin());
+  EXPECT_TRUE(class_linker_->IsDexFileRegistered(*dex_file));
+  // Installing again is a no-op, and there is one app image per process.
+  EXPECT_TRUE(class_linker_->InstallAppImage(*dex_file, class_loader));
+  EXPECT_TRUE(heap->AddAppImageSpace(app_image_filename, oat_checksum, &error_msg) == NULL);
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    mirror::ClassLoader* loader = soa.Decode<mirror::ClassLoader*>(class_loader);
+    mirror::DexCache* dex_cache = class_linker_->FindDexCache(*dex_file);
+    EXPECT_TRUE(app_image_space->Contains(dex_cache));
+    const char* descriptors[] = {
+      "LInterfaces;", "LInterfaces$I;", "LInterfaces$J;", "LInterfaces$K;", "LInterfaces$A;",
+      "LInterfaces$B;",
+    };
+    for (size_t i = 0; i < arraysize(descriptors); ++i) {
+      mirror::Class* klass = class_linker_->LookupClass(descriptors[i], loader);
+      ASSERT_TRUE(klass != NULL) << descriptors[i];
+      EXPECT_TRUE(app_image_space->Contains(klass)) << descriptors[i];
+      EXPECT_EQ(loader, klass->GetClassLoader()) << descriptors[i];
+      EXPECT_TRUE(klass->IsResolved()) << descriptors[i];
+      EXPECT_EQ(dex_cache, klass->GetDexCache()) << descriptors[i];
+      EXPECT_EQ(klass, dex_cache->GetResolvedType(klass->GetDexTypeIndex())) << descriptors[i];
+      for (size_t j = 0; j < klass->NumVirtualMethods(); ++j) {
+        EXPECT_TRUE(klass->GetVirtualMethod(j)->GetEntryPointFromCompiledCode() != NULL);
+      }
+    }
+    // B implements K, which extends J.
+    mirror::Class* b = class_linker_->LookupClass("LInterfaces$B;", loader);
+    mirror::Class* j = class_linker_->LookupClass("LInterfaces$J;", loader);
+    ASSERT_TRUE(b != NULL);
+    EXPECT_TRUE(b->Implements(j));
+  }
+
+  EXPECT_EQ(0, unlink(oat_filename.c_str()));
+  EXPECT_EQ(0, unlink(app_image_filename.c_str()));
+}
+
+TEST_F(ImageTest, MultiImage) {
+  TEST_DISABLED_FOR_PORTABLE();
+  std::vector<const DexFile*> core_dex_files(class_linker_->GetBootClassPath());
+  std::vector<const DexFile*> interfaces_dex_files;
+  interfaces_dex_files.push_back(AppendTestDexFileToBootClassPath("Interfaces"));
+
+  // One image per dex file, Interfaces last as it only depends on core.
+  ScratchFile core_image;
+  ScratchFile interfaces_image;
+  std::vector<std::string> image_filenames;
+  image_filenames.push_back(core_image.GetFilename());
+  image_filenames.push_back(interfaces_image.GetFilename());
+  std::vector<std::string> oat_filenames;
+  oat_filenames.push_back(android_data_ + "/core.oat");
+  oat_filenames.push_back(android_data_ + "/core-Interfaces.oat");
+  CompileImageDexFiles(class_linker_->GetBootClassPath());
+  WriteImageOatFile(core_dex_files, oat_filenames[0]);
+  ASSERT_FALSE(HasFatalFailure());
+  WriteImageOatFile(interfaces_dex_files, oat_filenames[1]);
+  ASSERT_FALSE(HasFatalFailure());
+  WriteImages(image_filenames, ART_BASE_ADDRESS, oat_filenames);
+  ASSERT_FALSE(HasFatalFailure());
+
+  // The second image depends on the first, and follows it and its oat file.
+  ImageHeader core_header;
+  ReadImageHeader(image_filenames[0], &core_header);
+  ASSERT_FALSE(HasFatalFailure());
+  ImageHeader interfaces_header;
+  ReadImageHeader(image_filenames[1], &interfaces_header);
+  ASSERT_FALSE(HasFatalFailure());
+  EXPECT_EQ(reinterpret_cast<byte*>(ART_BASE_ADDRESS), core_header.GetImageBegin());
+  EXPECT_EQ(0U, core_header.GetDependencyChecksum());
+  EXPECT_EQ(core_header.GetChainChecksum(), interfaces_header.GetDependencyChecksum());
+  EXPECT_LE(core_header.GetOatFileEnd(), interfaces_header.GetImageBegin());
+
+  // Both images map, and the classes come from the image of their dex file.
+  RestartRuntime(image_filenames[0] + ":" + image_filenames[1], false, NULL);
+  ASSERT_FALSE(HasFatalFailure());
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    const std::vector<gc::space::ImageSpace*>& image_spaces =
+        Runtime::Current()->GetHeap()->GetImageSpaces();
+    ASSERT_EQ(2U, image_spaces.size());
+    mirror::Class* object_class = class_linker_->FindSystemClass("Ljava/lang/Object;");
+    ASSERT_TRUE(object_class != NULL);
+    EXPECT_TRUE(image_spaces[0]->Contains(object_class));
+    mirror::Class* klass = class_linker_->FindSystemClass("LInterfaces$A;");
+    ASSERT_TRUE(klass != NULL);
+    EXPECT_TRUE(image_spaces[1]->Contains(klass));
+    EXPECT_TRUE(image_spaces[1]->Contains(klass->GetDexCache()));
+    EXPECT_EQ(object_class, klass->GetSuperClass());
+  }
+  VerifyHeapReferences();
+
+  // A process that does not need Interfaces maps the core image alone.
+  RestartRuntime(image_filenames[0], false, NULL);
+  ASSERT_FALSE(HasFatalFailure());
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    ASSERT_EQ(1U, Runtime::Current()->GetHeap()->GetImageSpaces().size());
+    EXPECT_TRUE(class_linker_->FindSystemClass("Ljava/lang/Object;") != NULL);
+    EXPECT_TRUE(class_linker_->FindSystemClass("LInterfaces$A;") == NULL);
+    EXPECT_TRUE(soa.Self()->IsExceptionPending());
+    soa.Self()->ClearException();
+  }
+  VerifyHeapReferences();
+
+  for (size_t i = 0; i < oat_filenames.size(); ++i) {
+    EXPECT_EQ(0, unlink(oat_filenames[i].c_str()));
+  }
+}
+
+TEST_F(ImageTest, ExtendBootImage) {
+  TEST_DISABLED_FOR_PORTABLE();
+  ScratchFile boot_oat;
+  ScratchFile boot_image;
+  WriteBootImage(&boot_oat, &boot_image);
+  ASSERT_FALSE(HasFatalFailure());
+
+  // Compile Interfaces for an image against the loaded boot image, the way dex2oat does with
+  // --boot-image and --image.
+  RestartRuntime(boot_image.GetFilename(), true, NULL);
+  ASSERT_FALSE(HasFatalFailure());
+  compiler_driver_.reset(new CompilerDriver(verified_methods_data_.get(),
+                                            method_inliner_map_.get(), kQuick,
+                                            instruction_set_, instruction_set_features_,
+                                            true, new CompilerDriver::DescriptorSet, 2, true));
+  compiler_driver_->SetSupportBootImageFixup(false);
+  std::vector<const DexFile*> dex_files;
+  dex_files.push_back(AppendTestDexFileToBootClassPath("Interfaces"));
+  ScratchFile image;
+  std::vector<std::string> image_filenames(1, image.GetFilename());
+  std::vector<std::string> oat_filenames(1, android_data_ + "/core-Interfaces.oat");
+  CompileImageDexFiles(dex_files);
+  WriteImageOatFile(dex_files, oat_filenames[0]);
+  ASSERT_FALSE(HasFatalFailure());
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  byte* image_begin = heap->GetBootImageEnd();
+  uint32_t boot_image_checksum = heap->GetBootImageChecksum();
+  WriteImages(image_filenames, reinterpret_cast<uintptr_t>(image_begin), oat_filenames);
+  ASSERT_FALSE(HasFatalFailure());
+
+  ImageHeader image_header;
+  ReadImageHeader(image_filenames[0], &image_header);
+  ASSERT_FALSE(HasFatalFailure());
+  EXPECT_EQ(image_begin, image_header.GetImageBegin());
+  EXPECT_EQ(boot_image_checksum, image_header.GetDependencyChecksum());
+
+  // The boot image is mapped as it was written, and the extension after it.
+  RestartRuntime(boot_image.GetFilename() + ":" + image_filenames[0], false, NULL);
+  ASSERT_FALSE(HasFatalFailure());
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    const std::vector<gc::space::ImageSpace*>& image_spaces =
+        Runtime::Current()->GetHeap()->GetImageSpaces();
+    ASSERT_EQ(2U, image_spaces.size());
+    EXPECT_EQ(image_begin, image_spaces[1]->Begin());
+    mirror::Class* object_class = class_linker_->FindSystemClass("Ljava/lang/Object;");
+    ASSERT_TRUE(object_class != NULL);
+    EXPECT_TRUE(image_spaces[0]->Contains(object_class));
+    mirror::Class* klass = class_linker_->FindSystemClass("LInterfaces$B;");
+    ASSERT_TRUE(klass != NULL);
+    EXPECT_TRUE(image_spaces[1]->Contains(klass));
+    EXPECT_EQ(object_class, klass->GetSuperClass());
+  }
+  VerifyHeapReferences();
+
+  EXPECT_EQ(0, unlink(oat_filenames[0].c_str()));
+}
+
 TEST_F(ImageTest, ImageHeaderIsValid) {
     uint32_t image_begin = ART_BASE_ADDRESS;
     uint32_t image_size_ = 16 * KB;
@@ -185,7 +582,8 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
                              oat_file_begin,
                              oat_data_begin,
                              oat_data_end,
-                             oat_file_end);
+                             oat_file_end,
+                             0);
     ASSERT_TRUE(image_header.IsValid());
 
     char* magic = const_cast<char*>(image_header.GetMagic());
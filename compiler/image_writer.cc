@@ -18,6 +18,7 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "base/logging.h"
@@ -31,6 +32,7 @@
 #include "gc/accounting/heap_bitmap.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
+#include "gc/space/image_space.h"
 #include "gc/space/large_object_space.h"
 #include "gc/space/space-inl.h"
 #include "globals.h"
@@ -69,47 +71,91 @@ bool ImageWriter::Write(const std::string& image_filename,
                         uintptr_t image_begin,
                         const std::string& oat_filename,
                         const std::string& oat_location) {
-  CHECK(!image_filename.empty());
+  return Write(std::vector<std::string>(1, image_filename),
+               image_begin,
+               std::vector<std::string>(1, oat_filename),
+               std::vector<std::string>(1, oat_location));
+}
+
+bool ImageWriter::Write(const std::vector<std::string>& image_filenames,
+                        uintptr_t image_begin,
+                        const std::vector<std::string>& oat_filenames,
+                        const std::vector<std::string>& oat_locations) {
+  CHECK(!image_filenames.empty());
+  CHECK_EQ(image_filenames.size(), oat_filenames.size());
+  CHECK_EQ(image_filenames.size(), oat_locations.size());
 
   CHECK_NE(image_begin, 0U);
   image_begin_ = reinterpret_cast<byte*>(image_begin);
 
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  if (heap->HasImageSpace()) {
+    // The images extend the boot image, and follow its last oat file.
+    extend_boot_image_ = true;
+    CHECK_EQ(image_begin_, heap->GetBootImageEnd());
+    SetBootImageRange();
+  }
 
-  UniquePtr<File> oat_file(OS::OpenFileReadWrite(oat_filename.c_str()));
-  if (oat_file.get() == NULL) {
-    LOG(ERROR) << "Failed to open oat file " << oat_filename << " for " << oat_location;
-    return false;
+  images_.resize(image_filenames.size());
+  for (size_t i = 0; i < images_.size(); ++i) {
+    const std::string& oat_filename = oat_filenames[i];
+    const std::string& oat_location = oat_locations[i];
+    UniquePtr<File> oat_file(OS::OpenFileReadWrite(oat_filename.c_str()));
+    if (oat_file.get() == NULL) {
+      LOG(ERROR) << "Failed to open oat file " << oat_filename << " for " << oat_location;
+      return false;
+    }
+    std::string error_msg;
+    OatFile* writable_oat_file = OatFile::OpenWritable(oat_file.get(), oat_location, &error_msg);
+    if (writable_oat_file == nullptr) {
+      LOG(ERROR) << "Failed to open writable oat file " << oat_filename << " for " << oat_location
+          << ": " << error_msg;
+      return false;
+    }
+    CHECK_EQ(class_linker->RegisterOatFile(writable_oat_file), writable_oat_file);
+    images_[i].oat_file = writable_oat_file;
+    ElfWriter::GetOatElfInformation(oat_file.get(), images_[i].oat_loaded_size,
+                                    images_[i].oat_data_offset);
+    CHECK_NE(0U, images_[i].oat_loaded_size);
   }
-  std::string error_msg;
-  oat_file_ = OatFile::OpenWritable(oat_file.get(), oat_location, &error_msg);
-  if (oat_file_ == nullptr) {
-    LOG(ERROR) << "Failed to open writable oat file " << oat_filename << " for " << oat_location
-        << ": " << error_msg;
-    return false;
+
+  if (IsLayered()) {
+    // Each image holds the dex caches of the dex files its oat file was written for, the others
+    // are in the boot image being extended.
+    ScopedObjectAccess soa(Thread::Current());
+    for (size_t i = 0; i < images_.size(); ++i) {
+      for (const OatFile::OatDexFile* oat_dex_file : images_[i].oat_file->GetOatDexFiles()) {
+        for (const DexFile* dex_file : class_linker->GetBootClassPath()) {
+          if (dex_file->GetLocation() == oat_dex_file->GetDexFileLocation()) {
+            dex_cache_images_.Put(class_linker->FindDexCache(*dex_file), i);
+          }
+        }
+      }
+    }
+    for (const DexFile* dex_file : class_linker->GetBootClassPath()) {
+      DexCache* dex_cache = class_linker->FindDexCache(*dex_file);
+      CHECK(IsInBootImage(dex_cache) ||
+            dex_cache_images_.find(dex_cache) != dex_cache_images_.end())
+          << "No image for " << dex_file->GetLocation();
+    }
   }
-  CHECK_EQ(class_linker->RegisterOatFile(oat_file_), oat_file_);
 
-  interpreter_to_interpreter_bridge_offset_ =
-      oat_file_->GetOatHeader().GetInterpreterToInterpreterBridgeOffset();
+  // The stubs are taken from the oat file of the first image.
+  const OatHeader& oat_header = images_[0].oat_file->GetOatHeader();
+  interpreter_to_interpreter_bridge_offset_ = oat_header.GetInterpreterToInterpreterBridgeOffset();
   interpreter_to_compiled_code_bridge_offset_ =
-      oat_file_->GetOatHeader().GetInterpreterToCompiledCodeBridgeOffset();
-
-  jni_dlsym_lookup_offset_ = oat_file_->GetOatHeader().GetJniDlsymLookupOffset();
-
-  portable_imt_conflict_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetPortableImtConflictTrampolineOffset();
-  portable_resolution_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetPortableResolutionTrampolineOffset();
-  portable_to_interpreter_bridge_offset_ =
-      oat_file_->GetOatHeader().GetPortableToInterpreterBridgeOffset();
-
-  quick_imt_conflict_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetQuickImtConflictTrampolineOffset();
-  quick_resolution_trampoline_offset_ =
-      oat_file_->GetOatHeader().GetQuickResolutionTrampolineOffset();
-  quick_to_interpreter_bridge_offset_ =
-      oat_file_->GetOatHeader().GetQuickToInterpreterBridgeOffset();
+      oat_header.GetInterpreterToCompiledCodeBridgeOffset();
+
+  jni_dlsym_lookup_offset_ = oat_header.GetJniDlsymLookupOffset();
+
+  portable_imt_conflict_trampoline_offset_ = oat_header.GetPortableImtConflictTrampolineOffset();
+  portable_resolution_trampoline_offset_ = oat_header.GetPortableResolutionTrampolineOffset();
+  portable_to_interpreter_bridge_offset_ = oat_header.GetPortableToInterpreterBridgeOffset();
+
+  quick_imt_conflict_trampoline_offset_ = oat_header.GetQuickImtConflictTrampolineOffset();
+  quick_resolution_trampoline_offset_ = oat_header.GetQuickResolutionTrampolineOffset();
+  quick_to_interpreter_bridge_offset_ = oat_header.GetQuickToInterpreterBridgeOffset();
   {
     Thread::Current()->TransitionFromSuspendedToRunnable();
     PruneNonImageClasses();  // Remove junk
@@ -117,7 +163,6 @@ bool ImageWriter::Write(const std::string& image_filename,
     ComputeEagerResolvedStrings();
     Thread::Current()->TransitionFromRunnableToSuspended(kNative);
   }
-  gc::Heap* heap = Runtime::Current()->GetHeap();
   heap->CollectGarbage(false);  // Remove garbage.
 
   if (!AllocMemory()) {
@@ -130,44 +175,168 @@ bool ImageWriter::Write(const std::string& image_filename,
   }
 
   Thread::Current()->TransitionFromSuspendedToRunnable();
-  size_t oat_loaded_size = 0;
-  size_t oat_data_offset = 0;
-  ElfWriter::GetOatElfInformation(oat_file.get(), oat_loaded_size, oat_data_offset);
-  CalculateNewObjectOffsets(oat_loaded_size, oat_data_offset);
-  CopyAndFixupObjects();
-  PatchOatCodeAndMethods();
+  std::vector<ObjectArray<Object>*> image_roots;
+  CalculateNewObjectOffsets(&image_roots);
+  if (!layering_failed_) {
+    CopyAndFixupObjects();
+    PatchOatCodeAndMethods();
+  }
   Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  if (layering_failed_) {
+    LOG(ERROR) << "Failed to lay out the images from " << image_filenames[0]
+               << " in layers, reorder the dex files or write a single image";
+    return false;
+  }
+
+  return WriteImageFiles(image_filenames);
+}
 
-  UniquePtr<File> image_file(OS::CreateEmptyFile(image_filename.c_str()));
-  ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin());
-  if (image_file.get() == NULL) {
-    LOG(ERROR) << "Failed to open image file " << image_filename;
+bool ImageWriter::WriteAppImage(const std::string& image_filename,
+                                const std::string& oat_filename,
+                                const std::string& oat_location) {
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  CHECK(heap->HasImageSpace());
+  app_image_ = true;
+  image_begin_ = heap->GetAppImageBegin();
+  SetBootImageRange();
+
+  UniquePtr<File> oat_file(OS::OpenFileReadWrite(oat_filename.c_str()));
+  if (oat_file.get() == NULL) {
+    LOG(ERROR) << "Failed to open oat file " << oat_filename << " for " << oat_location;
+    return false;
+  }
+  std::string error_msg;
+  app_oat_file_.reset(OatFile::OpenWritable(oat_file.get(), oat_location, &error_msg));
+  if (app_oat_file_.get() == nullptr) {
+    LOG(ERROR) << "Failed to open writable oat file " << oat_filename << " for " << oat_location
+        << ": " << error_msg;
     return false;
   }
-  if (fchmod(image_file->Fd(), 0644) != 0) {
-    PLOG(ERROR) << "Failed to make image file world readable: " << image_filename;
-    return EXIT_FAILURE;
+  images_.resize(1);
+  images_[0].oat_file = app_oat_file_.get();
+
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    for (const OatFile::OatDexFile* oat_dex_file : app_oat_file_->GetOatDexFiles()) {
+      for (DexCache* dex_cache : class_linker->GetDexCaches()) {
+        if (dex_cache->GetDexFile()->GetLocation() == oat_dex_file->GetDexFileLocation()) {
+          app_dex_caches_.push_back(dex_cache);
+        }
+      }
+    }
+    CHECK_EQ(app_dex_caches_.size(), 1U) << oat_location;
+    PrepareAppImageClasses();
   }
 
-  // Write out the image.
-  CHECK_EQ(image_end_, image_header->GetImageSize());
-  if (!image_file->WriteFully(image_->Begin(), image_end_)) {
-    PLOG(ERROR) << "Failed to write image file " << image_filename;
+  if (!AllocMemory()) {
     return false;
   }
 
-  // Write out the image bitmap at the page aligned start of the image end.
-  CHECK_ALIGNED(image_header->GetImageBitmapOffset(), kPageSize);
-  if (!image_file->Write(reinterpret_cast<char*>(image_bitmap_->Begin()),
-                         image_header->GetImageBitmapSize(),
-                         image_header->GetImageBitmapOffset())) {
-    PLOG(ERROR) << "Failed to write image file " << image_filename;
+  Thread::Current()->TransitionFromSuspendedToRunnable();
+  std::vector<ObjectArray<Object>*> image_roots;
+  CalculateNewObjectOffsets(&image_roots);
+  if (!app_image_failed_) {
+    CopyAndFixupObjects();
+  }
+  Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  if (app_image_failed_) {
+    LOG(WARNING) << "Failed to lay out app image " << image_filename;
     return false;
   }
 
+  return WriteImageFiles(std::vector<std::string>(1, image_filename));
+}
+
+void ImageWriter::SetBootImageRange() {
+  for (gc::space::ImageSpace* image_space : Runtime::Current()->GetHeap()->GetImageSpaces()) {
+    if (boot_image_begin_ == NULL || image_space->Begin() < boot_image_begin_) {
+      boot_image_begin_ = image_space->Begin();
+    }
+    if (image_space->End() > boot_image_end_) {
+      boot_image_end_ = image_space->End();
+    }
+  }
+}
+
+bool ImageWriter::WriteImageFiles(const std::vector<std::string>& image_filenames) {
+  const size_t heap_bytes_per_bitmap_byte = kBitsPerByte * gc::accounting::SpaceBitmap::kAlignment;
+  for (size_t i = 0; i < images_.size(); ++i) {
+    const std::string& image_filename = image_filenames[i];
+    const ImageInfo& image = images_[i];
+    UniquePtr<File> image_file(OS::CreateEmptyFile(image_filename.c_str()));
+    ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin() +
+                                                               image.image_offset);
+    if (image_file.get() == NULL) {
+      LOG(ERROR) << "Failed to open image file " << image_filename;
+      return false;
+    }
+    if (fchmod(image_file->Fd(), 0644) != 0) {
+      PLOG(ERROR) << "Failed to make image file world readable: " << image_filename;
+      return false;
+    }
+
+    // Write out the image.
+    size_t image_size = image.image_end - image.image_offset;
+    CHECK_EQ(image_size, image_header->GetImageSize());
+    if (!image_file->WriteFully(image_->Begin() + image.image_offset, image_size)) {
+      PLOG(ERROR) << "Failed to write image file " << image_filename;
+      return false;
+    }
+
+    // Write out the image bitmap at the page aligned start of the image end. The image starts on
+    // a page boundary of image_, so its part of the bitmap starts on a byte boundary.
+    CHECK_ALIGNED(image_header->GetImageBitmapOffset(), kPageSize);
+    CHECK_ALIGNED(image.image_offset, kPageSize);
+    const byte* bitmap_begin = reinterpret_cast<const byte*>(image_bitmap_->Begin()) +
+        image.image_offset / heap_bytes_per_bitmap_byte;
+    if (!image_file->Write(reinterpret_cast<const char*>(bitmap_begin),
+                           image_header->GetImageBitmapSize(),
+                           image_header->GetImageBitmapOffset())) {
+      PLOG(ERROR) << "Failed to write image file " << image_filename;
+      return false;
+    }
+  }
+
   return true;
 }
 
+size_t ImageWriter::GetDexCacheImage(const DexCache* dex_cache) const {
+  if (dex_cache_images_.empty()) {
+    return 0;
+  }
+  auto it = dex_cache_images_.find(dex_cache);
+  CHECK(it != dex_cache_images_.end());
+  return it->second;
+}
+
+int ImageWriter::GetOwnerImage(Object* obj) const {
+  if (dex_cache_images_.empty()) {
+    return -1;
+  }
+  // Classes, methods and fields belong with the dex cache of their dex file. Anything else is only
+  // looked up, a dex cache is its own key. Objects of the dex files of the boot image being
+  // extended that are not in it go where they are first reached.
+  const Object* key = obj;
+  if (obj->IsClass()) {
+    Class* klass = obj->AsClass();
+    while (klass->IsArrayClass()) {
+      klass = klass->GetComponentType();
+    }
+    key = klass->GetDexCache();
+  } else if (obj->IsArtMethod()) {
+    Class* declaring_class = obj->AsArtMethod()->GetDeclaringClass();
+    key = (declaring_class != NULL) ? declaring_class->GetDexCache() : NULL;
+  } else if (obj->IsArtField()) {
+    key = obj->AsArtField()->GetDeclaringClass()->GetDexCache();
+  }
+  auto it = dex_cache_images_.find(reinterpret_cast<const DexCache*>(key));
+  if (it == dex_cache_images_.end()) {
+    return -1;
+  }
+  return static_cast<int>(it->second);
+}
+
 void ImageWriter::SetImageOffset(mirror::Object* object, size_t offset) {
   DCHECK(object != nullptr);
   DCHECK_NE(offset, 0U);
@@ -224,6 +393,12 @@ size_t ImageWriter::GetImageOffset(const mirror::Object* object) const {
 
 bool ImageWriter::AllocMemory() {
   size_t length = RoundUp(Runtime::Current()->GetHeap()->GetTotalMemory(), kPageSize);
+  if (images_.size() > 1) {
+    // Each image starts on a page boundary after the oat file of the previous one.
+    for (const ImageInfo& image : images_) {
+      length += kPageSize + RoundUp(image.oat_loaded_size, kPageSize);
+    }
+  }
   std::string error_msg;
   image_.reset(MemMap::MapAnonymous("image writer image", NULL, length, PROT_READ | PROT_WRITE,
                                     &error_msg));
@@ -242,6 +417,81 @@ bool ImageWriter::AllocMemory() {
   return true;
 }
 
+bool ImageWriter::IsAppImageClass(Class* klass, std::set<Class*>* visited) {
+  if (IsBootOrAppImageClass(klass)) {
+    return true;
+  }
+  if (klass->IsArrayClass() || klass->IsProxyClass() ||
+      std::find(app_dex_caches_.begin(), app_dex_caches_.end(), klass->GetDexCache()) ==
+          app_dex_caches_.end()) {
+    return false;
+  }
+  // Classes being verified or initialized at runtime carry state that can't be imaged.
+  Class::Status status = klass->GetStatus();
+  if (status != Class::kStatusResolved && status != Class::kStatusRetryVerificationAtRuntime &&
+      status != Class::kStatusVerified && status != Class::kStatusInitialized) {
+    return false;
+  }
+  if (!visited->insert(klass).second) {
+    return false;  // Circular, the class can't be linked.
+  }
+  // The superclass and interfaces have to be imaged too, their own interfaces are checked when
+  // they are.
+  if (klass->GetSuperClass() != NULL && !IsAppImageClass(klass->GetSuperClass(), visited)) {
+    return false;
+  }
+  ClassHelper kh(klass);
+  for (size_t i = 0; i < kh.NumDirectInterfaces(); ++i) {
+    if (!IsAppImageClass(kh.GetDirectInterface(i), visited)) {
+      return false;
+    }
+  }
+  app_image_classes_.insert(klass);
+  return true;
+}
+
+void ImageWriter::PrepareAppImageClasses() {
+  ArtMethod* resolution_method = Runtime::Current()->GetResolutionMethod();
+  for (DexCache* dex_cache : app_dex_caches_) {
+    const DexFile& dex_file = *dex_cache->GetDexFile();
+    for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+      Class* klass = dex_cache->GetResolvedType(dex_file.GetClassDef(i).class_idx_);
+      if (klass != NULL) {
+        std::set<Class*> visited;
+        IsAppImageClass(klass, &visited);
+      }
+    }
+  }
+  // The loader is the one of the compilation, the runtime one is set on installation.
+  for (Class* klass : app_image_classes_) {
+    klass->SetClassLoader(NULL);
+    klass->ComputeName();
+  }
+  // Leave only the entries that can be imaged in the dex caches, like PruneNonImageClasses.
+  for (DexCache* dex_cache : app_dex_caches_) {
+    for (size_t i = 0; i < dex_cache->NumResolvedTypes(); i++) {
+      Class* klass = dex_cache->GetResolvedType(i);
+      if (klass != NULL && !IsBootOrAppImageClass(klass)) {
+        dex_cache->SetResolvedType(i, NULL);
+        dex_cache->GetInitializedStaticStorage()->Set(i, NULL);
+      }
+    }
+    for (size_t i = 0; i < dex_cache->NumResolvedMethods(); i++) {
+      ArtMethod* method = dex_cache->GetResolvedMethod(i);
+      if (method != NULL && !method->IsRuntimeMethod() &&
+          !IsBootOrAppImageClass(method->GetDeclaringClass())) {
+        dex_cache->SetResolvedMethod(i, resolution_method);
+      }
+    }
+    for (size_t i = 0; i < dex_cache->NumResolvedFields(); i++) {
+      ArtField* field = dex_cache->GetResolvedField(i);
+      if (field != NULL && !IsBootOrAppImageClass(field->GetDeclaringClass())) {
+        dex_cache->SetResolvedField(i, NULL);
+      }
+    }
+  }
+}
+
 void ImageWriter::ComputeLazyFieldsForImageClasses() {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   class_linker->VisitClassesWithoutClassesLock(ComputeLazyFieldsForClassesVisitor, NULL);
@@ -373,8 +623,9 @@ void ImageWriter::DumpImageClasses() {
 
 void ImageWriter::CalculateObjectOffsets(Object* obj) {
   DCHECK(obj != NULL);
-  // if it is a string, we want to intern it if its not interned.
-  if (obj->GetClass()->IsStringClass()) {
+  // if it is a string, we want to intern it if its not interned. App image strings are interned
+  // when the image is installed.
+  if (!app_image_ && obj->GetClass()->IsStringClass()) {
     // we must be an interned string that was forward referenced and already assigned
     if (IsImageOffsetAssigned(obj)) {
       DCHECK_EQ(obj, obj->AsString()->Intern());
@@ -398,17 +649,27 @@ void ImageWriter::CalculateObjectOffsets(Object* obj) {
   AssignImageOffset(obj);
 }
 
-ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
+ObjectArray<Object>* ImageWriter::CreateImageRoots(size_t image_index) const {
   Runtime* runtime = Runtime::Current();
   ClassLinker* class_linker = runtime->GetClassLinker();
   Thread* self = Thread::Current();
   SirtRef<Class> object_array_class(self, class_linker->FindSystemClass("[Ljava/lang/Object;"));
 
-  // build an Object[] of all the DexCaches used in the source_space_
+  // build an Object[] of all the DexCaches of this image used in the source_space_
+  std::vector<DexCache*> image_dex_caches;
+  if (app_image_) {
+    image_dex_caches = app_dex_caches_;
+  } else {
+    for (DexCache* dex_cache : class_linker->GetDexCaches()) {
+      if (!IsInBootImage(dex_cache) && GetDexCacheImage(dex_cache) == image_index) {
+        image_dex_caches.push_back(dex_cache);
+      }
+    }
+  }
   ObjectArray<Object>* dex_caches = ObjectArray<Object>::Alloc(self, object_array_class.get(),
-                                                               class_linker->GetDexCaches().size());
+                                                               image_dex_caches.size());
   int i = 0;
-  for (DexCache* dex_cache : class_linker->GetDexCaches()) {
+  for (DexCache* dex_cache : image_dex_caches) {
     dex_caches->Set(i++, dex_cache);
   }
 
@@ -425,9 +686,31 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   image_roots->Set(ImageHeader::kRefsAndArgsSaveMethod,
                    runtime->GetCalleeSaveMethod(Runtime::kRefsAndArgs));
   image_roots->Set(ImageHeader::kOatLocation,
-                   String::AllocFromModifiedUtf8(self, oat_file_->GetLocation().c_str()));
+                   String::AllocFromModifiedUtf8(
+                       self, images_[image_index].oat_file->GetLocation().c_str()));
   image_roots->Set(ImageHeader::kDexCaches, dex_caches);
-  image_roots->Set(ImageHeader::kClassRoots, class_linker->GetClassRoots());
+  if (app_image_) {
+    // The app classes in class def order, their superclasses come first.
+    std::vector<Class*> classes;
+    for (DexCache* dex_cache : app_dex_caches_) {
+      const DexFile& dex_file = *dex_cache->GetDexFile();
+      for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+        Class* klass = dex_cache->GetResolvedType(dex_file.GetClassDef(i).class_idx_);
+        if (klass != NULL && app_image_classes_.find(klass) != app_image_classes_.end()) {
+          classes.push_back(klass);
+        }
+      }
+    }
+    SirtRef<Class> class_array_class(self, class_linker->FindSystemClass("[Ljava/lang/Class;"));
+    ObjectArray<Class>* class_roots = ObjectArray<Class>::Alloc(self, class_array_class.get(),
+                                                                classes.size());
+    for (size_t i = 0; i < classes.size(); ++i) {
+      class_roots->Set(i, classes[i]);
+    }
+    image_roots->Set(ImageHeader::kClassRoots, class_roots);
+  } else {
+    image_roots->Set(ImageHeader::kClassRoots, class_linker->GetClassRoots());
+  }
   for (int i = 0; i < ImageHeader::kImageRootsMax; i++) {
     CHECK(image_roots->Get(i) != NULL);
   }
@@ -458,6 +741,16 @@ void ImageWriter::WalkInstanceFields(mirror::Object* obj, mirror::Class* klass)
 // For an unvisited object, visit it then all its children found via fields.
 void ImageWriter::WalkFieldsInOrder(mirror::Object* obj) {
   if (!IsImageOffsetAssigned(obj)) {
+    if (app_image_) {
+      if (IsInBootImage(obj)) {
+        return;  // Referenced in place.
+      }
+      if (obj->IsClass() && !IsBootOrAppImageClass(obj->AsClass())) {
+        LOG(WARNING) << "App image reaches " << PrettyClass(obj->AsClass());
+        app_image_failed_ = true;
+        return;
+      }
+    }
     // Walk instance fields of all objects
     Thread* self = Thread::Current();
     SirtRef<mirror::Object> sirt_obj(self, obj);
@@ -496,51 +789,240 @@ void ImageWriter::WalkFieldsCallback(mirror::Object* obj, void* arg) {
   writer->WalkFieldsInOrder(obj);
 }
 
-void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_data_offset) {
-  CHECK_NE(0U, oat_loaded_size);
+void ImageWriter::AssignObjectImages(const std::vector<ObjectArray<Object>*>& image_roots,
+                                     const std::vector<Class*>& classes) {
+  for (size_t i = 0; i < images_.size(); ++i) {
+    // Start with the roots, so they are at the start of the image as for a single image, then
+    // take the classes of the dex files of the image that the roots do not reach.
+    AssignReferenceImage(NULL, i, image_roots[i], false);
+    for (Class* klass : classes) {
+      if (GetOwnerImage(klass) == static_cast<int>(i)) {
+        AssignReferenceImage(NULL, i, klass, false);
+      }
+    }
+  }
+  Runtime::Current()->GetHeap()->VisitObjects(AssignLeftoverObjectImageCallback, this);
+}
+
+void ImageWriter::AssignLeftoverObjectImageCallback(Object* obj, void* arg) {
+  ImageWriter* writer = reinterpret_cast<ImageWriter*>(arg);
+  DCHECK(writer != nullptr);
+  if (writer->IsInBootImage(obj) ||
+      writer->object_images_.find(obj) != writer->object_images_.end() ||
+      writer->interned_strings_.find(obj) != writer->interned_strings_.end()) {
+    return;
+  }
+  int owner_image = writer->GetOwnerImage(obj);
+  writer->AssignObjectImage(obj, (owner_image == -1) ? writer->images_.size() - 1 : owner_image);
+}
+
+void ImageWriter::AssignReferenceImage(Object* obj, size_t image_index, Object* ref,
+                                       bool clearable) {
+  if (ref == NULL) {
+    return;
+  }
+  if (interned_strings_.find(ref) != interned_strings_.end()) {
+    ref = const_cast<Object*>(interned_strings_.Get(ref));
+  }
+  if (IsInBootImage(ref)) {
+    return;  // Referenced in place.
+  }
+  size_t ref_image;
+  auto it = object_images_.find(ref);
+  if (it != object_images_.end()) {
+    ref_image = it->second;
+  } else {
+    int owner_image = GetOwnerImage(ref);
+    ref_image = (owner_image == -1) ? image_index : owner_image;
+    if (ref_image <= image_index) {
+      AssignObjectImage(ref, ref_image);
+      return;
+    }
+  }
+  if (ref_image > image_index && !clearable) {
+    LOG(ERROR) << "Image " << image_index << " object " << PrettyTypeOf(obj)
+               << " references " << PrettyTypeOf(ref) << " of image " << ref_image;
+    if (ref->IsClass()) {
+      LOG(ERROR) << "Referenced class " << PrettyClass(ref->AsClass());
+    }
+    layering_failed_ = true;
+  }
+}
+
+void ImageWriter::AssignObjectImage(Object* obj, size_t image_index) {
+  DCHECK(object_images_.find(obj) == object_images_.end());
+  if (obj->GetClass()->IsStringClass()) {
+    // The string is written as its interned string, wherever that goes.
+    String* interned = obj->AsString()->Intern();
+    if (interned != obj) {
+      interned_strings_.Put(obj, interned);
+      AssignReferenceImage(obj, image_index, interned, false);
+      return;
+    }
+  }
+  object_images_.Put(obj, image_index);
+  images_[image_index].objects.push_back(obj);
+
+  // Instance fields, including those of the superclasses.
+  for (Class* klass = obj->GetClass(); klass != NULL; klass = klass->GetSuperClass()) {
+    for (size_t i = 0; i < klass->NumReferenceInstanceFields(); ++i) {
+      MemberOffset field_offset = klass->GetInstanceField(i)->GetOffset();
+      AssignReferenceImage(obj, image_index, obj->GetFieldObject<Object*>(field_offset, false),
+                           false);
+    }
+  }
+  if (obj->IsClass()) {
+    Class* klass = obj->AsClass();
+    for (size_t i = 0; i < klass->NumReferenceStaticFields(); ++i) {
+      MemberOffset field_offset = klass->GetStaticField(i)->GetOffset();
+      AssignReferenceImage(obj, image_index, obj->GetFieldObject<Object*>(field_offset, false),
+                           false);
+    }
+  } else if (obj->IsObjectArray()) {
+    bool clearable = dex_cache_arrays_.find(obj) != dex_cache_arrays_.end();
+    ObjectArray<Object>* array = obj->AsObjectArray<Object>();
+    for (int32_t i = 0; i < array->GetLength(); ++i) {
+      AssignReferenceImage(obj, image_index, array->Get(i), clearable);
+    }
+  } else if (obj->IsReferenceInstance()) {
+    // The referent is not a reference field, but it is written out.
+    ArtField* field = obj->GetClass()->FindInstanceField("referent", "Ljava/lang/Object;");
+    AssignReferenceImage(obj, image_index, obj->GetFieldObject<Object*>(field->GetOffset(), false),
+                         false);
+  }
+}
+
+bool ImageWriter::CollectClassesVisitor(Class* klass, void* arg) {
+  reinterpret_cast<std::vector<Class*>*>(arg)->push_back(klass);
+  return true;
+}
+
+size_t ImageWriter::GetImageIndex(const Object* object) const {
+  size_t offset = reinterpret_cast<const byte*>(GetImageAddress(object)) - image_begin_;
+  for (size_t i = 0; i < images_.size(); ++i) {
+    if (images_[i].image_offset <= offset && offset < images_[i].image_end) {
+      return i;
+    }
+  }
+  LOG(FATAL) << "No image for " << PrettyTypeOf(object);
+  return 0;
+}
+
+void ImageWriter::CalculateNewObjectOffsets(std::vector<ObjectArray<Object>*>* image_roots) {
   Thread* self = Thread::Current();
-  SirtRef<ObjectArray<Object> > image_roots(self, CreateImageRoots());
+  if (image_roots->size() != images_.size()) {
+    // Keep the roots of this image alive while the roots of the following ones are allocated.
+    SirtRef<ObjectArray<Object> > roots(self, CreateImageRoots(image_roots->size()));
+    image_roots->push_back(roots.get());
+    CalculateNewObjectOffsets(image_roots);
+    return;
+  }
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   DCHECK_EQ(0U, image_end_);
 
-  // Leave space for the header, but do not write it yet, we need to
-  // know where image_roots is going to end up
-  image_end_ += RoundUp(sizeof(ImageHeader), 8);  // 64-bit-alignment
+  std::vector<Class*> classes;
+  if (IsLayered()) {
+    // Entries of the dex caches that resolve to a later image are cleared, unresolved methods
+    // resolve to the resolution method.
+    ArtMethod* resolution_method = Runtime::Current()->GetResolutionMethod();
+    for (const auto& it : dex_cache_images_) {
+      const DexCache* dex_cache = it.first;
+      dex_cache_arrays_.Overwrite(dex_cache->GetStrings(), NULL);
+      dex_cache_arrays_.Overwrite(dex_cache->GetResolvedTypes(), NULL);
+      dex_cache_arrays_.Overwrite(dex_cache->GetResolvedMethods(), resolution_method);
+      dex_cache_arrays_.Overwrite(dex_cache->GetResolvedFields(), NULL);
+      dex_cache_arrays_.Overwrite(dex_cache->GetInitializedStaticStorage(), NULL);
+    }
+    Runtime::Current()->GetClassLinker()->VisitClasses(CollectClassesVisitor, &classes);
+  }
 
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     // TODO: Image spaces only?
     const char* old = self->StartAssertNoThreadSuspension("ImageWriter");
-    DCHECK_LT(image_end_, image_->Size());
-    // Clear any pre-existing monitors which may have been in the monitor words.
-    heap->VisitObjects(WalkFieldsCallback, this);
+    if (IsLayered()) {
+      AssignObjectImages(*image_roots, classes);
+    }
+    for (size_t i = 0; i < images_.size() && !layering_failed_; ++i) {
+      ImageInfo& image = images_[i];
+      image.image_offset = image_end_;
+
+      // Leave space for the header, but do not write it yet, we need to
+      // know where image_roots is going to end up
+      image_end_ += RoundUp(sizeof(ImageHeader), 8);  // 64-bit-alignment
+      DCHECK_LT(image_end_, image_->Size());
+
+      if (IsLayered()) {
+        for (Object* obj : image.objects) {
+          AssignImageOffset(obj);
+        }
+      } else if (app_image_) {
+        // An app image only holds what its roots reach.
+        WalkFieldsInOrder((*image_roots)[i]);
+      } else {
+        // Clear any pre-existing monitors which may have been in the monitor words.
+        heap->VisitObjects(WalkFieldsCallback, this);
+      }
+      image.image_end = image_end_;
+
+      if (i != images_.size() - 1) {
+        // The next image follows the oat file of this one.
+        image_end_ = RoundUp(image_end_, kPageSize) + RoundUp(image.oat_loaded_size, kPageSize);
+      }
+    }
     self->EndAssertNoThreadSuspension(old);
   }
+  if (layering_failed_) {
+    return;
+  }
 
-  const byte* oat_file_begin = image_begin_ + RoundUp(image_end_, kPageSize);
-  const byte* oat_file_end = oat_file_begin + oat_loaded_size;
-  oat_data_begin_ = oat_file_begin + oat_data_offset;
-  const byte* oat_data_end = oat_data_begin_ + oat_file_->Size();
+  for (size_t i = 0; i < images_.size(); ++i) {
+    WriteImageHeader(i, (*image_roots)[i]);
+  }
+
+  // Note that image_end_ is left at end of used space
+}
+
+void ImageWriter::WriteImageHeader(size_t image_index, ObjectArray<Object>* image_roots) {
+  ImageInfo& image = images_[image_index];
+  const byte* oat_file_begin = image_begin_ + RoundUp(image.image_end, kPageSize);
+  const byte* oat_file_end = oat_file_begin + image.oat_loaded_size;
+  image.oat_data_begin = oat_file_begin + image.oat_data_offset;
+  const byte* oat_data_end = image.oat_data_begin + image.oat_file->Size();
 
   // Return to write header at start of image with future location of image_roots. At this point,
-  // image_end_ is the size of the image (excluding bitmaps).
+  // image.image_end is the end of the image (excluding bitmaps).
+  const size_t image_size = image.image_end - image.image_offset;
   const size_t heap_bytes_per_bitmap_byte = kBitsPerByte * gc::accounting::SpaceBitmap::kAlignment;
-  const size_t bitmap_bytes = RoundUp(image_end_, heap_bytes_per_bitmap_byte) /
+  const size_t bitmap_bytes = RoundUp(image_size, heap_bytes_per_bitmap_byte) /
       heap_bytes_per_bitmap_byte;
-  ImageHeader image_header(reinterpret_cast<uint32_t>(image_begin_),
-                           static_cast<uint32_t>(image_end_),
-                           RoundUp(image_end_, kPageSize),
+  if (app_image_) {
+    // The oat file of an app image is mapped anywhere, its code is linked at installation.
+    ImageHeader image_header(reinterpret_cast<uint32_t>(image_begin_ + image.image_offset),
+                             static_cast<uint32_t>(image_size),
+                             RoundUp(image_size, kPageSize),
+                             RoundUp(bitmap_bytes, kPageSize),
+                             reinterpret_cast<uint32_t>(GetImageAddress(image_roots)),
+                             image.oat_file->GetOatHeader().GetChecksum(),
+                             0, 0, 0, 0,
+                             Runtime::Current()->GetHeap()->GetBootImageChecksum());
+    memcpy(image_->Begin() + image.image_offset, &image_header, sizeof(image_header));
+    return;
+  }
+  // The dependency checksum is filled in once the oat files are patched.
+  ImageHeader image_header(reinterpret_cast<uint32_t>(image_begin_ + image.image_offset),
+                           static_cast<uint32_t>(image_size),
+                           RoundUp(image_size, kPageSize),
                            RoundUp(bitmap_bytes, kPageSize),
-                           reinterpret_cast<uint32_t>(GetImageAddress(image_roots.get())),
-                           oat_file_->GetOatHeader().GetChecksum(),
+                           reinterpret_cast<uint32_t>(GetImageAddress(image_roots)),
+                           image.oat_file->GetOatHeader().GetChecksum(),
                            reinterpret_cast<uint32_t>(oat_file_begin),
-                           reinterpret_cast<uint32_t>(oat_data_begin_),
+                           reinterpret_cast<uint32_t>(image.oat_data_begin),
                            reinterpret_cast<uint32_t>(oat_data_end),
-                           reinterpret_cast<uint32_t>(oat_file_end));
-  memcpy(image_->Begin(), &image_header, sizeof(image_header));
-
-  // Note that image_end_ is left at end of used space
+                           reinterpret_cast<uint32_t>(oat_file_end),
+                           0);
+  memcpy(image_->Begin() + image.image_offset, &image_header, sizeof(image_header));
 }
 
 void ImageWriter::CopyAndFixupObjects()
@@ -565,6 +1047,10 @@ void ImageWriter::CopyAndFixupObjectsCallback(Object* obj, void* arg) {
   DCHECK(obj != NULL);
   DCHECK(arg != NULL);
   ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  if ((image_writer->app_image_ || image_writer->IsLayered()) &&
+      !image_writer->IsImageOffsetAssigned(obj)) {
+    return;  // Not part of the images, or written as its interned string.
+  }
   // see GetLocalAddress for similar computation
   size_t offset = image_writer->GetImageOffset(obj);
   byte* dst = image_writer->image_->Begin() + offset;
@@ -603,6 +1089,17 @@ void ImageWriter::FixupClass(const Class* orig, Class* copy) {
 void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
   FixupInstanceFields(orig, copy);
 
+  if (app_image_) {
+    // Linked by the class linker when the app image is installed.
+    copy->SetEntryPointFromCompiledCode(NULL);
+    copy->SetEntryPointFromInterpreter(NULL);
+    copy->SetNativeMethod(NULL);
+    copy->SetMappingTable(NULL);
+    copy->SetVmapTable(NULL);
+    copy->SetNativeGcMap(NULL);
+    return;
+  }
+
   // OatWriter replaces the code_ with an offset value. Here we re-adjust to a pointer relative to
   // oat_begin_
 
@@ -636,7 +1133,8 @@ void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
       (const_cast<byte*>(GetOatAddress(interpreter_to_compiled_code_bridge_offset_))));
       // Use original code if it exists. Otherwise, set the code pointer to the resolution
       // trampoline.
-      const byte* code = GetOatAddress(orig->GetOatCodeOffset());
+      size_t image_index = GetDexCacheImage(orig->GetDeclaringClass()->GetDexCache());
+      const byte* code = GetOatAddress(image_index, orig->GetOatCodeOffset());
       if (code != NULL) {
         copy->SetEntryPointFromCompiledCode(code);
       } else {
@@ -653,15 +1151,15 @@ void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
       } else {
         // Normal (non-abstract non-native) methods have various tables to relocate.
         uint32_t mapping_table_off = orig->GetOatMappingTableOffset();
-        const byte* mapping_table = GetOatAddress(mapping_table_off);
+        const byte* mapping_table = GetOatAddress(image_index, mapping_table_off);
         copy->SetMappingTable(mapping_table);
 
         uint32_t vmap_table_offset = orig->GetOatVmapTableOffset();
-        const byte* vmap_table = GetOatAddress(vmap_table_offset);
+        const byte* vmap_table = GetOatAddress(image_index, vmap_table_offset);
         copy->SetVmapTable(vmap_table);
 
         uint32_t native_gc_map_offset = orig->GetOatNativeGcMapOffset();
-        const byte* native_gc_map = GetOatAddress(native_gc_map_offset);
+        const byte* native_gc_map = GetOatAddress(image_index, native_gc_map_offset);
         copy->SetNativeGcMap(reinterpret_cast<const uint8_t*>(native_gc_map));
       }
     }
@@ -669,6 +1167,19 @@ void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
 }
 
 void ImageWriter::FixupObjectArray(const ObjectArray<Object>* orig, ObjectArray<Object>* copy) {
+  auto it = dex_cache_arrays_.find(orig);
+  if (it != dex_cache_arrays_.end()) {
+    // Clear the entries of a dex cache of a layered image that resolve to a later image.
+    size_t image_index = GetImageIndex(orig);
+    for (int32_t i = 0; i < orig->GetLength(); ++i) {
+      const Object* element = orig->Get(i);
+      if (element != NULL && !IsInBootImage(element) && GetImageIndex(element) > image_index) {
+        element = it->second;
+      }
+      copy->SetPtrWithoutChecks(i, GetImageAddress(element));
+    }
+    return;
+  }
   for (int32_t i = 0; i < orig->GetLength(); ++i) {
     const Object* element = orig->Get(i);
     copy->SetPtrWithoutChecks(i, GetImageAddress(element));
@@ -768,10 +1279,12 @@ void ImageWriter::PatchOatCodeAndMethods() {
   for (size_t i = 0; i < code_to_patch.size(); i++) {
     const CompilerDriver::PatchInformation* patch = code_to_patch[i];
     ArtMethod* target = GetTargetMethod(patch);
+    size_t image_index = GetDexCacheImage(target->GetDeclaringClass()->GetDexCache());
     uint32_t code = reinterpret_cast<uint32_t>(class_linker->GetOatCodeFor(target));
-    uint32_t code_base = reinterpret_cast<uint32_t>(&oat_file_->GetOatHeader());
+    uint32_t code_base =
+        reinterpret_cast<uint32_t>(&images_[image_index].oat_file->GetOatHeader());
     uint32_t code_offset = code - code_base;
-    SetPatchLocation(patch, reinterpret_cast<uint32_t>(GetOatAddress(code_offset)));
+    SetPatchLocation(patch, reinterpret_cast<uint32_t>(GetOatAddress(image_index, code_offset)));
   }
 
   const Patches& methods_to_patch = compiler_driver_.GetMethodsToPatch();
@@ -781,9 +1294,17 @@ void ImageWriter::PatchOatCodeAndMethods() {
     SetPatchLocation(patch, reinterpret_cast<uint32_t>(GetImageAddress(target)));
   }
 
-  // Update the image header with the new checksum after patching
-  ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin());
-  image_header->SetOatChecksum(oat_file_->GetOatHeader().GetChecksum());
+  // Update the image headers with the new checksums after patching. Each image depends on the
+  // one before it, the first one on the boot image it extends.
+  uint32_t dependency_checksum =
+      extend_boot_image_ ? Runtime::Current()->GetHeap()->GetBootImageChecksum() : 0;
+  for (const ImageInfo& image : images_) {
+    ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin() +
+                                                               image.image_offset);
+    image_header->SetOatChecksum(image.oat_file->GetOatHeader().GetChecksum());
+    image_header->SetDependencyChecksum(dependency_checksum);
+    dependency_checksum = image_header->GetChainChecksum();
+  }
   self->EndAssertNoThreadSuspension(old_cause);
 }
 
@@ -792,7 +1313,9 @@ void ImageWriter::SetPatchLocation(const CompilerDriver::PatchInformation* patch
   const void* oat_code = class_linker->GetOatCodeFor(patch->GetDexFile(),
                                                      patch->GetReferrerClassDefIdx(),
                                                      patch->GetReferrerMethodIdx());
-  OatHeader& oat_header = const_cast<OatHeader&>(oat_file_->GetOatHeader());
+  // The patched code is in the oat file of the referrer's dex file.
+  size_t image_index = GetDexCacheImage(class_linker->FindDexCache(patch->GetDexFile()));
+  OatHeader& oat_header = const_cast<OatHeader&>(images_[image_index].oat_file->GetOatHeader());
   // TODO: make this Thumb2 specific
   uint8_t* base = reinterpret_cast<uint8_t*>(reinterpret_cast<uint32_t>(oat_code) & ~0x1);
   uint32_t* patch_location = reinterpret_cast<uint32_t*>(base + patch->GetLiteralOffset());
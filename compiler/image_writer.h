@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "driver/compiler_driver.h"
 #include "mem_map.h"
@@ -38,11 +39,13 @@ namespace art {
 class ImageWriter {
  public:
   explicit ImageWriter(const CompilerDriver& compiler_driver)
-      : compiler_driver_(compiler_driver), oat_file_(NULL), image_end_(0), image_begin_(NULL),
-        oat_data_begin_(NULL), interpreter_to_interpreter_bridge_offset_(0),
+      : compiler_driver_(compiler_driver), image_end_(0), image_begin_(NULL),
+        interpreter_to_interpreter_bridge_offset_(0),
         interpreter_to_compiled_code_bridge_offset_(0), portable_imt_conflict_trampoline_offset_(0),
         portable_resolution_trampoline_offset_(0), quick_imt_conflict_trampoline_offset_(0),
-        quick_resolution_trampoline_offset_(0) {}
+        quick_resolution_trampoline_offset_(0), app_image_(false), app_image_failed_(false),
+        extend_boot_image_(false), layering_failed_(false), boot_image_begin_(NULL),
+        boot_image_end_(NULL) {}
 
   ~ImageWriter() {}
 
@@ -52,13 +55,69 @@ class ImageWriter {
              const std::string& oat_location)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Writes a multi-image boot image: one image per oat file, each oat file holding the code of
+  // its own dex files. The images are laid out from image_begin in order, each followed by its
+  // oat file. The images are layered, an image only references itself and the images before it,
+  // so a runtime can map any prefix of them. Dex cache entries that resolve to a later image are
+  // cleared, any other reference to a later image fails the write.
+  //
+  // If the heap already has image spaces, the images extend that boot image: they are written
+  // for the dex files appended to the boot class path, image_begin must be the end of the boot
+  // image and the objects of the boot image are referenced in place.
+  bool Write(const std::vector<std::string>& image_filenames,
+             uintptr_t image_begin,
+             const std::vector<std::string>& oat_filenames,
+             const std::vector<std::string>& oat_locations)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Writes an app image of the classes of the single dex file compiled into the oat file, laid
+  // out after the boot image of the running heap. Objects of the boot image are referenced in
+  // place. The code of the methods is linked by the class linker when the image is installed.
+  bool WriteAppImage(const std::string& image_filename,
+                     const std::string& oat_filename,
+                     const std::string& oat_location)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   uintptr_t GetOatDataBegin() {
-    return reinterpret_cast<uintptr_t>(oat_data_begin_);
+    return GetOatDataBegin(0);
+  }
+
+  uintptr_t GetOatDataBegin(size_t image_index) {
+    return reinterpret_cast<uintptr_t>(images_[image_index].oat_data_begin);
   }
 
  private:
+  // One image of the boot image and the oat file it links to.
+  struct ImageInfo {
+    ImageInfo()
+        : oat_file(NULL), image_offset(0), image_end(0), oat_loaded_size(0), oat_data_offset(0),
+          oat_data_begin(NULL) {}
+
+    // Objects of a layered image, in layout order.
+    std::vector<mirror::Object*> objects;
+
+    // oat file with code for this image
+    OatFile* oat_file;
+
+    // Offset of the image header in image_, page aligned.
+    size_t image_offset;
+
+    // Offset of the end of the image objects in image_.
+    size_t image_end;
+
+    // Layout of the oat file when loaded.
+    size_t oat_loaded_size;
+    size_t oat_data_offset;
+
+    // Beginning target oat address for the pointers from the output image to its oat file.
+    const byte* oat_data_begin;
+  };
+
   bool AllocMemory();
 
+  // Records the range of the image spaces of the heap, whose objects are referenced in place.
+  void SetBootImageRange();
+
   // Mark the objects defined in this space in the given live bitmap.
   void RecordImageAllocations() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -73,26 +132,58 @@ class ImageWriter {
     if (object == NULL) {
       return NULL;
     }
+    if (IsInBootImage(object)) {
+      return const_cast<mirror::Object*>(object);
+    }
+    if (!interned_strings_.empty() && !IsImageOffsetAssigned(object)) {
+      return GetImageAddress(interned_strings_.Get(object));
+    }
     return reinterpret_cast<mirror::Object*>(image_begin_ + GetImageOffset(object));
   }
 
+  // Index of the image a laid out object of a layered image is in.
+  size_t GetImageIndex(const mirror::Object* object) const;
+
   mirror::Object* GetLocalAddress(const mirror::Object* object) const {
     size_t offset = GetImageOffset(object);
     byte* dst = image_->Begin() + offset;
     return reinterpret_cast<mirror::Object*>(dst);
   }
 
+  // Address of the given offset into the oat file of the first image, which holds the stubs.
   const byte* GetOatAddress(uint32_t offset) const {
+    return GetOatAddress(0, offset);
+  }
+
+  const byte* GetOatAddress(size_t image_index, uint32_t offset) const {
 #if !defined(ART_USE_PORTABLE_COMPILER)
     // With Quick, code is within the OatFile, as there are all in one
     // .o ELF object. However with Portable, the code is always in
     // different .o ELF objects.
-    DCHECK_LT(offset, oat_file_->Size());
+    DCHECK_LT(offset, images_[image_index].oat_file->Size());
 #endif
     if (offset == 0) {
       return NULL;
     }
-    return oat_data_begin_ + offset;
+    return images_[image_index].oat_data_begin + offset;
+  }
+
+  bool IsInBootImage(const mirror::Object* object) const {
+    const byte* address = reinterpret_cast<const byte*>(object);
+    return boot_image_begin_ <= address && address < boot_image_end_;
+  }
+
+  // Index of the image whose oat file holds the code of the given dex cache, 0 for a single image.
+  size_t GetDexCacheImage(const mirror::DexCache* dex_cache) const;
+
+  // Returns the image an object has to be laid out in because of the dex file it comes from, or
+  // -1 for objects that go into the image that first reaches them. Array classes go with their
+  // element class.
+  int GetOwnerImage(mirror::Object* obj) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Whether the images are laid out in layers, see Write.
+  bool IsLayered() const {
+    return !app_image_ && (images_.size() > 1 || extend_boot_image_);
   }
 
   // Returns true if the class was in the original requested image classes list.
@@ -112,6 +203,15 @@ class ImageWriter {
   static void ComputeEagerResolvedStringsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Selects the classes of the app dex caches that can be imaged and clears the entries of the
+  // app dex caches that refer to anything outside of the boot image and those classes.
+  void PrepareAppImageClasses() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool IsAppImageClass(mirror::Class* klass, std::set<mirror::Class*>* visited)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool IsBootOrAppImageClass(mirror::Class* klass) const {
+    return IsInBootImage(klass) || app_image_classes_.find(klass) != app_image_classes_.end();
+  }
+
   // Remove unwanted classes from various roots.
   void PruneNonImageClasses() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static bool NonImageClassesVisitor(mirror::Class* c, void* arg)
@@ -123,9 +223,12 @@ class ImageWriter {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Lays out where the image objects will be at runtime.
-  void CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_data_offset)
+  // Creates the roots of the images after the ones in image_roots, then lays out every image.
+  void CalculateNewObjectOffsets(std::vector<mirror::ObjectArray<mirror::Object>*>* image_roots)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  mirror::ObjectArray<mirror::Object>* CreateImageRoots(size_t image_index) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::ObjectArray<mirror::Object>* CreateImageRoots() const
+  void WriteImageHeader(size_t image_index, mirror::ObjectArray<mirror::Object>* image_roots)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void CalculateObjectOffsets(mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -137,6 +240,26 @@ class ImageWriter {
   static void WalkFieldsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Decides the image of every object of layered images. Each image takes what its roots and the
+  // classes of its dex files reach, the last image also takes the objects left over.
+  void AssignObjectImages(const std::vector<mirror::ObjectArray<mirror::Object>*>& image_roots,
+                          const std::vector<mirror::Class*>& classes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void AssignObjectImage(mirror::Object* obj, size_t image_index)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Places what obj in image image_index references. A reference to a later image is only allowed
+  // from a dex cache array, whose entry is cleared in the image.
+  void AssignReferenceImage(mirror::Object* obj, size_t image_index, mirror::Object* ref,
+                            bool clearable)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void AssignLeftoverObjectImageCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static bool CollectClassesVisitor(mirror::Class* klass, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Writes out the images and their bitmaps once laid out and fixed up.
+  bool WriteImageFiles(const std::vector<std::string>& image_filenames);
+
   // Creates the contiguous image in memory and adjusts pointers.
   void CopyAndFixupObjects();
   static void CopyAndFixupObjectsCallback(mirror::Object* obj, void* arg)
@@ -167,10 +290,15 @@ class ImageWriter {
 
   const CompilerDriver& compiler_driver_;
 
-  // oat file with code for this image
-  OatFile* oat_file_;
+  // The images being written, in layout order.
+  std::vector<ImageInfo> images_;
 
-  // Memory mapped for generating the image.
+  // Image of each boot dex cache when writing more than one image.
+  SafeMap<const mirror::DexCache*, size_t> dex_cache_images_;
+
+  // Memory mapped for generating the image. Images and the oat files following them are laid out
+  // in it as they will be in memory, so the offset of an object in image_ is relative to
+  // image_begin_ whatever image it is in.
   UniquePtr<MemMap> image_;
 
   // Offset to the free space in image_.
@@ -182,13 +310,10 @@ class ImageWriter {
   // Saved hashes (objects are inside of the image so that they don't move).
   std::vector<std::pair<mirror::Object*, uint32_t> > saved_hashes_;
 
-  // Beginning target oat address for the pointers from the output image to its oat file.
-  const byte* oat_data_begin_;
-
   // Image bitmap which lets us know where the objects inside of the image reside.
   UniquePtr<gc::accounting::SpaceBitmap> image_bitmap_;
 
-  // Offset from oat_data_begin_ to the stubs.
+  // Offset from the oat data begin of the first image to the stubs.
   uint32_t interpreter_to_interpreter_bridge_offset_;
   uint32_t interpreter_to_compiled_code_bridge_offset_;
   uint32_t jni_dlsym_lookup_offset_;
@@ -198,6 +323,39 @@ class ImageWriter {
   uint32_t quick_imt_conflict_trampoline_offset_;
   uint32_t quick_resolution_trampoline_offset_;
   uint32_t quick_to_interpreter_bridge_offset_;
+
+  // Whether an app image is being written, see WriteAppImage.
+  bool app_image_;
+
+  // Set if the app image reaches a class that is neither in the boot image nor an app class.
+  bool app_image_failed_;
+
+  // Set if the images extend the boot image of the heap, see Write.
+  bool extend_boot_image_;
+
+  // Set if an image of layered images references a later one.
+  bool layering_failed_;
+
+  // Image of each object of layered images, see AssignObjectImages.
+  SafeMap<const mirror::Object*, size_t> object_images_;
+
+  // Strings of layered images that are written as their interned string.
+  SafeMap<const mirror::Object*, const mirror::Object*> interned_strings_;
+
+  // The arrays of the dex caches of layered images, with the value their entries that resolve to
+  // a later image are cleared to.
+  SafeMap<const mirror::Object*, const mirror::Object*> dex_cache_arrays_;
+
+  // Range of the boot image spaces of the heap, used for an app image and to extend a boot image.
+  const byte* boot_image_begin_;
+  const byte* boot_image_end_;
+
+  // The oat file an app image is written for, it is not registered with the class linker.
+  UniquePtr<OatFile> app_oat_file_;
+
+  // Dex caches and classes that go into an app image.
+  std::vector<mirror::DexCache*> app_dex_caches_;
+  std::set<mirror::Class*> app_image_classes_;
 };
 
 }  // namespace art
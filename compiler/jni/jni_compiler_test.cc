@@ -19,6 +19,7 @@
 #include "dex_file.h"
 #include "gtest/gtest.h"
 #include "indirect_reference_table.h"
+#include "interpreter/interpreter.h"
 #include "jni_internal.h"
 #include "mem_map.h"
 #include "mirror/art_method-inl.h"
@@ -774,4 +775,96 @@ TEST_F(JniCompilerTest, UpcallArgumentTypeChecking_Static) {
   check_jni_abort_catcher.Check("bad arguments passed to void MyClassNatives.staticMethodThatShouldTakeClass(int, java.lang.Class)");
 }
 
+int gJava_MyClassNatives_fastFooII_calls = 0;
+jint Java_MyClassNatives_fastFooII(JNIEnv* env, jobject thisObj, jint x, jint y) {
+  // 1 = thisObj
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(thisObj != NULL);
+  gJava_MyClassNatives_fastFooII_calls++;
+  return x - y;  // non-commutative operator
+}
+
+TEST_F(JniCompilerTest, CompileAndRunFastNativeMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "fastFooII", "(II)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fastFooII));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastFooII_calls);
+  jint result = env_->CallNonvirtualIntMethod(jobj_, jklass_, jmethod_, 99, 10);
+  EXPECT_EQ(99 - 10, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooII_calls);
+}
+
+int gJava_MyClassNatives_criticalFooII_calls = 0;
+jint Java_MyClassNatives_criticalFooII(jint x, jint y) {
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  gJava_MyClassNatives_criticalFooII_calls++;
+  return x - y;  // non-commutative operator
+}
+
+TEST_F(JniCompilerTest, CompileAndRunCriticalNativeIntIntMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalFooII", "(II)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalFooII));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_criticalFooII_calls);
+  jint result = env_->CallStaticIntMethod(jklass_, jmethod_, 20, 30);
+  EXPECT_EQ(20 - 30, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalFooII_calls);
+}
+
+int gJava_MyClassNatives_criticalFooIJD_calls = 0;
+jlong Java_MyClassNatives_criticalFooIJD(jint x, jlong y, jdouble z) {
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  gJava_MyClassNatives_criticalFooIJD_calls++;
+  return x + y + static_cast<jlong>(z);
+}
+
+TEST_F(JniCompilerTest, CompileAndRunCriticalNativeMixedMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalFooIJD", "(IJD)J",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalFooIJD));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_criticalFooIJD_calls);
+  jlong result = env_->CallStaticLongMethod(jklass_, jmethod_, 1, 0x100000000ll, 2.0);
+  EXPECT_EQ(0x100000003ll, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalFooIJD_calls);
+}
+
+TEST_F(JniCompilerTest, InterpretCriticalNativeMethods) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalFooII", "(II)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalFooII));
+  gJava_MyClassNatives_criticalFooII_calls = 0;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    uint32_t args[] = { 20, 30 };
+    JValue result;
+    interpreter::EnterInterpreterFromInvoke(soa.Self(), soa.DecodeMethod(jmethod_), NULL, args,
+                                            &result);
+    EXPECT_EQ(20 - 30, result.GetI());
+  }
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalFooII_calls);
+
+  SetUpForTest(true, "criticalFooIJD", "(IJD)J",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalFooIJD));
+  gJava_MyClassNatives_criticalFooIJD_calls = 0;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    JValue y;
+    y.SetJ(0x100000000ll);
+    JValue z;
+    z.SetD(2.0);
+    uint32_t args[] = { 1, static_cast<uint32_t>(y.GetJ()), static_cast<uint32_t>(y.GetJ() >> 32),
+                        static_cast<uint32_t>(z.GetJ()), static_cast<uint32_t>(z.GetJ() >> 32) };
+    JValue result;
+    interpreter::EnterInterpreterFromInvoke(soa.Self(), soa.DecodeMethod(jmethod_), NULL, args,
+                                            &result);
+    EXPECT_EQ(0x100000003ll, result.GetJ());
+  }
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalFooIJD_calls);
+}
+
 }  // namespace art
@@ -61,6 +61,8 @@ JniCompiler::JniCompiler(LlvmCompilationUnit* cunit,
 }
 
 CompiledMethod* JniCompiler::Compile() {
+  // The compiler driver compiles @CriticalNative methods as regular natives for this backend.
+  DCHECK_EQ(dex_compilation_unit_->GetAccessFlags() & kAccCriticalNative, 0U);
   const bool is_static = dex_compilation_unit_->IsStatic();
   const bool is_synchronized = dex_compilation_unit_->IsSynchronized();
   const DexFile* dex_file = dex_compilation_unit_->GetDexFile();
@@ -206,9 +206,13 @@ class ManagedRuntimeCallingConvention : public CallingConvention {
 //
 // [1] We must save all callee saves here to enable any exception throws to restore
 // callee saves for frames above this one.
+//
+// For @CriticalNative methods neither the JNIEnv* nor the jclass are passed, the native arguments
+// are just the primitive arguments of the managed method.
 class JniCallingConvention : public CallingConvention {
  public:
-  static JniCallingConvention* Create(bool is_static, bool is_synchronized, const char* shorty,
+  static JniCallingConvention* Create(bool is_static, bool is_synchronized,
+                                      bool is_critical_native, const char* shorty,
                                       InstructionSet instruction_set);
 
   // Size of frame excluding space for outgoing args (its assumed Method* is
@@ -273,15 +277,23 @@ class JniCallingConvention : public CallingConvention {
     kObjectOrClass = 1
   };
 
-  explicit JniCallingConvention(bool is_static, bool is_synchronized, const char* shorty)
-      : CallingConvention(is_static, is_synchronized, shorty) {}
+  JniCallingConvention(bool is_static, bool is_synchronized, bool is_critical_native,
+                       const char* shorty)
+      : CallingConvention(is_static, is_synchronized, shorty),
+        is_critical_native_(is_critical_native) {}
+
+  bool IsCriticalNative() const {
+    return is_critical_native_;
+  }
 
   // Number of stack slots for outgoing arguments, above which the SIRT is
   // located
   virtual size_t NumberOfOutgoingStackArgs() = 0;
 
- protected:
-  size_t NumberOfExtraArgumentsForJni();
+  size_t NumberOfExtraArgumentsForJni() const;
+
+ private:
+  const bool is_critical_native_;
 };
 
 }  // namespace art
@@ -45,6 +45,9 @@ static void CopyParameter(Assembler* jni_asm,
 static void SetNativeParameter(Assembler* jni_asm,
                                JniCallingConvention* jni_conv,
                                ManagedRegister in_reg);
+static CompiledMethod* CompileCriticalNativeStub(CompilerDriver& compiler,
+                                                 InstructionSet instruction_set,
+                                                 const char* shorty);
 
 // Generate the JNI bridge for the given method, general contract:
 // - Arguments are in the managed runtime format, either on stack or in
@@ -58,14 +61,21 @@ CompiledMethod* ArtJniCompileMethodInternal(CompilerDriver& compiler,
   CHECK(is_native);
   const bool is_static = (access_flags & kAccStatic) != 0;
   const bool is_synchronized = (access_flags & kAccSynchronized) != 0;
+  // @FastNative methods stay Runnable, @CriticalNative ones additionally get no JNIEnv*/jclass.
+  const bool is_fast_native = (access_flags & kAccFastNative) != 0;
+  const bool is_critical_native = (access_flags & kAccCriticalNative) != 0;
   const char* shorty = dex_file.GetMethodShorty(dex_file.GetMethodId(method_idx));
   InstructionSet instruction_set = compiler.GetInstructionSet();
   if (instruction_set == kThumb2) {
     instruction_set = kArm;
   }
+  if (is_critical_native) {
+    CHECK(is_static && !is_synchronized) << PrettyMethod(method_idx, dex_file);
+    return CompileCriticalNativeStub(compiler, instruction_set, shorty);
+  }
   // Calling conventions used to iterate over parameters to method
   UniquePtr<JniCallingConvention> main_jni_conv(
-      JniCallingConvention::Create(is_static, is_synchronized, shorty, instruction_set));
+      JniCallingConvention::Create(is_static, is_synchronized, false, shorty, instruction_set));
   bool reference_return = main_jni_conv->IsReturnAReference();
 
   UniquePtr<ManagedRuntimeCallingConvention> mr_conv(
@@ -79,7 +89,8 @@ CompiledMethod* ArtJniCompileMethodInternal(CompilerDriver& compiler,
   const char* jni_end_shorty = jni_end_arg_count == 0 ? "I"
                                                         : (jni_end_arg_count == 1 ? "II" : "III");
   UniquePtr<JniCallingConvention> end_jni_conv(
-      JniCallingConvention::Create(is_static, is_synchronized, jni_end_shorty, instruction_set));
+      JniCallingConvention::Create(is_static, is_synchronized, false, jni_end_shorty,
+                                   instruction_set));
 
   // Assembler that holds generated instructions
   UniquePtr<Assembler> jni_asm(Assembler::Create(instruction_set));
@@ -168,9 +179,12 @@ CompiledMethod* ArtJniCompileMethodInternal(CompilerDriver& compiler,
   // 6. Call into appropriate JniMethodStart passing Thread* so that transition out of Runnable
   //    can occur. The result is the saved JNI local state that is restored by the exit call. We
   //    abuse the JNI calling convention here, that is guaranteed to support passing 2 pointer
-  //    arguments.
+  //    arguments. Synchronized @FastNative methods use the general entrypoints which check the
+  //    method's fast flag at runtime.
   ThreadOffset jni_start = is_synchronized ? QUICK_ENTRYPOINT_OFFSET(pJniMethodStartSynchronized)
-                                           : QUICK_ENTRYPOINT_OFFSET(pJniMethodStart);
+                                           : (is_fast_native
+                                              ? QUICK_ENTRYPOINT_OFFSET(pJniMethodFastStart)
+                                              : QUICK_ENTRYPOINT_OFFSET(pJniMethodStart));
   main_jni_conv->ResetIterator(FrameOffset(main_out_arg_size));
   FrameOffset locked_object_sirt_offset(0);
   if (is_synchronized) {
@@ -301,13 +315,16 @@ CompiledMethod* ArtJniCompileMethodInternal(CompilerDriver& compiler,
   ThreadOffset jni_end(-1);
   if (reference_return) {
     // Pass result.
-    jni_end = is_synchronized ? QUICK_ENTRYPOINT_OFFSET(pJniMethodEndWithReferenceSynchronized)
-                              : QUICK_ENTRYPOINT_OFFSET(pJniMethodEndWithReference);
+    jni_end = is_synchronized
+        ? QUICK_ENTRYPOINT_OFFSET(pJniMethodEndWithReferenceSynchronized)
+        : (is_fast_native ? QUICK_ENTRYPOINT_OFFSET(pJniMethodFastEndWithReference)
+                          : QUICK_ENTRYPOINT_OFFSET(pJniMethodEndWithReference));
     SetNativeParameter(jni_asm.get(), end_jni_conv.get(), end_jni_conv->ReturnRegister());
     end_jni_conv->Next();
   } else {
     jni_end = is_synchronized ? QUICK_ENTRYPOINT_OFFSET(pJniMethodEndSynchronized)
-                              : QUICK_ENTRYPOINT_OFFSET(pJniMethodEnd);
+                              : (is_fast_native ? QUICK_ENTRYPOINT_OFFSET(pJniMethodFastEnd)
+                                                : QUICK_ENTRYPOINT_OFFSET(pJniMethodEnd));
   }
   // Pass saved local reference state.
   if (end_jni_conv->IsCurrentParamOnStack()) {
@@ -371,6 +388,104 @@ CompiledMethod* ArtJniCompileMethodInternal(CompilerDriver& compiler,
                             main_jni_conv->FpSpillMask());
 }
 
+// Generate the bridge for a @CriticalNative method. The thread stays Runnable and no SIRT or local
+// reference segment is needed as only primitives are passed, so the bridge just shuffles the
+// arguments into the native calling convention and calls the native code directly.
+static CompiledMethod* CompileCriticalNativeStub(CompilerDriver& compiler,
+                                                 InstructionSet instruction_set,
+                                                 const char* shorty) {
+  UniquePtr<JniCallingConvention> jni_conv(
+      JniCallingConvention::Create(true, false, true, shorty, instruction_set));
+  UniquePtr<ManagedRuntimeCallingConvention> mr_conv(
+      ManagedRuntimeCallingConvention::Create(true, false, shorty, instruction_set));
+  CHECK_EQ(jni_conv->ReferenceCount(), 0u);
+  UniquePtr<Assembler> jni_asm(Assembler::Create(instruction_set));
+
+  // 1. Build the frame saving all callee saves.
+  const size_t frame_size(jni_conv->FrameSize());
+  const std::vector<ManagedRegister>& callee_save_regs = jni_conv->CalleeSaveRegisters();
+  __ BuildFrame(frame_size, mr_conv->MethodRegister(), callee_save_regs, mr_conv->EntrySpills());
+
+  // 2. Write out the end of the quick frames, the dlsym lookup stub needs to find the method and
+  //    may raise UnsatisfiedLinkError.
+  __ StoreStackPointerToThread(Thread::TopOfManagedStackOffset());
+  __ StoreImmediateToThread(Thread::TopOfManagedStackPcOffset(), 0,
+                            mr_conv->InterproceduralScratchRegister());
+
+  // 3. Move frame down to allow space for out going args.
+  const size_t out_arg_size = jni_conv->OutArgSize();
+  __ IncreaseFrameSize(out_arg_size);
+
+  // 4. Shuffle the arguments, backwards as in the general bridge.
+  mr_conv->ResetIterator(FrameOffset(frame_size + out_arg_size));
+  uint32_t args_count = 0;
+  while (mr_conv->HasNext()) {
+    args_count++;
+    mr_conv->Next();
+  }
+  for (uint32_t i = 0; i < args_count; ++i) {
+    mr_conv->ResetIterator(FrameOffset(frame_size + out_arg_size));
+    jni_conv->ResetIterator(FrameOffset(out_arg_size));
+    for (uint32_t j = 0; j < args_count - i - 1; ++j) {
+      mr_conv->Next();
+      jni_conv->Next();
+    }
+    CopyParameter(jni_asm.get(), mr_conv.get(), jni_conv.get(), frame_size, out_arg_size);
+  }
+
+  // 5. Plant call to native code associated with method.
+  jni_conv->ResetIterator(FrameOffset(out_arg_size));
+  __ Call(jni_conv->MethodStackOffset(), mirror::ArtMethod::NativeMethodOffset(),
+          mr_conv->InterproceduralScratchRegister());
+
+  // 6. Fix differences in result widths and move the result to the managed return register.
+  if (instruction_set == kX86) {
+    if (jni_conv->GetReturnType() == Primitive::kPrimByte ||
+        jni_conv->GetReturnType() == Primitive::kPrimShort) {
+      __ SignExtend(jni_conv->ReturnRegister(),
+                    Primitive::ComponentSize(jni_conv->GetReturnType()));
+    } else if (jni_conv->GetReturnType() == Primitive::kPrimBoolean ||
+               jni_conv->GetReturnType() == Primitive::kPrimChar) {
+      __ ZeroExtend(jni_conv->ReturnRegister(),
+                    Primitive::ComponentSize(jni_conv->GetReturnType()));
+    }
+  }
+  if (jni_conv->SizeOfReturnValue() != 0 &&
+      !jni_conv->ReturnRegister().Equals(mr_conv->ReturnRegister())) {
+    FrameOffset return_save_location = jni_conv->ReturnValueSaveLocation();
+    if (instruction_set == kMips && jni_conv->GetReturnType() == Primitive::kPrimDouble &&
+        return_save_location.Uint32Value() % 8 != 0) {
+      // Ensure doubles are 8-byte aligned for MIPS
+      return_save_location = FrameOffset(return_save_location.Uint32Value() + kPointerSize);
+    }
+    CHECK_LT(return_save_location.Uint32Value(), frame_size + out_arg_size);
+    __ Store(return_save_location, jni_conv->ReturnRegister(), jni_conv->SizeOfReturnValue());
+    __ Load(mr_conv->ReturnRegister(), return_save_location, mr_conv->SizeOfReturnValue());
+  }
+
+  // 7. Move frame up now we're done with the out arg space.
+  __ DecreaseFrameSize(out_arg_size);
+
+  // 8. The native code can't throw, but a failed lazy lookup of the native code can.
+  __ ExceptionPoll(jni_conv->InterproceduralScratchRegister(), 0);
+
+  // 9. Remove activation.
+  __ RemoveFrame(frame_size, callee_save_regs);
+
+  // 10. Finalize code generation
+  __ EmitSlowPaths();
+  size_t cs = __ CodeSize();
+  std::vector<uint8_t> managed_code(cs);
+  MemoryRegion code(&managed_code[0], managed_code.size());
+  __ FinalizeInstructions(code);
+  return new CompiledMethod(compiler,
+                            instruction_set,
+                            managed_code,
+                            frame_size,
+                            jni_conv->CoreSpillMask(),
+                            jni_conv->FpSpillMask());
+}
+
 // Copy a single parameter from the managed to the JNI calling convention
 static void CopyParameter(Assembler* jni_asm,
                           ManagedRuntimeCallingConvention* mr_conv,
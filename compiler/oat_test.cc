@@ -15,6 +15,8 @@
  */
 
 #include "compiler/oat_writer.h"
+#include "dex_instruction.h"
+#include "driver/input_oat_file.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object_array-inl.h"
@@ -64,6 +66,80 @@ class OatTest : public CommonTest {
 #endif
     }
   }
+
+  // Compiles the dex files of class_loader for an application and writes them to file. Returns
+  // the driver holding the compiled code.
+  CompilerDriver* CompileToOatFile(jobject class_loader, File* file)
+      LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    UniquePtr<CompilerDriver> driver(NewApplicationDriver());
+    TimingLogger timings("OatTest::CompileToOatFile", false, false);
+    const std::vector<const DexFile*>& dex_files =
+        Runtime::Current()->GetCompileTimeClassPath(class_loader);
+    driver->CompileAll(class_loader, dex_files, timings);
+    ScopedObjectAccess soa(Thread::Current());
+    // There is no boot image, so the oat file records a boot image checksum of 0.
+    OatWriter oat_writer(dex_files, 0U, 0U, "", driver.get(), &timings);
+    CHECK(driver->WriteElf(GetTestAndroidRoot(), !kIsTargetBuild, dex_files, oat_writer, file));
+    return driver.release();
+  }
+
+  CompilerDriver* NewApplicationDriver() {
+    return new CompilerDriver(verified_methods_data_.get(), method_inliner_map_.get(), kQuick,
+                              compiler_driver_->GetInstructionSet(),
+                              compiler_driver_->GetInstructionSetFeatures(),
+                              false, NULL, 2, true);
+  }
+
+  InputOatFile* OpenInputOatFile(const std::string& filename) {
+    std::string error_msg;
+    OatFile* oat_file = OatFile::Open(filename, filename, NULL, false, &error_msg);
+    CHECK(oat_file != NULL) << error_msg;
+    return new InputOatFile(oat_file);
+  }
+
+  // Asks input_oat_file for the code of every method of dex_file, and returns how many methods it
+  // could reuse. Reused code must match the code compiled from original_dex_file, or the method
+  // named changed_method must not be reused.
+  size_t CountReusedMethods(InputOatFile* input_oat_file, CompilerDriver* driver,
+                            const DexFile& dex_file, const DexFile& original_dex_file,
+                            const char* changed_method) {
+    size_t reused = 0;
+    for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+      const byte* class_data = dex_file.GetClassData(dex_file.GetClassDef(i));
+      if (class_data == NULL) {
+        continue;
+      }
+      ClassDataItemIterator it(dex_file, class_data);
+      while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+        it.Next();
+      }
+      for (; it.HasNext(); it.Next()) {
+        uint32_t method_idx = it.GetMemberIndex();
+        UniquePtr<CompiledMethod> compiled_method(
+            input_oat_file->GetCompiledMethod(*driver, dex_file, i, method_idx,
+                                              it.GetMethodCodeItem()));
+        if (compiled_method.get() == NULL) {
+          continue;
+        }
+        ++reused;
+        const char* name = dex_file.GetMethodName(dex_file.GetMethodId(method_idx));
+        EXPECT_TRUE(changed_method == NULL || strcmp(name, changed_method) != 0) << name;
+        const CompiledMethod* original =
+            driver->GetCompiledMethod(MethodReference(&original_dex_file, method_idx));
+        EXPECT_TRUE(original != NULL) << name;
+        if (original == NULL) {
+          continue;
+        }
+        EXPECT_TRUE(original->GetCode() == compiled_method->GetCode()) << name;
+        EXPECT_EQ(original->GetFrameSizeInBytes(), compiled_method->GetFrameSizeInBytes());
+        EXPECT_TRUE(original->GetMappingTable() == compiled_method->GetMappingTable()) << name;
+        EXPECT_TRUE(original->GetVmapTable() == compiled_method->GetVmapTable()) << name;
+        EXPECT_TRUE(original->GetGcMap() == compiled_method->GetGcMap()) << name;
+      }
+    }
+    EXPECT_EQ(reused, input_oat_file->GetReusedMethodCount());
+    return reused;
+  }
 };
 
 TEST_F(OatTest, WriteRead) {
@@ -156,11 +232,185 @@ TEST_F(OatTest, WriteRead) {
   }
 }
 
+TEST_F(OatTest, InputOatFileReusesUnchangedMethods) {
+  TEST_DISABLED_FOR_PORTABLE();
+  jobject class_loader;
+  const DexFile* dex_file;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("ProtoCompare");
+    dex_file = Runtime::Current()->GetCompileTimeClassPath(class_loader)[0];
+  }
+  ScratchFile tmp;
+  UniquePtr<CompilerDriver> driver(CompileToOatFile(class_loader, tmp.GetFile()));
+
+  UniquePtr<InputOatFile> input_oat_file(OpenInputOatFile(tmp.GetFilename()));
+  std::vector<const DexFile*> dex_files;
+  dex_files.push_back(dex_file);
+  input_oat_file->MatchDexFiles(dex_files, dex_files, driver->GetInstructionSet(),
+                                driver->GetInstructionSetFeatures(), 0U);
+  // ProtoCompare has a constructor and methods m1 to m4.
+  EXPECT_EQ(5U, CountReusedMethods(input_oat_file.get(), driver.get(), *dex_file, *dex_file,
+                                   NULL));
+
+  // A recompilation with the oat file as input copies every method from it.
+  UniquePtr<CompilerDriver> recompile_driver(NewApplicationDriver());
+  InputOatFile* recompile_input = OpenInputOatFile(tmp.GetFilename());
+  recompile_driver->SetInputOatFile(recompile_input);
+  TimingLogger timings("OatTest::InputOatFileReusesUnchangedMethods", false, false);
+  recompile_driver->CompileAll(class_loader, dex_files, timings);
+  EXPECT_EQ(5U, recompile_input->GetReusedMethodCount());
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    SirtRef<mirror::ClassLoader> loader(soa.Self(),
+                                        soa.Decode<mirror::ClassLoader*>(class_loader));
+    mirror::Class* klass = class_linker_->FindClass("LProtoCompare;", loader);
+    ASSERT_TRUE(klass != NULL);
+    for (size_t i = 0; i < klass->NumVirtualMethods(); ++i) {
+      MethodReference ref(dex_file, klass->GetVirtualMethod(i)->GetDexMethodIndex());
+      const CompiledMethod* compiled = driver->GetCompiledMethod(ref);
+      const CompiledMethod* recompiled = recompile_driver->GetCompiledMethod(ref);
+      ASSERT_TRUE(compiled != NULL);
+      ASSERT_TRUE(recompiled != NULL);
+      EXPECT_TRUE(compiled->GetCode() == recompiled->GetCode());
+    }
+  }
+
+  // Input oat files for another instruction set or boot image are ignored.
+  UniquePtr<InputOatFile> other_image(OpenInputOatFile(tmp.GetFilename()));
+  other_image->MatchDexFiles(dex_files, dex_files, driver->GetInstructionSet(),
+                             driver->GetInstructionSetFeatures(), 42U);
+  EXPECT_EQ(0U, CountReusedMethods(other_image.get(), driver.get(), *dex_file, *dex_file, NULL));
+}
+
+TEST_F(OatTest, InputOatFileRecompilesChangedMethods) {
+  TEST_DISABLED_FOR_PORTABLE();
+  jobject class_loader;
+  const DexFile* dex_file;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("ProtoCompare");
+    dex_file = Runtime::Current()->GetCompileTimeClassPath(class_loader)[0];
+  }
+  ScratchFile tmp;
+  UniquePtr<CompilerDriver> driver(CompileToOatFile(class_loader, tmp.GetFile()));
+
+  // A new version of the dex file where m1 subtracts instead of adding.
+  std::string error_msg;
+  UniquePtr<const DexFile> changed_dex_file(
+      DexFile::Open(GetTestDexFileName("ProtoCompare").c_str(), dex_file->GetLocation().c_str(),
+                    &error_msg));
+  ASSERT_TRUE(changed_dex_file.get() != NULL) << error_msg;
+  ASSERT_TRUE(changed_dex_file->EnableWrite());
+  bool changed = false;
+  ClassDataItemIterator it(*changed_dex_file,
+                           changed_dex_file->GetClassData(changed_dex_file->GetClassDef(0)));
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  for (; it.HasNext() && !changed; it.Next()) {
+    const DexFile::MethodId& method_id = changed_dex_file->GetMethodId(it.GetMemberIndex());
+    if (strcmp(changed_dex_file->GetMethodName(method_id), "m1") != 0) {
+      continue;
+    }
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    uint16_t* insns = const_cast<uint16_t*>(code_item->insns_);
+    for (uint32_t dex_pc = 0; dex_pc < code_item->insns_size_in_code_units_ && !changed;) {
+      const Instruction* inst = Instruction::At(insns + dex_pc);
+      if (inst->Opcode() == Instruction::ADD_INT) {
+        insns[dex_pc] = (insns[dex_pc] & 0xff00) | Instruction::SUB_INT;
+        changed = true;
+      } else if (inst->Opcode() == Instruction::ADD_INT_2ADDR) {
+        insns[dex_pc] = (insns[dex_pc] & 0xff00) | Instruction::SUB_INT_2ADDR;
+        changed = true;
+      }
+      dex_pc += inst->SizeInCodeUnits();
+    }
+  }
+  ASSERT_TRUE(changed);
+
+  UniquePtr<InputOatFile> input_oat_file(OpenInputOatFile(tmp.GetFilename()));
+  std::vector<const DexFile*> dex_files;
+  dex_files.push_back(changed_dex_file.get());
+  input_oat_file->MatchDexFiles(dex_files, dex_files, driver->GetInstructionSet(),
+                                driver->GetInstructionSetFeatures(), 0U);
+  // Only m1 is compiled again.
+  EXPECT_EQ(4U, CountReusedMethods(input_oat_file.get(), driver.get(), *changed_dex_file,
+                                   *dex_file, "m1"));
+}
+
+TEST_F(OatTest, InputOatFileRecompilesChangedClasses) {
+  TEST_DISABLED_FOR_PORTABLE();
+  jobject class_loader;
+  const DexFile* dex_file;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("ProtoCompare");
+    dex_file = Runtime::Current()->GetCompileTimeClassPath(class_loader)[0];
+  }
+  ScratchFile tmp;
+  UniquePtr<CompilerDriver> driver(CompileToOatFile(class_loader, tmp.GetFile()));
+
+  // ProtoCompare2 has the same code as ProtoCompare under another class name, which changes the
+  // class declarations. Open it as a new version of ProtoCompare.
+  std::string error_msg;
+  UniquePtr<const DexFile> changed_dex_file(
+      DexFile::Open(GetTestDexFileName("ProtoCompare2").c_str(), dex_file->GetLocation().c_str(),
+                    &error_msg));
+  ASSERT_TRUE(changed_dex_file.get() != NULL) << error_msg;
+
+  UniquePtr<InputOatFile> input_oat_file(OpenInputOatFile(tmp.GetFilename()));
+  std::vector<const DexFile*> dex_files;
+  dex_files.push_back(changed_dex_file.get());
+  input_oat_file->MatchDexFiles(dex_files, dex_files, driver->GetInstructionSet(),
+                                driver->GetInstructionSetFeatures(), 0U);
+  EXPECT_EQ(0U, CountReusedMethods(input_oat_file.get(), driver.get(), *changed_dex_file,
+                                   *dex_file, NULL));
+}
+
+TEST_F(OatTest, InputOatFileRecompilesAgainstOtherDexFiles) {
+  TEST_DISABLED_FOR_PORTABLE();
+  jobject class_loader;
+  const DexFile* dex_file;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("ProtoCompare");
+    dex_file = Runtime::Current()->GetCompileTimeClassPath(class_loader)[0];
+  }
+  ScratchFile tmp;
+  UniquePtr<CompilerDriver> driver(CompileToOatFile(class_loader, tmp.GetFile()));
+
+  // ProtoCompare is unchanged, but its code may depend on declarations in a dex file that was
+  // not compiled into the oat file.
+  std::string error_msg;
+  std::string other_location(GetTestDexFileName("Interfaces"));
+  UniquePtr<const DexFile> other_dex_file(
+      DexFile::Open(other_location.c_str(), other_location.c_str(), &error_msg));
+  ASSERT_TRUE(other_dex_file.get() != NULL) << error_msg;
+
+  std::vector<const DexFile*> dex_files;
+  dex_files.push_back(dex_file);
+  std::vector<const DexFile*> class_path(dex_files);
+  class_path.push_back(other_dex_file.get());
+  UniquePtr<InputOatFile> other_class_path(OpenInputOatFile(tmp.GetFilename()));
+  other_class_path->MatchDexFiles(dex_files, class_path, driver->GetInstructionSet(),
+                                  driver->GetInstructionSetFeatures(), 0U);
+  EXPECT_EQ(0U, CountReusedMethods(other_class_path.get(), driver.get(), *dex_file, *dex_file,
+                                   NULL));
+
+  dex_files.push_back(other_dex_file.get());
+  UniquePtr<InputOatFile> other_input(OpenInputOatFile(tmp.GetFilename()));
+  other_input->MatchDexFiles(dex_files, dex_files, driver->GetInstructionSet(),
+                             driver->GetInstructionSetFeatures(), 0U);
+  EXPECT_EQ(0U, CountReusedMethods(other_input.get(), driver.get(), *dex_file, *dex_file, NULL));
+}
+
 TEST_F(OatTest, OatHeaderSizeCheck) {
   // If this test is failing and you have to update these constants,
   // it is time to update OatHeader::kOatVersion
   EXPECT_EQ(76U, sizeof(OatHeader));
   EXPECT_EQ(28U, sizeof(OatMethodOffsets));
+  EXPECT_EQ(16U, sizeof(OatDexCacheTable));
 }
 
 TEST_F(OatTest, OatHeaderIsValid) {
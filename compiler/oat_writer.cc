@@ -24,10 +24,14 @@
 #include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex/verified_methods_data.h"
+#include "gc/heap.h"
+#include "gc/space/image_space.h"
 #include "gc/space/space.h"
+#include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/array.h"
 #include "mirror/class_loader.h"
+#include "mirror/dex_cache-inl.h"
 #include "mirror/object-inl.h"
 #include "os.h"
 #include "output_stream.h"
@@ -54,6 +58,8 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_header_(0),
     size_oat_header_image_file_location_(0),
     size_dex_file_(0),
+    size_dex_cache_table_alignment_(0),
+    size_dex_cache_table_(0),
     size_interpreter_to_interpreter_bridge_(0),
     size_interpreter_to_compiled_code_bridge_(0),
     size_jni_dlsym_lookup_(0),
@@ -74,6 +80,7 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_dex_file_location_data_(0),
     size_oat_dex_file_location_checksum_(0),
     size_oat_dex_file_offset_(0),
+    size_oat_dex_file_dex_cache_table_offset_(0),
     size_oat_dex_file_methods_offsets_(0),
     size_oat_class_type_(0),
     size_oat_class_status_(0),
@@ -92,6 +99,10 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     TimingLogger::ScopedSplit split("InitDexFiles", timings);
     offset = InitDexFiles(offset);
   }
+  {
+    TimingLogger::ScopedSplit split("InitDexCacheTables", timings);
+    offset = InitDexCacheTables(offset);
+  }
   {
     TimingLogger::ScopedSplit split("InitOatClasses", timings);
     offset = InitOatClasses(offset);
@@ -158,6 +169,85 @@ size_t OatWriter::InitDexFiles(size_t offset) {
   return offset;
 }
 
+static bool IsInBootImage(const mirror::Object* obj) {
+  for (gc::space::ImageSpace* space : Runtime::Current()->GetHeap()->GetImageSpaces()) {
+    if (space->HasAddress(obj)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Appends a (dex index, boot image address) entry for obj if it is a boot image object.
+static void AddDexCacheTableEntry(std::vector<uint32_t>* entries, size_t index,
+                                  const mirror::Object* obj) {
+  if (obj != NULL && IsInBootImage(obj)) {
+    entries->push_back(index);
+    entries->push_back(reinterpret_cast<uint32_t>(obj));
+  }
+}
+
+size_t OatWriter::InitDexCacheTables(size_t offset) {
+  // The boot image is at a fixed address that the oat header records through its checksum, so
+  // an app oat file can name the boot image objects its dex files resolved to. Resolution from
+  // an app class loader delegates to the boot class path first, so those entries are stable.
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  if (compiler_driver_->IsImage() || !Runtime::Current()->GetHeap()->HasImageSpace()) {
+    return offset;
+  }
+  for (size_t i = 0; i != dex_files_->size(); ++i) {
+    const DexFile& dex_file = *(*dex_files_)[i];
+    if (!class_linker->IsDexFileRegistered(dex_file)) {
+      continue;
+    }
+    mirror::DexCache* dex_cache = class_linker->FindDexCache(dex_file);
+    std::vector<uint32_t> strings;
+    for (size_t j = 0; j < dex_cache->NumStrings(); ++j) {
+      AddDexCacheTableEntry(&strings, j, dex_cache->GetResolvedString(j));
+    }
+    std::vector<uint32_t> types;
+    for (size_t j = 0; j < dex_cache->NumResolvedTypes(); ++j) {
+      AddDexCacheTableEntry(&types, j, dex_cache->GetResolvedType(j));
+    }
+    std::vector<uint32_t> methods;
+    for (size_t j = 0; j < dex_cache->NumResolvedMethods(); ++j) {
+      mirror::ArtMethod* method = dex_cache->GetResolvedMethod(j);
+      // Unresolved entries hold the resolution method, which is in the boot image too.
+      if (method != NULL && !method->IsRuntimeMethod()) {
+        AddDexCacheTableEntry(&methods, j, method);
+      }
+    }
+    std::vector<uint32_t> fields;
+    for (size_t j = 0; j < dex_cache->NumResolvedFields(); ++j) {
+      AddDexCacheTableEntry(&fields, j, dex_cache->GetResolvedField(j));
+    }
+    if (strings.empty() && types.empty() && methods.empty() && fields.empty()) {
+      continue;
+    }
+
+    OatDexCacheTable table(strings.size() / 2, types.size() / 2, methods.size() / 2,
+                           fields.size() / 2);
+    std::vector<uint32_t>& data = oat_dex_files_[i]->dex_cache_table_;
+    const uint32_t* table_words = reinterpret_cast<const uint32_t*>(&table);
+    data.assign(table_words, table_words + sizeof(table) / sizeof(uint32_t));
+    data.insert(data.end(), strings.begin(), strings.end());
+    data.insert(data.end(), types.begin(), types.end());
+    data.insert(data.end(), methods.begin(), methods.end());
+    data.insert(data.end(), fields.begin(), fields.end());
+    CHECK_EQ(data.size() * sizeof(uint32_t), table.SizeOf());
+
+    size_t original_offset = offset;
+    offset = RoundUp(offset, 4);
+    size_dex_cache_table_alignment_ += offset - original_offset;
+    oat_dex_files_[i]->dex_cache_table_offset_ = offset;
+    offset += table.SizeOf();
+    oat_header_->UpdateChecksum(&data[0], table.SizeOf());
+    VLOG(compiler) << "Preloading " << table.NumEntries() << " dex cache entries of "
+                   << dex_file.GetLocation();
+  }
+  return offset;
+}
+
 size_t OatWriter::InitOatClasses(size_t offset) {
   // create the OatClasses
   // calculate the offsets within OatDexFiles to OatClasses
@@ -545,6 +635,8 @@ bool OatWriter::Write(OutputStream& out) {
     DO_STAT(size_oat_header_);
     DO_STAT(size_oat_header_image_file_location_);
     DO_STAT(size_dex_file_);
+    DO_STAT(size_dex_cache_table_alignment_);
+    DO_STAT(size_dex_cache_table_);
     DO_STAT(size_interpreter_to_interpreter_bridge_);
     DO_STAT(size_interpreter_to_compiled_code_bridge_);
     DO_STAT(size_jni_dlsym_lookup_);
@@ -565,6 +657,7 @@ bool OatWriter::Write(OutputStream& out) {
     DO_STAT(size_oat_dex_file_location_data_);
     DO_STAT(size_oat_dex_file_location_checksum_);
     DO_STAT(size_oat_dex_file_offset_);
+    DO_STAT(size_oat_dex_file_dex_cache_table_offset_);
     DO_STAT(size_oat_dex_file_methods_offsets_);
     DO_STAT(size_oat_class_type_);
     DO_STAT(size_oat_class_status_);
@@ -607,6 +700,25 @@ bool OatWriter::WriteTables(OutputStream& out, const size_t file_offset) {
     }
     size_dex_file_ += dex_file->GetHeader().file_size_;
   }
+  for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
+    const std::vector<uint32_t>& dex_cache_table = oat_dex_files_[i]->dex_cache_table_;
+    if (dex_cache_table.empty()) {
+      continue;
+    }
+    uint32_t expected_offset = file_offset + oat_dex_files_[i]->dex_cache_table_offset_;
+    off_t actual_offset = out.Seek(expected_offset, kSeekSet);
+    if (static_cast<uint32_t>(actual_offset) != expected_offset) {
+      PLOG(ERROR) << "Failed to seek to dex cache table. Actual: " << actual_offset
+                  << " Expected: " << expected_offset << " File: " << out.GetLocation();
+      return false;
+    }
+    size_t table_size = dex_cache_table.size() * sizeof(dex_cache_table[0]);
+    if (!out.WriteFully(&dex_cache_table[0], table_size)) {
+      PLOG(ERROR) << "Failed to write dex cache table to " << out.GetLocation();
+      return false;
+    }
+    size_dex_cache_table_ += table_size;
+  }
   for (size_t i = 0; i != oat_classes_.size(); ++i) {
     if (!oat_classes_[i]->Write(this, out, file_offset)) {
       PLOG(ERROR) << "Failed to write oat methods information to " << out.GetLocation();
@@ -882,6 +994,7 @@ OatWriter::OatDexFile::OatDexFile(size_t offset, const DexFile& dex_file) {
   dex_file_location_data_ = reinterpret_cast<const uint8_t*>(location.data());
   dex_file_location_checksum_ = dex_file.GetLocationChecksum();
   dex_file_offset_ = 0;
+  dex_cache_table_offset_ = 0;
   methods_offsets_.resize(dex_file.NumClassDefs());
 }
 
@@ -890,6 +1003,7 @@ size_t OatWriter::OatDexFile::SizeOf() const {
           + dex_file_location_size_
           + sizeof(dex_file_location_checksum_)
           + sizeof(dex_file_offset_)
+          + sizeof(dex_cache_table_offset_)
           + (sizeof(methods_offsets_[0]) * methods_offsets_.size());
 }
 
@@ -898,6 +1012,7 @@ void OatWriter::OatDexFile::UpdateChecksum(OatHeader& oat_header) const {
   oat_header.UpdateChecksum(dex_file_location_data_, dex_file_location_size_);
   oat_header.UpdateChecksum(&dex_file_location_checksum_, sizeof(dex_file_location_checksum_));
   oat_header.UpdateChecksum(&dex_file_offset_, sizeof(dex_file_offset_));
+  oat_header.UpdateChecksum(&dex_cache_table_offset_, sizeof(dex_cache_table_offset_));
   oat_header.UpdateChecksum(&methods_offsets_[0],
                             sizeof(methods_offsets_[0]) * methods_offsets_.size());
 }
@@ -926,6 +1041,11 @@ bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
     return false;
   }
   oat_writer->size_oat_dex_file_offset_ += sizeof(dex_file_offset_);
+  if (!out.WriteFully(&dex_cache_table_offset_, sizeof(dex_cache_table_offset_))) {
+    PLOG(ERROR) << "Failed to write dex cache table offset to " << out.GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_dex_cache_table_offset_ += sizeof(dex_cache_table_offset_);
   if (!out.WriteFully(&methods_offsets_[0],
                       sizeof(methods_offsets_[0]) * methods_offsets_.size())) {
     PLOG(ERROR) << "Failed to write methods offsets to " << out.GetLocation();
@@ -45,6 +45,9 @@ class OutputStream;
 // ...
 // Dex[D]
 //
+// OatDexCacheTable  optional table of boot image objects each app dex cache is preloaded with
+// ...
+//
 // OatClass[0]       one variable sized OatClass for each of C DexFile::ClassDefs
 // OatClass[1]       contains OatClass entries with class status, offsets to code, etc.
 // ...
@@ -86,6 +89,8 @@ class OatWriter {
   size_t InitOatHeader();
   size_t InitOatDexFiles(size_t offset);
   size_t InitDexFiles(size_t offset);
+  size_t InitDexCacheTables(size_t offset)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   size_t InitOatClasses(size_t offset);
   size_t InitOatCode(size_t offset)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -137,8 +142,13 @@ class OatWriter {
     const uint8_t* dex_file_location_data_;
     uint32_t dex_file_location_checksum_;
     uint32_t dex_file_offset_;
+    uint32_t dex_cache_table_offset_;
     std::vector<uint32_t> methods_offsets_;
 
+    // The OatDexCacheTable at dex_cache_table_offset_ followed by its entries, empty if the dex
+    // cache has no entries to preload.
+    std::vector<uint32_t> dex_cache_table_;
+
    private:
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
   };
@@ -240,6 +250,8 @@ class OatWriter {
   uint32_t size_oat_header_;
   uint32_t size_oat_header_image_file_location_;
   uint32_t size_dex_file_;
+  uint32_t size_dex_cache_table_alignment_;
+  uint32_t size_dex_cache_table_;
   uint32_t size_interpreter_to_interpreter_bridge_;
   uint32_t size_interpreter_to_compiled_code_bridge_;
   uint32_t size_jni_dlsym_lookup_;
@@ -260,6 +272,7 @@ class OatWriter {
   uint32_t size_oat_dex_file_location_data_;
   uint32_t size_oat_dex_file_location_checksum_;
   uint32_t size_oat_dex_file_offset_;
+  uint32_t size_oat_dex_file_dex_cache_table_offset_;
   uint32_t size_oat_dex_file_methods_offsets_;
   uint32_t size_oat_class_type_;
   uint32_t size_oat_class_status_;
@@ -16,7 +16,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
 #include <valgrind.h>
 
 #include <fstream>
@@ -34,8 +36,10 @@
 #include "dex_file-inl.h"
 #include "dex/verified_methods_data.h"
 #include "driver/compiler_driver.h"
+#include "driver/input_oat_file.h"
 #include "elf_fixup.h"
 #include "elf_stripper.h"
+#include "gc/heap.h"
 #include "gc/space/image_space.h"
 #include "gc/space/space-inl.h"
 #include "image_writer.h"
@@ -45,6 +49,7 @@
 #include "mirror/class_loader.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "oat_file.h"
 #include "oat_writer.h"
 #include "object_utils.h"
 #include "os.h"
@@ -110,16 +115,40 @@ static void Usage(const char* fmt, ...) {
   UsageError("  --bitcode=<file.bc>: specifies the optional bitcode filename.");
   UsageError("      Example: --bitcode=/system/framework/boot.bc");
   UsageError("");
+  UsageError("  --input-oat=<file.oat>: an oat file from an earlier compilation of the same");
+  UsageError("      input. Methods that did not change reuse its compiled code. It must not be");
+  UsageError("      the output file.");
+  UsageError("      Example: --input-oat=/tmp/Calculator.apk.oat");
+  UsageError("");
   UsageError("  --image=<file.art>: specifies the output image filename.");
   UsageError("      Example: --image=/system/framework/boot.art");
   UsageError("");
+  UsageError("  --multi-image: write an image and oat file for each --dex-file instead of one");
+  UsageError("      for all of them. The first dex file uses the --image and --oat-file names,");
+  UsageError("      later ones add the dex file name, e.g. boot-framework.art. The runtime loads");
+  UsageError("      them with a colon separated -Ximage list in the same order, or only the");
+  UsageError("      first ones of them: an image only refers to the images before it. Put the");
+  UsageError("      dex files that change most often last.");
+  UsageError("");
+  UsageError("  With --boot-image, --image writes images that extend that boot image with the");
+  UsageError("  --dex-file arguments, laid out after it, so that only the images of changed dex");
+  UsageError("  files and the ones after them need to be written again.");
+  UsageError("      Example: --boot-image=boot.art --image=boot-framework.art");
+  UsageError("");
+  UsageError("  --app-image-file=<file.art>: write an image of the classes of the single");
+  UsageError("      --dex-file, laid out after the boot image. The runtime looks for it next to");
+  UsageError("      the oat file with an .art extension and needs -XX:AppImageReservation.");
+  UsageError("      Example: --app-image-file=/data/app/Calculator.art");
+  UsageError("");
   UsageError("  --image-classes=<classname-file>: specifies classes to include in an image.");
   UsageError("      Example: --image=frameworks/base/preloaded-classes");
   UsageError("");
   UsageError("  --base=<hex-address>: specifies the base address when creating a boot image.");
+  UsageError("      It is not used to extend a boot image.");
   UsageError("      Example: --base=0x50000000");
   UsageError("");
-  UsageError("  --boot-image=<file.art>: provide the image file for the boot class path.");
+  UsageError("  --boot-image=<file.art>: provide the image file for the boot class path, or a");
+  UsageError("      colon separated list of the images of a multi-image boot image.");
   UsageError("      Example: --boot-image=/system/framework/boot.art");
   UsageError("      Default: <host-prefix>/system/framework/boot.art");
   UsageError("");
@@ -150,6 +179,21 @@ static void Usage(const char* fmt, ...) {
   UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
+  UsageError("  --server-socket=<path>: instead of compiling the given input, keep the runtime");
+  UsageError("      resident and compile applications sent as jobs over a Unix domain socket");
+  UsageError("      created at <path>. Each job passes the zip and oat file descriptors and");
+  UsageError("      --zip-location and --oat-location.");
+  UsageError("      Example: --server-socket=/tmp/dex2oat.socket");
+  UsageError("");
+  UsageError("  --server-max-jobs=<count>: exit after serving <count> jobs.");
+  UsageError("      Example: --server-max-jobs=500");
+  UsageError("      Default: 0 (no limit)");
+  UsageError("");
+  UsageError("  --memory-budget=<megabytes>: compile fewer methods at once while the resident");
+  UsageError("      set size of dex2oat exceeds the budget.");
+  UsageError("      Example: --memory-budget=512");
+  UsageError("      Default: 0 (no limit)");
+  UsageError("");
   UsageError("  --runtime-arg <argument>: used to specify various arguments for the runtime,");
   UsageError("      such as initial heap size, maximum heap size, and verbose output.");
   UsageError("      Use a separate --runtime-arg switch for each argument.");
@@ -178,7 +222,22 @@ class Dex2Oat {
     return true;
   }
 
+  bool CreateAppImageFile(const std::string& image_filename,
+                          const std::string& oat_filename,
+                          const std::string& oat_location,
+                          const CompilerDriver& compiler)
+      LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    ImageWriter image_writer(compiler);
+    if (!image_writer.WriteAppImage(image_filename, oat_filename, oat_location)) {
+      LOG(WARNING) << "Failed to create app image file " << image_filename;
+      return false;
+    }
+    return true;
+  }
+
   ~Dex2Oat() {
+    // The workers are attached to the runtime.
+    thread_pool_.reset();
     delete runtime_;
     VLOG(compiler) << "dex2oat took " << PrettyDuration(NanoTime() - start_ns_)
               << " (threads: " << thread_count_ << ")";
@@ -244,8 +303,9 @@ class Dex2Oat {
                                       const std::string& android_root,
                                       bool is_host,
                                       const std::vector<const DexFile*>& dex_files,
-                                      File* oat_file,
+                                      const std::vector<File*>& oat_files,
                                       const std::string& bitcode_filename,
+                                      const std::string& input_oat_filename,
                                       bool image,
                                       UniquePtr<CompilerDriver::DescriptorSet>& image_classes,
                                       bool dump_stats,
@@ -253,7 +313,24 @@ class Dex2Oat {
     // SirtRef and ClassLoader creation needs to come after Runtime::Create
     jobject class_loader = NULL;
     Thread* self = Thread::Current();
-    if (!boot_image_option.empty()) {
+    if (!boot_image_option.empty() && image) {
+      // The dex files extend the boot class path of the boot image.
+      ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+      ScopedObjectAccess soa(self);
+      for (const DexFile* dex_file : dex_files) {
+        class_linker->AppendToBootClassPath(*dex_file);
+      }
+      // Without --image-classes, the images hold every class of the dex files.
+      if (image_classes.get() == NULL) {
+        image_classes.reset(new CompilerDriver::DescriptorSet);
+        for (const DexFile* dex_file : dex_files) {
+          for (size_t i = 0; i < dex_file->NumClassDefs(); ++i) {
+            const DexFile::ClassDef& class_def = dex_file->GetClassDef(i);
+            image_classes->insert(dex_file->GetClassDescriptor(class_def));
+          }
+        }
+      }
+    } else if (!boot_image_option.empty()) {
       ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
       std::vector<const DexFile*> class_path_files(dex_files);
       OpenClassPathFiles(runtime_->GetClassPathString(), class_path_files);
@@ -261,7 +338,6 @@ class Dex2Oat {
       for (size_t i = 0; i < class_path_files.size(); i++) {
         class_linker->RegisterDexFile(*class_path_files[i]);
       }
-      soa.Env()->AllocObject(WellKnownClasses::dalvik_system_PathClassLoader);
       ScopedLocalRef<jobject> class_loader_local(soa.Env(),
           soa.Env()->AllocObject(WellKnownClasses::dalvik_system_PathClassLoader));
       class_loader = soa.Env()->NewGlobalRef(class_loader_local.get());
@@ -282,7 +358,23 @@ class Dex2Oat {
       driver->SetBitcodeFileName(bitcode_filename);
     }
 
-    driver->CompileAll(class_loader, dex_files, timings);
+    if (memory_budget_ != 0) {
+      driver->SetMemoryBudget(memory_budget_);
+    }
+
+    if (!input_oat_filename.empty()) {
+      std::string error_msg;
+      OatFile* input_oat_file = OatFile::Open(input_oat_filename, input_oat_filename, NULL, false,
+                                              &error_msg);
+      if (input_oat_file == NULL) {
+        LOG(WARNING) << "Failed to open input oat file '" << input_oat_filename << "', compiling "
+            << "all methods: " << error_msg;
+      } else {
+        driver->SetInputOatFile(new InputOatFile(input_oat_file));
+      }
+    }
+
+    driver->CompileAll(class_loader, dex_files, timings, thread_pool_.get());
 
     timings.NewSplit("dex2oat OatWriter");
     std::string image_file_location;
@@ -290,57 +382,89 @@ class Dex2Oat {
     uint32_t image_file_location_oat_data_begin = 0;
     if (!driver->IsImage()) {
       TimingLogger::ScopedSplit split("Loading image checksum", &timings);
-      gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
-      image_file_location_oat_checksum = image_space->GetImageHeader().GetOatChecksum();
-      image_file_location_oat_data_begin =
-          reinterpret_cast<uint32_t>(image_space->GetImageHeader().GetOatDataBegin());
-      image_file_location = image_space->GetImageFilename();
-      if (host_prefix != NULL && StartsWith(image_file_location, host_prefix->c_str())) {
-        image_file_location = image_file_location.substr(host_prefix->size());
+      gc::Heap* heap = Runtime::Current()->GetHeap();
+      image_file_location_oat_checksum = heap->GetBootImageChecksum();
+      image_file_location_oat_data_begin = heap->GetBootImageOatDataBegin();
+      // Record every image of a multi-image boot image, as for -Ximage.
+      for (gc::space::ImageSpace* image_space : heap->GetImageSpaces()) {
+        std::string image_filename(image_space->GetImageFilename());
+        if (host_prefix != NULL && StartsWith(image_filename, host_prefix->c_str())) {
+          image_filename = image_filename.substr(host_prefix->size());
+        }
+        if (!image_file_location.empty()) {
+          image_file_location += ':';
+        }
+        image_file_location += image_filename;
       }
     }
 
-    OatWriter oat_writer(dex_files,
-                         image_file_location_oat_checksum,
-                         image_file_location_oat_data_begin,
-                         image_file_location,
-                         driver.get(),
-                         &timings);
-
-    TimingLogger::ScopedSplit split("Writing ELF", &timings);
-    if (!driver->WriteElf(android_root, is_host, dex_files, oat_writer, oat_file)) {
-      LOG(ERROR) << "Failed to write ELF file " << oat_file->GetPath();
-      return NULL;
+    for (size_t i = 0; i < oat_files.size(); ++i) {
+      // A multi-image boot image has an oat file for each dex file.
+      std::vector<const DexFile*> oat_dex_files;
+      if (oat_files.size() == 1) {
+        oat_dex_files = dex_files;
+      } else {
+        CHECK_EQ(oat_files.size(), dex_files.size());
+        oat_dex_files.push_back(dex_files[i]);
+      }
+      OatWriter oat_writer(oat_dex_files,
+                           image_file_location_oat_checksum,
+                           image_file_location_oat_data_begin,
+                           image_file_location,
+                           driver.get(),
+                           &timings);
+
+      TimingLogger::ScopedSplit split("Writing ELF", &timings);
+      if (!driver->WriteElf(android_root, is_host, oat_dex_files, oat_writer, oat_files[i])) {
+        LOG(ERROR) << "Failed to write ELF file " << oat_files[i]->GetPath();
+        return NULL;
+      }
     }
 
     return driver.release();
   }
 
-  bool CreateImageFile(const std::string& image_filename,
+  // Creates a thread pool that every following CreateOatFile compiles with, instead of each
+  // compilation starting and joining its own workers.
+  void CreateThreadPool() {
+    CHECK(thread_pool_.get() == NULL);
+    thread_pool_.reset(new ThreadPool("Compiler driver thread pool", thread_count_ - 1));
+  }
+
+  // Limits the resident set size of the following CreateOatFile compilations.
+  void SetMemoryBudget(size_t memory_budget) {
+    memory_budget_ = memory_budget;
+  }
+
+  bool CreateImageFile(const std::vector<std::string>& image_filenames,
                        uintptr_t image_base,
-                       const std::string& oat_filename,
-                       const std::string& oat_location,
+                       const std::vector<std::string>& oat_filenames,
+                       const std::vector<std::string>& oat_locations,
                        const CompilerDriver& compiler)
       LOCKS_EXCLUDED(Locks::mutator_lock_) {
-    uintptr_t oat_data_begin;
+    std::vector<uintptr_t> oat_data_begins;
     {
       // ImageWriter is scoped so it can free memory before doing FixupElf
       ImageWriter image_writer(compiler);
-      if (!image_writer.Write(image_filename, image_base, oat_filename, oat_location)) {
-        LOG(ERROR) << "Failed to create image file " << image_filename;
+      if (!image_writer.Write(image_filenames, image_base, oat_filenames, oat_locations)) {
+        LOG(ERROR) << "Failed to create image file " << image_filenames[0];
         return false;
       }
-      oat_data_begin = image_writer.GetOatDataBegin();
+      for (size_t i = 0; i < oat_filenames.size(); ++i) {
+        oat_data_begins.push_back(image_writer.GetOatDataBegin(i));
+      }
     }
 
-    UniquePtr<File> oat_file(OS::OpenFileReadWrite(oat_filename.c_str()));
-    if (oat_file.get() == NULL) {
-      PLOG(ERROR) << "Failed to open ELF file: " << oat_filename;
-      return false;
-    }
-    if (!ElfFixup::Fixup(oat_file.get(), oat_data_begin)) {
-      LOG(ERROR) << "Failed to fixup ELF file " << oat_file->GetPath();
-      return false;
+    for (size_t i = 0; i < oat_filenames.size(); ++i) {
+      UniquePtr<File> oat_file(OS::OpenFileReadWrite(oat_filenames[i].c_str()));
+      if (oat_file.get() == NULL) {
+        PLOG(ERROR) << "Failed to open ELF file: " << oat_filenames[i];
+        return false;
+      }
+      if (!ElfFixup::Fixup(oat_file.get(), oat_data_begins[i])) {
+        LOG(ERROR) << "Failed to fixup ELF file " << oat_file->GetPath();
+        return false;
+      }
     }
     return true;
   }
@@ -385,6 +509,8 @@ class Dex2Oat {
         callbacks_(verified_methods_data_.get(), method_inliner_map_.get()),
         runtime_(nullptr),
         thread_count_(thread_count),
+        thread_pool_(NULL),
+        memory_budget_(0),
         start_ns_(NanoTime()) {
   }
 
@@ -451,6 +577,9 @@ class Dex2Oat {
   Dex2OatCompilerCallbacks callbacks_;
   Runtime* runtime_;
   size_t thread_count_;
+  UniquePtr<ThreadPool> thread_pool_;
+  // Resident set size that compilation is throttled to stay below, or 0 for no limit.
+  size_t memory_budget_;
   uint64_t start_ns_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(Dex2Oat);
@@ -466,6 +595,26 @@ static bool ParseInt(const char* in, int* out) {
   return true;
 }
 
+// Returns the name of an output of a multi-image boot image for the dex file at dex_location,
+// e.g. boot.art and framework.jar give boot-framework.art.
+static std::string GetMultiImageFilename(const std::string& filename, const char* dex_location) {
+  std::string dex_name(dex_location);
+  size_t slash = dex_name.rfind('/');
+  if (slash != std::string::npos) {
+    dex_name = dex_name.substr(slash + 1);
+  }
+  size_t dex_dot = dex_name.rfind('.');
+  if (dex_dot != std::string::npos) {
+    dex_name = dex_name.substr(0, dex_dot);
+  }
+  size_t dot = filename.rfind('.');
+  size_t filename_slash = filename.rfind('/');
+  if (dot == std::string::npos || (filename_slash != std::string::npos && dot < filename_slash)) {
+    return filename + "-" + dex_name;
+  }
+  return filename.substr(0, dot) + "-" + dex_name + filename.substr(dot);
+}
+
 static size_t OpenDexFiles(const std::vector<const char*>& dex_filenames,
                            const std::vector<const char*>& dex_locations,
                            std::vector<const DexFile*>& dex_files) {
@@ -489,6 +638,53 @@ static size_t OpenDexFiles(const std::vector<const char*>& dex_filenames,
   return failure_count;
 }
 
+// Opens the classes.dex of the zip archive open on zip_fd, taking ownership of the descriptor.
+static const DexFile* OpenDexFileFromZipFd(int zip_fd, const std::string& zip_location) {
+  std::string error_msg;
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::OpenFromFd(zip_fd, zip_location.c_str(),
+                                                           &error_msg));
+  if (zip_archive.get() == NULL) {
+    LOG(ERROR) << "Failed to open zip from file descriptor for '" << zip_location << "': "
+        << error_msg;
+    return NULL;
+  }
+  const DexFile* dex_file = DexFile::Open(*zip_archive.get(), zip_location, &error_msg);
+  if (dex_file == NULL) {
+    LOG(ERROR) << "Failed to open dex from file descriptor for zip file '" << zip_location
+        << "': " << error_msg;
+    return NULL;
+  }
+  return dex_file;
+}
+
+// Ensure opened dex files are writable for dex-to-dex transformations.
+static void EnableDexFileWrites(const std::vector<const DexFile*>& dex_files) {
+  for (const auto& dex_file : dex_files) {
+    if (!dex_file->EnableWrite()) {
+      PLOG(ERROR) << "Failed to make .dex file writeable '" << dex_file->GetLocation() << "'\n";
+    }
+  }
+}
+
+/*
+ * If we're not in interpret-only mode, go ahead and compile small applications. Don't
+ * bother to check if we're doing the image.
+ */
+static void CompileSmallApplications(const std::vector<const DexFile*>& dex_files) {
+  if (Runtime::Current()->GetCompilerFilter() != Runtime::kInterpretOnly) {
+    size_t num_methods = 0;
+    for (size_t i = 0; i != dex_files.size(); ++i) {
+      const DexFile* dex_file = dex_files[i];
+      CHECK(dex_file != NULL);
+      num_methods += dex_file->NumMethodIds();
+    }
+    if (num_methods <= Runtime::Current()->GetNumDexMethodsThreshold()) {
+      Runtime::Current()->SetCompilerFilter(Runtime::kSpeed);
+      VLOG(compiler) << "Below method threshold, compiling anyways";
+    }
+  }
+}
+
 // The primary goal of the watchdog is to prevent stuck build servers
 // during development when fatal aborts lead to a cascade of failures
 // that result in a deadlock.
@@ -646,6 +842,262 @@ static InstructionSetFeatures ParseFeatureList(std::string str) {
   return result;
 }
 
+// Compiles applications sent over a local socket with a single runtime, so that the boot image
+// is mapped, boot classes are resolved and compiler workers are started once rather than for
+// every application.
+//
+// The socket is a SOCK_SEQPACKET Unix domain socket. Each message is one job: its payload is a
+// sequence of NUL-terminated options, --zip-location=<location> and --oat-location=<location>
+// and optionally --dump-timing, and it carries two file descriptors in an SCM_RIGHTS control
+// message, the zip file to compile and the oat file to write. The server answers every job with
+// an int32_t exit status. A connection may send any number of jobs; connections are served one
+// at a time. Only the server's user may connect to the socket.
+class CompilationServer {
+ public:
+  CompilationServer(Dex2Oat* dex2oat,
+                    const std::string& boot_image_option,
+                    const std::string* host_prefix,
+                    const std::string& android_root,
+                    bool is_host,
+                    bool dump_stats,
+                    size_t max_jobs)
+      : dex2oat_(dex2oat),
+        boot_image_option_(boot_image_option),
+        host_prefix_(host_prefix),
+        android_root_(android_root),
+        is_host_(is_host),
+        dump_stats_(dump_stats),
+        max_jobs_(max_jobs),
+        jobs_run_(0),
+        compiler_filter_(Runtime::Current()->GetCompilerFilter()) {
+  }
+
+  // Serves jobs until max_jobs have been run, or forever if max_jobs is 0. Every job leaves its
+  // dex files and class loader registered with the runtime, so a limit bounds the server's
+  // memory use.
+  int Run(const std::string& socket_path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+      LOG(ERROR) << "Server socket path too long: " << socket_path;
+      return EXIT_FAILURE;
+    }
+    strcpy(address.sun_path, socket_path.c_str());
+
+    int server_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (server_fd == -1) {
+      PLOG(ERROR) << "Failed to create server socket";
+      return EXIT_FAILURE;
+    }
+    unlink(socket_path.c_str());
+    // A job can read and write any file the server can open, so only the server's user may
+    // connect. The socket file is created by bind, so restrict its mode through the umask rather
+    // than after the fact.
+    mode_t old_umask = umask(0077);
+    int bind_result = bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    umask(old_umask);
+    if (bind_result != 0 || listen(server_fd, kListenBacklog) != 0) {
+      PLOG(ERROR) << "Failed to listen on server socket " << socket_path;
+      close(server_fd);
+      return EXIT_FAILURE;
+    }
+
+    dex2oat_->CreateThreadPool();
+    LOG(INFO) << "dex2oat: waiting for compilation jobs on " << socket_path;
+    int result = EXIT_SUCCESS;
+    while (!Done()) {
+      int connection_fd = TEMP_FAILURE_RETRY(accept(server_fd, NULL, NULL));
+      if (connection_fd == -1) {
+        PLOG(ERROR) << "Failed to accept connection on " << socket_path;
+        result = EXIT_FAILURE;
+        break;
+      }
+      while (!Done() && ServeJob(connection_fd)) {
+      }
+      close(connection_fd);
+    }
+    close(server_fd);
+    unlink(socket_path.c_str());
+    return result;
+  }
+
+ private:
+  static const int kListenBacklog = 16;
+  static const size_t kMaxJobSize = 4 * KB;
+  static const size_t kJobFdCount = 2;
+  static const jint kJobLocalReferences = 16;
+
+  bool Done() const {
+    return max_jobs_ != 0 && jobs_run_ >= max_jobs_;
+  }
+
+  // Receives a job from connection_fd, runs it and sends back its status. Returns false once the
+  // connection is closed or broken.
+  bool ServeJob(int connection_fd) {
+    char buffer[kMaxJobSize];
+    iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = sizeof(buffer);
+    union {
+      cmsghdr align;
+      char data[CMSG_SPACE(kJobFdCount * sizeof(int))];
+    } control;
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof(control.data);
+    ssize_t length = TEMP_FAILURE_RETRY(recvmsg(connection_fd, &message, MSG_CMSG_CLOEXEC));
+    if (length <= 0) {
+      if (length == -1) {
+        PLOG(ERROR) << "Failed to receive compilation job";
+      }
+      return false;
+    }
+
+    std::vector<int> fds;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        const int* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+        fds.insert(fds.end(), data, data + (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+      }
+    }
+    std::vector<std::string> options;
+    const char* end = buffer + length;
+    for (const char* option = buffer; option < end;) {
+      size_t option_length = strnlen(option, end - option);
+      options.push_back(std::string(option, option_length));
+      option += option_length + 1;
+    }
+
+    bool success = false;
+    if ((message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 || fds.size() != kJobFdCount) {
+      LOG(ERROR) << "Malformed compilation job with " << fds.size() << " file descriptors";
+      for (size_t i = 0; i < fds.size(); ++i) {
+        close(fds[i]);
+      }
+    } else {
+      // Jobs run on the main thread, which never returns to managed code to release the JNI local
+      // references a job makes, so each job gets a local reference frame of its own.
+      JNIEnv* env = Thread::Current()->GetJniEnv();
+      if (env->PushLocalFrame(kJobLocalReferences) != JNI_OK) {
+        LOG(ERROR) << "Failed to push a local reference frame for a compilation job";
+        env->ExceptionClear();
+        for (size_t i = 0; i < fds.size(); ++i) {
+          close(fds[i]);
+        }
+      } else {
+        success = RunJob(options, fds[0], fds[1]);
+        env->PopLocalFrame(NULL);
+      }
+    }
+    ++jobs_run_;
+
+    int32_t status = success ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (TEMP_FAILURE_RETRY(write(connection_fd, &status, sizeof(status))) != sizeof(status)) {
+      PLOG(ERROR) << "Failed to send compilation job status";
+      return false;
+    }
+    return true;
+  }
+
+  // Compiles the zip on zip_fd into the oat file on oat_fd, taking ownership of both.
+  bool RunJob(const std::vector<std::string>& options, int zip_fd, int oat_fd) {
+    std::string zip_location;
+    std::string oat_location;
+    bool dump_timing = false;
+    for (size_t i = 0; i < options.size(); ++i) {
+      const StringPiece option(options[i]);
+      if (option.starts_with("--zip-location=")) {
+        zip_location = option.substr(strlen("--zip-location=")).data();
+      } else if (option.starts_with("--oat-location=")) {
+        oat_location = option.substr(strlen("--oat-location=")).data();
+      } else if (option == "--dump-timing") {
+        dump_timing = true;
+      } else {
+        LOG(ERROR) << "Unknown compilation job option " << options[i];
+        close(zip_fd);
+        close(oat_fd);
+        return false;
+      }
+    }
+    if (zip_location.empty() || oat_location.empty()) {
+      LOG(ERROR) << "Compilation job needs --zip-location and --oat-location";
+      close(zip_fd);
+      close(oat_fd);
+      return false;
+    }
+    UniquePtr<File> oat_file(new File(oat_fd, oat_location));
+
+    TimingLogger timings("compiler", false, false);
+    timings.StartSplit("dex2oat Setup");
+    LOG(INFO) << "dex2oat: " << oat_location;
+
+    const DexFile* dex_file = OpenDexFileFromZipFd(zip_fd, zip_location);
+    if (dex_file == NULL) {
+      return false;
+    }
+    std::vector<const DexFile*> dex_files;
+    dex_files.push_back(dex_file);
+    EnableDexFileWrites(dex_files);
+
+    // Undo the filter change a previous small application may have made.
+    Runtime::Current()->SetCompilerFilter(compiler_filter_);
+    CompileSmallApplications(dex_files);
+
+    UniquePtr<CompilerDriver::DescriptorSet> image_classes(NULL);
+    std::vector<File*> oat_files(1, oat_file.get());
+    UniquePtr<const CompilerDriver> compiler(dex2oat_->CreateOatFile(boot_image_option_,
+                                                                     host_prefix_,
+                                                                     android_root_,
+                                                                     is_host_,
+                                                                     dex_files,
+                                                                     oat_files,
+                                                                     "",
+                                                                     "",
+                                                                     false,
+                                                                     image_classes,
+                                                                     dump_stats_,
+                                                                     timings));
+    if (compiler.get() == NULL) {
+      LOG(ERROR) << "Failed to create oat file: " << oat_location;
+      return false;
+    }
+
+#if ART_USE_PORTABLE_COMPILER  // We currently only generate symbols on Portable
+    timings.NewSplit("dex2oat ElfStripper");
+    off_t seek_actual = lseek(oat_file->Fd(), 0, SEEK_SET);
+    CHECK_EQ(0, seek_actual);
+    std::string error_msg;
+    if (!ElfStripper::Strip(oat_file.get(), &error_msg)) {
+      LOG(ERROR) << "Failed to strip oat file " << oat_location << ": " << error_msg;
+      return false;
+    }
+#endif  // ART_USE_PORTABLE_COMPILER
+
+    timings.EndSplit();
+    if (dump_timing) {
+      LOG(INFO) << Dumpable<TimingLogger>(timings);
+    }
+    return true;
+  }
+
+  Dex2Oat* const dex2oat_;
+  const std::string boot_image_option_;
+  const std::string* const host_prefix_;
+  const std::string android_root_;
+  const bool is_host_;
+  const bool dump_stats_;
+  const size_t max_jobs_;
+  size_t jobs_run_;
+  const Runtime::CompilerFilter compiler_filter_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompilationServer);
+};
+
 static int dex2oat(int argc, char** argv) {
   TimingLogger timings("compiler", false, false);
 
@@ -668,9 +1120,12 @@ static int dex2oat(int argc, char** argv) {
   std::string oat_location;
   int oat_fd = -1;
   std::string bitcode_filename;
+  std::string input_oat_filename;
   const char* image_classes_zip_filename = NULL;
   const char* image_classes_filename = NULL;
   std::string image_filename;
+  bool multi_image = false;
+  std::string app_image_filename;
   std::string boot_image_filename;
   uintptr_t image_base = 0;
   UniquePtr<std::string> host_prefix;
@@ -703,6 +1158,9 @@ static int dex2oat(int argc, char** argv) {
   bool dump_timing = false;
   bool dump_slow_timing = kIsDebugBuild;
   bool watch_dog_enabled = !kIsTargetBuild;
+  std::string server_socket;
+  int server_max_jobs = 0;
+  int memory_budget_mb = 0;
 
 
   for (int i = 0; i < argc; i++) {
@@ -744,8 +1202,14 @@ static int dex2oat(int argc, char** argv) {
       oat_location = option.substr(strlen("--oat-location=")).data();
     } else if (option.starts_with("--bitcode=")) {
       bitcode_filename = option.substr(strlen("--bitcode=")).data();
+    } else if (option.starts_with("--input-oat=")) {
+      input_oat_filename = option.substr(strlen("--input-oat=")).data();
     } else if (option.starts_with("--image=")) {
       image_filename = option.substr(strlen("--image=")).data();
+    } else if (option == "--multi-image") {
+      multi_image = true;
+    } else if (option.starts_with("--app-image-file=")) {
+      app_image_filename = option.substr(strlen("--app-image-file=")).data();
     } else if (option.starts_with("--image-classes=")) {
       image_classes_filename = option.substr(strlen("--image-classes=")).data();
     } else if (option.starts_with("--image-classes-zip=")) {
@@ -796,12 +1260,39 @@ static int dex2oat(int argc, char** argv) {
       dump_timing = true;
     } else if (option == "--dump-stats") {
       dump_stats = true;
+    } else if (option.starts_with("--server-socket=")) {
+      server_socket = option.substr(strlen("--server-socket=")).data();
+    } else if (option.starts_with("--server-max-jobs=")) {
+      const char* max_jobs_str = option.substr(strlen("--server-max-jobs=")).data();
+      if (!ParseInt(max_jobs_str, &server_max_jobs) || server_max_jobs < 0) {
+        Usage("Failed to parse --server-max-jobs argument '%s' as an integer", max_jobs_str);
+      }
+    } else if (option.starts_with("--memory-budget=")) {
+      const char* memory_budget_str = option.substr(strlen("--memory-budget=")).data();
+      if (!ParseInt(memory_budget_str, &memory_budget_mb) || memory_budget_mb < 0) {
+        Usage("Failed to parse --memory-budget argument '%s' as an integer", memory_budget_str);
+      }
     } else {
       Usage("Unknown argument %s", option.data());
     }
   }
 
-  if (oat_filename.empty() && oat_fd == -1) {
+  bool server = !server_socket.empty();
+  if (server) {
+    if (!dex_filenames.empty() || zip_fd != -1 || !oat_filename.empty() || oat_fd != -1) {
+      Usage("--server-socket takes its input and output from compilation jobs");
+    }
+    if (!image_filename.empty()) {
+      Usage("--server-socket should not be used with --image");
+    }
+    if (!input_oat_filename.empty()) {
+      Usage("--server-socket should not be used with --input-oat");
+    }
+  } else if (server_max_jobs != 0) {
+    Usage("--server-max-jobs should be used with --server-socket");
+  }
+
+  if (!server && oat_filename.empty() && oat_fd == -1) {
     Usage("Output must be supplied with either --oat-file or --oat-fd");
   }
 
@@ -821,6 +1312,39 @@ static int dex2oat(int argc, char** argv) {
     Usage("--oat-fd should not be used with --image");
   }
 
+  if (multi_image) {
+    if (image_filename.empty()) {
+      Usage("--multi-image should be used with --image");
+    }
+    if (!oat_symbols.empty()) {
+      Usage("--multi-image should not be used with --oat-symbols");
+    }
+    if (compiler_backend != kQuick) {
+      Usage("--multi-image requires the Quick compiler backend");
+    }
+  }
+
+  if (!app_image_filename.empty()) {
+    if (!image_filename.empty()) {
+      Usage("--app-image-file should not be used with --image");
+    }
+    if (oat_fd != -1) {
+      Usage("--app-image-file should not be used with --oat-fd");
+    }
+  }
+
+  if (!input_oat_filename.empty()) {
+    if (!image_filename.empty()) {
+      Usage("--input-oat should not be used with --image");
+    }
+    if (compiler_backend != kQuick) {
+      Usage("--input-oat requires the Quick compiler backend");
+    }
+    if (input_oat_filename == oat_filename || input_oat_filename == oat_symbols) {
+      Usage("--input-oat should not be the output file");
+    }
+  }
+
   if (host_prefix.get() == NULL) {
     const char* android_product_out = getenv("ANDROID_PRODUCT_OUT");
     if (android_product_out != NULL) {
@@ -856,15 +1380,15 @@ static int dex2oat(int argc, char** argv) {
     Usage("--image-classes should only be used with --image");
   }
 
-  if (image_classes_filename != NULL && !boot_image_option.empty()) {
-    Usage("--image-classes should not be used with --boot-image");
+  if (image && !boot_image_option.empty() && image_base != 0) {
+    Usage("--base should not be used to extend a boot image with --boot-image");
   }
 
   if (image_classes_zip_filename != NULL && image_classes_filename == NULL) {
     Usage("--image-classes-zip should be used with --image-classes");
   }
 
-  if (dex_filenames.empty() && zip_fd == -1) {
+  if (!server && dex_filenames.empty() && zip_fd == -1) {
     Usage("Input must be supplied with either --dex-file or --zip-fd");
   }
 
@@ -902,8 +1426,8 @@ static int dex2oat(int argc, char** argv) {
     oat_unstripped += oat_filename;
   }
 
-  // Done with usage checks, enable watchdog if requested
-  WatchDog watch_dog(watch_dog_enabled);
+  // Done with usage checks, enable watchdog if requested. A server runs until it is killed.
+  WatchDog watch_dog(watch_dog_enabled && !server);
 
   // Check early that the result of compilation can be written
   UniquePtr<File> oat_file;
@@ -926,6 +1450,32 @@ static int dex2oat(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  // The outputs of each image, a multi-image boot image has one per dex file.
+  std::vector<std::string> image_filenames(1, image_filename);
+  std::vector<std::string> oat_filenames(1, oat_unstripped);
+  std::vector<std::string> oat_locations(1, oat_location);
+  std::vector<File*> oat_files(1, oat_file.get());
+  std::vector<File*> extra_oat_files;
+  if (multi_image) {
+    for (size_t i = 1; i < dex_locations.size(); ++i) {
+      image_filenames.push_back(GetMultiImageFilename(image_filename, dex_locations[i]));
+      oat_filenames.push_back(GetMultiImageFilename(oat_unstripped, dex_locations[i]));
+      oat_locations.push_back(GetMultiImageFilename(oat_location, dex_locations[i]));
+      File* extra_oat_file = OS::CreateEmptyFile(oat_filenames.back().c_str());
+      if (extra_oat_file == NULL) {
+        PLOG(ERROR) << "Failed to create oat file: " << oat_locations.back();
+        return EXIT_FAILURE;
+      }
+      extra_oat_files.push_back(extra_oat_file);
+      oat_files.push_back(extra_oat_file);
+      if (fchmod(extra_oat_file->Fd(), 0644) != 0) {
+        PLOG(ERROR) << "Failed to make oat file world readable: " << oat_locations.back();
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  STLElementDeleter<std::vector<File*> > extra_oat_files_deleter(&extra_oat_files);
+
   timings.StartSplit("dex2oat Setup");
   LOG(INFO) << "dex2oat: " << oat_location;
 
@@ -972,6 +1522,7 @@ static int dex2oat(int argc, char** argv) {
     return EXIT_FAILURE;
   }
   UniquePtr<Dex2Oat> dex2oat(p_dex2oat);
+  dex2oat->SetMemoryBudget(static_cast<size_t>(memory_budget_mb) * MB);
   // Runtime::Create acquired the mutator_lock_ that is normally given away when we Runtime::Start,
   // give it away now so that we don't starve GC.
   Thread* self = Thread::Current();
@@ -982,6 +1533,17 @@ static int dex2oat(int argc, char** argv) {
   // Whilst we're in native take the opportunity to initialize well known classes.
   WellKnownClasses::Init(self->GetJniEnv());
 
+  if (server) {
+    CompilationServer compilation_server(dex2oat.get(), boot_image_option, host_prefix.get(),
+                                         android_root, is_host, dump_stats, server_max_jobs);
+    return compilation_server.Run(server_socket);
+  }
+
+  if (image && !boot_image_option.empty()) {
+    // Images extending the boot image are laid out right after it and its oat files.
+    image_base = reinterpret_cast<uintptr_t>(Runtime::Current()->GetHeap()->GetBootImageEnd());
+  }
+
   // If --image-classes was specified, calculate the full list of classes to include in the image
   UniquePtr<CompilerDriver::DescriptorSet> image_classes(NULL);
   if (image_classes_filename != NULL) {
@@ -1005,18 +1567,8 @@ static int dex2oat(int argc, char** argv) {
     dex_files = Runtime::Current()->GetClassLinker()->GetBootClassPath();
   } else {
     if (dex_filenames.empty()) {
-      std::string error_msg;
-      UniquePtr<ZipArchive> zip_archive(ZipArchive::OpenFromFd(zip_fd, zip_location.c_str(),
-                                                               &error_msg));
-      if (zip_archive.get() == NULL) {
-        LOG(ERROR) << "Failed to open zip from file descriptor for '" << zip_location << "': "
-            << error_msg;
-        return EXIT_FAILURE;
-      }
-      const DexFile* dex_file = DexFile::Open(*zip_archive.get(), zip_location, &error_msg);
+      const DexFile* dex_file = OpenDexFileFromZipFd(zip_fd, zip_location);
       if (dex_file == NULL) {
-        LOG(ERROR) << "Failed to open dex from file descriptor for zip file '" << zip_location
-            << "': " << error_msg;
         return EXIT_FAILURE;
       }
       dex_files.push_back(dex_file);
@@ -1028,29 +1580,11 @@ static int dex2oat(int argc, char** argv) {
       }
     }
 
-    // Ensure opened dex files are writable for dex-to-dex transformations.
-    for (const auto& dex_file : dex_files) {
-      if (!dex_file->EnableWrite()) {
-        PLOG(ERROR) << "Failed to make .dex file writeable '" << dex_file->GetLocation() << "'\n";
-      }
-    }
+    EnableDexFileWrites(dex_files);
   }
 
-  /*
-   * If we're not in interpret-only mode, go ahead and compile small applications. Don't
-   * bother to check if we're doing the image.
-   */
-  if (!image && (Runtime::Current()->GetCompilerFilter() != Runtime::kInterpretOnly)) {
-    size_t num_methods = 0;
-    for (size_t i = 0; i != dex_files.size(); ++i) {
-      const DexFile* dex_file = dex_files[i];
-      CHECK(dex_file != NULL);
-      num_methods += dex_file->NumMethodIds();
-    }
-    if (num_methods <= Runtime::Current()->GetNumDexMethodsThreshold()) {
-      Runtime::Current()->SetCompilerFilter(Runtime::kSpeed);
-      VLOG(compiler) << "Below method threshold, compiling anyways";
-    }
+  if (!image) {
+    CompileSmallApplications(dex_files);
   }
 
   UniquePtr<const CompilerDriver> compiler(dex2oat->CreateOatFile(boot_image_option,
@@ -1058,8 +1592,9 @@ static int dex2oat(int argc, char** argv) {
                                                                   android_root,
                                                                   is_host,
                                                                   dex_files,
-                                                                  oat_file.get(),
+                                                                  oat_files,
                                                                   bitcode_filename,
+                                                                  input_oat_filename,
                                                                   image,
                                                                   image_classes,
                                                                   dump_stats,
@@ -1124,15 +1659,36 @@ static int dex2oat(int argc, char** argv) {
   //
   if (image) {
     timings.NewSplit("dex2oat ImageWriter");
-    bool image_creation_success = dex2oat->CreateImageFile(image_filename,
+    bool image_creation_success = dex2oat->CreateImageFile(image_filenames,
                                                            image_base,
-                                                           oat_unstripped,
-                                                           oat_location,
+                                                           oat_filenames,
+                                                           oat_locations,
                                                            *compiler.get());
     if (!image_creation_success) {
       return EXIT_FAILURE;
     }
-    VLOG(compiler) << "Image written successfully: " << image_filename;
+    VLOG(compiler) << "Image written successfully: " << Join(image_filenames, ':');
+  }
+
+  if (!app_image_filename.empty()) {
+    // The class linker installs an app image for the single dex file of an oat file.
+    if (dex_files.size() != 1) {
+      LOG(WARNING) << "Not writing app image " << app_image_filename << " for "
+                   << dex_files.size() << " dex files";
+    } else {
+      timings.NewSplit("dex2oat AppImageWriter");
+      if (dex2oat->CreateAppImageFile(app_image_filename, oat_unstripped, oat_location,
+                                      *compiler.get())) {
+        VLOG(compiler) << "App image written successfully: " << app_image_filename;
+      } else {
+        // The app image only speeds up class loading, the oat file is complete without it. Do not
+        // leave a partial or stale image behind for the runtime to find.
+        LOG(WARNING) << "Not writing app image " << app_image_filename;
+        if (unlink(app_image_filename.c_str()) != 0 && errno != ENOENT) {
+          PLOG(WARNING) << "Failed to remove app image " << app_image_filename;
+        }
+      }
+    }
   }
 
   if (is_host) {
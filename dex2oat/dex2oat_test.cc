@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "common_test.h"
+#include "dex_file.h"
+#include "oat_file.h"
+
+namespace art {
+
+class Dex2oatTest : public CommonTest {
+ protected:
+  std::string GetDex2oatPath() {
+    std::string path(GetTestAndroidRoot());
+    path += (kIsDebugBuild ? "/bin/dex2oatd" : "/bin/dex2oat");
+    return path;
+  }
+
+  std::string GetCoreImagePath() {
+    if (IsHost()) {
+      return GetTestAndroidRoot() + "/framework/core.art";
+    }
+    return "/data/art-test/core.art";
+  }
+
+  // Starts a compilation server on socket_path that exits after max_jobs jobs. Returns its pid.
+  // With interpret_only, the jobs only verify their dex files.
+  pid_t StartServer(const std::string& socket_path, size_t max_jobs, bool interpret_only) {
+    std::vector<std::string> args;
+    args.push_back(GetDex2oatPath());
+    args.push_back("--runtime-arg");
+    args.push_back("-Xms16m");
+    args.push_back("--runtime-arg");
+    args.push_back("-Xmx16m");
+    if (interpret_only) {
+      args.push_back("--runtime-arg");
+      args.push_back("-compiler-filter:interpret-only");
+    }
+    args.push_back("--boot-image=" + GetCoreImagePath());
+    args.push_back("--android-root=" + GetTestAndroidRoot());
+    if (IsHost()) {
+      args.push_back("--host");
+      args.push_back("--host-prefix=");
+    }
+    args.push_back("--server-socket=" + socket_path);
+    args.push_back(StringPrintf("--server-max-jobs=%zd", max_jobs));
+    std::vector<char*> argv;
+    for (size_t i = 0; i < args.size(); ++i) {
+      argv.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    pid_t pid = fork();
+    CHECK_NE(pid, -1);
+    if (pid == 0) {
+      execv(argv[0], &argv[0]);
+      _exit(1);
+    }
+    return pid;
+  }
+
+  // Connects to the server listening on socket_path, waiting for it to start. Returns -1 if the
+  // server exits first.
+  int Connect(const std::string& socket_path, pid_t server_pid) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    CHECK_LT(socket_path.size(), sizeof(address.sun_path));
+    strcpy(address.sun_path, socket_path.c_str());
+    while (true) {
+      int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+      CHECK_NE(fd, -1);
+      if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        return fd;
+      }
+      close(fd);
+      int status;
+      if (waitpid(server_pid, &status, WNOHANG) == server_pid) {
+        return -1;
+      }
+      usleep(100 * 1000);
+    }
+  }
+
+  // Sends a job with the given options and file descriptors, and returns the server's status.
+  int32_t SubmitJob(int connection_fd, const std::vector<std::string>& options, int zip_fd,
+                    int oat_fd) {
+    std::string payload;
+    for (size_t i = 0; i < options.size(); ++i) {
+      payload += options[i];
+      payload += '\0';
+    }
+    iovec iov;
+    iov.iov_base = &payload[0];
+    iov.iov_len = payload.size();
+    union {
+      cmsghdr align;
+      char data[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof(control.data);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    int* fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+    fds[0] = zip_fd;
+    fds[1] = oat_fd;
+    CHECK_EQ(static_cast<ssize_t>(payload.size()),
+             TEMP_FAILURE_RETRY(sendmsg(connection_fd, &message, 0)));
+    int32_t status = -1;
+    CHECK_EQ(static_cast<ssize_t>(sizeof(status)),
+             TEMP_FAILURE_RETRY(read(connection_fd, &status, sizeof(status))));
+    return status;
+  }
+};
+
+TEST_F(Dex2oatTest, CompilationServer) {
+  std::string socket_path(android_data_ + "/dex2oat.socket");
+  pid_t server_pid = StartServer(socket_path, 1, false);
+  int connection_fd = Connect(socket_path, server_pid);
+  ASSERT_NE(-1, connection_fd) << "dex2oat server exited before accepting jobs";
+
+  // Only the server's user may submit jobs.
+  struct stat socket_stat;
+  ASSERT_EQ(0, stat(socket_path.c_str(), &socket_stat));
+  EXPECT_TRUE(S_ISSOCK(socket_stat.st_mode));
+  EXPECT_EQ(0U, socket_stat.st_mode & (S_IRWXG | S_IRWXO));
+
+  std::string zip_location(GetTestDexFileName("Main"));
+  int zip_fd = open(zip_location.c_str(), O_RDONLY);
+  ASSERT_NE(-1, zip_fd);
+  ScratchFile oat;
+  std::vector<std::string> options;
+  options.push_back("--zip-location=" + zip_location);
+  options.push_back("--oat-location=" + oat.GetFilename());
+  EXPECT_EQ(EXIT_SUCCESS, SubmitJob(connection_fd, options, zip_fd, oat.GetFd()));
+  close(zip_fd);
+  close(connection_fd);
+
+  // The server exits after its only job, and removes its socket.
+  int status;
+  ASSERT_EQ(server_pid, TEMP_FAILURE_RETRY(waitpid(server_pid, &status, 0)));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+  EXPECT_EQ(-1, access(socket_path.c_str(), F_OK));
+
+  std::string error_msg;
+  UniquePtr<OatFile> oat_file(OatFile::Open(oat.GetFilename(), oat.GetFilename(), NULL, false,
+                                            &error_msg));
+  ASSERT_TRUE(oat_file.get() != NULL) << error_msg;
+  ASSERT_TRUE(oat_file->GetOatHeader().IsValid());
+  EXPECT_EQ(1U, oat_file->GetOatHeader().GetDexFileCount());
+  uint32_t dex_checksum;
+  ASSERT_TRUE(DexFile::GetChecksum(zip_location.c_str(), &dex_checksum, &error_msg)) << error_msg;
+  EXPECT_TRUE(oat_file->GetOatDexFile(zip_location.c_str(), &dex_checksum, false) != NULL);
+}
+
+// More jobs than fit in the JNI local reference table of the server's main thread.
+TEST_F(Dex2oatTest, CompilationServerRunsManyJobs) {
+  const size_t kJobs = 600;
+  std::string socket_path(android_data_ + "/dex2oat.socket");
+  pid_t server_pid = StartServer(socket_path, kJobs, true);
+  int connection_fd = Connect(socket_path, server_pid);
+  ASSERT_NE(-1, connection_fd) << "dex2oat server exited before accepting jobs";
+
+  std::string zip_location(GetTestDexFileName("Main"));
+  for (size_t i = 0; i < kJobs; ++i) {
+    int zip_fd = open(zip_location.c_str(), O_RDONLY);
+    ASSERT_NE(-1, zip_fd);
+    ScratchFile oat;
+    std::vector<std::string> options;
+    options.push_back("--zip-location=" + zip_location);
+    options.push_back("--oat-location=" + oat.GetFilename());
+    ASSERT_EQ(EXIT_SUCCESS, SubmitJob(connection_fd, options, zip_fd, oat.GetFd())) << i;
+    close(zip_fd);
+    EXPECT_LT(0, oat.GetFile()->GetLength()) << i;
+  }
+  close(connection_fd);
+
+  int status;
+  ASSERT_EQ(server_pid, TEMP_FAILURE_RETRY(waitpid(server_pid, &status, 0)));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+}
+
+TEST_F(Dex2oatTest, CompilationServerRejectsMalformedJob) {
+  std::string socket_path(android_data_ + "/dex2oat.socket");
+  pid_t server_pid = StartServer(socket_path, 1, false);
+  int connection_fd = Connect(socket_path, server_pid);
+  ASSERT_NE(-1, connection_fd) << "dex2oat server exited before accepting jobs";
+
+  std::string zip_location(GetTestDexFileName("Main"));
+  int zip_fd = open(zip_location.c_str(), O_RDONLY);
+  ASSERT_NE(-1, zip_fd);
+  ScratchFile oat;
+  std::vector<std::string> options;
+  options.push_back("--zip-location=" + zip_location);
+  EXPECT_EQ(EXIT_FAILURE, SubmitJob(connection_fd, options, zip_fd, oat.GetFd()));
+  close(zip_fd);
+  close(connection_fd);
+
+  int status;
+  ASSERT_EQ(server_pid, TEMP_FAILURE_RETRY(waitpid(server_pid, &status, 0)));
+  EXPECT_EQ(0, oat.GetFile()->GetLength());
+}
+
+}  // namespace art
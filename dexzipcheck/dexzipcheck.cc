@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/stringpiece.h"
+#include "dex_file.h"
+#include "UniquePtr.h"
+#include "utils.h"
+#include "zip_archive.h"
+
+namespace art {
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: dexzipcheck [options] <file.jar|file.apk>...\n"
+          "    Checks that classes.dex is stored uncompressed and aligned, so that the runtime\n"
+          "    maps it straight from the zip file instead of inflating it into private memory.\n"
+          "    Example: dexzipcheck /system/framework/core-libart.jar\n"
+          "    Example: dexzipcheck --alignment=4096 /data/app/Calculator.apk\n"
+          "\n");
+  fprintf(stderr,
+          "  --alignment=<bytes>: the alignment required of the classes.dex data, a power of two\n"
+          "      and a multiple of %zd. A page alignment also keeps the mapping from sharing a\n"
+          "      page with zip headers.\n"
+          "      Example: --alignment=4096\n"
+          "      Default: %zd\n"
+          "\n", DexFile::kClassesDexAlignment, DexFile::kClassesDexAlignment);
+  fprintf(stderr,
+          "  --verbose: also report the zip files that pass.\n"
+          "\n");
+  exit(EXIT_FAILURE);
+}
+
+static bool ParseInt(const char* in, int* out) {
+  char* end;
+  int result = strtol(in, &end, 10);
+  if (in == end || *end != '\0') {
+    return false;
+  }
+  *out = result;
+  return true;
+}
+
+// Returns whether the classes.dex of the given zip file can be mapped directly.
+static bool CheckZipFile(const char* zip_filename, size_t alignment, bool verbose) {
+  std::string error_msg;
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(zip_filename, &error_msg));
+  if (zip_archive.get() == NULL) {
+    fprintf(stderr, "%s: failed to open zip archive: %s\n", zip_filename, error_msg.c_str());
+    return false;
+  }
+  UniquePtr<ZipEntry> zip_entry(zip_archive->Find(DexFile::kClassesDex, &error_msg));
+  if (zip_entry.get() == NULL) {
+    fprintf(stderr, "%s: no %s: %s\n", zip_filename, DexFile::kClassesDex, error_msg.c_str());
+    return false;
+  }
+  int64_t offset = zip_entry->GetDataOffset();
+  if (!zip_entry->IsUncompressed()) {
+    fprintf(stdout, "%s: %s is compressed and will be extracted into memory\n", zip_filename,
+            DexFile::kClassesDex);
+    return false;
+  }
+  if (!zip_entry->IsAlignedTo(alignment)) {
+    fprintf(stdout, "%s: %s is stored at offset %" PRId64 ", which is not %zd byte aligned\n",
+            zip_filename, DexFile::kClassesDex, offset, alignment);
+    return false;
+  }
+  if (verbose) {
+    fprintf(stdout, "%s: %s is stored at offset %" PRId64 " and will be mapped directly\n",
+            zip_filename, DexFile::kClassesDex, offset);
+  }
+  return true;
+}
+
+static int dexzipcheck(int argc, char** argv) {
+  InitLogging(argv);
+
+  // Skip over argv[0].
+  argv++;
+  argc--;
+
+  size_t alignment = DexFile::kClassesDexAlignment;
+  bool verbose = false;
+  std::vector<const char*> zip_filenames;
+  for (int i = 0; i < argc; i++) {
+    const StringPiece option(argv[i]);
+    if (option.starts_with("--alignment=")) {
+      const char* alignment_str = option.substr(strlen("--alignment=")).data();
+      int alignment_value;
+      if (!ParseInt(alignment_str, &alignment_value) || alignment_value <= 0 ||
+          !IsPowerOfTwo(alignment_value) ||
+          alignment_value % DexFile::kClassesDexAlignment != 0) {
+        fprintf(stderr, "Invalid --alignment %s\n", alignment_str);
+        usage();
+      }
+      alignment = alignment_value;
+    } else if (option == "--verbose") {
+      verbose = true;
+    } else if (option.starts_with("--")) {
+      fprintf(stderr, "Unknown argument %s\n", option.data());
+      usage();
+    } else {
+      zip_filenames.push_back(argv[i]);
+    }
+  }
+
+  if (zip_filenames.empty()) {
+    fprintf(stderr, "No zip files specified\n");
+    usage();
+  }
+
+  size_t failures = 0;
+  for (size_t i = 0; i < zip_filenames.size(); ++i) {
+    if (!CheckZipFile(zip_filenames[i], alignment, verbose)) {
+      failures++;
+    }
+  }
+  if (failures != 0) {
+    fprintf(stdout, "%zd of %zd zip files cannot be mapped directly\n", failures,
+            zip_filenames.size());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace art
+
+int main(int argc, char** argv) {
+  return art::dexzipcheck(argc, argv);
+}
@@ -14,14 +14,18 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/stringpiece.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -53,6 +57,16 @@
 
 namespace art {
 
+static bool ParseInt(const char* in, int* out) {
+  char* end;
+  int result = strtol(in, &end, 10);
+  if (in == end || *end != '\0') {
+    return false;
+  }
+  *out = result;
+  return true;
+}
+
 static void usage() {
   fprintf(stderr,
           "Usage: oatdump [options] ...\n"
@@ -81,6 +95,18 @@ static void usage() {
           "  --output=<file> may be used to send the output to a file.\n"
           "      Example: --output=/tmp/oatdump.txt\n"
           "\n");
+  fprintf(stderr,
+          "  -j<number>: specifies the number of threads used to dump the classes of each dex\n"
+          "      file. The output is the same whatever the number of threads.\n"
+          "      Example: -j4\n"
+          "      Default: 1\n"
+          "\n");
+  fprintf(stderr,
+          "  --method-stats=(csv|json): with --oat-file, dumps one record per method\n"
+          "      instead of the text dump: the size of its code, frame, mapping table, vmap\n"
+          "      table and gc map, and how many methods share each of them.\n"
+          "      Example: --method-stats=csv\n"
+          "\n");
   exit(EXIT_FAILURE);
 }
 
@@ -96,17 +122,37 @@ const char* image_roots_descriptions_[] = {
   "kClassRoots",
 };
 
+enum MethodStatsFormat {
+  kMethodStatsNone,  // Dump everything as text.
+  kMethodStatsCsv,
+  kMethodStatsJson,
+};
+
+static const char* kMethodStatsColumns[] = {
+  "dex_file", "class", "method", "dex_method_idx", "code_offset", "code_size", "code_shared",
+  "frame_size", "mapping_table_size", "mapping_table_shared", "vmap_table_size",
+  "vmap_table_shared", "gc_map_size", "gc_map_shared",
+};
+
 class OatDumper {
  public:
-  explicit OatDumper(const std::string& host_prefix, const OatFile& oat_file)
+  explicit OatDumper(const std::string& host_prefix, const OatFile& oat_file,
+                     size_t thread_count = 1, MethodStatsFormat method_stats = kMethodStatsNone)
     : host_prefix_(host_prefix),
       oat_file_(oat_file),
       oat_dex_files_(oat_file.GetOatDexFiles()),
+      thread_count_(thread_count),
+      method_stats_(method_stats),
+      wrote_method_stats_(false),
       disassembler_(Disassembler::Create(oat_file_.GetOatHeader().GetInstructionSet())) {
     AddAllOffsets();
   }
 
   void Dump(std::ostream& os) {
+    if (method_stats_ != kMethodStatsNone) {
+      DumpMethodStats(os);
+      return;
+    }
     const OatHeader& oat_header = oat_file_.GetOatHeader();
 
     os << "MAGIC:\n";
@@ -243,20 +289,57 @@ class OatDumper {
   }
 
   void AddOffsets(const OatFile::OatMethod& oat_method) {
-    uint32_t code_offset = oat_method.GetCodeOffset();
-    if (oat_file_.GetOatHeader().GetInstructionSet() == kThumb2) {
-      code_offset &= ~0x1;
-    }
+    uint32_t code_offset = GetCodeOffset(oat_method);
     offsets_.insert(code_offset);
     offsets_.insert(oat_method.GetMappingTableOffset());
     offsets_.insert(oat_method.GetVmapTableOffset());
     offsets_.insert(oat_method.GetNativeGcMapOffset());
+    // The compiler dedupes identical code and tables, so count the methods sharing each of them.
+    AddReference(code_offset);
+    AddReference(oat_method.GetMappingTableOffset());
+    AddReference(oat_method.GetVmapTableOffset());
+    AddReference(oat_method.GetNativeGcMapOffset());
+  }
+
+  void AddReference(uint32_t offset) {
+    if (offset == 0) {
+      return;
+    }
+    SafeMap<uint32_t, uint32_t>::iterator it = references_.find(offset);
+    if (it == references_.end()) {
+      references_.Put(offset, 1);
+    } else {
+      ++it->second;
+    }
+  }
+
+  uint32_t GetReferences(uint32_t offset) const {
+    SafeMap<uint32_t, uint32_t>::const_iterator it = references_.find(offset);
+    return (it != references_.end()) ? it->second : 0;
+  }
+
+  uint32_t GetCodeOffset(const OatFile::OatMethod& oat_method) {
+    uint32_t code_offset = oat_method.GetCodeOffset();
+    if (GetInstructionSet() == kThumb2) {
+      code_offset &= ~0x1;
+    }
+    return code_offset;
+  }
+
+  size_t GetTableSize(uint32_t offset) {
+    return (offset != 0) ? ComputeSize(oat_file_.Begin() + offset) : 0;
   }
 
   void DumpOatDexFile(std::ostream& os, const OatFile::OatDexFile& oat_dex_file) {
     os << "OAT DEX FILE:\n";
     os << StringPrintf("location: %s\n", oat_dex_file.GetDexFileLocation().c_str());
     os << StringPrintf("checksum: 0x%08x\n", oat_dex_file.GetDexFileLocationChecksum());
+    const OatDexCacheTable* dex_cache_table = oat_dex_file.GetDexCacheTable();
+    if (dex_cache_table != NULL) {
+      os << StringPrintf("preloaded dex cache: %u strings, %u types, %u methods, %u fields\n",
+                         dex_cache_table->num_strings_, dex_cache_table->num_types_,
+                         dex_cache_table->num_methods_, dex_cache_table->num_fields_);
+    }
 
     // Create the verifier early.
 
@@ -266,23 +349,270 @@ class OatDumper {
       os << "NOT FOUND: " << error_msg << "\n\n";
       return;
     }
-    for (size_t class_def_index = 0; class_def_index < dex_file->NumClassDefs(); class_def_index++) {
-      const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
-      const char* descriptor = dex_file->GetClassDescriptor(class_def);
-      UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file.GetOatClass(class_def_index));
-      CHECK(oat_class.get() != NULL);
-      os << StringPrintf("%zd: %s (type_idx=%d)", class_def_index, descriptor, class_def.class_idx_)
-         << " (" << oat_class->GetStatus() << ")"
-         << " (" << oat_class->GetType() << ")\n";
-      // TODO: include bitmap here if type is kOatClassBitmap?
-      Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
-      std::ostream indented_os(&indent_filter);
-      DumpOatClass(indented_os, *oat_class.get(), *(dex_file.get()), class_def);
+    DumpClasses(os, oat_dex_file, *dex_file.get());
+
+    os << std::flush;
+  }
+
+  // The classes of a dex file being dumped by several threads.
+  struct ClassDumps {
+    ClassDumps(OatDumper* dumper, const OatFile::OatDexFile& oat_dex_file,
+               const DexFile& dex_file)
+        : dumper(dumper), oat_dex_file(oat_dex_file), dex_file(dex_file),
+          lock("oatdump class dumps lock"), cond("oatdump class dumps condition", lock),
+          next_class(0), written_classes(0), dumps(dex_file.NumClassDefs(), NULL) {}
+
+    OatDumper* const dumper;
+    const OatFile::OatDexFile& oat_dex_file;
+    const DexFile& dex_file;
+    Mutex lock;
+    ConditionVariable cond GUARDED_BY(lock);
+    size_t next_class GUARDED_BY(lock);
+    size_t written_classes GUARDED_BY(lock);
+    // The dump of each class from when it is done until it is written.
+    std::vector<std::string*> dumps GUARDED_BY(lock);
+  };
+
+  // How far the dumping threads may get ahead of the class being written.
+  static const size_t kMaxPendingClasses = 256;
+
+  // Dumps the classes of a dex file in order, dumping them on thread_count_ threads if there are
+  // several.
+  void DumpClasses(std::ostream& os, const OatFile::OatDexFile& oat_dex_file,
+                   const DexFile& dex_file) {
+    const size_t class_count = dex_file.NumClassDefs();
+    if (thread_count_ <= 1 || class_count <= 1) {
+      for (size_t class_def_index = 0; class_def_index < class_count; class_def_index++) {
+        std::ostringstream class_os;
+        DumpClass(class_os, disassembler_.get(), oat_dex_file, dex_file, class_def_index);
+        WriteClass(os, class_os.str());
+      }
+      return;
     }
 
+    // The dumping threads need the mutator lock to verify, so don't hold on to it while waiting.
+    Thread* self = Thread::Current();
+    ScopedThreadStateChange tsc(self, kNative);
+    ClassDumps dumps(this, oat_dex_file, dex_file);
+    std::vector<pthread_t> threads(std::min(thread_count_, class_count));
+    for (size_t i = 0; i < threads.size(); ++i) {
+      CHECK_PTHREAD_CALL(pthread_create, (&threads[i], NULL, &RunClassDumpThread, &dumps),
+                         "oatdump thread");
+    }
+    for (size_t class_def_index = 0; class_def_index < class_count; class_def_index++) {
+      std::string* dump;
+      {
+        MutexLock mu(self, dumps.lock);
+        while (dumps.dumps[class_def_index] == NULL) {
+          dumps.cond.Wait(self);
+        }
+        dump = dumps.dumps[class_def_index];
+        dumps.dumps[class_def_index] = NULL;
+        dumps.written_classes = class_def_index + 1;
+        dumps.cond.Broadcast(self);
+      }
+      WriteClass(os, *dump);
+      delete dump;
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+      CHECK_PTHREAD_CALL(pthread_join, (threads[i], NULL), "oatdump thread");
+    }
+  }
+
+  static void* RunClassDumpThread(void* arg) {
+    ClassDumps* dumps = reinterpret_cast<ClassDumps*>(arg);
+    Runtime* runtime = Runtime::Current();
+    if (runtime != NULL) {
+      CHECK(runtime->AttachCurrentThread("oatdump thread", true, NULL, false));
+    }
+    dumps->dumper->DumpClassesOnThread(dumps);
+    if (runtime != NULL) {
+      runtime->DetachCurrentThread();
+    }
+    return NULL;
+  }
+
+  void DumpClassesOnThread(ClassDumps* dumps) {
+    Thread* self = Thread::Current();
+    // Disassemblers keep state between instructions, so each thread needs its own.
+    UniquePtr<Disassembler> disassembler(Disassembler::Create(GetInstructionSet()));
+    while (true) {
+      size_t class_def_index;
+      {
+        MutexLock mu(self, dumps->lock);
+        while (dumps->next_class < dumps->dumps.size() &&
+               dumps->next_class >= dumps->written_classes + kMaxPendingClasses) {
+          dumps->cond.Wait(self);
+        }
+        if (dumps->next_class == dumps->dumps.size()) {
+          break;
+        }
+        class_def_index = dumps->next_class++;
+      }
+      std::ostringstream class_os;
+      DumpClass(class_os, disassembler.get(), dumps->oat_dex_file, dumps->dex_file,
+                class_def_index);
+      std::string* dump = new std::string(class_os.str());
+      MutexLock mu(self, dumps->lock);
+      dumps->dumps[class_def_index] = dump;
+      dumps->cond.Broadcast(self);
+    }
+  }
+
+  void WriteClass(std::ostream& os, const std::string& dump) {
+    if (method_stats_ == kMethodStatsJson && !dump.empty()) {
+      // Separate the records of this class from those of the previous ones.
+      if (wrote_method_stats_) {
+        os << ",\n";
+      }
+      wrote_method_stats_ = true;
+    }
+    os << dump;
+  }
+
+  void DumpClass(std::ostream& os, Disassembler* disassembler,
+                 const OatFile::OatDexFile& oat_dex_file, const DexFile& dex_file,
+                 size_t class_def_index) {
+    const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
+    const char* descriptor = dex_file.GetClassDescriptor(class_def);
+    UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file.GetOatClass(class_def_index));
+    CHECK(oat_class.get() != NULL);
+    if (method_stats_ != kMethodStatsNone) {
+      DumpClassMethodStats(os, *oat_class.get(), dex_file, class_def);
+      return;
+    }
+    os << StringPrintf("%zd: %s (type_idx=%d)", class_def_index, descriptor, class_def.class_idx_)
+       << " (" << oat_class->GetStatus() << ")"
+       << " (" << oat_class->GetType() << ")\n";
+    // TODO: include bitmap here if type is kOatClassBitmap?
+    Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
+    std::ostream indented_os(&indent_filter);
+    DumpOatClass(indented_os, disassembler, *oat_class.get(), dex_file, class_def);
+  }
+
+  void DumpMethodStats(std::ostream& os) {
+    if (method_stats_ == kMethodStatsCsv) {
+      for (size_t i = 0; i < arraysize(kMethodStatsColumns); ++i) {
+        os << (i != 0 ? "," : "") << kMethodStatsColumns[i];
+      }
+      os << "\n";
+    } else {
+      std::ostringstream instruction_set;
+      instruction_set << GetInstructionSet();
+      os << "{\"oat_file\": " << QuoteJson(oat_file_.GetLocation()) << ",\n"
+         << " \"instruction_set\": " << QuoteJson(instruction_set.str()) << ",\n"
+         << " \"methods\": [\n";
+    }
+    for (size_t i = 0; i < oat_dex_files_.size(); i++) {
+      const OatFile::OatDexFile* oat_dex_file = oat_dex_files_[i];
+      CHECK(oat_dex_file != NULL);
+      std::string error_msg;
+      UniquePtr<const DexFile> dex_file(oat_dex_file->OpenDexFile(&error_msg));
+      if (dex_file.get() == NULL) {
+        LOG(WARNING) << "Failed to open dex file '" << oat_dex_file->GetDexFileLocation()
+            << "': " << error_msg;
+        continue;
+      }
+      DumpClasses(os, *oat_dex_file, *dex_file.get());
+    }
+    if (method_stats_ == kMethodStatsJson) {
+      os << "\n]}\n";
+    }
     os << std::flush;
   }
 
+  void DumpClassMethodStats(std::ostream& os, const OatFile::OatClass& oat_class,
+                            const DexFile& dex_file, const DexFile::ClassDef& class_def) {
+    const byte* class_data = dex_file.GetClassData(class_def);
+    if (class_data == NULL) {
+      return;
+    }
+    const char* descriptor = dex_file.GetClassDescriptor(class_def);
+    ClassDataItemIterator it(dex_file, class_data);
+    SkipAllFields(it);
+    uint32_t class_method_idx = 0;
+    while (it.HasNext()) {
+      if (method_stats_ == kMethodStatsJson && class_method_idx != 0) {
+        os << ",\n";
+      }
+      DumpMethodStatsRecord(os, dex_file, descriptor, it.GetMemberIndex(),
+                            oat_class.GetOatMethod(class_method_idx));
+      class_method_idx++;
+      it.Next();
+    }
+  }
+
+  void DumpMethodStatsRecord(std::ostream& os, const DexFile& dex_file, const char* descriptor,
+                             uint32_t dex_method_idx, const OatFile::OatMethod& oat_method) {
+    const uint32_t code_offset = GetCodeOffset(oat_method);
+    const uint32_t mapping_table_offset = oat_method.GetMappingTableOffset();
+    const uint32_t vmap_table_offset = oat_method.GetVmapTableOffset();
+    const uint32_t gc_map_offset = oat_method.GetNativeGcMapOffset();
+    const std::string strings[] = {
+      dex_file.GetLocation(),
+      PrettyDescriptor(descriptor),
+      PrettyMethod(dex_method_idx, dex_file, true),
+    };
+    const uint64_t numbers[] = {
+      dex_method_idx,
+      code_offset,
+      oat_method.GetCodeSize(),
+      GetReferences(code_offset),
+      oat_method.GetFrameSizeInBytes(),
+      GetTableSize(mapping_table_offset),
+      GetReferences(mapping_table_offset),
+      GetTableSize(vmap_table_offset),
+      GetReferences(vmap_table_offset),
+      GetTableSize(gc_map_offset),
+      GetReferences(gc_map_offset),
+    };
+    DCHECK_EQ(arraysize(strings) + arraysize(numbers), arraysize(kMethodStatsColumns));
+    const bool json = (method_stats_ == kMethodStatsJson);
+    os << (json ? "{" : "");
+    for (size_t i = 0; i < arraysize(kMethodStatsColumns); ++i) {
+      if (i != 0) {
+        os << (json ? ", " : ",");
+      }
+      if (json) {
+        os << "\"" << kMethodStatsColumns[i] << "\": ";
+      }
+      if (i < arraysize(strings)) {
+        os << (json ? QuoteJson(strings[i]) : QuoteCsv(strings[i]));
+      } else {
+        os << numbers[i - arraysize(strings)];
+      }
+    }
+    os << (json ? "}" : "\n");
+  }
+
+  static std::string QuoteCsv(const std::string& s) {
+    std::string result("\"");
+    for (char c : s) {
+      if (c == '"') {
+        result += '"';
+      }
+      result += c;
+    }
+    result += '"';
+    return result;
+  }
+
+  static std::string QuoteJson(const std::string& s) {
+    std::string result("\"");
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        result += '\\';
+        result += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        StringAppendF(&result, "\\u%04x", c);
+      } else {
+        result += c;
+      }
+    }
+    result += '"';
+    return result;
+  }
+
   static void SkipAllFields(ClassDataItemIterator& it) {
     while (it.HasNextStaticField()) {
       it.Next();
@@ -292,7 +622,8 @@ class OatDumper {
     }
   }
 
-  void DumpOatClass(std::ostream& os, const OatFile::OatClass& oat_class, const DexFile& dex_file,
+  void DumpOatClass(std::ostream& os, Disassembler* disassembler,
+                    const OatFile::OatClass& oat_class, const DexFile& dex_file,
                     const DexFile::ClassDef& class_def) {
     const byte* class_data = dex_file.GetClassData(class_def);
     if (class_data == NULL) {  // empty class such as a marker interface?
@@ -303,14 +634,14 @@ class OatDumper {
     uint32_t class_method_idx = 0;
     while (it.HasNextDirectMethod()) {
       const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
-      DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
+      DumpOatMethod(os, disassembler, class_def, class_method_idx, oat_method, dex_file,
                     it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
       class_method_idx++;
       it.Next();
     }
     while (it.HasNextVirtualMethod()) {
       const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
-      DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
+      DumpOatMethod(os, disassembler, class_def, class_method_idx, oat_method, dex_file,
                     it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
       class_method_idx++;
       it.Next();
@@ -319,8 +650,8 @@ class OatDumper {
     os << std::flush;
   }
 
-  void DumpOatMethod(std::ostream& os, const DexFile::ClassDef& class_def,
-                     uint32_t class_method_index,
+  void DumpOatMethod(std::ostream& os, Disassembler* disassembler,
+                     const DexFile::ClassDef& class_def, uint32_t class_method_index,
                      const OatFile::OatMethod& oat_method, const DexFile& dex_file,
                      uint32_t dex_method_idx, const DexFile::CodeItem* code_item,
                      uint32_t method_access_flags) {
@@ -390,9 +721,9 @@ class OatDumper {
         verifier::MethodVerifier verifier(&dex_file, &dex_cache, &class_loader, &class_def, code_item,
                                           dex_method_idx, nullptr, method_access_flags, true, true);
         verifier.Verify();
-        DumpCode(indent2_os, &verifier, oat_method, code_item);
+        DumpCode(indent2_os, disassembler, &verifier, oat_method, code_item);
       } else {
-        DumpCode(indent2_os, nullptr, oat_method, code_item);
+        DumpCode(indent2_os, disassembler, nullptr, oat_method, code_item);
       }
     }
   }
@@ -642,7 +973,7 @@ class OatDumper {
     }
   }
 
-  void DumpCode(std::ostream& os, verifier::MethodVerifier* verifier,
+  void DumpCode(std::ostream& os, Disassembler* disassembler, verifier::MethodVerifier* verifier,
                 const OatFile::OatMethod& oat_method, const DexFile::CodeItem* code_item) {
     const void* code = oat_method.GetCode();
     size_t code_size = oat_method.GetCodeSize();
@@ -654,7 +985,7 @@ class OatDumper {
     size_t offset = 0;
     while (offset < code_size) {
       DumpMappingAtOffset(os, oat_method, offset, false);
-      offset += disassembler_->Dump(os, native_pc + offset);
+      offset += disassembler->Dump(os, native_pc + offset);
       uint32_t dex_pc = DumpMappingAtOffset(os, oat_method, offset, true);
       if (dex_pc != DexFile::kDexNoIndex) {
         DumpGcMapAtNativePcOffset(os, oat_method, code_item, offset);
@@ -669,6 +1000,13 @@ class OatDumper {
   const OatFile& oat_file_;
   std::vector<const OatFile::OatDexFile*> oat_dex_files_;
   std::set<uint32_t> offsets_;
+  // The number of methods referring to each code and table offset.
+  SafeMap<uint32_t, uint32_t> references_;
+  const size_t thread_count_;
+  const MethodStatsFormat method_stats_;
+  // Whether a JSON method record has been written, and the next needs a separator.
+  bool wrote_method_stats_;
+  // The disassembler of the main thread.
   UniquePtr<Disassembler> disassembler_;
 };
 
@@ -676,9 +1014,9 @@ class ImageDumper {
  public:
   explicit ImageDumper(std::ostream* os, const std::string& image_filename,
                        const std::string& host_prefix, gc::space::ImageSpace& image_space,
-                       const ImageHeader& image_header)
+                       const ImageHeader& image_header, size_t thread_count)
       : os_(os), image_filename_(image_filename), host_prefix_(host_prefix),
-        image_space_(image_space), image_header_(image_header) {}
+        image_space_(image_space), image_header_(image_header), thread_count_(thread_count) {}
 
   void Dump() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     std::ostream& os = *os_;
@@ -760,7 +1098,7 @@ class ImageDumper {
 
     stats_.oat_file_bytes = oat_file->Size();
 
-    oat_dumper_.reset(new OatDumper(host_prefix_, *oat_file));
+    oat_dumper_.reset(new OatDumper(host_prefix_, *oat_file, thread_count_));
 
     for (const OatFile::OatDexFile* oat_dex_file : oat_file->GetOatDexFiles()) {
       CHECK(oat_dex_file != NULL);
@@ -1369,6 +1707,7 @@ class ImageDumper {
   const std::string host_prefix_;
   gc::space::ImageSpace& image_space_;
   const ImageHeader& image_header_;
+  const size_t thread_count_;
 
   DISALLOW_COPY_AND_ASSIGN(ImageDumper);
 };
@@ -1392,6 +1731,8 @@ static int oatdump(int argc, char** argv) {
   UniquePtr<std::string> host_prefix;
   std::ostream* os = &std::cout;
   UniquePtr<std::ofstream> out;
+  int thread_count = 1;
+  MethodStatsFormat method_stats = kMethodStatsNone;
 
   for (int i = 0; i < argc; i++) {
     const StringPiece option(argv[i]);
@@ -1411,6 +1752,17 @@ static int oatdump(int argc, char** argv) {
         usage();
       }
       os = out.get();
+    } else if (option.starts_with("-j")) {
+      const char* thread_count_str = option.substr(strlen("-j")).data();
+      if (!ParseInt(thread_count_str, &thread_count) || thread_count < 1) {
+        fprintf(stderr, "Failed to parse -j argument '%s' as a positive integer\n",
+                thread_count_str);
+        usage();
+      }
+    } else if (option == "--method-stats=csv") {
+      method_stats = kMethodStatsCsv;
+    } else if (option == "--method-stats=json") {
+      method_stats = kMethodStatsJson;
     } else {
       fprintf(stderr, "Unknown argument %s\n", option.data());
       usage();
@@ -1427,6 +1779,11 @@ static int oatdump(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  if (method_stats != kMethodStatsNone && oat_filename == NULL) {
+    fprintf(stderr, "--method-stats requires --oat-file\n");
+    return EXIT_FAILURE;
+  }
+
   if (host_prefix.get() == NULL) {
     const char* android_product_out = getenv("ANDROID_PRODUCT_OUT");
     if (android_product_out != NULL) {
@@ -1444,7 +1801,7 @@ static int oatdump(int argc, char** argv) {
       fprintf(stderr, "Failed to open oat file from '%s': %s\n", oat_filename, error_msg.c_str());
       return EXIT_FAILURE;
     }
-    OatDumper oat_dumper(*host_prefix.get(), *oat_file);
+    OatDumper oat_dumper(*host_prefix.get(), *oat_file, thread_count, method_stats);
     oat_dumper.Dump(*os);
     return EXIT_SUCCESS;
   }
@@ -1491,7 +1848,8 @@ static int oatdump(int argc, char** argv) {
     fprintf(stderr, "Invalid image header %s\n", image_filename);
     return EXIT_FAILURE;
   }
-  ImageDumper image_dumper(os, image_filename, *host_prefix.get(), *image_space, image_header);
+  ImageDumper image_dumper(os, image_filename, *host_prefix.get(), *image_space, image_header,
+                           thread_count);
   image_dumper.Dump();
   return EXIT_SUCCESS;
 }
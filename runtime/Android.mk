@@ -19,6 +19,7 @@ LOCAL_PATH := $(call my-dir)
 include art/build/Android.common.mk
 
 LIBART_COMMON_SRC_FILES := \
+	alloc_sampler.cc \
 	atomic.cc.arm \
 	barrier.cc \
 	base/allocator.cc \
@@ -54,6 +55,7 @@ LIBART_COMMON_SRC_FILES := \
 	gc/collector/semi_space.cc \
 	gc/collector/sticky_mark_sweep.cc \
 	gc/heap.cc \
+	gc/heap_histogram.cc \
 	gc/reference_queue.cc \
 	gc/space/bump_pointer_space.cc \
 	gc/space/dlmalloc_space.cc \
@@ -119,6 +121,7 @@ LIBART_COMMON_SRC_FILES := \
 	oat.cc \
 	oat_file.cc \
 	offsets.cc \
+	page_in_profile.cc \
 	os_linux.cc \
 	primitive.cc \
 	reference_table.cc \
@@ -174,6 +177,7 @@ LIBART_COMMON_SRC_FILES += \
 	entrypoints/quick/quick_jni_entrypoints.cc \
 	entrypoints/quick/quick_lock_entrypoints.cc \
 	entrypoints/quick/quick_math_entrypoints.cc \
+	entrypoints/quick/quick_memory_entrypoints.cc \
 	entrypoints/quick/quick_thread_entrypoints.cc \
 	entrypoints/quick/quick_throw_entrypoints.cc \
 	entrypoints/quick/quick_trampoline_entrypoints.cc
@@ -191,6 +195,7 @@ ifeq ($(TARGET_ARCH),arm)
 LIBART_TARGET_SRC_FILES += \
 	arch/arm/context_arm.cc.arm \
 	arch/arm/entrypoints_init_arm.cc \
+	arch/arm/interpreter_mterp_arm.S \
 	arch/arm/jni_entrypoints_arm.S \
 	arch/arm/portable_entrypoints_arm.S \
 	arch/arm/quick_entrypoints_arm.S \
@@ -201,6 +206,7 @@ ifeq ($(TARGET_ARCH),x86)
 LIBART_TARGET_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
+	arch/x86/interpreter_mterp_x86.S \
 	arch/x86/jni_entrypoints_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
@@ -211,6 +217,7 @@ ifeq ($(TARGET_ARCH),x86_64)
 LIBART_TARGET_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
+	arch/x86/interpreter_mterp_x86.S \
 	arch/x86/jni_entrypoints_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
@@ -247,6 +254,7 @@ ifeq ($(HOST_ARCH),x86)
 LIBART_HOST_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
+	arch/x86/interpreter_mterp_x86.S \
 	arch/x86/jni_entrypoints_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
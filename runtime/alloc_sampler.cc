@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "alloc_sampler.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+#include "os.h"
+#include "stack.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+AllocationSampler::AllocationSampler(size_t interval, const std::string& file)
+    : interval_(interval),
+      file_(file),
+      lock_("allocation sampler lock") {
+  CHECK_NE(interval_, 0U);
+  Reset();
+}
+
+void AllocationSampler::Reset() {
+  MutexLock mu(Thread::Current(), lock_);
+  nodes_.clear();
+  children_.clear();
+  class_descriptors_.clear();
+  class_indexes_.clear();
+  Node root = { 0, NULL, 0, 0, 0 };
+  nodes_.push_back(root);
+}
+
+struct AllocSampleStackVisitor : public StackVisitor {
+  AllocSampleStackVisitor(Thread* thread, std::vector<AllocationSampler::Frame>* frames)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, NULL), frames(frames) {}
+
+  bool VisitFrame() NO_THREAD_SAFETY_ANALYSIS {
+    if (frames->size() >= AllocationSampler::kMaxStackDepth) {
+      return false;
+    }
+    mirror::ArtMethod* m = GetMethod();
+    if (!m->IsRuntimeMethod()) {
+      AllocationSampler::Frame frame = { m, GetDexPc() };
+      frames->push_back(frame);
+    }
+    return true;
+  }
+
+  std::vector<AllocationSampler::Frame>* const frames;
+};
+
+void AllocationSampler::TakeSample(Thread* self, mirror::Class* klass, uint64_t bytes) {
+  // Walk the stack and name the class before taking the lock, to keep other threads' samples
+  // waiting as briefly as possible.
+  std::vector<Frame> frames;
+  frames.reserve(kMaxStackDepth);
+  AllocSampleStackVisitor visitor(self, &frames);
+  visitor.WalkStack();
+  std::string descriptor(ClassHelper(klass).GetDescriptor());
+
+  MutexLock mu(self, lock_);
+  uint32_t class_index;
+  SafeMap<std::string, uint32_t>::iterator it = class_indexes_.find(descriptor);
+  if (it != class_indexes_.end()) {
+    class_index = it->second;
+  } else {
+    class_index = class_descriptors_.size();
+    class_descriptors_.push_back(descriptor);
+    class_indexes_.Put(descriptor, class_index);
+  }
+  uint32_t node = 0;
+  nodes_[node].samples++;
+  nodes_[node].bytes += bytes;
+  // The frames are innermost first, the tree is rooted at the outermost frame.
+  for (std::vector<Frame>::reverse_iterator frame = frames.rbegin(); frame != frames.rend();
+      ++frame) {
+    node = GetChild(node, frame->method, frame->dex_pc);
+    nodes_[node].samples++;
+    nodes_[node].bytes += bytes;
+  }
+  node = GetChild(node, NULL, class_index);
+  nodes_[node].samples++;
+  nodes_[node].bytes += bytes;
+}
+
+uint32_t AllocationSampler::GetChild(uint32_t parent, mirror::ArtMethod* method,
+                                     uint32_t dex_pc_or_class) {
+  NodeKey key = { parent, method, dex_pc_or_class };
+  SafeMap<NodeKey, uint32_t>::iterator it = children_.find(key);
+  if (it != children_.end()) {
+    return it->second;
+  }
+  uint32_t child = nodes_.size();
+  Node node = { parent, method, dex_pc_or_class, 0, 0 };
+  nodes_.push_back(node);
+  children_.Put(key, child);
+  return child;
+}
+
+std::string AllocationSampler::GetFileName() const {
+  // Processes forked from the zygote share the option, so each writes a file of its own.
+  return StringPrintf("%s.%d", file_.c_str(), getpid());
+}
+
+bool AllocationSampler::Write(std::string* error_msg) {
+  std::string contents;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    // Write the stacks that allocated the most first.
+    std::vector<std::pair<uint64_t, uint32_t> > leaves;
+    for (size_t i = 1; i < nodes_.size(); ++i) {
+      if (nodes_[i].method == NULL) {
+        leaves.push_back(std::make_pair(nodes_[i].bytes, i));
+      }
+    }
+    std::sort(leaves.rbegin(), leaves.rend());
+    StringAppendF(&contents, "# interval=%zd samples=%llu bytes=%llu\n", interval_,
+                  static_cast<unsigned long long>(nodes_[0].samples),
+                  static_cast<unsigned long long>(nodes_[0].bytes));
+    std::vector<std::string> frames;
+    for (size_t i = 0; i < leaves.size(); ++i) {
+      const Node& leaf = nodes_[leaves[i].second];
+      frames.clear();
+      for (uint32_t node = leaf.parent; node != 0; node = nodes_[node].parent) {
+        mirror::ArtMethod* method = nodes_[node].method;
+        frames.push_back(StringPrintf("%s:%d", PrettyMethod(method, false).c_str(),
+                                      MethodHelper(method).GetLineNumFromDexPC(
+                                          nodes_[node].dex_pc_or_class)));
+      }
+      StringAppendF(&contents, "%llu %llu ", static_cast<unsigned long long>(leaf.bytes),
+                    static_cast<unsigned long long>(leaf.samples));
+      for (std::vector<std::string>::reverse_iterator frame = frames.rbegin();
+          frame != frames.rend(); ++frame) {
+        contents += *frame;
+        contents += ';';
+      }
+      contents += PrettyDescriptor(class_descriptors_[leaf.dex_pc_or_class]);
+      contents += '\n';
+    }
+  }
+
+  std::string file_name(GetFileName());
+  UniquePtr<File> file(OS::CreateEmptyFile(file_name.c_str()));
+  if (file.get() == NULL) {
+    *error_msg = StringPrintf("Failed to create allocation samples '%s': %s", file_name.c_str(),
+                              strerror(errno));
+    return false;
+  }
+  if (!file->WriteFully(contents.data(), contents.size()) || file->Close() != 0) {
+    *error_msg = StringPrintf("Failed to write allocation samples '%s': %s", file_name.c_str(),
+                              strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void AllocationSampler::DumpForSigQuit(std::ostream& os) {
+  std::string error_msg;
+  if (!Write(&error_msg)) {
+    os << error_msg << "\n";
+    return;
+  }
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Allocation samples: " << nodes_[0].samples << " of " << PrettySize(interval_)
+     << " each, " << (nodes_.size() - 1) << " call tree nodes, written to '" << GetFileName()
+     << "'\n";
+}
+
+}  // namespace art
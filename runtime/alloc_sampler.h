@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_ALLOC_SAMPLER_H_
+#define ART_RUNTIME_ALLOC_SAMPLER_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "safe_map.h"
+#include "thread.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+/*
+ * Samples the allocations of each thread once every interval bytes, capturing the allocating
+ * stack. Samples are aggregated into a call tree in which stacks with a common prefix share their
+ * nodes, with one leaf per allocated class. Each sample stands for the interval bytes allocated
+ * since the previous one, so the bytes of a leaf estimate what its stack allocated.
+ *
+ * The tree is written to "<file>.<pid>" with one line per leaf:
+ * "<bytes> <samples> <outermost frame>;...;<innermost frame>;<class>".
+ */
+class AllocationSampler {
+ public:
+  static const size_t kMaxStackDepth = 16;
+
+  struct Frame {
+    mirror::ArtMethod* method;
+    uint32_t dex_pc;
+  };
+
+  AllocationSampler(size_t interval, const std::string& file);
+
+  // Called for every allocation while the quick allocation entry points are instrumented.
+  void RecordAllocation(Thread* self, mirror::Class* klass, size_t byte_count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_) {
+    size_t bytes_left = self->alloc_sample_bytes_left_;
+    if (UNLIKELY(bytes_left == 0)) {
+      // The first allocation of the thread.
+      bytes_left = interval_;
+    }
+    if (LIKELY(byte_count < bytes_left)) {
+      self->alloc_sample_bytes_left_ = bytes_left - byte_count;
+      return;
+    }
+    // An allocation larger than the interval stands for every interval it spans.
+    size_t overshoot = byte_count - bytes_left;
+    self->alloc_sample_bytes_left_ = interval_ - overshoot % interval_;
+    TakeSample(self, klass, (overshoot / interval_ + 1) * interval_);
+  }
+
+  // Drops the samples inherited from the zygote.
+  void Reset() LOCKS_EXCLUDED(lock_);
+
+  // Writes the call tree, replacing the file of an earlier write.
+  bool Write(std::string* error_msg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_);
+
+  void DumpForSigQuit(std::ostream& os)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct Node {
+    uint32_t parent;
+    // The frame of the node, or NULL for a leaf naming the allocated class.
+    mirror::ArtMethod* method;
+    // The dex pc of the frame, or the index into class_descriptors_ of a leaf.
+    uint32_t dex_pc_or_class;
+    // Totals of all samples whose stack runs through this node.
+    uint64_t samples;
+    uint64_t bytes;
+  };
+
+  struct NodeKey {
+    uint32_t parent;
+    mirror::ArtMethod* method;
+    uint32_t dex_pc_or_class;
+
+    bool operator<(const NodeKey& other) const {
+      if (parent != other.parent) {
+        return parent < other.parent;
+      }
+      if (method != other.method) {
+        return method < other.method;
+      }
+      return dex_pc_or_class < other.dex_pc_or_class;
+    }
+  };
+
+  void TakeSample(Thread* self, mirror::Class* klass, uint64_t bytes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_);
+
+  // Returns the child of parent for the given frame or class, adding it if it is new.
+  uint32_t GetChild(uint32_t parent, mirror::ArtMethod* method, uint32_t dex_pc_or_class)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  std::string GetFileName() const;
+
+  const size_t interval_;
+  const std::string file_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Node 0 is the root, which has no frame.
+  std::vector<Node> nodes_ GUARDED_BY(lock_);
+  SafeMap<NodeKey, uint32_t> children_ GUARDED_BY(lock_);
+  // Classes are named by descriptor, as they may move.
+  std::vector<std::string> class_descriptors_ GUARDED_BY(lock_);
+  SafeMap<std::string, uint32_t> class_indexes_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSampler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_ALLOC_SAMPLER_H_
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "alloc_sampler.h"
+
+#include "base/stringprintf.h"
+#include "common_test.h"
+
+namespace art {
+
+class AllocationSamplerTest : public CommonTest {};
+
+TEST_F(AllocationSamplerTest, SamplesEveryInterval) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* klass = class_linker_->FindSystemClass("Ljava/lang/String;");
+  ASSERT_TRUE(klass != NULL);
+  std::string file(dalvik_cache_ + "/alloc_samples");
+  std::string written_file(StringPrintf("%s.%d", file.c_str(), getpid()));
+  AllocationSampler sampler(1 * KB, file);
+
+  // 10000 bytes span nine intervals.
+  for (size_t i = 0; i < 100; ++i) {
+    sampler.RecordAllocation(soa.Self(), klass, 100);
+  }
+  std::string error_msg;
+  ASSERT_TRUE(sampler.Write(&error_msg)) << error_msg;
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(written_file, &contents));
+  EXPECT_EQ("# interval=1024 samples=9 bytes=9216\n"
+            "9216 9 java.lang.String\n", contents);
+
+  // With 240 bytes left to the next sample, a 3KB allocation spans three intervals.
+  sampler.Reset();
+  sampler.RecordAllocation(soa.Self(), klass, 3 * KB);
+  ASSERT_TRUE(sampler.Write(&error_msg)) << error_msg;
+  contents.clear();
+  ASSERT_TRUE(ReadFileToString(written_file, &contents));
+  EXPECT_EQ("# interval=1024 samples=1 bytes=3072\n"
+            "3072 1 java.lang.String\n", contents);
+}
+
+}  // namespace art
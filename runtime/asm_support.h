@@ -42,4 +42,9 @@
 #define METHOD_DEX_CACHE_METHODS_OFFSET 16
 #define METHOD_CODE_OFFSET 40
 
+// Offsets within ShadowFrame.
+#define SHADOWFRAME_NUMBER_OF_VREGS_OFFSET 0
+#define SHADOWFRAME_DEX_PC_OFFSET 12
+#define SHADOWFRAME_VREGS_OFFSET 16
+
 #endif  // ART_RUNTIME_ASM_SUPPORT_H_
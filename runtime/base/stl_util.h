@@ -57,7 +57,7 @@ void STLDeleteContainerPointers(ForwardIterator begin,
 // If container is NULL, this function is a no-op.
 //
 // As an alternative to calling STLDeleteElements() directly, consider
-// ElementDeleter (defined below), which ensures that your container's elements
+// STLElementDeleter (defined below), which ensures that your container's elements
 // are deleted when the ElementDeleter goes out of scope.
 template <class T>
 void STLDeleteElements(T *container) {
@@ -66,6 +66,18 @@ void STLDeleteElements(T *container) {
   container->clear();
 }
 
+// STLElementDeleter deletes the elements of a container of pointers when it goes
+// out of scope, see STLDeleteElements().
+template <class T>
+class STLElementDeleter {
+ public:
+  explicit STLElementDeleter(T* container) : container_(container) {}
+  ~STLElementDeleter() { STLDeleteElements(container_); }
+
+ private:
+  T* const container_;
+};
+
 // Given an STL container consisting of (key, value) pairs, STLDeleteValues
 // deletes all the "value" components and clears the container.  Does nothing
 // in the case it's given a NULL pointer.
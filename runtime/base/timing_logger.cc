@@ -144,6 +144,13 @@ TimingLogger::TimingLogger(const char* name, bool precise, bool verbose)
 void TimingLogger::Reset() {
   current_split_ = NULL;
   splits_.clear();
+  worker_times_.clear();
+}
+
+void TimingLogger::AddWorkerTimes(uint64_t wall_ns, const std::vector<uint64_t>& busy_ns) {
+  CHECK(current_split_ != NULL) << "Worker times recorded outside of a split";
+  WorkerTimes times = { current_split_->label_, wall_ns, busy_ns };
+  worker_times_.push_back(times);
 }
 
 void TimingLogger::StartSplit(const char* new_split_label) {
@@ -205,6 +212,20 @@ void TimingLogger::Dump(std::ostream &os) const {
        << split.second << "\n";
   }
   os << name_ << ": end, " << NsToMs(total_ns) << " ms\n";
+  for (const WorkerTimes& times : worker_times_) {
+    uint64_t total_busy_ns = 0;
+    for (uint64_t busy_ns : times.busy_ns) {
+      total_busy_ns += busy_ns;
+    }
+    uint64_t available_ns = times.wall_ns * times.busy_ns.size();
+    os << name_ << ": " << times.label << ": " << times.busy_ns.size() << " workers "
+       << (available_ns == 0 ? 100 : total_busy_ns * 100 / available_ns) << "% busy, busy/idle";
+    for (uint64_t busy_ns : times.busy_ns) {
+      os << " " << PrettyDuration(busy_ns) << "/"
+         << PrettyDuration(times.wall_ns - std::min(busy_ns, times.wall_ns));
+    }
+    os << "\n";
+  }
 }
 
 
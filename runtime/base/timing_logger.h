@@ -96,6 +96,11 @@ class TimingLogger {
 
   void Dump(std::ostream& os) const;
 
+  // Records, for a loop run in parallel within the current split, how long each worker spent
+  // running tasks during the wall_ns the loop took. Dump reports each worker's busy and idle time
+  // after the splits, showing phases whose work was unevenly spread.
+  void AddWorkerTimes(uint64_t wall_ns, const std::vector<uint64_t>& busy_ns);
+
   // Scoped timing splits that can be nested and composed with the explicit split
   // starts and ends.
   class ScopedSplit {
@@ -160,6 +165,15 @@ class TimingLogger {
   // Splits that have ended.
   SplitTimings splits_;
 
+  struct WorkerTimes {
+    const char* label;
+    uint64_t wall_ns;
+    std::vector<uint64_t> busy_ns;
+  };
+
+  // Worker times recorded with AddWorkerTimes.
+  std::vector<WorkerTimes> worker_times_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(TimingLogger);
 };
@@ -41,6 +41,7 @@
 #include "gc/space/image_space.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "jni_internal.h"
 #include "leb128.h"
 #include "oat.h"
 #include "oat_file.h"
@@ -174,6 +175,7 @@ const char* ClassLinker::class_roots_descriptors_[] = {
 ClassLinker::ClassLinker(InternTable* intern_table)
     // dex_lock_ is recursive as it may be used in stack dumping.
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
+      app_image_lock_("ClassLinker app image lock", kAppImageLock),
       dex_cache_image_class_lookup_required_(false),
       failed_dex_cache_class_lookups_(0),
       class_roots_(NULL),
@@ -550,7 +552,12 @@ bool ClassLinker::GenerateOatFile(const char* dex_filename,
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   std::string boot_image_option_string("--boot-image=");
-  boot_image_option_string += heap->GetImageSpace()->GetImageFilename();
+  for (gc::space::ImageSpace* image_space : heap->GetImageSpaces()) {
+    if (image_space != heap->GetImageSpaces().front()) {
+      boot_image_option_string += ':';
+    }
+    boot_image_option_string += image_space->GetImageFilename();
+  }
   const char* boot_image_option = boot_image_option_string.c_str();
 
   std::string dex_file_option_string("--dex-file=");
@@ -709,8 +716,8 @@ const DexFile* ClassLinker::FindDexFileInOatLocation(const char* dex_location,
     return nullptr;
   }
   Runtime* runtime = Runtime::Current();
-  const ImageHeader& image_header = runtime->GetHeap()->GetImageSpace()->GetImageHeader();
-  uint32_t expected_image_oat_checksum = image_header.GetOatChecksum();
+  gc::Heap* heap = runtime->GetHeap();
+  uint32_t expected_image_oat_checksum = heap->GetBootImageChecksum();
   uint32_t actual_image_oat_checksum = oat_file->GetOatHeader().GetImageFileLocationOatChecksum();
   if (expected_image_oat_checksum != actual_image_oat_checksum) {
     *error_msg = StringPrintf("Failed to find oat file at '%s' with expected image oat checksum of "
@@ -719,7 +726,7 @@ const DexFile* ClassLinker::FindDexFileInOatLocation(const char* dex_location,
     return nullptr;
   }
 
-  uint32_t expected_image_oat_offset = reinterpret_cast<uint32_t>(image_header.GetOatDataBegin());
+  uint32_t expected_image_oat_offset = heap->GetBootImageOatDataBegin();
   uint32_t actual_image_oat_offset = oat_file->GetOatHeader().GetImageFileLocationOatDataBegin();
   if (expected_image_oat_offset != actual_image_oat_offset) {
     *error_msg = StringPrintf("Failed to find oat file at '%s' with expected image oat offset %ud, "
@@ -863,9 +870,8 @@ bool ClassLinker::VerifyOatFileChecksums(const OatFile* oat_file,
                                          uint32_t dex_location_checksum,
                                          std::string* error_msg) {
   Runtime* runtime = Runtime::Current();
-  const ImageHeader& image_header = runtime->GetHeap()->GetImageSpace()->GetImageHeader();
-  uint32_t image_oat_checksum = image_header.GetOatChecksum();
-  uint32_t image_oat_data_begin = reinterpret_cast<uint32_t>(image_header.GetOatDataBegin());
+  uint32_t image_oat_checksum = runtime->GetHeap()->GetBootImageChecksum();
+  uint32_t image_oat_data_begin = runtime->GetHeap()->GetBootImageOatDataBegin();
   bool image_check = ((oat_file->GetOatHeader().GetImageFileLocationOatChecksum() == image_oat_checksum)
                       && (oat_file->GetOatHeader().GetImageFileLocationOatDataBegin() == image_oat_data_begin));
 
@@ -1045,18 +1051,8 @@ void ClassLinker::InitFromImage() {
   gc::space::ImageSpace* space = heap->GetImageSpace();
   dex_cache_image_class_lookup_required_ = true;
   CHECK(space != NULL);
-  OatFile& oat_file = GetImageOatFile(space);
-  CHECK_EQ(oat_file.GetOatHeader().GetImageFileLocationOatChecksum(), 0U);
-  CHECK_EQ(oat_file.GetOatHeader().GetImageFileLocationOatDataBegin(), 0U);
-  CHECK(oat_file.GetOatHeader().GetImageFileLocation().empty());
-  portable_resolution_trampoline_ = oat_file.GetOatHeader().GetPortableResolutionTrampoline();
-  quick_resolution_trampoline_ = oat_file.GetOatHeader().GetQuickResolutionTrampoline();
-  portable_imt_conflict_trampoline_ = oat_file.GetOatHeader().GetPortableImtConflictTrampoline();
-  quick_imt_conflict_trampoline_ = oat_file.GetOatHeader().GetQuickImtConflictTrampoline();
-  mirror::Object* dex_caches_object = space->GetImageHeader().GetImageRoot(ImageHeader::kDexCaches);
-  mirror::ObjectArray<mirror::DexCache>* dex_caches =
-      dex_caches_object->AsObjectArray<mirror::DexCache>();
-
+  // The class roots and trampolines come from the first image, later images of a multi-image boot
+  // image only add their dex files.
   SirtRef<mirror::ObjectArray<mirror::Class> > class_roots(
       self,
       space->GetImageHeader().GetImageRoot(ImageHeader::kClassRoots)->AsObjectArray<mirror::Class>());
@@ -1066,25 +1062,43 @@ void ClassLinker::InitFromImage() {
   // as being Strings or not
   mirror::String::SetClass(GetClassRoot(kJavaLangString));
 
-  CHECK_EQ(oat_file.GetOatHeader().GetDexFileCount(),
-           static_cast<uint32_t>(dex_caches->GetLength()));
-  for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
-    SirtRef<mirror::DexCache> dex_cache(self, dex_caches->Get(i));
-    const std::string& dex_file_location(dex_cache->GetLocation()->ToModifiedUtf8());
-    const OatFile::OatDexFile* oat_dex_file = oat_file.GetOatDexFile(dex_file_location.c_str(),
-                                                                     nullptr);
-    CHECK(oat_dex_file != NULL) << oat_file.GetLocation() << " " << dex_file_location;
-    std::string error_msg;
-    const DexFile* dex_file = oat_dex_file->OpenDexFile(&error_msg);
-    if (dex_file == NULL) {
-      LOG(FATAL) << "Failed to open dex file " << dex_file_location
-                 << " from within oat file " << oat_file.GetLocation()
-                 << " error '" << error_msg << "'";
-    }
+  for (gc::space::ImageSpace* image_space : heap->GetImageSpaces()) {
+    OatFile& oat_file = GetImageOatFile(image_space);
+    CHECK_EQ(oat_file.GetOatHeader().GetImageFileLocationOatChecksum(), 0U);
+    CHECK_EQ(oat_file.GetOatHeader().GetImageFileLocationOatDataBegin(), 0U);
+    CHECK(oat_file.GetOatHeader().GetImageFileLocation().empty());
+    if (image_space == space) {
+      portable_resolution_trampoline_ = oat_file.GetOatHeader().GetPortableResolutionTrampoline();
+      quick_resolution_trampoline_ = oat_file.GetOatHeader().GetQuickResolutionTrampoline();
+      portable_imt_conflict_trampoline_ =
+          oat_file.GetOatHeader().GetPortableImtConflictTrampoline();
+      quick_imt_conflict_trampoline_ = oat_file.GetOatHeader().GetQuickImtConflictTrampoline();
+    }
+    mirror::Object* dex_caches_object =
+        image_space->GetImageHeader().GetImageRoot(ImageHeader::kDexCaches);
+    mirror::ObjectArray<mirror::DexCache>* dex_caches =
+        dex_caches_object->AsObjectArray<mirror::DexCache>();
+
+    CHECK_EQ(oat_file.GetOatHeader().GetDexFileCount(),
+             static_cast<uint32_t>(dex_caches->GetLength()));
+    for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
+      SirtRef<mirror::DexCache> dex_cache(self, dex_caches->Get(i));
+      const std::string& dex_file_location(dex_cache->GetLocation()->ToModifiedUtf8());
+      const OatFile::OatDexFile* oat_dex_file = oat_file.GetOatDexFile(dex_file_location.c_str(),
+                                                                       nullptr);
+      CHECK(oat_dex_file != NULL) << oat_file.GetLocation() << " " << dex_file_location;
+      std::string error_msg;
+      const DexFile* dex_file = oat_dex_file->OpenDexFile(&error_msg);
+      if (dex_file == NULL) {
+        LOG(FATAL) << "Failed to open dex file " << dex_file_location
+                   << " from within oat file " << oat_file.GetLocation()
+                   << " error '" << error_msg << "'";
+      }
 
-    CHECK_EQ(dex_file->GetLocationChecksum(), oat_dex_file->GetDexFileLocationChecksum());
+      CHECK_EQ(dex_file->GetLocationChecksum(), oat_dex_file->GetDexFileLocationChecksum());
 
-    AppendToBootClassPath(*dex_file, dex_cache);
+      AppendToBootClassPath(*dex_file, dex_cache);
+    }
   }
 
   // Set classes on AbstractMethod early so that IsMethod tests can be performed during the live
@@ -1943,6 +1957,14 @@ mirror::ArtMethod* ClassLinker::LoadMethod(Thread* self, const DexFile& dex_file
       }
     }
   }
+  if (UNLIKELY((access_flags & kAccNative) != 0)) {
+    access_flags |= GetNativeMethodOptimizationFlags(dex_file, klass->GetDexClassDefIndex(),
+                                                     dex_method_idx, access_flags);
+#if defined(ART_USE_PORTABLE_COMPILER)
+    // Portable code has no @CriticalNative bridges, see CompilerDriver::CompileMethod.
+    access_flags &= ~kAccCriticalNative;
+#endif
+  }
   dst->SetAccessFlags(access_flags);
 
   self->EndAssertNoThreadSuspension(old_cause);
@@ -2002,6 +2024,7 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file) {
   // get to a suspend point.
   SirtRef<mirror::DexCache> dex_cache(self, AllocDexCache(self, dex_file));
   CHECK(dex_cache.get() != NULL) << "Failed to allocate dex cache for " << dex_file.GetLocation();
+  PreloadDexCache(dex_file, dex_cache.get());
   {
     WriterMutexLock mu(self, dex_lock_);
     if (IsDexFileRegisteredLocked(dex_file)) {
@@ -2017,6 +2040,185 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file,
   RegisterDexFileLocked(dex_file, dex_cache);
 }
 
+void ClassLinker::PreloadDexCache(const DexFile& dex_file, mirror::DexCache* dex_cache) {
+  const OatFile* oat_file = FindOpenedOatFileForDexFile(dex_file);
+  if (oat_file == NULL) {
+    return;
+  }
+  uint32_t dex_location_checksum = dex_file.GetLocationChecksum();
+  const OatFile::OatDexFile* oat_dex_file =
+      oat_file->GetOatDexFile(dex_file.GetLocation().c_str(), &dex_location_checksum, false);
+  if (oat_dex_file == NULL || oat_dex_file->GetDexCacheTable() == NULL) {
+    return;
+  }
+  // The table holds addresses of the boot image the oat file was compiled against.
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  const OatHeader& oat_header = oat_file->GetOatHeader();
+  if (!heap->HasImageSpace() ||
+      oat_header.GetImageFileLocationOatChecksum() != heap->GetBootImageChecksum() ||
+      oat_header.GetImageFileLocationOatDataBegin() != heap->GetBootImageOatDataBegin()) {
+    return;
+  }
+  const OatDexCacheTable* table = oat_dex_file->GetDexCacheTable();
+  const uint32_t* entry = table->GetEntries();
+  for (uint32_t i = 0; i < table->num_strings_; ++i, entry += 2) {
+    dex_cache->SetResolvedString(entry[0], reinterpret_cast<mirror::String*>(entry[1]));
+  }
+  for (uint32_t i = 0; i < table->num_types_; ++i, entry += 2) {
+    dex_cache->SetResolvedType(entry[0], reinterpret_cast<mirror::Class*>(entry[1]));
+  }
+  for (uint32_t i = 0; i < table->num_methods_; ++i, entry += 2) {
+    dex_cache->SetResolvedMethod(entry[0], reinterpret_cast<mirror::ArtMethod*>(entry[1]));
+  }
+  for (uint32_t i = 0; i < table->num_fields_; ++i, entry += 2) {
+    dex_cache->SetResolvedField(entry[0], reinterpret_cast<mirror::ArtField*>(entry[1]));
+  }
+  VLOG(class_linker) << "Preloaded " << table->NumEntries() << " dex cache entries of "
+                     << dex_file.GetLocation();
+}
+
+bool ClassLinker::InstallAppImage(const DexFile& dex_file, jobject class_loader) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, app_image_lock_);
+  if (app_image_dex_files_.find(&dex_file) != app_image_dex_files_.end()) {
+    return true;
+  }
+  if (IsDexFileRegistered(dex_file)) {
+    return false;  // Classes are already being loaded from the dex file.
+  }
+  std::string image_location;
+  uint32_t oat_checksum;
+  {
+    ScopedObjectAccess soa(self);
+    const OatFile* oat_file = FindOpenedOatFileForDexFile(dex_file);
+    if (oat_file == NULL || oat_file->GetOatDexFiles().size() != 1) {
+      return false;  // App images are only written for oat files of a single dex file.
+    }
+    image_location = gc::space::ImageSpace::GetAppImageLocation(oat_file->GetLocation());
+    oat_checksum = oat_file->GetOatHeader().GetChecksum();
+    // Don't use up the app image reservation on an image that would be rejected below.
+    mirror::ClassLoader* loader = soa.Decode<mirror::ClassLoader*>(class_loader);
+    for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+      const char* descriptor = dex_file.GetClassDescriptor(dex_file.GetClassDef(i));
+      if (LookupClass(descriptor, loader) != NULL) {
+        return false;
+      }
+    }
+  }
+  if (!OS::FileExists(image_location.c_str())) {
+    return false;
+  }
+  std::string error_msg;
+  gc::space::ImageSpace* space =
+      Runtime::Current()->GetHeap()->AddAppImageSpace(image_location, oat_checksum, &error_msg);
+  if (space == NULL) {
+    LOG(WARNING) << "Failed to add app image " << image_location << ": " << error_msg;
+    return false;
+  }
+
+  ScopedObjectAccess soa(self);
+  const ImageHeader& header = space->GetImageHeader();
+  mirror::ObjectArray<mirror::DexCache>* dex_caches =
+      header.GetImageRoot(ImageHeader::kDexCaches)->AsObjectArray<mirror::DexCache>();
+  CHECK_EQ(dex_caches->GetLength(), 1) << image_location;
+  SirtRef<mirror::DexCache> dex_cache(self, dex_caches->Get(0));
+  CHECK(dex_cache->GetLocation()->Equals(dex_file.GetLocation())) << image_location;
+  // The dex cache is only registered once its classes are installed, but the classes need their
+  // dex file to be linked.
+  dex_cache->SetDexFile(&dex_file);
+  // Strings in the image that are not boot image strings are only interned once installed.
+  for (size_t i = 0; i < dex_cache->NumStrings(); ++i) {
+    mirror::String* string = dex_cache->GetResolvedString(i);
+    if (string != NULL && space->Contains(string)) {
+      mirror::String* interned = intern_table_->InternStrong(string);
+      if (interned != string) {
+        dex_cache->SetResolvedString(i, interned);
+      }
+    }
+  }
+
+  // The image writer cleared the loaders and entry points of the classes, the code is linked
+  // here as the oat file may not be mapped at the address it was compiled for.
+  mirror::ClassLoader* loader = soa.Decode<mirror::ClassLoader*>(class_loader);
+  SirtRef<mirror::ObjectArray<mirror::Class> > classes(self,
+      header.GetImageRoot(ImageHeader::kClassRoots)->AsObjectArray<mirror::Class>());
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    SirtRef<mirror::Class> klass(self, classes->Get(i));
+    klass->SetClassLoader(loader);
+    UniquePtr<const OatFile::OatClass> oat_class(GetOatClass(dex_file,
+                                                             klass->GetDexClassDefIndex()));
+    CHECK(oat_class.get() != NULL) << PrettyDescriptor(klass.get());
+    for (size_t j = 0; j < klass->NumDirectMethods(); ++j) {
+      SirtRef<mirror::ArtMethod> method(self, klass->GetDirectMethod(j));
+      LinkCode(method, oat_class.get(), j);
+    }
+    for (size_t j = 0; j < klass->NumVirtualMethods(); ++j) {
+      SirtRef<mirror::ArtMethod> method(self, klass->GetVirtualMethod(j));
+      if (method->IsMiranda()) {
+        // Miranda methods are clones of abstract interface methods.
+        method->SetEntryPointFromCompiledCode(GetCompiledCodeToInterpreterBridge());
+        method->SetEntryPointFromInterpreter(interpreter::artInterpreterToInterpreterBridge);
+      } else {
+        LinkCode(method, oat_class.get(), klass->NumDirectMethods() + j);
+      }
+    }
+    if (klass->IsInitialized()) {
+      FixupStaticTrampolines(klass.get());
+    }
+  }
+
+  if (!InsertAppImageClasses(dex_file, dex_cache, classes.get(), loader, &error_msg)) {
+    // Nothing refers to the image, it stays mapped unused as there is one per process.
+    LOG(WARNING) << "Rejecting app image " << image_location << ": " << error_msg;
+    return false;
+  }
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    Dbg::PostClassPrepare(classes->Get(i));
+  }
+  app_image_dex_files_.insert(&dex_file);
+  VLOG(class_linker) << "Installed " << classes->GetLength() << " classes from app image "
+                     << image_location;
+  return true;
+}
+
+bool ClassLinker::InsertAppImageClasses(const DexFile& dex_file,
+                                        const SirtRef<mirror::DexCache>& dex_cache,
+                                        mirror::ObjectArray<mirror::Class>* classes,
+                                        const mirror::ClassLoader* class_loader,
+                                        std::string* error_msg) {
+  // The image classes and dex cache refer to each other, so they are installed all or nothing:
+  // classes can't be defined meanwhile, and the dex file can't be registered.
+  Thread* self = Thread::Current();
+  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  std::vector<size_t> hashes(classes->GetLength());
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    const char* descriptor = ClassHelper(classes->Get(i)).GetDescriptor();
+    hashes[i] = Hash(descriptor);
+    if (LookupClassFromTableLocked(descriptor, class_loader, hashes[i]) != NULL) {
+      *error_msg = StringPrintf("class %s is already loaded", descriptor);
+      return false;
+    }
+  }
+  {
+    WriterMutexLock dex_mu(self, dex_lock_);
+    if (IsDexFileRegisteredLocked(dex_file)) {
+      *error_msg = StringPrintf("%s is already registered", dex_file.GetLocation().c_str());
+      return false;
+    }
+    RegisterDexFileLocked(dex_file, dex_cache);
+  }
+  for (int32_t i = 0; i < classes->GetLength(); ++i) {
+    mirror::Class* klass = classes->Get(i);
+    if (VLOG_IS_ON(class_linker)) {
+      LOG(INFO) << "Loaded class " << ClassHelper(klass).GetDescriptor() << " from app image";
+    }
+    Runtime::Current()->GetHeap()->VerifyObject(klass);
+    class_table_.insert(std::make_pair(hashes[i], klass));
+  }
+  class_table_dirty_ = true;
+  return true;
+}
+
 mirror::DexCache* ClassLinker::FindDexCache(const DexFile& dex_file) const {
   ReaderMutexLock mu(Thread::Current(), dex_lock_);
   // Search assuming unique-ness of dex file.
@@ -2340,9 +2542,8 @@ mirror::Class* ClassLinker::LookupClassFromTableLocked(const char* descriptor,
   return NULL;
 }
 
-static mirror::ObjectArray<mirror::DexCache>* GetImageDexCaches()
+static mirror::ObjectArray<mirror::DexCache>* GetImageDexCaches(gc::space::ImageSpace* image)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  gc::space::ImageSpace* image = Runtime::Current()->GetHeap()->GetImageSpace();
   CHECK(image != NULL);
   mirror::Object* root = image->GetImageHeader().GetImageRoot(ImageHeader::kDexCaches);
   return root->AsObjectArray<mirror::DexCache>();
@@ -2356,23 +2557,25 @@ void ClassLinker::MoveImageClassesToClassTable() {
   }
   const char* old_no_suspend_cause =
       self->StartAssertNoThreadSuspension("Moving image classes to class table");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
-  for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    mirror::ObjectArray<mirror::Class>* types = dex_cache->GetResolvedTypes();
-    for (int32_t j = 0; j < types->GetLength(); j++) {
-      mirror::Class* klass = types->Get(j);
-      if (klass != NULL) {
-        ClassHelper kh(klass);
-        DCHECK(klass->GetClassLoader() == NULL);
-        const char* descriptor = kh.GetDescriptor();
-        size_t hash = Hash(descriptor);
-        mirror::Class* existing = LookupClassFromTableLocked(descriptor, NULL, hash);
-        if (existing != NULL) {
-          CHECK(existing == klass) << PrettyClassAndClassLoader(existing) << " != "
-              << PrettyClassAndClassLoader(klass);
-        } else {
-          class_table_.insert(std::make_pair(hash, klass));
+  for (gc::space::ImageSpace* image_space : Runtime::Current()->GetHeap()->GetImageSpaces()) {
+    mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches(image_space);
+    for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
+      mirror::DexCache* dex_cache = dex_caches->Get(i);
+      mirror::ObjectArray<mirror::Class>* types = dex_cache->GetResolvedTypes();
+      for (int32_t j = 0; j < types->GetLength(); j++) {
+        mirror::Class* klass = types->Get(j);
+        if (klass != NULL) {
+          ClassHelper kh(klass);
+          DCHECK(klass->GetClassLoader() == NULL);
+          const char* descriptor = kh.GetDescriptor();
+          size_t hash = Hash(descriptor);
+          mirror::Class* existing = LookupClassFromTableLocked(descriptor, NULL, hash);
+          if (existing != NULL) {
+            CHECK(existing == klass) << PrettyClassAndClassLoader(existing) << " != "
+                << PrettyClassAndClassLoader(klass);
+          } else {
+            class_table_.insert(std::make_pair(hash, klass));
+          }
         }
       }
     }
@@ -2386,18 +2589,35 @@ mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor) {
   Thread* self = Thread::Current();
   const char* old_no_suspend_cause =
       self->StartAssertNoThreadSuspension("Image class lookup");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
-  for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    const DexFile* dex_file = dex_cache->GetDexFile();
-    // First search using the class def map, but don't bother for non-class types.
-    if (descriptor[0] == 'L') {
-      const DexFile::StringId* descriptor_string_id = dex_file->FindStringId(descriptor);
-      if (descriptor_string_id != NULL) {
+  for (gc::space::ImageSpace* image_space : Runtime::Current()->GetHeap()->GetImageSpaces()) {
+    mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches(image_space);
+    for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
+      mirror::DexCache* dex_cache = dex_caches->Get(i);
+      const DexFile* dex_file = dex_cache->GetDexFile();
+      // First search using the class def map, but don't bother for non-class types.
+      if (descriptor[0] == 'L') {
+        const DexFile::StringId* descriptor_string_id = dex_file->FindStringId(descriptor);
+        if (descriptor_string_id != NULL) {
+          const DexFile::TypeId* type_id =
+              dex_file->FindTypeId(dex_file->GetIndexForStringId(*descriptor_string_id));
+          if (type_id != NULL) {
+            mirror::Class* klass =
+                dex_cache->GetResolvedType(dex_file->GetIndexForTypeId(*type_id));
+            if (klass != NULL) {
+              self->EndAssertNoThreadSuspension(old_no_suspend_cause);
+              return klass;
+            }
+          }
+        }
+      }
+      // Now try binary searching the string/type index.
+      const DexFile::StringId* string_id = dex_file->FindStringId(descriptor);
+      if (string_id != NULL) {
         const DexFile::TypeId* type_id =
-            dex_file->FindTypeId(dex_file->GetIndexForStringId(*descriptor_string_id));
+            dex_file->FindTypeId(dex_file->GetIndexForStringId(*string_id));
         if (type_id != NULL) {
-          mirror::Class* klass = dex_cache->GetResolvedType(dex_file->GetIndexForTypeId(*type_id));
+          uint16_t type_idx = dex_file->GetIndexForTypeId(*type_id);
+          mirror::Class* klass = dex_cache->GetResolvedType(type_idx);
           if (klass != NULL) {
             self->EndAssertNoThreadSuspension(old_no_suspend_cause);
             return klass;
@@ -2405,20 +2625,6 @@ mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor) {
         }
       }
     }
-    // Now try binary searching the string/type index.
-    const DexFile::StringId* string_id = dex_file->FindStringId(descriptor);
-    if (string_id != NULL) {
-      const DexFile::TypeId* type_id =
-          dex_file->FindTypeId(dex_file->GetIndexForStringId(*string_id));
-      if (type_id != NULL) {
-        uint16_t type_idx = dex_file->GetIndexForTypeId(*type_id);
-        mirror::Class* klass = dex_cache->GetResolvedType(type_idx);
-        if (klass != NULL) {
-          self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-          return klass;
-        }
-      }
-    }
   }
   self->EndAssertNoThreadSuspension(old_no_suspend_cause);
   return NULL;
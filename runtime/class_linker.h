@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_CLASS_LINKER_H_
 #define ART_RUNTIME_CLASS_LINKER_H_
 
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -223,6 +224,14 @@ class ClassLinker {
   const OatFile* RegisterOatFile(const OatFile* oat_file)
       LOCKS_EXCLUDED(dex_lock_);
 
+  // Maps the app image written next to the oat file of dex_file, if there is one, and installs
+  // its classes with the given class loader. Returns true if the classes of dex_file come from
+  // an app image, false if they have to be loaded from the dex file, as when one of the image
+  // classes is already loaded with the class loader. Must be called from the native state, since
+  // mapping the image suspends all threads.
+  bool InstallAppImage(const DexFile& dex_file, jobject class_loader)
+      LOCKS_EXCLUDED(app_image_lock_, dex_lock_, Locks::mutator_lock_);
+
   const std::vector<const DexFile*>& GetBootClassPath() {
     return boot_class_path_;
   }
@@ -437,6 +446,19 @@ class ClassLinker {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool IsDexFileRegisteredLocked(const DexFile& dex_file) const SHARED_LOCKS_REQUIRED(dex_lock_);
 
+  // Registers the dex cache of an app image and inserts its classes, or does neither and sets
+  // error_msg if a class is already loaded with class_loader or dex_file is already registered.
+  bool InsertAppImageClasses(const DexFile& dex_file, const SirtRef<mirror::DexCache>& dex_cache,
+                             mirror::ObjectArray<mirror::Class>* classes,
+                             const mirror::ClassLoader* class_loader, std::string* error_msg)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_, dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Fills a new dex cache with the boot image objects the oat file of dex_file recorded for it.
+  void PreloadDexCache(const DexFile& dex_file, mirror::DexCache* dex_cache)
+      LOCKS_EXCLUDED(dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   bool InitializeClass(const SirtRef<mirror::Class>& klass, bool can_run_clinit,
                        bool can_init_parents)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -530,6 +552,11 @@ class ClassLinker {
   std::vector<mirror::DexCache*> dex_caches_ GUARDED_BY(dex_lock_);
   std::vector<const OatFile*> oat_files_ GUARDED_BY(dex_lock_);
 
+  // Serializes app image installation, it is held across the suspension in Heap::AddAppImageSpace.
+  Mutex app_image_lock_;
+  // Dex files whose classes were installed from an app image.
+  std::set<const DexFile*> app_image_dex_files_ GUARDED_BY(app_image_lock_);
+
 
   // multimap from a string hash code of a class descriptor to
   // mirror::Class* instances. Results should be compared for a matching
@@ -1060,4 +1060,30 @@ TEST_F(ClassLinkerTest, ClassRootDescriptors) {
   }
 }
 
+TEST_F(ClassLinkerTest, InstallAppImageWithoutImage) {
+  jobject class_loader;
+  const DexFile* registered_dex_file;
+  const DexFile* dex_file;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("Interfaces");
+    registered_dex_file = Runtime::Current()->GetCompileTimeClassPath(class_loader)[0];
+    dex_file = OpenTestDexFile("Interfaces");
+  }
+  // Classes are already being loaded from a registered dex file.
+  EXPECT_FALSE(class_linker_->InstallAppImage(*registered_dex_file, class_loader));
+  // A dex file without an opened oat file has no app image, and is left unregistered.
+  EXPECT_FALSE(class_linker_->InstallAppImage(*dex_file, class_loader));
+  EXPECT_FALSE(class_linker_->IsDexFileRegistered(*dex_file));
+  EXPECT_TRUE(Runtime::Current()->GetHeap()->GetAppImageSpace() == NULL);
+
+  // Classes are loaded from the dex file instead.
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::ClassLoader> loader(soa.Self(), soa.Decode<mirror::ClassLoader*>(class_loader));
+  mirror::Class* klass = class_linker_->FindClass("LInterfaces$A;", loader);
+  ASSERT_TRUE(klass != NULL);
+  EXPECT_EQ(loader.get(), klass->GetClassLoader());
+  EXPECT_EQ(registered_dex_file, klass->GetDexCache()->GetDexFile());
+}
+
 }  // namespace art
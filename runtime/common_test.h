@@ -542,7 +542,7 @@ class CommonTest : public testing::Test {
     return GetAndroidRoot();
   }
 
-  const DexFile* OpenTestDexFile(const char* name) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  std::string GetTestDexFileName(const char* name) {
     CHECK(name != NULL);
     std::string filename;
     if (IsHost()) {
@@ -554,6 +554,11 @@ class CommonTest : public testing::Test {
     filename += "art-test-dex-";
     filename += name;
     filename += ".jar";
+    return filename;
+  }
+
+  const DexFile* OpenTestDexFile(const char* name) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    std::string filename(GetTestDexFileName(name));
     std::string error_msg;
     const DexFile* dex_file = DexFile::Open(filename.c_str(), filename.c_str(), &error_msg);
     CHECK(dex_file != NULL) << "Failed to open '" << filename << "': " << error_msg;
@@ -388,7 +388,11 @@ void ThrowNullPointerExceptionFromDexPC(const ThrowLocation& throw_location) {
     }
     case Instruction::IGET_QUICK:
     case Instruction::IGET_WIDE_QUICK:
-    case Instruction::IGET_OBJECT_QUICK: {
+    case Instruction::IGET_OBJECT_QUICK:
+    case Instruction::IGET_QUICK_IF_EQZ:
+    case Instruction::IGET_QUICK_IF_NEZ:
+    case Instruction::IGET_OBJECT_QUICK_IF_EQZ:
+    case Instruction::IGET_OBJECT_QUICK_IF_NEZ: {
       // Since we replaced the field index, we ask the verifier to tell us which
       // field is accessed at this location.
       mirror::ArtField* field =
@@ -436,6 +440,7 @@ void ThrowNullPointerExceptionFromDexPC(const ThrowLocation& throw_location) {
       break;
     }
     case Instruction::AGET:
+    case Instruction::AGET_ADD_INT:
     case Instruction::AGET_WIDE:
     case Instruction::AGET_OBJECT:
     case Instruction::AGET_BOOLEAN:
@@ -245,7 +245,9 @@ const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& l
   if (zip_entry.get() == NULL) {
     return nullptr;
   }
-  UniquePtr<MemMap> map(zip_entry->ExtractToMemMap(kClassesDex, error_msg));
+  // A classes.dex stored word aligned, as zipalign leaves it, is mapped without inflating it.
+  UniquePtr<MemMap> map(zip_entry->MapDirectlyOrExtract(location.c_str(), kClassesDex,
+                                                        kClassesDexAlignment, error_msg));
   if (map.get() == NULL) {
     *error_msg = StringPrintf("Failed to extract '%s' from '%s': %s", kClassesDex, location.c_str(),
                               error_msg->c_str());
@@ -384,6 +386,44 @@ const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
   return NULL;
 }
 
+bool DexFile::IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                        const char* annotation_descriptor) const {
+  if (class_def.annotations_off_ == 0) {
+    return false;
+  }
+  const AnnotationsDirectoryItem* directory =
+      reinterpret_cast<const AnnotationsDirectoryItem*>(begin_ + class_def.annotations_off_);
+  if (directory->methods_size_ == 0) {
+    return false;
+  }
+  // Method annotations follow the field annotations, both sorted by member index.
+  const FieldAnnotationsItem* field_items =
+      reinterpret_cast<const FieldAnnotationsItem*>(&directory[1]);
+  const MethodAnnotationsItem* method_items =
+      reinterpret_cast<const MethodAnnotationsItem*>(&field_items[directory->fields_size_]);
+  for (uint32_t i = 0; i < directory->methods_size_; ++i) {
+    if (method_items[i].method_idx_ < method_idx) {
+      continue;
+    }
+    if (method_items[i].method_idx_ > method_idx || method_items[i].annotations_off_ == 0) {
+      return false;
+    }
+    const AnnotationSetItem* set =
+        reinterpret_cast<const AnnotationSetItem*>(begin_ + method_items[i].annotations_off_);
+    for (uint32_t j = 0; j < set->size_; ++j) {
+      const AnnotationItem* item =
+          reinterpret_cast<const AnnotationItem*>(begin_ + set->entries_[j]);
+      const byte* annotation = item->annotation_;
+      uint32_t type_idx = DecodeUnsignedLeb128(&annotation);
+      if (strcmp(StringByTypeIdx(type_idx), annotation_descriptor) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return false;
+}
+
 const DexFile::FieldId* DexFile::FindFieldId(const DexFile::TypeId& declaring_klass,
                                               const DexFile::StringId& name,
                                               const DexFile::TypeId& type) const {
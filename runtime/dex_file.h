@@ -59,6 +59,9 @@ class DexFile {
   // name of the DexFile entry within a zip archive
   static const char* kClassesDex;
 
+  // Alignment of a stored kClassesDex entry that lets it be mapped from the zip archive directly.
+  static const size_t kClassesDexAlignment = 4;
+
   // The value of an invalid index.
   static const uint32_t kDexNoIndex = 0xFFFFFFFF;
 
@@ -627,6 +630,11 @@ class DexFile {
     }
   }
 
+  // Returns true if the method carries an annotation of the given type descriptor, regardless of
+  // its visibility.
+  bool IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                 const char* annotation_descriptor) const;
+
   //
   const CodeItem* GetCodeItem(const uint32_t code_off) const {
     if (code_off == 0) {
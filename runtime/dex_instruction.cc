@@ -478,6 +478,10 @@ std::string Instruction::DumpString(const DexFile* file) const {
           }  // else fall-through
         case IGET_QUICK:
         case IGET_OBJECT_QUICK:
+        case IGET_QUICK_IF_EQZ:
+        case IGET_QUICK_IF_NEZ:
+        case IGET_OBJECT_QUICK_IF_EQZ:
+        case IGET_OBJECT_QUICK_IF_NEZ:
           if (file != NULL) {
             uint32_t field_idx = VRegC_22c();
             os << opcode << " v" << static_cast<int>(VRegA_22c()) << ", v" << static_cast<int>(VRegB_22c()) << ", "
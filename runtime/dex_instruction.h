@@ -422,6 +422,26 @@ class Instruction {
     return kInstructionFlags[opcode];
   }
 
+  // Returns the opcode a dex-to-dex superinstruction was formed from. Only the first opcode of
+  // the fused pair is rewritten and the second instruction is left in place, so anything other
+  // than the interpreter's fast path can treat a superinstruction as its first half.
+  static Code UnfusedOpcode(Code opcode) {
+    switch (opcode) {
+      case IGET_QUICK_IF_EQZ:
+      case IGET_QUICK_IF_NEZ:
+        return IGET_QUICK;
+      case IGET_OBJECT_QUICK_IF_EQZ:
+      case IGET_OBJECT_QUICK_IF_NEZ:
+        return IGET_OBJECT_QUICK;
+      case CONST_4_ADD_INT:
+        return CONST_4;
+      case AGET_ADD_INT:
+        return AGET;
+      default:
+        return opcode;
+    }
+  }
+
   // Returns true if this instruction is a branch.
   bool IsBranch() const {
     return (kInstructionFlags[Opcode()] & kBranch) != 0;
@@ -396,6 +396,10 @@ llvm::ELF::Elf32_Shdr& ElfFile::GetSectionNameStringSection() {
   return GetSectionHeader(GetHeader().e_shstrndx);
 }
 
+llvm::ELF::Elf32_Word ElfFile::ElfHash(const char* symbol_name) {
+  return elfhash(symbol_name);
+}
+
 byte* ElfFile::FindDynamicSymbolAddress(const std::string& symbol_name) {
   llvm::ELF::Elf32_Word hash = elfhash(symbol_name.c_str());
   llvm::ELF::Elf32_Word bucket_index = hash % GetHashBucketNum();
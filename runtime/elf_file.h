@@ -71,6 +71,9 @@ class ElfFile {
   // Find .dynsym using .hash for more efficient lookup than FindSymbolAddress.
   byte* FindDynamicSymbolAddress(const std::string& symbol_name);
 
+  // The SysV hash used to index .hash, usable to key other symbol name lookups.
+  static ::llvm::ELF::Elf32_Word ElfHash(const char* symbol_name);
+
   static bool IsSymbolSectionType(::llvm::ELF::Elf32_Word section_type);
   ::llvm::ELF::Elf32_Word GetSymbolNum(::llvm::ELF::Elf32_Shdr&);
   ::llvm::ELF::Elf32_Sym& GetSymbol(::llvm::ELF::Elf32_Word section_type, ::llvm::ELF::Elf32_Word i);
@@ -24,18 +24,14 @@
 
 namespace art {
 
-// Used by the JNI dlsym stub to find the native method to invoke if none is registered.
-extern "C" void* artFindNativeMethod() {
-  Thread* self = Thread::Current();
-  Locks::mutator_lock_->AssertNotHeld(self);  // We come here as Native.
-  ScopedObjectAccess soa(self);
-
+static void* FindAndRegisterNativeMethod(Thread* self, JavaVMExt* vm)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   mirror::ArtMethod* method = self->GetCurrentMethod(NULL);
   DCHECK(method != NULL);
 
   // Lookup symbol address for method, on failure we'll return NULL with an exception set,
   // otherwise we return the address of the method we found.
-  void* native_code = soa.Vm()->FindCodeForNativeMethod(method);
+  void* native_code = vm->FindCodeForNativeMethod(method);
   if (native_code == NULL) {
     DCHECK(self->IsExceptionPending());
     return NULL;
@@ -46,6 +42,20 @@ extern "C" void* artFindNativeMethod() {
   }
 }
 
+// Used by the JNI dlsym stub to find the native method to invoke if none is registered.
+// TODO: NO_THREAD_SAFETY_ANALYSIS due to different control paths depending on fast JNI.
+extern "C" void* artFindNativeMethod() NO_THREAD_SAFETY_ANALYSIS {
+  Thread* self = Thread::Current();
+  if (self->GetState() == kRunnable) {
+    // Fast and critical natives never transition out of Runnable before calling the stub.
+    Locks::mutator_lock_->AssertSharedHeld(self);
+    return FindAndRegisterNativeMethod(self, self->GetJniEnv()->vm);
+  }
+  Locks::mutator_lock_->AssertNotHeld(self);  // We come here as Native.
+  ScopedObjectAccess soa(self);
+  return FindAndRegisterNativeMethod(self, soa.Vm());
+}
+
 static void WorkAroundJniBugsForJobject(intptr_t* arg_ptr) {
   intptr_t value = *arg_ptr;
   mirror::Object** value_as_jni_rep = reinterpret_cast<mirror::Object**>(value);
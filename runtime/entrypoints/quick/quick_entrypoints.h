@@ -84,6 +84,9 @@ struct PACKED(4) QuickEntryPoints {
   mirror::Object* (*pJniMethodEndWithReference)(jobject result, uint32_t cookie, Thread* self);
   mirror::Object* (*pJniMethodEndWithReferenceSynchronized)(jobject result, uint32_t cookie,
                                                     jobject locked, Thread* self);
+  uint32_t (*pJniMethodFastStart)(Thread*);
+  void (*pJniMethodFastEnd)(uint32_t cookie, Thread* self);
+  mirror::Object* (*pJniMethodFastEndWithReference)(jobject result, uint32_t cookie, Thread* self);
 
   // Locks
   void (*pLockObject)(void*);
@@ -116,6 +119,7 @@ struct PACKED(4) QuickEntryPoints {
   int32_t (*pMemcmp16)(void*, void*, int32_t);
   int32_t (*pStringCompareTo)(void*, void*);
   void* (*pMemcpy)(void*, const void*, size_t);
+  void* (*pMemcpySwapped)(void*, const void*, size_t, size_t);
 
   // Invocation
   void (*pQuickImtConflictTrampoline)(mirror::ArtMethod*);
@@ -160,6 +164,15 @@ extern mirror::Object* JniMethodEndWithReferenceSynchronized(jobject result,
                                                              jobject locked, Thread* self)
     NO_THREAD_SAFETY_ANALYSIS HOT_ATTR;
 
+// Variants for methods compiled as @FastNative, which stay Runnable across the native call.
+extern uint32_t JniMethodFastStart(Thread* self) NO_THREAD_SAFETY_ANALYSIS HOT_ATTR;
+extern void JniMethodFastEnd(uint32_t saved_local_ref_cookie, Thread* self)
+    NO_THREAD_SAFETY_ANALYSIS HOT_ATTR;
+extern mirror::Object* JniMethodFastEndWithReference(jobject result,
+                                                     uint32_t saved_local_ref_cookie,
+                                                     Thread* self)
+    NO_THREAD_SAFETY_ANALYSIS HOT_ATTR;
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_ENTRYPOINTS_QUICK_QUICK_ENTRYPOINTS_H_
@@ -27,12 +27,17 @@
 
 namespace art {
 
-// Called on entry to JNI, transition out of Runnable and release share of mutator_lock_.
-extern uint32_t JniMethodStart(Thread* self) {
+static inline uint32_t PushLocalReferenceSegment(Thread* self) {
   JNIEnvExt* env = self->GetJniEnv();
   DCHECK(env != nullptr);
   uint32_t saved_local_ref_cookie = env->local_ref_cookie;
   env->local_ref_cookie = env->locals.GetSegmentState();
+  return saved_local_ref_cookie;
+}
+
+// Called on entry to JNI, transition out of Runnable and release share of mutator_lock_.
+extern uint32_t JniMethodStart(Thread* self) {
+  uint32_t saved_local_ref_cookie = PushLocalReferenceSegment(self);
   mirror::ArtMethod* native_method = *self->GetManagedStack()->GetTopQuickFrame();
   if (!native_method->IsFastNative()) {
     // When not fast JNI we transition out of runnable.
@@ -67,6 +72,37 @@ static void PopLocalReferences(uint32_t saved_local_ref_cookie, Thread* self) {
   self->PopSirt();
 }
 
+// Called on entry to a method compiled as @FastNative, the thread stays Runnable so there is no
+// need to inspect the method's access flags as JniMethodStart does.
+extern uint32_t JniMethodFastStart(Thread* self) {
+  return PushLocalReferenceSegment(self);
+}
+
+extern void JniMethodFastEnd(uint32_t saved_local_ref_cookie, Thread* self) {
+  if (UNLIKELY(self->TestAllFlags())) {
+    CheckSuspend(self);
+  }
+  PopLocalReferences(saved_local_ref_cookie, self);
+}
+
+extern mirror::Object* JniMethodFastEndWithReference(jobject result,
+                                                     uint32_t saved_local_ref_cookie,
+                                                     Thread* self) {
+  if (UNLIKELY(self->TestAllFlags())) {
+    CheckSuspend(self);
+  }
+  mirror::Object* o = self->DecodeJObject(result);  // Must decode before pop.
+  PopLocalReferences(saved_local_ref_cookie, self);
+  // Process result.
+  if (UNLIKELY(self->GetJniEnv()->check_jni)) {
+    if (self->IsExceptionPending()) {
+      return NULL;
+    }
+    CheckReferenceResult(o, self);
+  }
+  return o;
+}
+
 extern void JniMethodEnd(uint32_t saved_local_ref_cookie, Thread* self) {
   GoToRunnable(self);
   PopLocalReferences(saved_local_ref_cookie, self);
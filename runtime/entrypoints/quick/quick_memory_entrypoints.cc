@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+namespace art {
+
+static inline uint16_t SwapBytes(uint16_t v) {
+  return static_cast<uint16_t>((v << 8) | (v >> 8));
+}
+
+static inline uint32_t SwapBytes(uint32_t v) {
+  return __builtin_bswap32(v);
+}
+
+static inline uint64_t SwapBytes(uint64_t v) {
+  return __builtin_bswap64(v);
+}
+
+// Neither end of the copy needs to be aligned for T: the native address comes straight from
+// Java, so elements are moved with memcpy and the compiler picks the best unaligned access.
+template <typename T>
+static void SwappedCopy(uint8_t* dst, const uint8_t* src, size_t byte_count) {
+  for (size_t i = 0; i + sizeof(T) <= byte_count; i += sizeof(T)) {
+    T v;
+    memcpy(&v, src + i, sizeof(T));
+    v = SwapBytes(v);
+    memcpy(dst + i, &v, sizeof(T));
+  }
+}
+
+// Called by compiled code for the swapping libcore.io.Memory array transfers. swap_size is
+// the element size when the bytes of each element must be reversed and 0 otherwise.
+extern "C" void* artMemcpySwapped(void* dst, const void* src, size_t byte_count,
+                                  size_t swap_size) {
+  uint8_t* d = reinterpret_cast<uint8_t*>(dst);
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+  switch (swap_size) {
+    case 2:
+      SwappedCopy<uint16_t>(d, s, byte_count);
+      return dst;
+    case 4:
+      SwappedCopy<uint32_t>(d, s, byte_count);
+      return dst;
+    case 8:
+      SwappedCopy<uint64_t>(d, s, byte_count);
+      return dst;
+    default:
+      return memcpy(dst, src, byte_count);
+  }
+}
+
+}  // namespace art
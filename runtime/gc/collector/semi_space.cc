@@ -122,7 +122,8 @@ SemiSpace::SemiSpace(Heap* heap, const std::string& name_prefix)
       cleared_reference_list_(nullptr),
       self_(nullptr),
       last_gc_to_space_end_(nullptr),
-      bytes_promoted_(0) {
+      bytes_promoted_(0),
+      pinned_objects_promoted_(0) {
 }
 
 void SemiSpace::InitializePhase() {
@@ -180,6 +181,14 @@ void SemiSpace::MarkingPhase() {
   // the live stack during the recursive mark.
   timings_.NewSplit("SwapStacks");
   heap_->SwapStacks();
+  // The interpreter caches are keyed on receiver classes, which are about to move.
+  timings_.NewSplit("ClearInterpreterCaches");
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
+      thread->ClearInterpreterCache();
+    }
+  }
   WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
   MarkRoots();
   // Mark roots of immune spaces.
@@ -322,9 +331,12 @@ Object* SemiSpace::MarkObject(Object* obj) {
         // Otherwise, we need to move the object and add it to the markstack for processing.
         size_t object_size = obj->SizeOf();
         size_t bytes_allocated = 0;
-        if (kEnableSimplePromo && reinterpret_cast<byte*>(obj) < last_gc_to_space_end_) {
-          // If it's allocated before the last GC (older), move (pseudo-promote) it to
-          // the non-moving space (as sort of an old generation.)
+        bool was_pinned = !objects_to_promote_.empty() &&
+            objects_to_promote_.find(obj) != objects_to_promote_.end();
+        if ((kEnableSimplePromo && reinterpret_cast<byte*>(obj) < last_gc_to_space_end_) ||
+            was_pinned) {
+          // If it's allocated before the last GC (older), or it has been pinned, move
+          // (pseudo-promote) it to the non-moving space (as sort of an old generation.)
           size_t bytes_promoted;
           space::MallocSpace* non_moving_space = GetHeap()->GetNonMovingSpace();
           forward_address = non_moving_space->Alloc(self_, object_size, &bytes_promoted);
@@ -334,6 +346,9 @@ Object* SemiSpace::MarkObject(Object* obj) {
           } else {
             GetHeap()->num_bytes_allocated_.FetchAndAdd(bytes_promoted);
             bytes_promoted_ += bytes_promoted;
+            if (was_pinned) {
+              ++pinned_objects_promoted_;
+            }
             // Mark forward_address on the live bit map.
             accounting::SpaceBitmap* live_bitmap = non_moving_space->GetLiveBitmap();
             DCHECK(live_bitmap != nullptr);
@@ -359,7 +374,7 @@ Object* SemiSpace::MarkObject(Object* obj) {
         MarkStackPush(forward_address);
       } else {
         DCHECK(to_space_->HasAddress(forward_address) ||
-               (kEnableSimplePromo && GetHeap()->GetNonMovingSpace()->HasAddress(forward_address)));
+               GetHeap()->GetNonMovingSpace()->HasAddress(forward_address));
       }
       ret = forward_address;
       // TODO: Do we need this if in the else statement?
@@ -577,7 +592,7 @@ inline Object* SemiSpace::GetMarkedForwardAddress(mirror::Object* obj) const
     mirror::Object* forwarding_address = GetForwardingAddressInFromSpace(const_cast<Object*>(obj));
     // If the object is forwarded then it MUST be marked.
     DCHECK(forwarding_address == nullptr || to_space_->HasAddress(forwarding_address) ||
-           (kEnableSimplePromo && GetHeap()->GetNonMovingSpace()->HasAddress(forwarding_address)));
+           GetHeap()->GetNonMovingSpace()->HasAddress(forwarding_address));
     if (forwarding_address != nullptr) {
       return forwarding_address;
     }
@@ -614,6 +629,11 @@ void SemiSpace::SetFromSpace(space::ContinuousMemMapAllocSpace* from_space) {
   from_space_ = from_space;
 }
 
+void SemiSpace::SetObjectsToPromote(std::set<const mirror::Object*>* objects) {
+  objects_to_promote_.swap(*objects);
+  objects->clear();
+}
+
 void SemiSpace::FinishPhase() {
   TimingLogger::ScopedSplit split("FinishPhase", &timings_);
   // Can't enqueue references if we hold the mutator lock.
@@ -625,6 +645,7 @@ void SemiSpace::FinishPhase() {
   // further action is done by the heap.
   to_space_ = nullptr;
   from_space_ = nullptr;
+  objects_to_promote_.clear();
 
   // Update the cumulative statistics
   total_freed_objects_ += GetFreedObjects() + GetFreedLargeObjects();
@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_GC_COLLECTOR_SEMI_SPACE_H_
 #define ART_RUNTIME_GC_COLLECTOR_SEMI_SPACE_H_
 
+#include <set>
+
 #include "atomic_integer.h"
 #include "barrier.h"
 #include "base/macros.h"
@@ -85,6 +87,14 @@ class SemiSpace : public GarbageCollector {
   // Set the space where we copy objects from.
   void SetFromSpace(space::ContinuousMemMapAllocSpace* from_space);
 
+  // Takes the set of from-space objects that should be promoted to the non-moving space rather
+  // than copied to the to-space, leaving the passed in set empty.
+  void SetObjectsToPromote(std::set<const mirror::Object*>* objects);
+
+  uint64_t GetPinnedObjectsPromoted() const {
+    return pinned_objects_promoted_;
+  }
+
   // Initializes internal structures.
   void Init();
 
@@ -290,6 +300,13 @@ class SemiSpace : public GarbageCollector {
   // pointer space to the non-moving space.
   uint64_t bytes_promoted_;
 
+  // Objects that were pinned for JNI critical access since the last collection. They are
+  // promoted to the non-moving space so that they don't need pinning again.
+  std::set<const mirror::Object*> objects_to_promote_;
+
+  // Cumulative number of objects promoted because they were pinned.
+  uint64_t pinned_objects_promoted_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(SemiSpace);
 };
@@ -19,6 +19,7 @@
 
 #include "heap.h"
 
+#include "alloc_sampler.h"
 #include "debugger.h"
 #include "gc/space/bump_pointer_space-inl.h"
 #include "gc/space/dlmalloc_space-inl.h"
@@ -86,8 +87,13 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self, mirror::Clas
     if (Dbg::IsAllocTrackingEnabled()) {
       Dbg::RecordAllocation(klass, bytes_allocated);
     }
+    AllocationSampler* alloc_sampler = Runtime::Current()->GetAllocationSampler();
+    if (alloc_sampler != nullptr) {
+      alloc_sampler->RecordAllocation(self, klass, bytes_allocated);
+    }
   } else {
     DCHECK(!Dbg::IsAllocTrackingEnabled());
+    DCHECK(Runtime::Current()->GetAllocationSampler() == nullptr);
   }
   // concurrent_gc_ isn't known at compile time so we can optimize by not checking it for
   // the BumpPointer or TLAB allocators. This is nice since it allows the entire if statement to be
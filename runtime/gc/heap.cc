@@ -38,6 +38,7 @@
 #include "gc/collector/partial_mark_sweep.h"
 #include "gc/collector/semi_space.h"
 #include "gc/collector/sticky_mark_sweep.h"
+#include "gc/heap_histogram.h"
 #include "gc/space/bump_pointer_space.h"
 #include "gc/space/dlmalloc_space-inl.h"
 #include "gc/space/image_space.h"
@@ -77,8 +78,10 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
            double target_utilization, size_t capacity, const std::string& image_file_name,
            CollectorType post_zygote_collector_type, size_t parallel_gc_threads,
            size_t conc_gc_threads, bool low_memory_mode, size_t long_pause_log_threshold,
-           size_t long_gc_log_threshold, bool ignore_max_footprint, bool use_tlab)
-    : non_moving_space_(nullptr),
+           size_t long_gc_log_threshold, bool ignore_max_footprint, bool use_tlab,
+           size_t app_image_reservation)
+    : app_image_space_(nullptr),
+      non_moving_space_(nullptr),
       concurrent_gc_(false),
       collector_type_(kCollectorTypeNone),
       post_zygote_collector_type_(post_zygote_collector_type),
@@ -143,6 +146,9 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       total_allocation_time_(0),
       verify_object_mode_(kHeapVerificationNotPermitted),
       gc_disable_count_(0),
+      disable_moving_gc_count_(0),
+      total_movable_pins_(0),
+      gcs_delayed_by_pinning_(0),
       running_on_valgrind_(RUNNING_ON_VALGRIND),
       use_tlab_(use_tlab) {
   if (VLOG_IS_ON(heap) || VLOG_IS_ON(startup)) {
@@ -162,15 +168,41 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   // Requested begin for the alloc space, to follow the mapped image and oat files
   byte* requested_alloc_space_begin = nullptr;
   if (!image_file_name.empty()) {
-    space::ImageSpace* image_space = space::ImageSpace::Create(image_file_name.c_str());
-    CHECK(image_space != nullptr) << "Failed to create space for " << image_file_name;
-    AddSpace(image_space);
-    // Oat files referenced by image files immediately follow them in memory, ensure alloc space
-    // isn't going to get in the middle
-    byte* oat_file_end_addr = image_space->GetImageHeader().GetOatFileEnd();
-    CHECK_GT(oat_file_end_addr, image_space->End());
-    if (oat_file_end_addr > requested_alloc_space_begin) {
-      requested_alloc_space_begin = AlignUp(oat_file_end_addr, kPageSize);
+    std::vector<std::string> image_file_names;
+    Split(image_file_name, ':', image_file_names);
+    for (const std::string& name : image_file_names) {
+      // Each image of a multi-image boot image is mapped after the oat file of the previous one
+      // and must have been written against it.
+      space::ImageSpace* previous = image_spaces_.empty() ? nullptr : image_spaces_.back();
+      space::ImageSpace* image_space = space::ImageSpace::Create(name.c_str(), previous);
+      CHECK(image_space != nullptr) << "Failed to create space for " << name;
+      AddSpace(image_space);
+      image_spaces_.push_back(image_space);
+      // Oat files referenced by image files immediately follow them in memory, ensure alloc space
+      // isn't going to get in the middle
+      byte* oat_file_end_addr = image_space->GetImageHeader().GetOatFileEnd();
+      CHECK_GT(oat_file_end_addr, image_space->End());
+      if (oat_file_end_addr > requested_alloc_space_begin) {
+        requested_alloc_space_begin = AlignUp(oat_file_end_addr, kPageSize);
+      }
+    }
+    if (app_image_reservation != 0) {
+      // Keep the pages after the boot image free for an app image. They lie below the alloc space
+      // so the card table covers them.
+      std::string error_msg;
+      app_image_reservation_.reset(MemMap::MapAnonymous("app image reservation",
+                                                        requested_alloc_space_begin,
+                                                        RoundUp(app_image_reservation, kPageSize),
+                                                        PROT_NONE, &error_msg));
+      if (app_image_reservation_.get() == nullptr) {
+        LOG(WARNING) << "Failed to reserve space for app images: " << error_msg;
+      } else if (app_image_reservation_->Begin() != requested_alloc_space_begin) {
+        LOG(WARNING) << "Failed to reserve space for app images at "
+                     << reinterpret_cast<void*>(requested_alloc_space_begin);
+        app_image_reservation_.reset();
+      } else {
+        requested_alloc_space_begin = app_image_reservation_->End();
+      }
     }
   }
 
@@ -224,10 +256,12 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
 
   // Card cache for now since it makes it easier for us to update the references to the copying
   // spaces.
-  accounting::ModUnionTable* mod_union_table =
-      new accounting::ModUnionTableCardCache("Image mod-union table", this, GetImageSpace());
-  CHECK(mod_union_table != nullptr) << "Failed to create image mod-union table";
-  AddModUnionTable(mod_union_table);
+  for (space::ImageSpace* image_space : image_spaces_) {
+    accounting::ModUnionTable* mod_union_table =
+        new accounting::ModUnionTableCardCache("Image mod-union table", this, image_space);
+    CHECK(mod_union_table != nullptr) << "Failed to create image mod-union table";
+    AddModUnionTable(mod_union_table);
+  }
 
   // TODO: Count objects in the image space here.
   num_bytes_allocated_ = 0;
@@ -321,6 +355,29 @@ void Heap::DecrementDisableGC(Thread* self) {
   --gc_disable_count_;
 }
 
+void Heap::IncrementDisableMovingGC(Thread* self) {
+  // Need to do this holding the lock to prevent races where the GC is about to run / running when
+  // we attempt to pin.
+  ScopedThreadStateChange tsc(self, kWaitingForGcToComplete);
+  MutexLock mu(self, *gc_complete_lock_);
+  WaitForGcToCompleteLocked(self);
+  ++disable_moving_gc_count_;
+  ++total_movable_pins_;
+}
+
+void Heap::PinMovableObject(Thread* self, const mirror::Object* obj) {
+  DCHECK(IsMovableObject(obj));
+  MutexLock mu(self, *gc_complete_lock_);
+  DCHECK_GT(disable_moving_gc_count_, 0U);
+  objects_to_promote_.insert(obj);
+}
+
+void Heap::DecrementDisableMovingGC(Thread* self) {
+  MutexLock mu(self, *gc_complete_lock_);
+  CHECK_GT(disable_moving_gc_count_, 0U);
+  --disable_moving_gc_count_;
+}
+
 void Heap::UpdateProcessState(ProcessState process_state) {
   process_state_ = process_state;
 }
@@ -471,6 +528,17 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
   }
   os << "Total mutator paused time: " << PrettyDuration(total_paused_time) << "\n";
   os << "Total time waiting for GC to complete: " << PrettyDuration(total_wait_time_) << "\n";
+  {
+    MutexLock mu(Thread::Current(), *gc_complete_lock_);
+    if (total_movable_pins_ != 0) {
+      os << "Total movable objects pinned: " << total_movable_pins_ << "\n";
+      os << "Total GCs delayed by pinned objects: " << gcs_delayed_by_pinning_ << "\n";
+    }
+  }
+  if (semi_space_collector_ != nullptr && semi_space_collector_->GetPinnedObjectsPromoted() != 0) {
+    os << "Total pinned objects promoted: " << semi_space_collector_->GetPinnedObjectsPromoted()
+       << "\n";
+  }
   os << "Approximate GC data structures memory overhead: " << gc_memory_overhead_;
 }
 
@@ -630,6 +698,77 @@ space::ImageSpace* Heap::GetImageSpace() const {
   return NULL;
 }
 
+uint32_t Heap::GetBootImageChecksum() const {
+  // The chain checksum of the last image covers every image before it.
+  CHECK(!image_spaces_.empty());
+  return image_spaces_.back()->GetImageHeader().GetChainChecksum();
+}
+
+uint32_t Heap::GetBootImageOatDataBegin() const {
+  CHECK(!image_spaces_.empty());
+  return reinterpret_cast<uint32_t>(image_spaces_.front()->GetImageHeader().GetOatDataBegin());
+}
+
+byte* Heap::GetBootImageEnd() const {
+  // Matches the placement of the app image reservation in the constructor.
+  CHECK(!image_spaces_.empty());
+  byte* boot_image_end = nullptr;
+  for (space::ImageSpace* image_space : image_spaces_) {
+    boot_image_end = std::max(boot_image_end,
+                              AlignUp(image_space->GetImageHeader().GetOatFileEnd(), kPageSize));
+  }
+  return boot_image_end;
+}
+
+space::ImageSpace* Heap::AddAppImageSpace(const std::string& image_location,
+                                          uint32_t oat_checksum, std::string* error_msg) {
+  if (app_image_reservation_.get() == nullptr) {
+    *error_msg = "No address space is reserved for app images";
+    return nullptr;
+  }
+  if (app_image_space_ != nullptr) {
+    *error_msg = StringPrintf("App image '%s' is already loaded", app_image_space_->GetName());
+    return nullptr;
+  }
+  Thread* self = Thread::Current();
+  space::ImageSpace* space;
+  {
+    ScopedObjectAccess soa(self);
+    space = space::ImageSpace::CreateAppImage(image_location.c_str(), oat_checksum,
+                                              GetBootImageChecksum(),
+                                              app_image_reservation_->Begin(),
+                                              app_image_reservation_->End(), error_msg);
+  }
+  if (space == nullptr) {
+    return nullptr;
+  }
+  CHECK(card_table_->AddrIsInCardTable(space->Begin()));
+  CHECK(card_table_->AddrIsInCardTable(space->End() - 1));
+
+  // The space lists can't change under a running collection.
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    WaitForGcToCompleteLocked(self);
+    is_gc_running_ = true;
+  }
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  AddSpace(space);
+  accounting::ModUnionTable* mod_union_table =
+      new accounting::ModUnionTableCardCache("App image mod-union table", this, space);
+  CHECK(mod_union_table != nullptr) << "Failed to create app image mod-union table";
+  AddModUnionTable(mod_union_table);
+  app_image_space_ = space;
+  thread_list->ResumeAll();
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    is_gc_running_ = false;
+    gc_complete_cond_->Broadcast(self);
+  }
+  return space;
+}
+
 static void MSpaceChunkCallback(void* start, void* end, size_t used_bytes, void* arg) {
   size_t chunk_size = reinterpret_cast<uint8_t*>(end) - reinterpret_cast<uint8_t*>(start);
   if (used_bytes < chunk_size) {
@@ -1059,6 +1198,126 @@ void Heap::GetReferringObjects(mirror::Object* o, int32_t max_count,
   GetLiveBitmap()->Visit(finder);
 }
 
+class HistogramVisitor {
+ public:
+  explicit HistogramVisitor(HeapHistogram* histogram) : histogram_(histogram) {
+  }
+
+  // The world is suspended, but the thread pool workers walk the heap without the mutator lock.
+  void operator()(mirror::Object* obj) const NO_THREAD_SAFETY_ANALYSIS {
+    mirror::Class* klass = obj->GetClass();
+    if (LIKELY(klass != nullptr)) {
+      histogram_->AddObject(klass, obj->SizeOf());
+    }
+  }
+
+  static void Callback(mirror::Object* obj, void* arg) NO_THREAD_SAFETY_ANALYSIS {
+    HistogramVisitor visitor(reinterpret_cast<HeapHistogram*>(arg));
+    visitor(obj);
+  }
+
+ private:
+  HeapHistogram* const histogram_;
+};
+
+// Counts the objects of one chunk of a space into a histogram of its own.
+class HistogramTask : public Task {
+ public:
+  HistogramTask(accounting::SpaceBitmap* bitmap, uintptr_t begin, uintptr_t end)
+      : bitmap_(bitmap), begin_(begin), end_(end) {
+  }
+
+  virtual void Run(Thread* self) {
+    bitmap_->VisitMarkedRange(begin_, end_, HistogramVisitor(&histogram_));
+  }
+
+  const HeapHistogram& GetHistogram() const {
+    return histogram_;
+  }
+
+ private:
+  accounting::SpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  HeapHistogram histogram_;
+};
+
+void Heap::WalkHistogram(Thread* self, HeapHistogram* histogram) {
+  ThreadPool* thread_pool = GetThreadPool();
+  const size_t thread_count = (thread_pool != nullptr) ? parallel_gc_threads_ + 1 : 1;
+  std::vector<HistogramTask*> tasks;
+  for (const auto& space : continuous_spaces_) {
+    accounting::SpaceBitmap* bitmap = space->GetLiveBitmap();
+    if (bitmap == nullptr) {
+      continue;
+    }
+    uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
+    uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
+    // A couple of chunks per thread balances the load without making tiny tasks.
+    const uintptr_t chunk = std::max(RoundUp((end - begin) / (thread_count * 2), KB),
+                                     static_cast<uintptr_t>(256 * KB));
+    while (begin < end) {
+      uintptr_t chunk_end = std::min(begin + chunk, end);
+      tasks.push_back(new HistogramTask(bitmap, begin, chunk_end));
+      begin = chunk_end;
+    }
+  }
+  if (thread_count > 1) {
+    for (HistogramTask* task : tasks) {
+      thread_pool->AddTask(self, task);
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  } else {
+    for (HistogramTask* task : tasks) {
+      task->Run(self);
+    }
+  }
+  for (HistogramTask* task : tasks) {
+    histogram->Merge(task->GetHistogram());
+  }
+  STLDeleteElements(&tasks);
+
+  // The remaining objects are not in the live bitmaps of continuous spaces.
+  HistogramVisitor visitor(histogram);
+  if (bump_pointer_space_ != nullptr) {
+    bump_pointer_space_->Walk(HistogramVisitor::Callback, histogram);
+  }
+  for (mirror::Object** it = allocation_stack_->Begin(), **end = allocation_stack_->End();
+      it < end; ++it) {
+    visitor(*it);
+  }
+  for (const auto& space_set : live_bitmap_->discontinuous_space_sets_) {
+    space_set->Visit(visitor);
+  }
+  histogram->Finish();
+}
+
+void Heap::ComputeHistogram(HeapHistogram* histogram) {
+  Thread* self = Thread::Current();
+  // Like a collection, the walk needs the thread pool and an unchanging heap to itself.
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    WaitForGcToCompleteLocked(self);
+    is_gc_running_ = true;
+  }
+  uint64_t start_time = NanoTime();
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  WalkHistogram(self, histogram);
+  thread_list->ResumeAll();
+  VLOG(heap) << "Heap histogram of " << histogram->GetObjectCount() << " objects took "
+             << PrettyDuration(NanoTime() - start_time);
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    is_gc_running_ = false;
+    gc_complete_cond_->Broadcast(self);
+  }
+}
+
 void Heap::CollectGarbage(bool clear_soft_references) {
   // Even if we waited for a GC we still need to do another GC since weaks allocated during the
   // last GC will not have necessarily been cleared.
@@ -1259,6 +1518,15 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
       LOG(WARNING) << "Skipping GC due to disable count " << gc_disable_count_;
       return collector::kGcTypeNone;
     }
+    // Every semi-space collection moves objects, so it can't run while some are pinned.
+    if (collector_type_ == kCollectorTypeSS) {
+      if (disable_moving_gc_count_ != 0) {
+        ++gcs_delayed_by_pinning_;
+        LOG(WARNING) << "Skipping GC due to " << disable_moving_gc_count_ << " pinned objects";
+        return collector::kGcTypeNone;
+      }
+      semi_space_collector_->SetObjectsToPromote(&objects_to_promote_);
+    }
     is_gc_running_ = true;
   }
   if (gc_cause == kGcCauseForAlloc && runtime->HasStatsEnabled()) {
@@ -1803,6 +2071,29 @@ void Heap::DumpForSigQuit(std::ostream& os) {
   os << "Heap: " << GetPercentFree() << "% free, " << PrettySize(GetBytesAllocated()) << "/"
      << PrettySize(GetTotalMemory()) << "; " << GetObjectsAllocated() << " objects\n";
   DumpGcPerformanceInfo(os);
+
+  // The world is already suspended, so a running collection can't be waited for.
+  Thread* self = Thread::Current();
+  bool collecting;
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    collecting = is_gc_running_;
+    if (!collecting) {
+      is_gc_running_ = true;
+    }
+  }
+  if (collecting) {
+    os << "Heap histogram skipped: collection in progress\n";
+    return;
+  }
+  HeapHistogram histogram;
+  WalkHistogram(self, &histogram);
+  histogram.Dump(os, kSigQuitHistogramClasses);
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    is_gc_running_ = false;
+    gc_complete_cond_->Broadcast(self);
+  }
 }
 
 size_t Heap::GetPercentFree() {
@@ -18,6 +18,7 @@
 #define ART_RUNTIME_GC_HEAP_H_
 
 #include <iosfwd>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -77,6 +78,8 @@ namespace space {
   class ContinuousMemMapAllocSpace;
 }  // namespace space
 
+class HeapHistogram;
+
 class AgeCardVisitor {
  public:
   byte operator()(byte card) const {
@@ -141,6 +144,8 @@ class Heap {
   static constexpr size_t kDefaultLongPauseLogThreshold = MsToNs(5);
   static constexpr size_t kDefaultLongGCLogThreshold = MsToNs(100);
   static constexpr size_t kDefaultTLABSize = 256 * KB;
+  // Number of classes of the heap histogram in the SIGQUIT dump.
+  static constexpr size_t kSigQuitHistogramClasses = 20;
 
   // Default target utilization.
   static constexpr double kDefaultTargetUtilization = 0.5;
@@ -150,13 +155,16 @@ class Heap {
 
   // Create a heap with the requested sizes. The possible empty
   // image_file_names names specify Spaces to load based on
-  // ImageWriter output.
+  // ImageWriter output. A multi-image boot image is given as a
+  // colon separated list, loaded in order. A non-zero
+  // app_image_reservation reserves that much address space after
+  // the boot image for an app image, see AddAppImageSpace.
   explicit Heap(size_t initial_size, size_t growth_limit, size_t min_free,
                 size_t max_free, double target_utilization, size_t capacity,
                 const std::string& original_image_file_name, CollectorType collector_type_,
                 size_t parallel_gc_threads, size_t conc_gc_threads, bool low_memory_mode,
                 size_t long_pause_threshold, size_t long_gc_threshold,
-                bool ignore_max_footprint, bool use_tlab);
+                bool ignore_max_footprint, bool use_tlab, size_t app_image_reservation);
 
   ~Heap();
 
@@ -249,6 +257,15 @@ class Heap {
   void IncrementDisableGC(Thread* self);
   void DecrementDisableGC(Thread* self);
 
+  // Pins a movable object for zero-copy JNI critical access. Waits for any running GC, so the
+  // caller must re-read the object afterwards and pass the new address to PinMovableObject.
+  // Moving collections are delayed until every pinned object is unpinned, and objects that
+  // were pinned are promoted to the non-moving space by the next semi-space collection, so
+  // later critical accesses to the same object don't need to pin at all.
+  void IncrementDisableMovingGC(Thread* self);
+  void PinMovableObject(Thread* self, const mirror::Object* obj);
+  void DecrementDisableMovingGC(Thread* self);
+
   // Initiates an explicit garbage collection.
   void CollectGarbage(bool clear_soft_references) LOCKS_EXCLUDED(Locks::mutator_lock_);
 
@@ -270,6 +287,11 @@ class Heap {
   void GetReferringObjects(mirror::Object* o, int32_t max_count, std::vector<mirror::Object*>& referring_objects)
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Implements VMDebug.getHeapHistogram and the histogram of SIGQUIT dumps. Counts the instances
+  // and bytes of every class in one walk of the heap, split over the GC thread pool. Waits for
+  // any running collection, and suspends the world for the walk. Unreachable objects that are
+  // not swept yet are counted too.
+  void ComputeHistogram(HeapHistogram* histogram) LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   // Removes the growth limit on the alloc space so it may grow to its maximum capacity. Used to
   // implement dalvik.system.VMRuntime.clearGrowthLimit.
@@ -431,7 +453,7 @@ class Heap {
                                                               bool fail_ok) const;
   space::Space* FindSpaceFromObject(const mirror::Object*, bool fail_ok) const;
 
-  void DumpForSigQuit(std::ostream& os);
+  void DumpForSigQuit(std::ostream& os) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Trim the managed and native heaps by releasing unused memory back to the OS.
   void Trim();
@@ -466,10 +488,41 @@ class Heap {
   void MarkAllocStackAsLive(accounting::ObjectStack* stack)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
-  // DEPRECATED: Should remove in "near" future when support for multiple image spaces is added.
-  // Assumes there is only one image space.
+  // Returns the first image space, which holds the class roots and runtime methods.
   space::ImageSpace* GetImageSpace() const;
 
+  // Returns all image spaces in the order they were loaded.
+  const std::vector<space::ImageSpace*>& GetImageSpaces() const {
+    return image_spaces_;
+  }
+
+  // Returns the app image space added by AddAppImageSpace, NULL if there is none.
+  space::ImageSpace* GetAppImageSpace() const {
+    return app_image_space_;
+  }
+
+  // Checksum and oat data begin identifying the loaded boot image, recorded in the header of oat
+  // files compiled against it.
+  uint32_t GetBootImageChecksum() const;
+  uint32_t GetBootImageOatDataBegin() const;
+
+  // Returns the first page after the boot image and its oat files, where images extending the
+  // boot image are written for.
+  byte* GetBootImageEnd() const;
+
+  // Returns the address app images are written for, the end of the boot image. Heaps created
+  // with an app image reservation reserve it from there.
+  byte* GetAppImageBegin() const {
+    return GetBootImageEnd();
+  }
+
+  // Maps the app image at image_location, written for an app oat file with checksum oat_checksum,
+  // into the app image reservation and adds it as an image space. There is at most one app image
+  // per process. Returns NULL and sets error_msg if the image can't be used.
+  space::ImageSpace* AddAppImageSpace(const std::string& image_location, uint32_t oat_checksum,
+                                      std::string* error_msg)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
+
   space::MallocSpace* GetNonMovingSpace() const {
     return non_moving_space_;
   }
@@ -577,6 +630,11 @@ class Heap {
   collector::GcType WaitForGcToCompleteLocked(Thread* self)
       EXCLUSIVE_LOCKS_REQUIRED(gc_complete_lock_);
 
+  // Walks the heap into the histogram. The caller keeps collections from starting and has
+  // suspended all other threads.
+  void WalkHistogram(Thread* self, HeapHistogram* histogram)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void RequestHeapTrim() LOCKS_EXCLUDED(Locks::runtime_shutdown_lock_);
   void RequestConcurrentGC(Thread* self) LOCKS_EXCLUDED(Locks::runtime_shutdown_lock_);
   bool IsGCRequestPending() const;
@@ -635,6 +693,15 @@ class Heap {
   // All-known discontinuous spaces, where objects may be placed throughout virtual memory.
   std::vector<space::DiscontinuousSpace*> discontinuous_spaces_;
 
+  // The image spaces of the boot image, in load order.
+  std::vector<space::ImageSpace*> image_spaces_;
+
+  // Address range kept free after the boot image for an app image, NULL if there is none.
+  UniquePtr<MemMap> app_image_reservation_;
+
+  // The app image mapped into app_image_reservation_, if any.
+  space::ImageSpace* app_image_space_;
+
   // All-known alloc spaces, where objects may be or have been allocated.
   std::vector<space::AllocSpace*> alloc_spaces_;
 
@@ -840,6 +907,16 @@ class Heap {
   // GC disable count, error on GC if > 0.
   size_t gc_disable_count_ GUARDED_BY(gc_complete_lock_);
 
+  // Number of pinned movable objects, moving collections are delayed if > 0.
+  size_t disable_moving_gc_count_ GUARDED_BY(gc_complete_lock_);
+
+  // Objects pinned since the last semi-space collection, which will promote them.
+  std::set<const mirror::Object*> objects_to_promote_ GUARDED_BY(gc_complete_lock_);
+
+  // Pinning statistics.
+  uint64_t total_movable_pins_ GUARDED_BY(gc_complete_lock_);
+  uint64_t gcs_delayed_by_pinning_ GUARDED_BY(gc_complete_lock_);
+
   std::vector<collector::GarbageCollector*> garbage_collectors_;
   collector::SemiSpace* semi_space_collector_;
 
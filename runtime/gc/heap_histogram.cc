@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "heap_histogram.h"
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/stringprintf.h"
+#include "mirror/class.h"
+#include "object_utils.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+
+HeapHistogram::Counts* HeapHistogram::GetCounts(mirror::Class* klass) {
+  ClassCounts::iterator it = classes_.find(klass);
+  if (it == classes_.end()) {
+    classes_.Put(klass, Counts());
+    it = classes_.find(klass);
+  }
+  return &it->second;
+}
+
+void HeapHistogram::Merge(const HeapHistogram& other) {
+  DCHECK(entries_.empty());
+  for (const auto& it : other.classes_) {
+    Counts* counts = GetCounts(it.first);
+    counts->count += it.second.count;
+    counts->bytes += it.second.bytes;
+  }
+}
+
+static bool CompareEntries(const HeapHistogram::Entry& lhs, const HeapHistogram::Entry& rhs) {
+  if (lhs.bytes != rhs.bytes) {
+    return lhs.bytes > rhs.bytes;
+  }
+  return lhs.descriptor < rhs.descriptor;
+}
+
+void HeapHistogram::Finish() {
+  DCHECK(entries_.empty());
+  entries_.reserve(classes_.size());
+  for (const auto& it : classes_) {
+    Entry entry;
+    entry.descriptor = ClassHelper(it.first).GetDescriptor();
+    entry.count = it.second.count;
+    entry.bytes = it.second.bytes;
+    entries_.push_back(entry);
+    objects_ += entry.count;
+    bytes_ += entry.bytes;
+  }
+  std::sort(entries_.begin(), entries_.end(), CompareEntries);
+  classes_.clear();
+  last_class_ = NULL;
+  last_counts_ = NULL;
+}
+
+void HeapHistogram::Dump(std::ostream& os, size_t max_classes) const {
+  os << "Heap histogram: " << objects_ << " objects, " << PrettySize(bytes_) << " in "
+     << entries_.size() << " classes\n";
+  size_t count = entries_.size();
+  if (max_classes != 0 && max_classes < count) {
+    count = max_classes;
+    os << "Largest " << count << " classes:\n";
+  }
+  os << StringPrintf("%12s %12s  %s\n", "instances", "bytes", "class");
+  for (size_t i = 0; i < count; ++i) {
+    const Entry& entry = entries_[i];
+    os << StringPrintf("%12llu %12llu  ", static_cast<unsigned long long>(entry.count),
+                       static_cast<unsigned long long>(entry.bytes))
+       << PrettyDescriptor(entry.descriptor) << "\n";
+  }
+}
+
+static void EncodeUnsignedLeb128(std::vector<uint8_t>* out, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0) {
+      byte |= 0x80;
+    }
+    out->push_back(byte);
+  } while (value != 0);
+}
+
+void HeapHistogram::Encode(std::vector<uint8_t>* out) const {
+  out->push_back(kEncodingVersion);
+  EncodeUnsignedLeb128(out, entries_.size());
+  for (const Entry& entry : entries_) {
+    EncodeUnsignedLeb128(out, entry.descriptor.size());
+    out->insert(out->end(), entry.descriptor.begin(), entry.descriptor.end());
+    EncodeUnsignedLeb128(out, entry.count);
+    EncodeUnsignedLeb128(out, entry.bytes);
+  }
+}
+
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_HEAP_HISTOGRAM_H_
+#define ART_RUNTIME_GC_HEAP_HISTOGRAM_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "locks.h"
+#include "safe_map.h"
+
+namespace art {
+namespace mirror {
+  class Class;
+}  // namespace mirror
+namespace gc {
+
+// Instance counts and shallow sizes of the objects in the heap, per class.
+class HeapHistogram {
+ public:
+  struct Entry {
+    std::string descriptor;
+    uint64_t count;
+    uint64_t bytes;
+  };
+
+  // Version of the format written by Encode.
+  static const uint8_t kEncodingVersion = 1;
+
+  HeapHistogram() : last_class_(NULL), last_counts_(NULL), objects_(0), bytes_(0) {}
+
+  void AddObject(mirror::Class* klass, size_t bytes) {
+    // Neighbouring objects tend to be of the same class, so skip the map lookup for them.
+    if (UNLIKELY(klass != last_class_)) {
+      last_class_ = klass;
+      last_counts_ = GetCounts(klass);
+    }
+    ++last_counts_->count;
+    last_counts_->bytes += bytes;
+  }
+
+  // Adds the counts of another histogram under construction to this one.
+  void Merge(const HeapHistogram& other);
+
+  // Names the classes and sorts them by total size, largest first. Classes may move or be
+  // unloaded once the world resumes, so this must be done before that.
+  void Finish() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  const std::vector<Entry>& GetEntries() const {
+    return entries_;
+  }
+
+  uint64_t GetObjectCount() const {
+    return objects_;
+  }
+
+  uint64_t GetByteCount() const {
+    return bytes_;
+  }
+
+  // Dumps the largest classes as text, or all of them if max_classes is 0.
+  void Dump(std::ostream& os, size_t max_classes) const;
+
+  // Appends a compact binary form of the histogram: a version byte, the number of classes, then
+  // the descriptor length, descriptor, instance count and total size of each class. Every number
+  // after the version byte is an unsigned LEB128.
+  void Encode(std::vector<uint8_t>* out) const;
+
+ private:
+  struct Counts {
+    Counts() : count(0), bytes(0) {}
+    uint64_t count;
+    uint64_t bytes;
+  };
+  typedef SafeMap<mirror::Class*, Counts> ClassCounts;
+
+  Counts* GetCounts(mirror::Class* klass);
+
+  ClassCounts classes_;
+  mirror::Class* last_class_;
+  Counts* last_counts_;
+
+  std::vector<Entry> entries_;
+  uint64_t objects_;
+  uint64_t bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapHistogram);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_HEAP_HISTOGRAM_H_
@@ -17,6 +17,8 @@
 #include "common_test.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/heap_histogram.h"
+#include "leb128.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
@@ -69,5 +71,47 @@ TEST_F(HeapTest, HeapBitmapCapacityTest) {
   bitmap->Set(fake_end_of_heap_object);
 }
 
+TEST_F(HeapTest, ComputeHistogram) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::Class> c(soa.Self(), class_linker_->FindSystemClass("[Ljava/lang/Object;"));
+  SirtRef<mirror::ObjectArray<mirror::Object> > array(soa.Self(),
+      mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), c.get(), 1024));
+  for (size_t i = 0; i < 1024; ++i) {
+    mirror::String* string = mirror::String::AllocFromModifiedUtf8(soa.Self(), "hello, world!");
+    array->Set(i, string);
+  }
+
+  HeapHistogram histogram;
+  {
+    ScopedThreadStateChange tsc(soa.Self(), kNative);
+    Runtime::Current()->GetHeap()->ComputeHistogram(&histogram);
+  }
+  const std::vector<HeapHistogram::Entry>& entries = histogram.GetEntries();
+  ASSERT_FALSE(entries.empty());
+  uint64_t strings = 0;
+  uint64_t objects = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i != 0) {
+      EXPECT_GE(entries[i - 1].bytes, entries[i].bytes);
+    }
+    if (entries[i].descriptor == "Ljava/lang/String;") {
+      strings = entries[i].count;
+    }
+    objects += entries[i].count;
+  }
+  EXPECT_GE(strings, 1024U);
+  EXPECT_EQ(objects, histogram.GetObjectCount());
+
+  std::vector<uint8_t> data;
+  histogram.Encode(&data);
+  ASSERT_GE(data.size(), 2U);
+  EXPECT_EQ(static_cast<int>(HeapHistogram::kEncodingVersion), static_cast<int>(data[0]));
+  const uint8_t* ptr = &data[1];
+  EXPECT_EQ(entries.size(), DecodeUnsignedLeb128(&ptr));
+  uint32_t descriptor_length = DecodeUnsignedLeb128(&ptr);
+  EXPECT_EQ(entries[0].descriptor, std::string(reinterpret_cast<const char*>(ptr),
+                                               descriptor_length));
+}
+
 }  // namespace gc
 }  // namespace art
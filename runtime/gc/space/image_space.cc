@@ -16,6 +16,7 @@
 
 #include "image_space.h"
 
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -137,11 +138,15 @@ static bool GenerateImage(const std::string& image_file_name, std::string* error
   return true;
 }
 
-ImageSpace* ImageSpace::Create(const char* original_image_file_name) {
+ImageSpace* ImageSpace::Create(const char* original_image_file_name,
+                               const ImageSpace* previous) {
+  uint32_t dependency_checksum =
+      (previous == nullptr) ? 0 : previous->GetImageHeader().GetChainChecksum();
   if (OS::FileExists(original_image_file_name)) {
     // If the /system file exists, it should be up-to-date, don't try to generate
     std::string error_msg;
-    ImageSpace* space = ImageSpace::Init(original_image_file_name, false, &error_msg);
+    ImageSpace* space = ImageSpace::Init(original_image_file_name, false, dependency_checksum,
+                                         &error_msg);
     if (space == nullptr) {
       LOG(FATAL) << "Failed to load image '" << original_image_file_name << "': " << error_msg;
     }
@@ -153,14 +158,20 @@ ImageSpace* ImageSpace::Create(const char* original_image_file_name) {
   std::string image_file_name(GetDalvikCacheFilenameOrDie(original_image_file_name));
   std::string error_msg;
   if (OS::FileExists(image_file_name.c_str())) {
-    space::ImageSpace* image_space = ImageSpace::Init(image_file_name.c_str(), true, &error_msg);
+    space::ImageSpace* image_space = ImageSpace::Init(image_file_name.c_str(), true,
+                                                      dependency_checksum, &error_msg);
     if (image_space != nullptr) {
       return image_space;
     }
   }
+  // Later images of a multi-image boot image are written by the same dex2oat invocation as the
+  // first, they can't be generated on their own.
+  if (previous != nullptr) {
+    LOG(FATAL) << "Failed to load image '" << original_image_file_name << "': " << error_msg;
+  }
   CHECK(GenerateImage(image_file_name, &error_msg))
       << "Failed to generate image '" << image_file_name << "': " << error_msg;
-  ImageSpace* space = ImageSpace::Init(image_file_name.c_str(), true, &error_msg);
+  ImageSpace* space = ImageSpace::Init(image_file_name.c_str(), true, 0, &error_msg);
   if (space == nullptr) {
     LOG(FATAL) << "Failed to load image '" << original_image_file_name << "': " << error_msg;
   }
@@ -179,7 +190,7 @@ void ImageSpace::VerifyImageAllocations() {
 }
 
 ImageSpace* ImageSpace::Init(const char* image_file_name, bool validate_oat_file,
-                             std::string* error_msg) {
+                             uint32_t dependency_checksum, std::string* error_msg) {
   CHECK(image_file_name != nullptr);
 
   uint64_t start_time = 0;
@@ -199,43 +210,20 @@ ImageSpace* ImageSpace::Init(const char* image_file_name, bool validate_oat_file
     *error_msg = StringPrintf("Invalid image header in '%s'", image_file_name);
     return nullptr;
   }
-
-  // Note: The image header is part of the image due to mmap page alignment required of offset.
-  UniquePtr<MemMap> map(MemMap::MapFileAtAddress(image_header.GetImageBegin(),
-                                                 image_header.GetImageSize(),
-                                                 PROT_READ | PROT_WRITE,
-                                                 MAP_PRIVATE | MAP_FIXED,
-                                                 file->Fd(),
-                                                 0,
-                                                 false,
-                                                 image_file_name,
-                                                 error_msg));
-  if (map.get() == NULL) {
-    DCHECK(!error_msg->empty());
+  if (image_header.IsAppImage()) {
+    *error_msg = StringPrintf("Image '%s' is an app image", image_file_name);
     return nullptr;
   }
-  CHECK_EQ(image_header.GetImageBegin(), map->Begin());
-  DCHECK_EQ(0, memcmp(&image_header, map->Begin(), sizeof(ImageHeader)));
-
-  UniquePtr<MemMap> image_map(MemMap::MapFileAtAddress(nullptr, image_header.GetImageBitmapSize(),
-                                                       PROT_READ, MAP_PRIVATE,
-                                                       file->Fd(), image_header.GetBitmapOffset(),
-                                                       false,
-                                                       image_file_name,
-                                                       error_msg));
-  if (image_map.get() == nullptr) {
-    *error_msg = StringPrintf("Failed to map image bitmap: %s", error_msg->c_str());
+  if (image_header.GetDependencyChecksum() != dependency_checksum) {
+    *error_msg = StringPrintf("Image '%s' depends on an image with checksum 0x%x, expected 0x%x",
+                              image_file_name, image_header.GetDependencyChecksum(),
+                              dependency_checksum);
     return nullptr;
   }
-  size_t bitmap_index = bitmap_index_.FetchAndAdd(1);
-  std::string bitmap_name(StringPrintf("imagespace %s live-bitmap %u", image_file_name,
-                                       bitmap_index));
-  UniquePtr<accounting::SpaceBitmap> bitmap(
-      accounting::SpaceBitmap::CreateFromMemMap(bitmap_name, image_map.release(),
-                                                reinterpret_cast<byte*>(map->Begin()),
-                                                map->Size()));
-  if (bitmap.get() == nullptr) {
-    *error_msg = StringPrintf("Could not create bitmap '%s'", bitmap_name.c_str());
+
+  UniquePtr<ImageSpace> space(MapImage(image_file_name, file.get(), image_header, false,
+                                       error_msg));
+  if (space.get() == nullptr) {
     return nullptr;
   }
 
@@ -254,11 +242,6 @@ ImageSpace* ImageSpace::Init(const char* image_file_name, bool validate_oat_file
   callee_save_method = image_header.GetImageRoot(ImageHeader::kRefsAndArgsSaveMethod);
   runtime->SetCalleeSaveMethod(down_cast<mirror::ArtMethod*>(callee_save_method), Runtime::kRefsAndArgs);
 
-  UniquePtr<ImageSpace> space(new ImageSpace(image_file_name, map.release(), bitmap.release()));
-  if (kIsDebugBuild) {
-    space->VerifyImageAllocations();
-  }
-
   space->oat_file_.reset(space->OpenOatFile(error_msg));
   if (space->oat_file_.get() == nullptr) {
     DCHECK(!error_msg->empty());
@@ -277,6 +260,125 @@ ImageSpace* ImageSpace::Init(const char* image_file_name, bool validate_oat_file
   return space.release();
 }
 
+ImageSpace* ImageSpace::CreateAppImage(const char* image_file_name, uint32_t oat_checksum,
+                                       uint32_t boot_image_checksum, byte* begin, byte* limit,
+                                       std::string* error_msg) {
+  UniquePtr<File> file(OS::OpenFileForReading(image_file_name));
+  if (file.get() == NULL) {
+    *error_msg = StringPrintf("Failed to open '%s'", image_file_name);
+    return nullptr;
+  }
+  ImageHeader image_header;
+  bool success = file->ReadFully(&image_header, sizeof(image_header));
+  if (!success || !image_header.IsValid() || !image_header.IsAppImage()) {
+    *error_msg = StringPrintf("Invalid app image header in '%s'", image_file_name);
+    return nullptr;
+  }
+  if (image_header.GetOatChecksum() != oat_checksum) {
+    *error_msg = StringPrintf("App image '%s' was written for an oat file with checksum 0x%x, "
+                              "expected 0x%x", image_file_name, image_header.GetOatChecksum(),
+                              oat_checksum);
+    return nullptr;
+  }
+  if (image_header.GetDependencyChecksum() != boot_image_checksum) {
+    *error_msg = StringPrintf("App image '%s' depends on a boot image with checksum 0x%x, "
+                              "expected 0x%x", image_file_name,
+                              image_header.GetDependencyChecksum(), boot_image_checksum);
+    return nullptr;
+  }
+  // The mapping replaces the reserved pages, it must not reach past them.
+  byte* image_begin = image_header.GetImageBegin();
+  if (image_begin != begin ||
+      image_begin + RoundUp(image_header.GetImageSize(), kPageSize) > limit) {
+    *error_msg = StringPrintf("App image '%s' at %p+%zd doesn't fit the reservation at %p-%p",
+                              image_file_name, image_begin, image_header.GetImageSize(), begin,
+                              limit);
+    return nullptr;
+  }
+  return MapImage(image_file_name, file.get(), image_header, true, error_msg);
+}
+
+std::string ImageSpace::GetAppImageLocation(const std::string& oat_location) {
+  size_t slash = oat_location.rfind('/');
+  size_t dot = oat_location.rfind('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return oat_location + ".art";
+  }
+  return oat_location.substr(0, dot) + ".art";
+}
+
+// Maps PROT_NONE pages over [begin, begin + size) again after mapping an app image over them
+// failed. A failed or unmapped MAP_FIXED mapping would otherwise leave a hole in the reservation
+// that other mappings could take.
+static void RestoreReservation(byte* begin, size_t size) {
+  void* result = mmap(begin, RoundUp(size, kPageSize), PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+  if (result != begin) {
+    PLOG(FATAL) << "Failed to restore the app image reservation at "
+                << reinterpret_cast<void*>(begin);
+  }
+}
+
+ImageSpace* ImageSpace::MapImage(const char* image_file_name, File* file,
+                                 const ImageHeader& image_header, bool reuse,
+                                 std::string* error_msg) {
+  // The bitmap is mapped first so that nothing can fail once reserved pages are replaced.
+  UniquePtr<MemMap> image_map(MemMap::MapFileAtAddress(nullptr, image_header.GetImageBitmapSize(),
+                                                       PROT_READ, MAP_PRIVATE,
+                                                       file->Fd(), image_header.GetBitmapOffset(),
+                                                       false,
+                                                       image_file_name,
+                                                       error_msg));
+  if (image_map.get() == nullptr) {
+    *error_msg = StringPrintf("Failed to map image bitmap: %s", error_msg->c_str());
+    return nullptr;
+  }
+
+  // Note: The image header is part of the image due to mmap page alignment required of offset.
+  UniquePtr<MemMap> map(MemMap::MapFileAtAddress(image_header.GetImageBegin(),
+                                                 image_header.GetImageSize(),
+                                                 PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_FIXED,
+                                                 file->Fd(),
+                                                 0,
+                                                 reuse,
+                                                 image_file_name,
+                                                 error_msg));
+  if (map.get() == NULL) {
+    DCHECK(!error_msg->empty());
+    if (reuse) {
+      RestoreReservation(image_header.GetImageBegin(), image_header.GetImageSize());
+    }
+    return nullptr;
+  }
+  CHECK_EQ(image_header.GetImageBegin(), map->Begin());
+  DCHECK_EQ(0, memcmp(&image_header, map->Begin(), sizeof(ImageHeader)));
+
+  size_t bitmap_index = bitmap_index_.FetchAndAdd(1);
+  std::string bitmap_name(StringPrintf("imagespace %s live-bitmap %u", image_file_name,
+                                       bitmap_index));
+  UniquePtr<accounting::SpaceBitmap> bitmap(
+      accounting::SpaceBitmap::CreateFromMemMap(bitmap_name, image_map.release(),
+                                                reinterpret_cast<byte*>(map->Begin()),
+                                                map->Size()));
+  if (bitmap.get() == nullptr) {
+    *error_msg = StringPrintf("Could not create bitmap '%s'", bitmap_name.c_str());
+    if (reuse) {
+      // Replace the image in place and drop the map without unmapping the pages, which belong
+      // to the reservation again.
+      RestoreReservation(map->Begin(), map->Size());
+      map.release();
+    }
+    return nullptr;
+  }
+
+  ImageSpace* space = new ImageSpace(image_file_name, map.release(), bitmap.release());
+  if (kIsDebugBuild) {
+    space->VerifyImageAllocations();
+  }
+  return space;
+}
+
 OatFile* ImageSpace::OpenOatFile(std::string* error_msg) const {
   const Runtime* runtime = Runtime::Current();
   const ImageHeader& image_header = GetImageHeader();
@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_GC_SPACE_IMAGE_SPACE_H_
 #define ART_RUNTIME_GC_SPACE_IMAGE_SPACE_H_
 
+#include "os.h"
 #include "space.h"
 
 namespace art {
@@ -45,7 +46,28 @@ class ImageSpace : public MemMapSpace {
   // creation of the alloc space. The ReleaseOatFile will later be
   // used to transfer ownership of the OatFile to the ClassLinker when
   // it is initialized.
-  static ImageSpace* Create(const char* image) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  //
+  // previous is the image loaded before this one for a multi-image boot
+  // image, or NULL for the first image. The image header must record the
+  // chain checksum of previous as its dependency. Only a first image is
+  // generated when missing.
+  static ImageSpace* Create(const char* image, const ImageSpace* previous)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Maps an app image into [begin, limit), the address range the heap
+  // reserved for it. The image must have been written for the app oat
+  // file with checksum oat_checksum, against the boot image with chain
+  // checksum boot_image_checksum. Returns NULL and sets error_msg if
+  // the image is stale or does not fit. App images have no oat file of
+  // their own, their code comes from the oat file of the app.
+  static ImageSpace* CreateAppImage(const char* image, uint32_t oat_checksum,
+                                    uint32_t boot_image_checksum, byte* begin, byte* limit,
+                                    std::string* error_msg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns where the app image of the app oat file at oat_location
+  // is, the oat location with an .art extension.
+  static std::string GetAppImageLocation(const std::string& oat_location);
 
   // Releases the OatFile from the ImageSpace so it can be transfer to
   // the caller, presumably the ClassLinker.
@@ -79,11 +101,24 @@ class ImageSpace : public MemMapSpace {
   // Tries to initialize an ImageSpace from the given image path,
   // returning NULL on error.
   //
+  // The image must have been written after an image with the given chain
+  // checksum, 0 for the first image.
+  //
   // If validate_oat_file is false (for /system), do not verify that
   // image's OatFile is up-to-date relative to its DexFile
   // inputs. Otherwise (for /data), validate the inputs and generate
   // the OatFile in /data/dalvik-cache if necessary.
-  static ImageSpace* Init(const char* image, bool validate_oat_file, std::string* error_msg)
+  static ImageSpace* Init(const char* image, bool validate_oat_file,
+                          uint32_t dependency_checksum, std::string* error_msg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Maps the objects and live bitmap of the image in file, whose
+  // header is image_header, at the image begin address. reuse allows
+  // mapping over an address range reserved by the caller, which stays
+  // reserved if mapping fails.
+  static ImageSpace* MapImage(const char* image_file_name, File* file,
+                              const ImageHeader& image_header, bool reuse,
+                              std::string* error_msg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   OatFile* OpenOatFile(std::string* error_msg) const
@@ -87,6 +87,11 @@ class NativePcOffsetToReferenceMap {
     return (static_cast<size_t>(data_[0]) | (static_cast<size_t>(data_[1]) << 8)) >> 3;
   }
 
+  // The size of the encoded map, including its header.
+  size_t SizeInBytes() const {
+    return (Table() - data_) + NumEntries() * EntryWidth();
+  }
+
  private:
   // Skip the size information at the beginning of data.
   const uint8_t* Table() const {
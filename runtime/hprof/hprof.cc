@@ -15,27 +15,35 @@
  */
 
 /*
- * Preparation and completion of hprof data generation.  The output is
- * written into two files and then combined.  This is necessary because
- * we generate some of the data (strings and classes) while we dump the
- * heap, and some analysis tools require that the class and string data
- * appear first.
+ * Preparation and completion of hprof data generation.  Some of the data
+ * (strings and classes) is generated while we dump the heap, and some
+ * analysis tools require that the class and string data appear first.
+ * Dumps sent to DDMS therefore buffer the heap records in memory and
+ * send them after the tables.  Dumps to a file must not double the
+ * memory in use, so they walk the heap twice instead: the first pass
+ * only collects the tables, the second streams the records to the file
+ * through a bounded buffer, gzip compressing them if the file name ends
+ * in ".gz".
  */
 
 #include "hprof.h"
 
-#include <cutils/open_memstream.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <time.h>
 #include <unistd.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <set>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/stringprintf.h"
@@ -176,6 +184,156 @@ typedef std::set<mirror::Class*>::iterator ClassSetIterator;
 typedef SafeMap<std::string, size_t> StringMap;
 typedef SafeMap<std::string, size_t>::iterator StringMapIterator;
 
+// Receives the serialized dump. Write failures are sticky, so that a dump which failed part way
+// through is reported as failed at the end.
+class HprofOutput {
+ public:
+  HprofOutput() : length_(0) {}
+  virtual ~HprofOutput() {}
+
+  bool Write(const void* data, size_t length) {
+    length_ += length;
+    return DoWrite(reinterpret_cast<const uint8_t*>(data), length);
+  }
+
+  // The number of bytes of hprof data written, before any compression.
+  uint64_t Length() const {
+    return length_;
+  }
+
+ protected:
+  virtual bool DoWrite(const uint8_t* data, size_t length) = 0;
+
+ private:
+  uint64_t length_;
+
+  DISALLOW_COPY_AND_ASSIGN(HprofOutput);
+};
+
+// Collects the dump in memory, as DDMS receives it in a single chunk.
+class MemoryHprofOutput : public HprofOutput {
+ public:
+  MemoryHprofOutput() {}
+
+  const std::vector<uint8_t>& Data() const {
+    return data_;
+  }
+
+ protected:
+  bool DoWrite(const uint8_t* data, size_t length) {
+    data_.insert(data_.end(), data, data + length);
+    return true;
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryHprofOutput);
+};
+
+// Discards the dump. The first pass of a streamed dump only collects strings and classes.
+class NullHprofOutput : public HprofOutput {
+ public:
+  NullHprofOutput() {}
+
+ protected:
+  bool DoWrite(const uint8_t*, size_t) {
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(NullHprofOutput);
+};
+
+// Writes the dump to a file through a fixed size buffer, optionally gzip compressing it.
+class FileHprofOutput : public HprofOutput {
+ public:
+  static const size_t kBufferSize = 64 * KB;
+
+  FileHprofOutput(File* file, bool compress)
+      : file_(file), compress_(compress), deflating_(false), failed_(false), used_(0),
+        buffer_(kBufferSize) {
+  }
+
+  ~FileHprofOutput() {
+    if (deflating_) {
+      deflateEnd(&stream_);
+    }
+  }
+
+  bool Init() {
+    if (!compress_) {
+      return true;
+    }
+    memset(&stream_, 0, sizeof(stream_));
+    // A window of 2^15 bytes, plus 16 for a gzip rather than a zlib wrapper.
+    if (deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      failed_ = true;
+      return false;
+    }
+    deflating_ = true;
+    deflated_.resize(kBufferSize);
+    return true;
+  }
+
+  // Writes out what is still buffered and, when compressing, the gzip trailer.
+  bool Finish() {
+    return !failed_ && FlushBuffer(Z_FINISH);
+  }
+
+ protected:
+  bool DoWrite(const uint8_t* data, size_t length) {
+    if (failed_) {
+      return false;
+    }
+    while (length != 0) {
+      size_t chunk = std::min(length, kBufferSize - used_);
+      memcpy(&buffer_[used_], data, chunk);
+      used_ += chunk;
+      data += chunk;
+      length -= chunk;
+      if (used_ == kBufferSize && !FlushBuffer(Z_NO_FLUSH)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  bool FlushBuffer(int flush) {
+    if (!compress_) {
+      failed_ = !file_->WriteFully(&buffer_[0], used_);
+      used_ = 0;
+      return !failed_;
+    }
+    stream_.next_in = &buffer_[0];
+    stream_.avail_in = used_;
+    do {
+      stream_.next_out = &deflated_[0];
+      stream_.avail_out = kBufferSize;
+      if (deflate(&stream_, flush) == Z_STREAM_ERROR ||
+          !file_->WriteFully(&deflated_[0], kBufferSize - stream_.avail_out)) {
+        failed_ = true;
+        return false;
+      }
+    } while (stream_.avail_out == 0);
+    used_ = 0;
+    return true;
+  }
+
+  File* const file_;
+  const bool compress_;
+  bool deflating_;
+  bool failed_;
+  z_stream stream_;
+  size_t used_;
+  std::vector<uint8_t> buffer_;
+  std::vector<uint8_t> deflated_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileHprofOutput);
+};
+
 // Represents a top-level hprof record, whose serialized format is:
 // U1  TAG: denoting the type of the record
 // U4  TIME: number of microseconds since the time stamp in the header
@@ -187,20 +345,20 @@ class HprofRecord {
     dirty_ = false;
     alloc_length_ = 128;
     body_ = reinterpret_cast<unsigned char*>(malloc(alloc_length_));
-    fp_ = NULL;
+    output_ = NULL;
   }
 
   ~HprofRecord() {
     free(body_);
   }
 
-  int StartNewRecord(FILE* fp, uint8_t tag, uint32_t time) {
+  int StartNewRecord(HprofOutput* output, uint8_t tag, uint32_t time) {
     int rc = Flush();
     if (rc != 0) {
       return rc;
     }
 
-    fp_ = fp;
+    output_ = output;
     tag_ = tag;
     time_ = time;
     length_ = 0;
@@ -216,16 +374,10 @@ class HprofRecord {
       U4_TO_BUF_BE(headBuf, 1, time_);
       U4_TO_BUF_BE(headBuf, 5, length_);
 
-      int nb = fwrite(headBuf, 1, sizeof(headBuf), fp_);
-      if (nb != sizeof(headBuf)) {
-        return UNIQUE_ERROR;
-      }
-      nb = fwrite(body_, 1, length_, fp_);
-      if (nb != static_cast<int>(length_)) {
+      dirty_ = false;
+      if (!output_->Write(headBuf, sizeof(headBuf)) || !output_->Write(body_, length_)) {
         return UNIQUE_ERROR;
       }
-
-      dirty_ = false;
     }
     // TODO if we used less than half (or whatever) of allocLen, shrink the buffer.
     return 0;
@@ -355,7 +507,7 @@ class HprofRecord {
   size_t alloc_length_;
   unsigned char* body_;
 
-  FILE* fp_;
+  HprofOutput* output_;
   uint8_t tag_;
   uint32_t time_;
   size_t length_;
@@ -376,43 +528,118 @@ class Hprof {
         gc_scan_state_(0),
         current_heap_(HPROF_HEAP_DEFAULT),
         objects_in_segment_(0),
-        header_fp_(NULL),
-        header_data_ptr_(NULL),
-        header_data_size_(0),
-        body_fp_(NULL),
-        body_data_ptr_(NULL),
-        body_data_size_(0),
-        next_string_id_(0x400000) {
+        header_output_(NULL),
+        body_output_(NULL),
+        next_string_id_(0x400000),
+        forked_(false) {
     LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
+  }
 
-    header_fp_ = open_memstream(&header_data_ptr_, &header_data_size_);
-    if (header_fp_ == NULL) {
-      PLOG(FATAL) << "header open_memstream failed";
-    }
+  // Prepares for Dump to run in a forked child. Only the forking thread survives there, and the
+  // threads that kept running in the native state may have held any lock at the fork, so the
+  // child must not take the locks guarding the runtime's roots nor allocate managed objects. The
+  // roots are visited now instead, with the world suspended, and failures are logged, not thrown.
+  void PrepareForkedDump() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    Runtime::Current()->VisitRoots(CollectRootVisitor, &roots_, false, false);
+    forked_ = true;
+  }
 
-    body_fp_ = open_memstream(&body_data_ptr_, &body_data_size_);
-    if (body_fp_ == NULL) {
-      PLOG(FATAL) << "body open_memstream failed";
+  // Returns false, having thrown a RuntimeException, if the dump could not be written.
+  bool Dump()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    if (direct_to_ddms_) {
+      DumpToDdms();
+      return true;
     }
+    return DumpToFile();
+  }
+
+ private:
+  void DumpToDdms()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    MemoryHprofOutput header;
+    MemoryHprofOutput body;
+    header_output_ = &header;
+    body_output_ = &body;
+    WalkHeap();
+    WriteHeader();
+
+    // Send the data off to DDMS.
+    iovec iov[2];
+    iov[0].iov_base = const_cast<uint8_t*>(&header.Data()[0]);
+    iov[0].iov_len = header.Data().size();
+    iov[1].iov_base = const_cast<uint8_t*>(&body.Data()[0]);
+    iov[1].iov_len = body.Data().size();
+    Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
+    LogCompletion(header.Length() + body.Length());
   }
 
-  ~Hprof() {
-    if (header_fp_ != NULL) {
-      fclose(header_fp_);
+  bool DumpToFile()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    // Where exactly are we writing to?
+    int out_fd;
+    if (fd_ >= 0) {
+      out_fd = dup(fd_);
+      if (out_fd < 0) {
+        DumpFailed(StringPrintf("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno)));
+        return false;
+      }
+    } else {
+      out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+      if (out_fd < 0) {
+        DumpFailed(StringPrintf("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
+                                strerror(errno)));
+        return false;
+      }
     }
-    if (body_fp_ != NULL) {
-      fclose(body_fp_);
+    UniquePtr<File> file(new File(out_fd, filename_));
+
+    // The first pass only finds the strings and classes the tables must list. The world stays
+    // suspended, so the second pass meets exactly the same objects.
+    NullHprofOutput tables_pass_output;
+    header_output_ = &tables_pass_output;
+    body_output_ = &tables_pass_output;
+    WalkHeap();
+    size_t num_strings = strings_.size();
+    size_t num_classes = classes_.size();
+
+    FileHprofOutput output(file.get(), EndsWith(filename_, ".gz"));
+    header_output_ = &output;
+    body_output_ = &output;
+    bool okay = output.Init() && WriteHeader() == 0;
+    if (okay) {
+      WalkHeap();
+      okay = output.Finish();
+    }
+    CHECK_EQ(num_strings, strings_.size());
+    CHECK_EQ(num_classes, classes_.size());
+    if (!okay) {
+      DumpFailed(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                              filename_.c_str(), strerror(errno)));
+      return false;
     }
-    free(header_data_ptr_);
-    free(body_data_ptr_);
+    LogCompletion(output.Length());
+    return true;
   }
 
-  void Dump()
+  // Writes the heap dump records to body_output_.
+  void WalkHeap()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    objects_in_segment_ = 0;
+    current_heap_ = HPROF_HEAP_DEFAULT;
     // Walk the roots and the heap.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
-    Runtime::Current()->VisitRoots(RootVisitor, this, false, false);
+    current_record_.StartNewRecord(body_output_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    if (forked_) {
+      for (const mirror::Object* root : roots_) {
+        VisitRoot(root);
+      }
+    } else {
+      Runtime::Current()->VisitRoots(RootVisitor, this, false, false);
+    }
     Thread* self = Thread::Current();
     {
       WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
@@ -422,68 +649,45 @@ class Hprof {
       ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
       Runtime::Current()->GetHeap()->GetLiveBitmap()->Walk(HeapBitmapCallback, this);
     }
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
+    current_record_.StartNewRecord(body_output_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
     current_record_.Flush();
-    fflush(body_fp_);
+  }
 
-    // Write the header.
-    WriteFixedHeader();
+  // Writes the fixed header and the tables to header_output_.
+  int WriteHeader() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    int err = WriteFixedHeader();
+    if (err != 0) {
+      return err;
+    }
     // Write the string and class tables, and any stack traces, to the header.
     // (jhat requires that these appear before any of the data in the body that refers to them.)
-    WriteStringTable();
-    WriteClassTable();
-    WriteStackTraces();
-    current_record_.Flush();
-    fflush(header_fp_);
-
-    bool okay = true;
-    if (direct_to_ddms_) {
-      // Send the data off to DDMS.
-      iovec iov[2];
-      iov[0].iov_base = header_data_ptr_;
-      iov[0].iov_len = header_data_size_;
-      iov[1].iov_base = body_data_ptr_;
-      iov[1].iov_len = body_data_size_;
-      Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
-    } else {
-      // Where exactly are we writing to?
-      int out_fd;
-      if (fd_ >= 0) {
-        out_fd = dup(fd_);
-        if (out_fd < 0) {
-          ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
-          return;
-        }
-      } else {
-        out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
-        if (out_fd < 0) {
-          ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
-                                strerror(errno));
-          return;
-        }
-      }
-
-      UniquePtr<File> file(new File(out_fd, filename_));
-      okay = file->WriteFully(header_data_ptr_, header_data_size_) &&
-          file->WriteFully(body_data_ptr_, body_data_size_);
-      if (!okay) {
-        std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                     filename_.c_str(), strerror(errno)));
-        ThrowRuntimeException("%s", msg.c_str());
-        LOG(ERROR) << msg;
-      }
+    err = WriteStringTable();
+    if (err != 0) {
+      return err;
     }
+    err = WriteClassTable();
+    if (err != 0) {
+      return err;
+    }
+    WriteStackTraces();
+    return current_record_.Flush();
+  }
 
+  void LogCompletion(uint64_t length) {
     // Throw out a log message for the benefit of "runhat".
-    if (okay) {
-      uint64_t duration = NanoTime() - start_ns_;
-      LOG(INFO) << "hprof: heap dump completed ("
-          << PrettySize(header_data_size_ + body_data_size_ + 1023)
-          << ") in " << PrettyDuration(duration);
+    uint64_t duration = NanoTime() - start_ns_;
+    LOG(INFO) << "hprof: heap dump completed (" << PrettySize(length + 1023) << ") in "
+              << PrettyDuration(duration);
+  }
+
+  // Logs msg, and throws it as a RuntimeException unless in a forked child.
+  void DumpFailed(const std::string& msg) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    LOG(ERROR) << msg;
+    if (!forked_) {
+      ThrowRuntimeException("%s", msg.c_str());
     }
   }
 
- private:
   static mirror::Object* RootVisitor(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     DCHECK(arg != NULL);
@@ -491,6 +695,12 @@ class Hprof {
     return obj;
   }
 
+  static mirror::Object* CollectRootVisitor(mirror::Object* obj, void* arg) {
+    DCHECK(arg != NULL);
+    reinterpret_cast<std::vector<const mirror::Object*>*>(arg)->push_back(obj);
+    return obj;
+  }
+
   static void HeapBitmapCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     CHECK(obj != NULL);
@@ -514,7 +724,7 @@ class Hprof {
       const mirror::Class* c = *it;
       CHECK(c != NULL);
 
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
+      int err = current_record_.StartNewRecord(header_output_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
       if (err != 0) {
         return err;
       }
@@ -540,7 +750,7 @@ class Hprof {
       const std::string& string = (*it).first;
       size_t id = (*it).second;
 
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_STRING, HPROF_TIME);
+      int err = current_record_.StartNewRecord(header_output_, HPROF_TAG_STRING, HPROF_TIME);
       if (err != 0) {
         return err;
       }
@@ -564,7 +774,7 @@ class Hprof {
 
   void StartNewHeapDumpSegment() {
     // This flushes the old segment and starts a new one.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    current_record_.StartNewRecord(body_output_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
     objects_in_segment_ = 0;
 
     // Starting a new HEAP_DUMP resets the heap to default.
@@ -613,17 +823,21 @@ class Hprof {
     return LookupStringId(PrettyDescriptor(c));
   }
 
-  void WriteFixedHeader() {
+  int WriteFixedHeader() {
     char magic[] = "JAVA PROFILE 1.0.3";
     unsigned char buf[4];
 
     // Write the file header.
     // U1: NUL-terminated magic string.
-    fwrite(magic, 1, sizeof(magic), header_fp_);
+    if (!header_output_->Write(magic, sizeof(magic))) {
+      return UNIQUE_ERROR;
+    }
 
     // U4: size of identifiers.  We're using addresses as IDs, so make sure a pointer fits.
     U4_TO_BUF_BE(buf, 0, sizeof(void*));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    if (!header_output_->Write(buf, sizeof(uint32_t))) {
+      return UNIQUE_ERROR;
+    }
 
     // The current time, in milliseconds since 0:00 GMT, 1/1/70.
     timeval now;
@@ -636,16 +850,21 @@ class Hprof {
 
     // U4: high word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs >> 32));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    if (!header_output_->Write(buf, sizeof(uint32_t))) {
+      return UNIQUE_ERROR;
+    }
 
     // U4: low word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs & 0xffffffffULL));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);  // xxx fix the time
+    if (!header_output_->Write(buf, sizeof(uint32_t))) {  // xxx fix the time
+      return UNIQUE_ERROR;
+    }
+    return 0;
   }
 
   void WriteStackTraces() {
     // Write a dummy stack trace record so the analysis tools don't freak out.
-    current_record_.StartNewRecord(header_fp_, HPROF_TAG_STACK_TRACE, HPROF_TIME);
+    current_record_.StartNewRecord(header_output_, HPROF_TAG_STACK_TRACE, HPROF_TIME);
     current_record_.AddU4(HPROF_NULL_STACK_TRACE);
     current_record_.AddU4(HPROF_NULL_THREAD);
     current_record_.AddU4(0);    // no frames
@@ -667,18 +886,18 @@ class Hprof {
   HprofHeapId current_heap_;  // Which heap we're currently dumping.
   size_t objects_in_segment_;
 
-  FILE* header_fp_;
-  char* header_data_ptr_;
-  size_t header_data_size_;
-
-  FILE* body_fp_;
-  char* body_data_ptr_;
-  size_t body_data_size_;
+  // Where the header and tables, and the heap dump records, are written.
+  HprofOutput* header_output_;
+  HprofOutput* body_output_;
 
   ClassSet classes_;
   size_t next_string_id_;
   StringMap strings_;
 
+  // Whether Dump runs in a forked child, walking roots_ instead of the runtime's roots.
+  bool forked_;
+  std::vector<const mirror::Object*> roots_;
+
   DISALLOW_COPY_AND_ASSIGN(Hprof);
 };
 
@@ -1071,6 +1290,72 @@ void Hprof::VisitRoot(const mirror::Object* obj) {
   gc_thread_serial_number_ = 0;
 }
 
+// How long a forked heap dump may take before the child is killed.
+static const unsigned int kForkedHeapDumpTimeoutSeconds = 10 * 60;
+
+// Suspends the world only for as long as it takes to fork. The child walks its copy-on-write
+// snapshot of the heap and writes the file, while the parent resumes and waits for it in the
+// native state, so only the requesting thread waits for the dump.
+static void DumpHeapInChild(const char* filename, int fd) {
+  Thread* self = Thread::Current();
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  uint64_t start_ns = NanoTime();
+  thread_list->SuspendAll();
+  Hprof hprof(filename, fd, false);
+  hprof.PrepareForkedDump();
+  // No other thread survives in the child to release a lock it holds, so hold the locks the child
+  // still takes across the fork: the heap bitmap lock, which the GC may hold without the mutator
+  // lock while it sweeps, and the logging lock. The C library resets its malloc locks itself.
+  Locks::heap_bitmap_lock_->ExclusiveLock(self);
+  Runtime::Current()->GetHeap()->FlushAllocStack();
+  Locks::logging_lock_->ExclusiveLock(self);
+  pid_t pid = fork();
+  int fork_errno = errno;
+  Locks::logging_lock_->ExclusiveUnlock(self);
+  Locks::heap_bitmap_lock_->ExclusiveUnlock(self);
+  if (pid == 0) {
+    // Only this thread exists in the child. It still holds the mutator lock exclusively, and the
+    // stacks of the other threads are there to be visited, suspended as they were. Nothing runs
+    // atexit handlers or unwinds: the child only writes the dump, or is killed by SIGALRM if it
+    // gets stuck.
+    alarm(kForkedHeapDumpTimeoutSeconds);
+    _exit(hprof.Dump() ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  thread_list->ResumeAll();
+  uint64_t pause_ns = NanoTime() - start_ns;
+
+  if (pid == -1) {
+    ScopedObjectAccess soa(self);
+    ThrowRuntimeException("Couldn't dump heap; fork failed: %s", strerror(fork_errno));
+    return;
+  }
+  LOG(INFO) << "hprof: suspended for " << PrettyDuration(pause_ns) << " to fork heap dump process "
+            << pid;
+  // Give the child's alarm a chance to fire first, then kill it.
+  uint64_t deadline_ns = NanoTime() + MsToNs((kForkedHeapDumpTimeoutSeconds + 10) * 1000);
+  int status;
+  pid_t waited;
+  while ((waited = TEMP_FAILURE_RETRY(waitpid(pid, &status, WNOHANG))) == 0) {
+    if (NanoTime() >= deadline_ns) {
+      LOG(ERROR) << "hprof: heap dump process " << pid << " timed out, killing it";
+      kill(pid, SIGKILL);
+      waited = TEMP_FAILURE_RETRY(waitpid(pid, &status, 0));
+      break;
+    }
+    usleep(10 * 1000);
+  }
+  if (waited == -1) {
+    // With SIGCHLD ignored the child is reaped without us, and its status is lost.
+    PLOG(WARNING) << "hprof: waitpid for heap dump process " << pid << " failed";
+    return;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    ScopedObjectAccess soa(self);
+    ThrowRuntimeException("Couldn't dump heap; heap dump process %d failed with status 0x%x",
+                          pid, status);
+  }
+}
+
 // If "direct_to_ddms" is true, the other arguments are ignored, and data is
 // sent directly to DDMS.
 // If "fd" is >= 0, the output will be written to that file descriptor.
@@ -1078,6 +1363,10 @@ void Hprof::VisitRoot(const mirror::Object* obj) {
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
   CHECK(filename != NULL);
 
+  if (!direct_to_ddms && Runtime::Current()->UseForkedHeapDump()) {
+    DumpHeapInChild(filename, fd);
+    return;
+  }
   Runtime::Current()->GetThreadList()->SuspendAll();
   Hprof hprof(filename, fd, direct_to_ddms);
   hprof.Dump();
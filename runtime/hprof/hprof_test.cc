@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hprof/hprof.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common_test.h"
+#include "mirror/class-inl.h"
+#include "os.h"
+
+namespace art {
+
+namespace hprof {
+
+class HprofTest : public CommonTest {
+ protected:
+  // Size of the fixed header: the magic string, the identifier size and the time stamp.
+  static const size_t kHeaderSize = sizeof("JAVA PROFILE 1.0.3") + 3 * sizeof(uint32_t);
+
+  static const uint8_t kTagString = 0x01;
+  static const uint8_t kTagLoadClass = 0x02;
+  static const uint8_t kTagHeapDumpSegment = 0x1c;
+  static const uint8_t kTagHeapDumpEnd = 0x2c;
+
+  // Dumps the heap to filename, with the calling thread in the native state.
+  void DumpHeapToFile(const std::string& filename) {
+    DumpHeap(filename.c_str(), -1, false);
+    ScopedObjectAccess soa(Thread::Current());
+    EXPECT_FALSE(soa.Self()->IsExceptionPending());
+  }
+
+  static bool ReadFile(const std::string& filename, std::vector<uint8_t>* data) {
+    UniquePtr<File> file(OS::OpenFileForReading(filename.c_str()));
+    if (file.get() == NULL) {
+      return false;
+    }
+    data->resize(file->GetLength());
+    return data->empty() || file->ReadFully(&(*data)[0], data->size());
+  }
+
+  static bool ReadGzipFile(const std::string& filename, std::vector<uint8_t>* data) {
+    gzFile file = gzopen(filename.c_str(), "rb");
+    if (file == NULL) {
+      return false;
+    }
+    uint8_t buffer[4096];
+    int length;
+    while ((length = gzread(file, buffer, sizeof(buffer))) > 0) {
+      data->insert(data->end(), buffer, buffer + length);
+    }
+    return gzclose(file) == Z_OK && length == 0;
+  }
+
+  static uint32_t ReadU4(const uint8_t* data) {
+    return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+  }
+
+  // Checks that dump is a complete hprof file whose string and class tables precede the heap
+  // dump records that refer to them. Returns the number of heap dump segments.
+  static size_t CheckDump(const std::vector<uint8_t>& dump) {
+    EXPECT_LT(kHeaderSize, dump.size());
+    if (dump.size() <= kHeaderSize) {
+      return 0;
+    }
+    EXPECT_STREQ("JAVA PROFILE 1.0.3", reinterpret_cast<const char*>(&dump[0]));
+    EXPECT_EQ(sizeof(void*), ReadU4(&dump[kHeaderSize - 3 * sizeof(uint32_t)]));
+    std::set<uint32_t> string_ids;
+    size_t num_classes = 0;
+    size_t num_segments = 0;
+    bool in_records = false;
+    uint8_t last_tag = 0;
+    size_t offset = kHeaderSize;
+    while (offset < dump.size()) {
+      // U1 tag, U4 time, U4 length and the body.
+      EXPECT_LE(offset + 9, dump.size());
+      if (offset + 9 > dump.size()) {
+        return 0;
+      }
+      uint8_t tag = dump[offset];
+      uint32_t length = ReadU4(&dump[offset + 5]);
+      const uint8_t* body = &dump[offset + 9];
+      offset += 9 + length;
+      EXPECT_LE(offset, dump.size());
+      if (offset > dump.size()) {
+        return 0;
+      }
+      switch (tag) {
+        case kTagString:
+          EXPECT_FALSE(in_records) << "string after heap dump records";
+          string_ids.insert(ReadU4(body));
+          break;
+        case kTagLoadClass:
+          // U4 serial number, ID class, U4 stack trace serial number, ID name.
+          EXPECT_FALSE(in_records) << "class after heap dump records";
+          EXPECT_EQ(1U, string_ids.count(ReadU4(body + 12))) << "class name not in string table";
+          ++num_classes;
+          break;
+        case kTagHeapDumpSegment:
+          in_records = true;
+          ++num_segments;
+          break;
+        default:
+          break;
+      }
+      last_tag = tag;
+    }
+    EXPECT_LT(0U, string_ids.size());
+    EXPECT_LT(0U, num_classes);
+    EXPECT_EQ(kTagHeapDumpEnd, last_tag) << "dump is truncated";
+    return num_segments;
+  }
+};
+
+TEST_F(HprofTest, DumpToFile) {
+  std::string filename(android_data_ + "/heap.hprof");
+  std::string gz_filename(android_data_ + "/heap.hprof.gz");
+  DumpHeapToFile(filename);
+  DumpHeapToFile(gz_filename);
+
+  std::vector<uint8_t> dump;
+  ASSERT_TRUE(ReadFile(filename, &dump));
+  EXPECT_LT(0U, CheckDump(dump));
+
+  // The gzip file is compressed, and holds the same dump once decompressed. The heap did not
+  // change in between, so only the time stamps in the header may differ.
+  std::vector<uint8_t> gz_data;
+  ASSERT_TRUE(ReadFile(gz_filename, &gz_data));
+  EXPECT_LT(gz_data.size(), dump.size());
+  std::vector<uint8_t> gz_dump;
+  ASSERT_TRUE(ReadGzipFile(gz_filename, &gz_dump));
+  EXPECT_EQ(CheckDump(dump), CheckDump(gz_dump));
+  ASSERT_EQ(dump.size(), gz_dump.size());
+  EXPECT_TRUE(std::equal(dump.begin() + kHeaderSize, dump.end(), gz_dump.begin() + kHeaderSize));
+
+  EXPECT_EQ(0, unlink(filename.c_str()));
+  EXPECT_EQ(0, unlink(gz_filename.c_str()));
+}
+
+TEST_F(HprofTest, ForkedDumpToFile) {
+  std::string filename(android_data_ + "/forked.hprof");
+  Runtime::Current()->SetForkedHeapDump(true);
+  DumpHeapToFile(filename);
+  Runtime::Current()->SetForkedHeapDump(false);
+
+  // The parent waits for the child, so the dump is complete once DumpHeap returns.
+  std::vector<uint8_t> dump;
+  ASSERT_TRUE(ReadFile(filename, &dump));
+  EXPECT_LT(0U, CheckDump(dump));
+  EXPECT_EQ(0, unlink(filename.c_str()));
+
+  // The parent resumed the world, and can run managed code again.
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, *Locks::thread_suspend_count_lock_);
+    EXPECT_EQ(0, self->GetSuspendCount());
+  }
+  EXPECT_EQ(kNative, self->GetState());
+  ScopedObjectAccess soa(self);
+  mirror::Class* klass = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(klass != NULL);
+  EXPECT_TRUE(klass->AllocObject(soa.Self()) != NULL);
+  EXPECT_FALSE(soa.Self()->IsExceptionPending());
+}
+
+}  // namespace hprof
+
+}  // namespace art
@@ -39,7 +39,8 @@ class PACKED(4) ImageHeader {
               uint32_t oat_file_begin,
               uint32_t oat_data_begin,
               uint32_t oat_data_end,
-              uint32_t oat_file_end);
+              uint32_t oat_file_end,
+              uint32_t dependency_checksum);
 
   bool IsValid() const;
   const char* GetMagic() const;
@@ -68,6 +69,28 @@ class PACKED(4) ImageHeader {
     oat_checksum_ = oat_checksum;
   }
 
+  // App images hold the classes of an app oat file, which is not mapped at a fixed address, so
+  // their oat addresses are all 0. Their dependency checksum is the chain checksum of the boot
+  // image they were written against.
+  bool IsAppImage() const {
+    return oat_file_begin_ == 0;
+  }
+
+  // Chain checksum of the image this one was laid out after, 0 for the first (or only) image.
+  uint32_t GetDependencyChecksum() const {
+    return dependency_checksum_;
+  }
+
+  void SetDependencyChecksum(uint32_t dependency_checksum) {
+    dependency_checksum_ = dependency_checksum;
+  }
+
+  // Checksum covering the oat file of this image and of every image it depends on. For a single
+  // image this is just the oat checksum.
+  uint32_t GetChainChecksum() const {
+    return dependency_checksum_ * 31 + oat_checksum_;
+  }
+
   byte* GetOatFileBegin() const {
     return reinterpret_cast<byte*>(oat_file_begin_);
   }
@@ -97,7 +120,7 @@ class PACKED(4) ImageHeader {
     kRefsAndArgsSaveMethod,
     kOatLocation,
     kDexCaches,
-    kClassRoots,
+    kClassRoots,  // For an app image, the classes it defines.
     kImageRootsMax,
   };
 
@@ -144,6 +167,9 @@ class PACKED(4) ImageHeader {
   // Absolute address of an Object[] of objects needed to reinitialize from an image.
   uint32_t image_roots_;
 
+  // Chain checksum of the preceding image of a multi-image boot image, checked when loading.
+  uint32_t dependency_checksum_;
+
   friend class ImageWriter;
   friend class ImageDumper;  // For GetImageRoots()
 };
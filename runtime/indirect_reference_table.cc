@@ -22,6 +22,7 @@
 #include "thread.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 namespace art {
@@ -35,35 +36,98 @@ static void AbortMaybe() {
 }
 
 IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
-                                               size_t maxCount, IndirectRefKind desiredKind) {
+                                               size_t maxCount, IndirectRefKind desiredKind,
+                                               size_t softCount) {
   CHECK_GT(initialCount, 0U);
   CHECK_LE(initialCount, maxCount);
+  CHECK_LE(maxCount, kIRTMaxEntries);
   CHECK_NE(desiredKind, kSirtOrInvalid);
 
-  table_ = reinterpret_cast<mirror::Object**>(malloc(initialCount * sizeof(const mirror::Object*)));
-  CHECK(table_ != NULL);
-  memset(table_, 0xd1, initialCount * sizeof(const mirror::Object*));
-
-  slot_data_ = reinterpret_cast<IndirectRefSlot*>(calloc(initialCount, sizeof(IndirectRefSlot)));
-  CHECK(slot_data_ != NULL);
+  size_t maxChunks = RoundUp(maxCount, kIRTChunkSize) >> kIRTChunkShift;
+  chunks_ = reinterpret_cast<IrtChunk**>(calloc(maxChunks, sizeof(IrtChunk*)));
+  CHECK(chunks_ != NULL);
 
   segment_state_.all = IRT_FIRST_SEGMENT;
-  alloc_entries_ = initialCount;
+  alloc_entries_ = 0;
   max_entries_ = maxCount;
   kind_ = desiredKind;
+  first_hole_ = kIRTNoHole;
+  soft_limit_ = (softCount != 0 && softCount < maxCount) ? softCount : 0;
+  while (alloc_entries_ < initialCount) {
+    CHECK(Grow());
+  }
 }
 
 IndirectReferenceTable::~IndirectReferenceTable() {
-  free(table_);
-  free(slot_data_);
-  table_ = NULL;
-  slot_data_ = NULL;
+  for (size_t i = 0; i < alloc_entries_; i += kIRTChunkSize) {
+    free(chunks_[i >> kIRTChunkShift]);
+  }
+  free(chunks_);
+  chunks_ = NULL;
   alloc_entries_ = max_entries_ = -1;
 }
 
+bool IndirectReferenceTable::Grow() {
+  if (alloc_entries_ == max_entries_) {
+    return false;
+  }
+  IrtChunk* chunk = reinterpret_cast<IrtChunk*>(calloc(1, sizeof(IrtChunk)));
+  if (chunk == NULL) {
+    return false;
+  }
+  memset(chunk->references, 0xd1, sizeof(chunk->references));
+  chunks_[alloc_entries_ >> kIRTChunkShift] = chunk;
+  alloc_entries_ = std::min(alloc_entries_ + kIRTChunkSize, max_entries_);
+  return true;
+}
+
+void IndirectReferenceTable::PushHole(uint32_t tableIndex) {
+  IndirectRefSlot& slot = SlotAt(tableIndex);
+  slot.next_hole = first_hole_;
+  slot.prev_hole = kIRTNoHole;
+  if (first_hole_ != kIRTNoHole) {
+    SlotAt(first_hole_).prev_hole = tableIndex;
+  }
+  first_hole_ = tableIndex;
+}
+
+void IndirectReferenceTable::UnlinkHole(uint32_t tableIndex) {
+  IndirectRefSlot& slot = SlotAt(tableIndex);
+  if (slot.prev_hole != kIRTNoHole) {
+    SlotAt(slot.prev_hole).next_hole = slot.next_hole;
+  } else {
+    DCHECK_EQ(first_hole_, tableIndex);
+    first_hole_ = slot.next_hole;
+  }
+  if (slot.next_hole != kIRTNoHole) {
+    SlotAt(slot.next_hole).prev_hole = slot.prev_hole;
+  }
+}
+
+// Popping a segment just resets the segment state, leaving the holes that
+// were above the new top index on the list.  They were created after any
+// hole that is still in the table, so they are all at the front.
+void IndirectReferenceTable::DropStaleHoles() {
+  uint32_t topIndex = segment_state_.parts.topIndex;
+  while (first_hole_ != kIRTNoHole && first_hole_ >= topIndex) {
+    first_hole_ = SlotAt(first_hole_).next_hole;
+  }
+  if (first_hole_ != kIRTNoHole) {
+    SlotAt(first_hole_).prev_hole = kIRTNoHole;
+  }
+}
+
+void IndirectReferenceTable::WarnSoftLimit() {
+  LOG(WARNING) << "JNI WARNING: " << kind_ << " table has " << Capacity() << " entries "
+               << "(soft limit=" << soft_limit_ << ", max=" << max_entries_ << ")\n"
+               << MutatorLockedDumpable<IndirectReferenceTable>(*this);
+  // Warn again only once the table has doubled.
+  soft_limit_ = (soft_limit_ * 2 < max_entries_) ? soft_limit_ * 2 : 0;
+}
+
 // Make sure that the entry at "idx" is correctly paired with "iref".
 bool IndirectReferenceTable::CheckEntry(const char* what, IndirectRef iref, int idx) const {
-  const mirror::Object* obj = table_[idx];
+  const mirror::Object* obj = EntryAt(idx);
   IndirectRef checkRef = ToIndirectRef(obj, idx);
   if (UNLIKELY(checkRef != iref)) {
     LOG(ERROR) << "JNI ERROR (app bug): attempt to " << what
@@ -83,64 +147,41 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, mirror::Object* obj) {
   CHECK(obj != NULL);
   // TODO: stronger sanity check on the object (such as in heap)
   DCHECK_ALIGNED(reinterpret_cast<uintptr_t>(obj), 8);
-  DCHECK(table_ != NULL);
+  DCHECK(chunks_ != NULL);
   DCHECK_LE(alloc_entries_, max_entries_);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
-  if (topIndex == alloc_entries_) {
-    // reached end of allocated space; did we hit buffer max?
-    if (topIndex == max_entries_) {
-      LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
-                 << "(max=" << max_entries_ << ")\n"
-                 << MutatorLockedDumpable<IndirectReferenceTable>(*this);
-    }
-
-    size_t newSize = alloc_entries_ * 2;
-    if (newSize > max_entries_) {
-      newSize = max_entries_;
-    }
-    DCHECK_GT(newSize, alloc_entries_);
-
-    table_ = reinterpret_cast<mirror::Object**>(realloc(table_, newSize * sizeof(mirror::Object*)));
-    slot_data_ = reinterpret_cast<IndirectRefSlot*>(realloc(slot_data_,
-                                                            newSize * sizeof(IndirectRefSlot)));
-    if (table_ == NULL || slot_data_ == NULL) {
-      LOG(FATAL) << "JNI ERROR (app bug): unable to expand "
-                 << kind_ << " table (from "
-                 << alloc_entries_ << " to " << newSize
-                 << ", max=" << max_entries_ << ")\n"
-                 << MutatorLockedDumpable<IndirectReferenceTable>(*this);
-    }
+  DropStaleHoles();
 
-    // Clear the newly-allocated slot_data_ elements.
-    memset(slot_data_ + alloc_entries_, 0, (newSize - alloc_entries_) * sizeof(IndirectRefSlot));
-
-    alloc_entries_ = newSize;
-  }
-
-  // We know there's enough room in the table.  Now we just need to find
-  // the right spot.  If there's a hole, find it and fill it; otherwise,
-  // add to the end of the list.
+  // If there's a hole in the current segment, fill the most recent one;
+  // otherwise, add to the end of the list.
   IndirectRef result;
   int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
   if (numHoles > 0) {
-    DCHECK_GT(topIndex, 1U);
-    // Find the first hole; likely to be near the end of the list.
-    mirror::Object** pScan = &table_[topIndex - 1];
-    DCHECK(*pScan != NULL);
-    while (*--pScan != NULL) {
-      DCHECK_GE(pScan, table_ + prevState.parts.topIndex);
-    }
-    UpdateSlotAdd(obj, pScan - table_);
-    result = ToIndirectRef(obj, pScan - table_);
-    *pScan = obj;
+    uint32_t holeIndex = first_hole_;
+    DCHECK_NE(holeIndex, kIRTNoHole);
+    DCHECK_GE(holeIndex, prevState.parts.topIndex);
+    DCHECK_LT(holeIndex, topIndex);
+    DCHECK(EntryAt(holeIndex) == NULL);
+    UnlinkHole(holeIndex);
+    UpdateSlotAdd(obj, holeIndex);
+    result = ToIndirectRef(obj, holeIndex);
+    EntryAt(holeIndex) = obj;
     segment_state_.parts.numHoles--;
   } else {
+    if (topIndex == alloc_entries_ && !Grow()) {
+      LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
+                 << "(max=" << max_entries_ << ")\n"
+                 << MutatorLockedDumpable<IndirectReferenceTable>(*this);
+    }
     // Add to the end.
     UpdateSlotAdd(obj, topIndex);
     result = ToIndirectRef(obj, topIndex);
-    table_[topIndex++] = obj;
+    EntryAt(topIndex++) = obj;
     segment_state_.parts.topIndex = topIndex;
+    if (UNLIKELY(soft_limit_ != 0 && topIndex >= soft_limit_)) {
+      WarnSoftLimit();
+    }
   }
   if (false) {
     LOG(INFO) << "+++ added at " << ExtractIndex(result) << " top=" << segment_state_.parts.topIndex
@@ -181,7 +222,7 @@ bool IndirectReferenceTable::GetChecked(IndirectRef iref) const {
     return false;
   }
 
-  if (UNLIKELY(table_[idx] == NULL)) {
+  if (UNLIKELY(EntryAt(idx) == NULL)) {
     LOG(ERROR) << "JNI ERROR (app bug): accessed deleted " << kind_ << " " << iref;
     AbortMaybe();
     return false;
@@ -195,9 +236,9 @@ bool IndirectReferenceTable::GetChecked(IndirectRef iref) const {
 }
 
 static int Find(mirror::Object* direct_pointer, int bottomIndex, int topIndex,
-                mirror::Object** table) {
+                IrtChunk* const* chunks) {
   for (int i = bottomIndex; i < topIndex; ++i) {
-    if (table[i] == direct_pointer) {
+    if (chunks[i >> kIRTChunkShift]->references[i & kIRTChunkMask] == direct_pointer) {
       return i;
     }
   }
@@ -205,7 +246,7 @@ static int Find(mirror::Object* direct_pointer, int bottomIndex, int topIndex,
 }
 
 bool IndirectReferenceTable::ContainsDirectPointer(mirror::Object* direct_pointer) const {
-  return Find(direct_pointer, 0, segment_state_.parts.topIndex, table_) != -1;
+  return Find(direct_pointer, 0, segment_state_.parts.topIndex, chunks_) != -1;
 }
 
 // Removes an object. We extract the table offset bits from "iref"
@@ -222,10 +263,12 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
   int topIndex = segment_state_.parts.topIndex;
   int bottomIndex = prevState.parts.topIndex;
 
-  DCHECK(table_ != NULL);
+  DCHECK(chunks_ != NULL);
   DCHECK_LE(alloc_entries_, max_entries_);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
+  DropStaleHoles();
+
   int idx = ExtractIndex(iref);
 
   JavaVMExt* vm = Runtime::Current()->GetJavaVM();
@@ -236,7 +279,7 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
   }
   if (GetIndirectRefKind(iref) == kSirtOrInvalid && vm->work_around_app_jni_bugs) {
     mirror::Object* direct_pointer = reinterpret_cast<mirror::Object*>(iref);
-    idx = Find(direct_pointer, bottomIndex, topIndex, table_);
+    idx = Find(direct_pointer, bottomIndex, topIndex, chunks_);
     if (idx == -1) {
       LOG(WARNING) << "Trying to work around app JNI bugs, but didn't find " << iref << " in table!";
       return false;
@@ -263,20 +306,21 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
       return false;
     }
 
-    table_[idx] = NULL;
+    EntryAt(idx) = NULL;
     int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
     if (numHoles != 0) {
       while (--topIndex > bottomIndex && numHoles != 0) {
         if (false) {
           LOG(INFO) << "+++ checking for hole at " << topIndex-1
-                    << " (cookie=" << cookie << ") val=" << table_[topIndex - 1];
+                    << " (cookie=" << cookie << ") val=" << EntryAt(topIndex - 1);
         }
-        if (table_[topIndex-1] != NULL) {
+        if (EntryAt(topIndex - 1) != NULL) {
           break;
         }
         if (false) {
           LOG(INFO) << "+++ ate hole at " << (topIndex - 1);
         }
+        UnlinkHole(topIndex - 1);
         numHoles--;
       }
       segment_state_.parts.numHoles = numHoles + prevState.parts.numHoles;
@@ -291,7 +335,7 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
     // Not the top-most entry.  This creates a hole.  We NULL out the
     // entry to prevent somebody from deleting it twice and screwing up
     // the hole count.
-    if (table_[idx] == NULL) {
+    if (EntryAt(idx) == NULL) {
       LOG(INFO) << "--- WEIRD: removing null entry " << idx;
       return false;
     }
@@ -299,7 +343,8 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
       return false;
     }
 
-    table_[idx] = NULL;
+    EntryAt(idx) = NULL;
+    PushHole(idx);
     segment_state_.parts.numHoles++;
     if (false) {
       LOG(INFO) << "+++ left hole at " << idx << ", holes=" << segment_state_.parts.numHoles;
@@ -318,11 +363,12 @@ void IndirectReferenceTable::VisitRoots(RootVisitor* visitor, void* arg) {
 
 void IndirectReferenceTable::Dump(std::ostream& os) const {
   os << kind_ << " table dump:\n";
-  ReferenceTable::Table entries(table_, table_ + Capacity());
-  // Remove NULLs.
-  for (int i = entries.size() - 1; i >= 0; --i) {
-    if (entries[i] == NULL) {
-      entries.erase(entries.begin() + i);
+  ReferenceTable::Table entries;
+  // Skip NULLs.
+  for (size_t i = 0; i < Capacity(); ++i) {
+    mirror::Object* entry = EntryAt(i);
+    if (entry != NULL) {
+      entries.push_back(entry);
     }
   }
   ReferenceTable::Dump(os, entries);
@@ -125,12 +125,33 @@ static inline IndirectRefKind GetIndirectRefKind(IndirectRef iref) {
 
 /*
  * Extended debugging structure.  We keep a parallel array of these, one
- * per slot in the table.
+ * per slot in the table.  Slots that are holes also link into the
+ * table's doubly-linked list of holes.
  */
 static const size_t kIRTPrevCount = 4;
 struct IndirectRefSlot {
   uint32_t serial;
   const mirror::Object* previous[kIRTPrevCount];
+  uint32_t next_hole;
+  uint32_t prev_hole;
+};
+
+/* terminates the list of holes */
+static const uint32_t kIRTNoHole = 0xffffffff;
+
+/* the table index is 16 bits wide, see IndirectRef */
+static const size_t kIRTMaxEntries = 65536;
+
+/*
+ * The table is stored in fixed-size chunks so that it can grow without
+ * copying, and so that pointers to entries stay valid.
+ */
+static const size_t kIRTChunkShift = 6;
+static const size_t kIRTChunkSize = 1 << kIRTChunkShift;
+static const size_t kIRTChunkMask = kIRTChunkSize - 1;
+struct IrtChunk {
+  mirror::Object* references[kIRTChunkSize];
+  IndirectRefSlot slot_data[kIRTChunkSize];
 };
 
 /* use as initial value for "cookie", and when table has only one segment */
@@ -145,13 +166,16 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  * operations are adding a new entry and removing an entire table segment.
  *
  * If "alloc_entries_" is not equal to "max_entries_", the table may expand
- * when entries are added, which means the memory may move.  If you want
- * to keep pointers into "table" rather than offsets, you must use a
- * fixed-size table.
+ * when entries are added.  Expansion allocates another chunk and never
+ * moves existing entries.
  *
  * If we delete entries from the middle of the list, we will be left with
  * "holes".  We track the number of holes so that, when adding new elements,
- * we can quickly decide to do a trivial append or go slot-hunting.
+ * we can quickly decide to do a trivial append or fill a hole.  Holes are
+ * kept on a list, most recently created first, so filling one is O(1).
+ * Since entries can only be removed from the current segment, the holes
+ * of the current segment are always at the front of that list; holes of
+ * segments that have been popped are dropped from the front lazily.
  *
  * When the top-most entry is removed, any holes immediately below it are
  * also removed.  Thus, deletion of an entry may reduce "topIndex" by more
@@ -181,20 +205,19 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  * stale references aren't possible (though we may be able to get similar
  * benefits with other approaches).
  *
- * TODO: consider a "lastDeleteIndex" for quick hole-filling when an
- * add immediately follows a delete; must invalidate after segment pop
- * (which could increase the cost/complexity of method call/return).
- * Might be worth only using it for JNI globals.
+ * Reaching "max_entries_" is fatal.  A table may also have a soft limit;
+ * crossing it logs a summary of the table's contents, so that leaks can
+ * be diagnosed before the hard limit is hit.  The next warning is issued
+ * when the table doubles again.
  *
  * TODO: may want completely different add/remove algorithms for global
  * and local refs to improve performance.  A large circular buffer might
  * reduce the amortized cost of adding global references.
  *
- * TODO: if we can guarantee that the underlying storage doesn't move,
- * e.g. by using oversized mmap regions to handle expanding tables, we may
- * be able to avoid having to synchronize lookups.  Might make sense to
- * add a "synchronized lookup" call that takes the mutex as an argument,
- * and either locks or doesn't lock based on internal details.
+ * TODO: now that the underlying storage doesn't move, we may be able to
+ * avoid having to synchronize lookups.  Might make sense to add a
+ * "synchronized lookup" call that takes the mutex as an argument, and
+ * either locks or doesn't lock based on internal details.
  */
 union IRTSegmentState {
   uint32_t          all;
@@ -206,8 +229,8 @@ union IRTSegmentState {
 
 class IrtIterator {
  public:
-  explicit IrtIterator(mirror::Object** table, size_t i, size_t capacity)
-      : table_(table), i_(i), capacity_(capacity) {
+  explicit IrtIterator(IrtChunk* const* chunks, size_t i, size_t capacity)
+      : chunks_(chunks), i_(i), capacity_(capacity) {
     SkipNullsAndTombstones();
   }
 
@@ -218,22 +241,26 @@ class IrtIterator {
   }
 
   mirror::Object** operator*() {
-    return &table_[i_];
+    return &chunks_[i_ >> kIRTChunkShift]->references[i_ & kIRTChunkMask];
   }
 
   bool equals(const IrtIterator& rhs) const {
-    return (i_ == rhs.i_ && table_ == rhs.table_);
+    return (i_ == rhs.i_ && chunks_ == rhs.chunks_);
   }
 
  private:
   void SkipNullsAndTombstones() {
     // We skip NULLs and tombstones. Clients don't want to see implementation details.
-    while (i_ < capacity_ && (table_[i_] == NULL || table_[i_] == kClearedJniWeakGlobal)) {
+    while (i_ < capacity_) {
+      mirror::Object* entry = chunks_[i_ >> kIRTChunkShift]->references[i_ & kIRTChunkMask];
+      if (entry != NULL && entry != kClearedJniWeakGlobal) {
+        break;
+      }
       ++i_;
     }
   }
 
-  mirror::Object** table_;
+  IrtChunk* const* chunks_;
   size_t i_;
   size_t capacity_;
 };
@@ -248,15 +275,17 @@ bool inline operator!=(const IrtIterator& lhs, const IrtIterator& rhs) {
 
 class IndirectReferenceTable {
  public:
-  IndirectReferenceTable(size_t initialCount, size_t maxCount, IndirectRefKind kind);
+  // A "softCount" of zero means the table has no soft limit.
+  IndirectReferenceTable(size_t initialCount, size_t maxCount, IndirectRefKind kind,
+                         size_t softCount = 0);
 
   ~IndirectReferenceTable();
 
   /*
    * Add a new entry.  "obj" must be a valid non-NULL object reference.
    *
-   * Returns NULL if the table is full (max entries reached, or alloc
-   * failed during expansion).
+   * Aborts if the table is full (max entries reached, or alloc failed
+   * during expansion).
    */
   IndirectRef Add(uint32_t cookie, mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -270,7 +299,7 @@ class IndirectReferenceTable {
     if (!GetChecked(iref)) {
       return kInvalidIndirectRefObject;
     }
-    return table_[ExtractIndex(iref)];
+    return EntryAt(ExtractIndex(iref));
   }
 
   // TODO: remove when we remove work_around_app_jni_bugs support.
@@ -300,11 +329,11 @@ class IndirectReferenceTable {
   }
 
   IrtIterator begin() {
-    return IrtIterator(table_, 0, Capacity());
+    return IrtIterator(chunks_, 0, Capacity());
   }
 
   IrtIterator end() {
-    return IrtIterator(table_, Capacity(), Capacity());
+    return IrtIterator(chunks_, Capacity(), Capacity());
   }
 
   void VisitRoots(RootVisitor* visitor, void* arg);
@@ -335,8 +364,8 @@ class IndirectReferenceTable {
    * implementations, so we shouldn't really be using it here.
    */
   IndirectRef ToIndirectRef(const mirror::Object* /*o*/, uint32_t tableIndex) const {
-    DCHECK_LT(tableIndex, 65536U);
-    uint32_t serialChunk = slot_data_[tableIndex].serial;
+    DCHECK_LT(tableIndex, kIRTMaxEntries);
+    uint32_t serialChunk = SlotAt(tableIndex).serial;
     uint32_t uref = serialChunk << 20 | (tableIndex << 2) | kind_;
     return (IndirectRef) uref;
   }
@@ -348,13 +377,34 @@ class IndirectReferenceTable {
    * this slot.
    */
   void UpdateSlotAdd(const mirror::Object* obj, int slot) {
-    if (slot_data_ != NULL) {
-      IndirectRefSlot* pSlot = &slot_data_[slot];
-      pSlot->serial++;
-      pSlot->previous[pSlot->serial % kIRTPrevCount] = obj;
-    }
+    IndirectRefSlot* pSlot = &SlotAt(slot);
+    pSlot->serial++;
+    pSlot->previous[pSlot->serial % kIRTPrevCount] = obj;
   }
 
+  /*
+   * Access the entry and the debugging info for a table index.  Storage
+   * for the index must have been allocated.
+   */
+  mirror::Object*& EntryAt(size_t tableIndex) const {
+    DCHECK_LT(tableIndex, alloc_entries_);
+    return chunks_[tableIndex >> kIRTChunkShift]->references[tableIndex & kIRTChunkMask];
+  }
+  IndirectRefSlot& SlotAt(size_t tableIndex) const {
+    DCHECK_LT(tableIndex, alloc_entries_);
+    return chunks_[tableIndex >> kIRTChunkShift]->slot_data[tableIndex & kIRTChunkMask];
+  }
+
+  /* maintain the list of holes */
+  void PushHole(uint32_t tableIndex);
+  void UnlinkHole(uint32_t tableIndex);
+  void DropStaleHoles();
+
+  /* allocate another chunk; returns false if the table can't grow */
+  bool Grow();
+
+  void WarnSoftLimit() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   /* extra debugging checks */
   bool GetChecked(IndirectRef) const;
   bool CheckEntry(const char*, IndirectRef, int) const;
@@ -362,16 +412,18 @@ class IndirectReferenceTable {
   /* semi-public - read/write by jni down calls */
   IRTSegmentState segment_state_;
 
-  /* bottom of the stack */
-  mirror::Object** table_;
+  /* chunk directory, sized for max_entries_ up front */
+  IrtChunk** chunks_;
   /* bit mask, ORed into all irefs */
   IndirectRefKind kind_;
-  /* extended debugging info */
-  IndirectRefSlot* slot_data_;
+  /* most recently created hole, or kIRTNoHole */
+  uint32_t first_hole_;
   /* #of entries we have space for */
   size_t alloc_entries_;
   /* max #of entries allowed */
   size_t max_entries_;
+  /* #of entries at which to warn next, or 0 */
+  size_t soft_limit_;
 };
 
 }  // namespace art
@@ -250,4 +250,79 @@ TEST_F(IndirectReferenceTableTest, BasicTest) {
   CheckDump(&irt, 0, 0);
 }
 
+TEST_F(IndirectReferenceTableTest, HolesAndSegments) {
+  ScopedObjectAccess soa(Thread::Current());
+  // Span several chunks so that growth and hole filling cross chunk boundaries.
+  static const size_t kTableInitial = 10;
+  static const size_t kTableMax = 4 * kIRTChunkSize;
+  static const size_t kNumRefs = 3 * kIRTChunkSize;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kGlobal);
+
+  mirror::Class* c = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(c != NULL);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != NULL);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != NULL);
+
+  const uint32_t cookie = IRT_FIRST_SEGMENT;
+  IndirectRef refs[kNumRefs];
+  for (size_t i = 0; i < kNumRefs; i++) {
+    refs[i] = irt.Add(cookie, obj0);
+    ASSERT_TRUE(refs[i] != NULL) << "Failed adding " << i;
+  }
+  ASSERT_EQ(kNumRefs, irt.Capacity());
+  CheckDump(&irt, kNumRefs, 1);
+
+  // Remove every other entry, out of order, then refill: all holes must be reused.
+  for (size_t i = 0; i < kNumRefs - 1; i += 2) {
+    ASSERT_TRUE(irt.Remove(cookie, refs[i])) << "failed removing " << i;
+  }
+  CheckDump(&irt, kNumRefs / 2, 1);
+  for (size_t i = 0; i < kNumRefs - 1; i += 2) {
+    refs[i] = irt.Add(cookie, obj1);
+    ASSERT_TRUE(refs[i] != NULL) << "Failed refilling " << i;
+  }
+  ASSERT_EQ(kNumRefs, irt.Capacity()) << "holes not filled";
+  CheckDump(&irt, kNumRefs, 2);
+  for (size_t i = 0; i < kNumRefs; i++) {
+    EXPECT_EQ((i % 2 == 0) ? obj1 : obj0, irt.Get(refs[i])) << i;
+  }
+
+  // Leave a hole in the first segment, then push a second segment.
+  ASSERT_TRUE(irt.Remove(cookie, refs[1]));
+  uint32_t segment_cookie = irt.GetSegmentState();
+
+  // Holes below the segment are not reused, and holes of a popped segment are forgotten.
+  IndirectRef segment_ref0 = irt.Add(segment_cookie, obj0);
+  ASSERT_TRUE(segment_ref0 != NULL);
+  EXPECT_EQ(kNumRefs + 1, irt.Capacity());
+  IndirectRef segment_ref1 = irt.Add(segment_cookie, obj0);
+  ASSERT_TRUE(segment_ref1 != NULL);
+  ASSERT_FALSE(irt.Remove(segment_cookie, refs[2])) << "removed from the wrong segment";
+  ASSERT_TRUE(irt.Remove(segment_cookie, segment_ref0));
+  EXPECT_EQ(kNumRefs + 2, irt.Capacity());
+  irt.SetSegmentState(segment_cookie);
+  EXPECT_EQ(kNumRefs, irt.Capacity());
+
+  refs[1] = irt.Add(cookie, obj0);
+  ASSERT_TRUE(refs[1] != NULL);
+  EXPECT_EQ(kNumRefs, irt.Capacity()) << "first segment hole not filled";
+  IndirectRef iref = irt.Add(cookie, obj0);
+  ASSERT_TRUE(iref != NULL);
+  EXPECT_EQ(kNumRefs + 1, irt.Capacity());
+  EXPECT_EQ(obj0, irt.Get(iref));
+
+  // Removing the top entry consumes the holes below it.
+  ASSERT_TRUE(irt.Remove(cookie, refs[kNumRefs - 2]));
+  ASSERT_TRUE(irt.Remove(cookie, refs[kNumRefs - 1]));
+  ASSERT_TRUE(irt.Remove(cookie, iref));
+  EXPECT_EQ(kNumRefs - 2, irt.Capacity());
+  for (size_t i = 0; i < kNumRefs - 2; i++) {
+    ASSERT_TRUE(irt.Remove(cookie, refs[i])) << "failed removing " << i;
+  }
+  ASSERT_EQ(0U, irt.Capacity());
+  CheckDump(&irt, 0, 0);
+}
+
 }  // namespace art
@@ -88,7 +88,26 @@ static void InterpreterJni(Thread* self, ArtMethod* method, const StringPiece& s
   // TODO: The following enters JNI code using a typedef-ed function rather than the JNI compiler,
   //       it should be removed and JNI compiled stubs used instead.
   ScopedObjectAccessUnchecked soa(self);
-  if (method->IsStatic()) {
+  if (method->IsCriticalNative()) {
+    // Critical natives are static with primitive arguments only. They are passed neither a
+    // JNIEnv* nor a jclass and run without leaving the Runnable state.
+    if (shorty == "III") {
+      typedef jint (fntype)(jint, jint);
+      fntype* const fn = reinterpret_cast<fntype*>(const_cast<void*>(method->GetNativeMethod()));
+      result->SetI(fn(args[0], args[1]));
+    } else if (shorty == "JIJD") {
+      typedef jlong (fntype)(jint, jlong, jdouble);
+      fntype* const fn = reinterpret_cast<fntype*>(const_cast<void*>(method->GetNativeMethod()));
+      JValue arg1;
+      arg1.SetJ((static_cast<uint64_t>(args[2]) << 32) | args[1]);
+      JValue arg2;
+      arg2.SetJ((static_cast<uint64_t>(args[4]) << 32) | args[3]);
+      result->SetJ(fn(args[0], arg1.GetJ(), arg2.GetD()));
+    } else {
+      LOG(FATAL) << "Do something with critical native method: " << PrettyMethod(method)
+          << " shorty: " << shorty;
+    }
+  } else if (method->IsStatic()) {
     if (shorty == "L") {
       typedef jobject (fntype)(JNIEnv*, jclass);
       fntype* const fn = reinterpret_cast<fntype*>(const_cast<void*>(method->GetNativeMethod()));
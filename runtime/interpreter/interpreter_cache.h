@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "base/macros.h"
+
+namespace art {
+
+class Instruction;
+
+namespace mirror {
+class ArtField;
+class ArtMethod;
+class Class;
+}  // namespace mirror
+
+namespace interpreter {
+
+// Per-thread inline cache of the interpreter. It maps an invoke instruction and receiver class
+// to the method the invoke dispatches to, and a field instruction to the resolved field, so that
+// executing the same instruction again skips resolution, access checks and interface dispatch.
+//
+// Entries are direct mapped on the address of the instruction. The referring method is part of
+// the key since identical code items may be shared between methods of different classes. Only
+// successful lookups are cached. Methods and fields are never moved or unloaded, but classes may
+// be moved by a moving collection, which therefore clears the caches of all threads while they
+// are suspended (see Thread::ClearInterpreterCache).
+class InterpreterCache {
+ public:
+  InterpreterCache() {
+    Clear();
+  }
+
+  // Returns the cached target of the invoke at 'inst' for receivers of class 'receiver_class'
+  // (NULL for invokes that don't dispatch on the receiver), or NULL.
+  mirror::ArtMethod* GetMethod(const Instruction* inst, const mirror::ArtMethod* referrer,
+                               const mirror::Class* receiver_class) const {
+    const Entry& entry = entries_[IndexOf(inst)];
+    if (entry.inst == inst && entry.referrer == referrer && entry.klass == receiver_class) {
+      return reinterpret_cast<mirror::ArtMethod*>(entry.value);
+    }
+    return NULL;
+  }
+
+  void PutMethod(const Instruction* inst, const mirror::ArtMethod* referrer,
+                 const mirror::Class* receiver_class, mirror::ArtMethod* method) {
+    Put(inst, referrer, receiver_class, method);
+  }
+
+  // Returns the cached field accessed by the instruction at 'inst', or NULL.
+  mirror::ArtField* GetField(const Instruction* inst, const mirror::ArtMethod* referrer) const {
+    const Entry& entry = entries_[IndexOf(inst)];
+    if (entry.inst == inst && entry.referrer == referrer) {
+      return reinterpret_cast<mirror::ArtField*>(entry.value);
+    }
+    return NULL;
+  }
+
+  void PutField(const Instruction* inst, const mirror::ArtMethod* referrer,
+                mirror::ArtField* field) {
+    Put(inst, referrer, NULL, field);
+  }
+
+  void Clear() {
+    memset(entries_, 0, sizeof(entries_));
+  }
+
+ private:
+  // Must be a power of two.
+  static const size_t kNumEntries = 256;
+
+  struct Entry {
+    const Instruction* inst;
+    const mirror::ArtMethod* referrer;
+    const mirror::Class* klass;
+    void* value;
+  };
+
+  static size_t IndexOf(const Instruction* inst) {
+    // Instructions are at least one 16-bit code unit apart.
+    return (reinterpret_cast<uintptr_t>(inst) >> 1) & (kNumEntries - 1);
+  }
+
+  void Put(const Instruction* inst, const mirror::ArtMethod* referrer,
+           const mirror::Class* klass, void* value) {
+    Entry& entry = entries_[IndexOf(inst)];
+    entry.inst = inst;
+    entry.referrer = referrer;
+    entry.klass = klass;
+    entry.value = value;
+  }
+
+  Entry entries_[kNumEntries];
+
+  DISALLOW_COPY_AND_ASSIGN(InterpreterCache);
+};
+
+}  // namespace interpreter
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INTERPRETER_CACHE_H_
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter/interpreter_cache.h"
+
+#include "UniquePtr.h"
+#include "gtest/gtest.h"
+
+namespace art {
+namespace interpreter {
+
+// The cache never dereferences its keys or values, so arbitrary addresses stand in for them.
+template <typename T>
+static T* FakePointer(uintptr_t address) {
+  return reinterpret_cast<T*>(address);
+}
+
+TEST(InterpreterCache, Methods) {
+  UniquePtr<InterpreterCache> cache(new InterpreterCache);
+  const Instruction* inst = FakePointer<const Instruction>(0x1000);
+  mirror::ArtMethod* referrer = FakePointer<mirror::ArtMethod>(0x2000);
+  mirror::Class* klass = FakePointer<mirror::Class>(0x3000);
+  mirror::ArtMethod* target = FakePointer<mirror::ArtMethod>(0x4000);
+
+  EXPECT_TRUE(cache->GetMethod(inst, referrer, klass) == NULL);
+  cache->PutMethod(inst, referrer, klass, target);
+  EXPECT_EQ(target, cache->GetMethod(inst, referrer, klass));
+  // Every part of the key must match.
+  EXPECT_TRUE(cache->GetMethod(inst, referrer, FakePointer<mirror::Class>(0x3008)) == NULL);
+  EXPECT_TRUE(cache->GetMethod(inst, FakePointer<mirror::ArtMethod>(0x2008), klass) == NULL);
+  EXPECT_TRUE(cache->GetField(inst, referrer) == NULL);
+
+  cache->Clear();
+  EXPECT_TRUE(cache->GetMethod(inst, referrer, klass) == NULL);
+}
+
+TEST(InterpreterCache, Fields) {
+  UniquePtr<InterpreterCache> cache(new InterpreterCache);
+  const Instruction* inst = FakePointer<const Instruction>(0x1000);
+  mirror::ArtMethod* referrer = FakePointer<mirror::ArtMethod>(0x2000);
+  mirror::ArtField* field = FakePointer<mirror::ArtField>(0x5000);
+
+  cache->PutField(inst, referrer, field);
+  EXPECT_EQ(field, cache->GetField(inst, referrer));
+  EXPECT_TRUE(cache->GetField(FakePointer<const Instruction>(0x1002), referrer) == NULL);
+
+  // An instruction mapping to the same entry evicts the previous one.
+  const Instruction* aliasing_inst = FakePointer<const Instruction>(0x1000 + 2 * 256);
+  cache->PutField(aliasing_inst, referrer, field);
+  EXPECT_TRUE(cache->GetField(inst, referrer) == NULL);
+  EXPECT_EQ(field, cache->GetField(aliasing_inst, referrer));
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -29,6 +29,7 @@
 #include "dex_instruction.h"
 #include "entrypoints/entrypoint_utils.h"
 #include "gc/accounting/card_table-inl.h"
+#include "interpreter/interpreter_cache.h"
 #include "invoke_arg_array_builder.h"
 #include "nth_caller_visitor.h"
 #include "mirror/art_field-inl.h"
@@ -75,6 +76,21 @@ extern JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh,
                               const DexFile::CodeItem* code_item,
                               ShadowFrame& shadow_frame, JValue result_register);
 
+// Assembly fast path of the computed-goto interpreter (arch/<arch>/interpreter_mterp_<arch>.S).
+// It runs from the shadow frame's dex pc and stops at the first instruction it leaves to C++:
+// anything that may throw, call or allocate, and backward branches while the thread has a
+// suspend or checkpoint request. The dex pc of that instruction is stored in the shadow frame.
+// It does no instrumentation and no access checks.
+#if (defined(__arm__) || defined(__i386__)) && !defined(ART_USE_PORTABLE_COMPILER)
+static constexpr bool kUseMterp = true;
+extern "C" void art_mterp_execute(ShadowFrame* shadow_frame, const uint16_t* insns, Thread* self);
+#else
+static constexpr bool kUseMterp = false;
+static inline void art_mterp_execute(ShadowFrame*, const uint16_t*, Thread*) {
+  LOG(FATAL) << "No assembly interpreter on this architecture";
+}
+#endif
+
 static inline void DoMonitorEnter(Thread* self, Object* ref) NO_THREAD_SAFETY_ANALYSIS {
   ref->MonitorEnter(self);
 }
@@ -98,12 +114,26 @@ static inline bool DoInvoke(Thread* self, ShadowFrame& shadow_frame, const Instr
   const uint32_t method_idx = (is_range) ? inst->VRegB_3rc() : inst->VRegB_35c();
   const uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
   Object* receiver = (type == kStatic) ? nullptr : shadow_frame.GetVRegReference(vregC);
-  ArtMethod* const method = FindMethodFromCode<type, do_access_check>(method_idx, receiver,
-                                                                      shadow_frame.GetMethod(),
-                                                                      self);
-  if (type != kStatic) {
-    // Reload the vreg since the GC may have moved the object.
-    receiver = shadow_frame.GetVRegReference(vregC);
+  ArtMethod* const referrer = shadow_frame.GetMethod();
+  // A null receiver takes the slow path so that FindMethodFromCode throws the NPE.
+  const bool use_cache = (type == kStatic) || (receiver != nullptr);
+  const bool dispatches_on_receiver = (type == kVirtual) || (type == kInterface);
+  Class* receiver_class = (dispatches_on_receiver && use_cache) ? receiver->GetClass() : nullptr;
+  InterpreterCache* const cache = self->GetInterpreterCache();
+  ArtMethod* method = use_cache ? cache->GetMethod(inst, referrer, receiver_class) : nullptr;
+  if (method == nullptr) {
+    method = FindMethodFromCode<type, do_access_check>(method_idx, receiver, referrer, self);
+    if (type != kStatic) {
+      // Reload the vreg since the GC may have moved the object.
+      receiver = shadow_frame.GetVRegReference(vregC);
+    }
+    if (use_cache && method != nullptr) {
+      // A moving GC during resolution may also have moved the class, and has cleared the cache.
+      if (dispatches_on_receiver) {
+        receiver_class = receiver->GetClass();
+      }
+      cache->PutMethod(inst, referrer, receiver_class, method);
+    }
   }
   if (UNLIKELY(method == nullptr)) {
     CHECK(self->IsExceptionPending());
@@ -149,6 +179,28 @@ static inline bool DoInvokeVirtualQuick(Thread* self, ShadowFrame& shadow_frame,
   }
 }
 
+// Resolves the field accessed by an iget/iput/sget/sput instruction, consulting the thread's
+// interpreter cache first. Static fields are only cached once their class is initialized so that
+// a hit never skips class initialization.
+template<FindFieldType find_type, Primitive::Type field_type, bool do_access_check>
+static inline ArtField* FindFieldFromCodeCached(Thread* self, const ShadowFrame& shadow_frame,
+                                                const Instruction* inst, uint32_t field_idx)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const bool is_static = (find_type == StaticObjectRead) || (find_type == StaticPrimitiveRead) ||
+      (find_type == StaticObjectWrite) || (find_type == StaticPrimitiveWrite);
+  ArtMethod* const referrer = shadow_frame.GetMethod();
+  InterpreterCache* const cache = self->GetInterpreterCache();
+  ArtField* f = cache->GetField(inst, referrer);
+  if (f == nullptr) {
+    f = FindFieldFromCode<find_type, do_access_check>(field_idx, referrer, self,
+                                                      Primitive::FieldSize(field_type));
+    if (f != nullptr && (!is_static || f->GetDeclaringClass()->IsInitialized())) {
+      cache->PutField(inst, referrer, f);
+    }
+  }
+  return f;
+}
+
 // Handles iget-XXX and sget-XXX instructions.
 // Returns true on success, otherwise throws an exception and returns false.
 template<FindFieldType find_type, Primitive::Type field_type, bool do_access_check>
@@ -156,8 +208,8 @@ static inline bool DoFieldGet(Thread* self, ShadowFrame& shadow_frame,
                               const Instruction* inst, uint16_t inst_data) {
   const bool is_static = (find_type == StaticObjectRead) || (find_type == StaticPrimitiveRead);
   const uint32_t field_idx = is_static ? inst->VRegB_21c() : inst->VRegC_22c();
-  ArtField* f = FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
-                                                              Primitive::FieldSize(field_type));
+  ArtField* f = FindFieldFromCodeCached<find_type, field_type, do_access_check>(self, shadow_frame,
+                                                                               inst, field_idx);
   if (UNLIKELY(f == nullptr)) {
     CHECK(self->IsExceptionPending());
     return false;
@@ -239,8 +291,8 @@ static inline bool DoFieldPut(Thread* self, const ShadowFrame& shadow_frame,
   bool do_assignability_check = do_access_check;
   bool is_static = (find_type == StaticObjectWrite) || (find_type == StaticPrimitiveWrite);
   uint32_t field_idx = is_static ? inst->VRegB_21c() : inst->VRegC_22c();
-  ArtField* f = FindFieldFromCode<find_type, do_access_check>(field_idx, shadow_frame.GetMethod(), self,
-                                                              Primitive::FieldSize(field_type));
+  ArtField* f = FindFieldFromCodeCached<find_type, field_type, do_access_check>(self, shadow_frame,
+                                                                               inst, field_idx);
   if (UNLIKELY(f == nullptr)) {
     CHECK(self->IsExceptionPending());
     return false;
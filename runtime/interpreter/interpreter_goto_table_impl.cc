@@ -54,6 +54,21 @@ namespace interpreter {
 #define UPDATE_HANDLER_TABLE() \
   currentHandlersTable = handlersTable[Runtime::Current()->GetInstrumentation()->GetInterpreterHandlerTable()]
 
+// Runs the assembly fast path from the instruction _offset code units away and resumes at the
+// instruction it stopped at. Skipped when access checks or instrumentation are needed, since
+// the fast path does neither.
+#define MTERP_EXECUTE(_offset)                                                          \
+  do {                                                                                  \
+    if (kUseMterp && !do_access_check &&                                                \
+        currentHandlersTable == handlersTable[instrumentation::kMainHandlerTable]) {    \
+      int32_t mterp_dex_pc = static_cast<int32_t>(dex_pc) + (_offset);                  \
+      shadow_frame.SetDexPC(static_cast<uint32_t>(mterp_dex_pc));                       \
+      art_mterp_execute(&shadow_frame, code_item->insns_, self);                        \
+      mterp_dex_pc = static_cast<int32_t>(shadow_frame.GetDexPC());                     \
+      ADVANCE(mterp_dex_pc - static_cast<int32_t>(dex_pc));                             \
+    }                                                                                   \
+  } while (false)
+
 #define UNREACHABLE_CODE_CHECK()                \
   do {                                          \
     if (kIsDebugBuild) {                        \
@@ -155,6 +170,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
   }
 
   // Jump to first instruction.
+  MTERP_EXECUTE(0);
   ADVANCE(0);
   UNREACHABLE_CODE_CHECK();
 
@@ -599,6 +615,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
         CheckSuspend(self);
         UPDATE_HANDLER_TABLE();
       }
+      MTERP_EXECUTE(offset);
     }
     ADVANCE(offset);
   }
@@ -611,6 +628,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
         CheckSuspend(self);
         UPDATE_HANDLER_TABLE();
       }
+      MTERP_EXECUTE(offset);
     }
     ADVANCE(offset);
   }
@@ -623,6 +641,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
         CheckSuspend(self);
         UPDATE_HANDLER_TABLE();
       }
+      MTERP_EXECUTE(offset);
     }
     ADVANCE(offset);
   }
@@ -635,6 +654,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
         CheckSuspend(self);
         UPDATE_HANDLER_TABLE();
       }
+      MTERP_EXECUTE(offset);
     }
     ADVANCE(offset);
   }
@@ -647,6 +667,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
         CheckSuspend(self);
         UPDATE_HANDLER_TABLE();
       }
+      MTERP_EXECUTE(offset);
     }
     ADVANCE(offset);
   }
@@ -740,6 +761,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -756,6 +778,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -772,6 +795,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -788,6 +812,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -804,6 +829,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -820,6 +846,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -836,6 +863,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -852,6 +880,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -868,6 +897,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -884,6 +914,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -900,6 +931,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -916,6 +948,7 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
           CheckSuspend(self);
           UPDATE_HANDLER_TABLE();
         }
+        MTERP_EXECUTE(offset);
       }
       ADVANCE(offset);
     } else {
@@ -2268,28 +2301,89 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
     UnexpectedOpcode(inst, mh);
   HANDLE_INSTRUCTION_END();
 
-  HANDLE_INSTRUCTION_START(UNUSED_EB)
-    UnexpectedOpcode(inst, mh);
+  // Superinstructions formed by the dex-to-dex compiler. The second instruction of each pair is
+  // still in place right after the first, so its operands are read from there and the pair
+  // advances past both at once.
+#define IGET_QUICK_IF(_type, _cond)                                                     \
+  do {                                                                                  \
+    bool success = DoIGetQuick<_type>(shadow_frame, inst, inst_data);                   \
+    if (UNLIKELY(!success)) {                                                           \
+      HANDLE_PENDING_EXCEPTION();                                                       \
+    }                                                                                   \
+    const Instruction* if_inst = inst->RelativeAt(2);                                   \
+    DCHECK(if_inst->Opcode() == Instruction::IF_EQZ ||                                  \
+           if_inst->Opcode() == Instruction::IF_NEZ);                                   \
+    if (shadow_frame.GetVReg(if_inst->VRegA_21t()) _cond 0) {                           \
+      int16_t offset = if_inst->VRegB_21t();                                            \
+      if (IsBackwardBranch(offset)) {                                                   \
+        if (UNLIKELY(self->TestAllFlags())) {                                           \
+          shadow_frame.SetDexPC(dex_pc + 2);                                            \
+          CheckSuspend(self);                                                           \
+          UPDATE_HANDLER_TABLE();                                                       \
+        }                                                                               \
+        MTERP_EXECUTE(2 + offset);                                                      \
+      }                                                                                 \
+      ADVANCE(2 + offset);                                                              \
+    } else {                                                                            \
+      ADVANCE(4);                                                                       \
+    }                                                                                   \
+  } while (false)
+
+  HANDLE_INSTRUCTION_START(IGET_QUICK_IF_EQZ)
+    IGET_QUICK_IF(Primitive::kPrimInt, ==);
   HANDLE_INSTRUCTION_END();
 
-  HANDLE_INSTRUCTION_START(UNUSED_EC)
-    UnexpectedOpcode(inst, mh);
+  HANDLE_INSTRUCTION_START(IGET_QUICK_IF_NEZ)
+    IGET_QUICK_IF(Primitive::kPrimInt, !=);
   HANDLE_INSTRUCTION_END();
 
-  HANDLE_INSTRUCTION_START(UNUSED_ED)
-    UnexpectedOpcode(inst, mh);
+  HANDLE_INSTRUCTION_START(IGET_OBJECT_QUICK_IF_EQZ)
+    IGET_QUICK_IF(Primitive::kPrimNot, ==);
   HANDLE_INSTRUCTION_END();
 
-  HANDLE_INSTRUCTION_START(UNUSED_EE)
-    UnexpectedOpcode(inst, mh);
+  HANDLE_INSTRUCTION_START(IGET_OBJECT_QUICK_IF_NEZ)
+    IGET_QUICK_IF(Primitive::kPrimNot, !=);
   HANDLE_INSTRUCTION_END();
 
-  HANDLE_INSTRUCTION_START(UNUSED_EF)
-    UnexpectedOpcode(inst, mh);
+#undef IGET_QUICK_IF
+
+  HANDLE_INSTRUCTION_START(CONST_4_ADD_INT) {
+    uint32_t dst = inst->VRegA_11n(inst_data);
+    int32_t val = inst->VRegB_11n(inst_data);
+    shadow_frame.SetVReg(dst, val);
+    if (val == 0) {
+      shadow_frame.SetVRegReference(dst, NULL);
+    }
+    const Instruction* add_inst = inst->RelativeAt(1);
+    DCHECK_EQ(add_inst->Opcode(), Instruction::ADD_INT);
+    shadow_frame.SetVReg(add_inst->VRegA_23x(),
+                         shadow_frame.GetVReg(add_inst->VRegB_23x()) +
+                         shadow_frame.GetVReg(add_inst->VRegC_23x()));
+    ADVANCE(3);
+  }
   HANDLE_INSTRUCTION_END();
 
-  HANDLE_INSTRUCTION_START(UNUSED_F0)
-    UnexpectedOpcode(inst, mh);
+  HANDLE_INSTRUCTION_START(AGET_ADD_INT) {
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+      IntArray* array = a->AsIntArray();
+      if (LIKELY(array->IsValidIndex(index))) {
+        shadow_frame.SetVReg(inst->VRegA_23x(inst_data), array->GetData()[index]);
+        const Instruction* add_inst = inst->RelativeAt(2);
+        DCHECK_EQ(add_inst->Opcode(), Instruction::ADD_INT);
+        shadow_frame.SetVReg(add_inst->VRegA_23x(),
+                             shadow_frame.GetVReg(add_inst->VRegB_23x()) +
+                             shadow_frame.GetVReg(add_inst->VRegC_23x()));
+        ADVANCE(4);
+      } else {
+        HANDLE_PENDING_EXCEPTION();
+      }
+    }
+  }
   HANDLE_INSTRUCTION_END();
 
   HANDLE_INSTRUCTION_START(UNUSED_F1)
@@ -2371,7 +2465,8 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
     }
   }
 
-  // Create alternative instruction handlers dedicated to instrumentation.
+  // Create alternative instruction handlers dedicated to instrumentation. Superinstructions run
+  // as their first half so that listeners see the dex pc of the second instruction too.
 #define INSTRUMENTATION_INSTRUCTION_HANDLER(o, code, n, f, r, i, a, v)                              \
   alt_op_##code: {                                                                                  \
       instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation(); \
@@ -2380,7 +2475,8 @@ JValue ExecuteGotoImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem*
                                          shadow_frame.GetMethod(), dex_pc);                         \
       }                                                                                             \
       UPDATE_HANDLER_TABLE();                                                                       \
-      goto *handlersTable[instrumentation::kMainHandlerTable][Instruction::code];                   \
+      Instruction::Code main_code = Instruction::UnfusedOpcode(Instruction::code);                  \
+      goto *handlersTable[instrumentation::kMainHandlerTable][main_code];                           \
   }
 #include "dex_instruction_list.h"
       DEX_INSTRUCTION_LIST(INSTRUMENTATION_INSTRUCTION_HANDLER)
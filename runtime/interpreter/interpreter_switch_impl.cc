@@ -256,7 +256,8 @@ JValue ExecuteSwitchImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem
         }
         return result;
       }
-      case Instruction::CONST_4: {
+      case Instruction::CONST_4:
+      case Instruction::CONST_4_ADD_INT: {
         PREAMBLE();
         uint4_t dst = inst->VRegA_11n(inst_data);
         int4_t val = inst->VRegB_11n(inst_data);
@@ -892,7 +893,8 @@ JValue ExecuteSwitchImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem
         }
         break;
       }
-      case Instruction::AGET: {
+      case Instruction::AGET:
+      case Instruction::AGET_ADD_INT: {
         PREAMBLE();
         Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
         if (UNLIKELY(a == NULL)) {
@@ -1121,7 +1123,9 @@ JValue ExecuteSwitchImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem
         POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
         break;
       }
-      case Instruction::IGET_QUICK: {
+      case Instruction::IGET_QUICK:
+      case Instruction::IGET_QUICK_IF_EQZ:
+      case Instruction::IGET_QUICK_IF_NEZ: {
         PREAMBLE();
         bool success = DoIGetQuick<Primitive::kPrimInt>(shadow_frame, inst, inst_data);
         POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
@@ -1133,7 +1137,9 @@ JValue ExecuteSwitchImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem
         POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
         break;
       }
-      case Instruction::IGET_OBJECT_QUICK: {
+      case Instruction::IGET_OBJECT_QUICK:
+      case Instruction::IGET_OBJECT_QUICK_IF_EQZ:
+      case Instruction::IGET_OBJECT_QUICK_IF_NEZ: {
         PREAMBLE();
         bool success = DoIGetQuick<Primitive::kPrimNot>(shadow_frame, inst, inst_data);
         POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
@@ -2127,7 +2133,7 @@ JValue ExecuteSwitchImpl(Thread* self, MethodHelper& mh, const DexFile::CodeItem
         inst = inst->Next_2xx();
         break;
       case Instruction::UNUSED_3E ... Instruction::UNUSED_43:
-      case Instruction::UNUSED_EB ... Instruction::UNUSED_FF:
+      case Instruction::UNUSED_F1 ... Instruction::UNUSED_FF:
       case Instruction::UNUSED_79:
       case Instruction::UNUSED_7A:
         UnexpectedOpcode(inst, mh);
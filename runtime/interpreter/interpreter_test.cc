@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter/interpreter.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "common_test.h"
+#include "dex_instruction.h"
+#include "gc/collector_type.h"
+#include "gc/heap.h"
+#include "interpreter/interpreter_cache.h"
+#include "mirror/art_field-inl.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/array-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "object_utils.h"
+#include "sirt_ref.h"
+#include "stack.h"
+
+namespace art {
+namespace interpreter {
+
+class InterpreterTest : public CommonTest {
+ protected:
+  static const size_t kNumVRegs = 5;
+
+  void SetUpAllFields(ScopedObjectAccess& soa) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    jobject jclass_loader = LoadDex("AllFields");
+    SirtRef<mirror::ClassLoader> class_loader(soa.Self(),
+                                              soa.Decode<mirror::ClassLoader*>(jclass_loader));
+    SirtRef<mirror::Class> klass(soa.Self(), class_linker_->FindClass("LAllFields;", class_loader));
+    ASSERT_TRUE(klass.get() != NULL);
+    ASSERT_TRUE(class_linker_->EnsureInitialized(klass, true, true));
+    all_fields_ = klass.get();
+    // The interpreted code runs on behalf of the constructor, which it never calls.
+    method_ = klass->FindDirectMethod("<init>", "()V");
+    ASSERT_TRUE(method_ != NULL);
+    int_field_ = klass->FindDeclaredInstanceField("iI", "I");
+    ASSERT_TRUE(int_field_ != NULL);
+    object_field_ = klass->FindDeclaredInstanceField("iObject", "Ljava/lang/Object;");
+    ASSERT_TRUE(object_field_ != NULL);
+  }
+
+  // Returns a code item of kNumVRegs registers around insns, stored in code.
+  static const DexFile::CodeItem* MakeCodeItem(const std::vector<uint16_t>& insns,
+                                               std::vector<uint32_t>* code) {
+    // Code items are 4-byte aligned.
+    const size_t header_size = OFFSETOF_MEMBER(DexFile::CodeItem, insns_);
+    code->assign((header_size + insns.size() * sizeof(uint16_t) + 3) / 4, 0);
+    DexFile::CodeItem* code_item = reinterpret_cast<DexFile::CodeItem*>(&(*code)[0]);
+    code_item->registers_size_ = kNumVRegs;
+    code_item->ins_size_ = 0;
+    code_item->outs_size_ = 0;
+    code_item->tries_size_ = 0;
+    code_item->debug_info_off_ = 0;
+    code_item->insns_size_in_code_units_ = insns.size();
+    memcpy(code_item->insns_, &insns[0], insns.size() * sizeof(uint16_t));
+    return code_item;
+  }
+
+  // Interprets insns with the given registers, in the interpreter with access checks unless the
+  // method is preverified. The registers are those of a frame of kNumVRegs registers, each with
+  // either an int or a reference.
+  JValue Interpret(Thread* self, const std::vector<uint16_t>& insns, bool preverified,
+                   const uint32_t* vregs, mirror::Object* const* references)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    std::vector<uint32_t> code;
+    return Interpret(self, MakeCodeItem(insns, &code), preverified, vregs, references);
+  }
+
+  JValue Interpret(Thread* self, const DexFile::CodeItem* code_item, bool preverified,
+                   const uint32_t* vregs, mirror::Object* const* references)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    uint32_t access_flags = method_->GetAccessFlags();
+    method_->SetAccessFlags(preverified ? (access_flags | kAccPreverified)
+                                        : (access_flags & ~kAccPreverified));
+
+    void* memory = alloca(ShadowFrame::ComputeSize(kNumVRegs));
+    ShadowFrame* shadow_frame = ShadowFrame::Create(kNumVRegs, NULL, method_, 0, memory);
+    for (size_t i = 0; i < kNumVRegs; ++i) {
+      if (references[i] != NULL) {
+        shadow_frame->SetVRegReference(i, references[i]);
+      } else {
+        shadow_frame->SetVReg(i, vregs[i]);
+      }
+    }
+    MethodHelper mh(method_);
+    JValue result;
+    artInterpreterToInterpreterBridge(self, mh, code_item, shadow_frame, &result);
+    method_->SetAccessFlags(access_flags);
+    return result;
+  }
+
+  // Runs "<get> v0, v2, field; <if> v0, +4; const/4 v1, #1; return v1; const/4 v1, #-1;
+  // return v1" on obj, with <get> fused with <if>. Returns 1 if the branch falls through and -1 if
+  // it is taken.
+  int32_t RunIGetQuickIf(Thread* self, Instruction::Code fused_opcode, Instruction::Code if_opcode,
+                         mirror::ArtField* field, mirror::Object* obj, bool preverified)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    std::vector<uint16_t> insns;
+    insns.push_back(fused_opcode | (0 << 8) | (2 << 12));
+    insns.push_back(field->GetOffset().Uint32Value());
+    insns.push_back(if_opcode | (0 << 8));
+    insns.push_back(4);
+    insns.push_back(Instruction::CONST_4 | (1 << 8) | (1 << 12));
+    insns.push_back(Instruction::RETURN | (1 << 8));
+    insns.push_back(Instruction::CONST_4 | (1 << 8) | (0xf << 12));
+    insns.push_back(Instruction::RETURN | (1 << 8));
+    uint32_t vregs[kNumVRegs] = { 0, 0, 0, 0, 0 };
+    mirror::Object* references[kNumVRegs] = { NULL, NULL, obj, NULL, NULL };
+    return Interpret(self, insns, preverified, vregs, references).GetI();
+  }
+
+  void ExpectPendingException(Thread* self, const char* descriptor)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    ASSERT_TRUE(self->IsExceptionPending());
+    mirror::Class* exception_class = class_linker_->FindSystemClass(descriptor);
+    EXPECT_TRUE(self->GetException(NULL)->InstanceOf(exception_class));
+    self->ClearException();
+  }
+
+  mirror::Class* all_fields_;
+  mirror::ArtMethod* method_;
+  mirror::ArtField* int_field_;
+  mirror::ArtField* object_field_;
+};
+
+TEST_F(InterpreterTest, IGetQuickIf) {
+  ScopedObjectAccess soa(Thread::Current());
+  SetUpAllFields(soa);
+  SirtRef<mirror::Object> obj(soa.Self(), all_fields_->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj.get() != NULL);
+  for (int preverified = 0; preverified < 2; ++preverified) {
+    int_field_->SetInt(obj.get(), 0);
+    EXPECT_EQ(-1, RunIGetQuickIf(soa.Self(), Instruction::IGET_QUICK_IF_EQZ, Instruction::IF_EQZ,
+                                 int_field_, obj.get(), preverified));
+    EXPECT_EQ(1, RunIGetQuickIf(soa.Self(), Instruction::IGET_QUICK_IF_NEZ, Instruction::IF_NEZ,
+                                int_field_, obj.get(), preverified));
+    int_field_->SetInt(obj.get(), 42);
+    EXPECT_EQ(1, RunIGetQuickIf(soa.Self(), Instruction::IGET_QUICK_IF_EQZ, Instruction::IF_EQZ,
+                                int_field_, obj.get(), preverified));
+    EXPECT_EQ(-1, RunIGetQuickIf(soa.Self(), Instruction::IGET_QUICK_IF_NEZ, Instruction::IF_NEZ,
+                                 int_field_, obj.get(), preverified));
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+
+    // The exception message is made up from the constructor's own code at the dex pc.
+    RunIGetQuickIf(soa.Self(), Instruction::IGET_QUICK_IF_EQZ, Instruction::IF_EQZ, int_field_,
+                   NULL, preverified);
+    ExpectPendingException(soa.Self(), "Ljava/lang/NullPointerException;");
+  }
+}
+
+TEST_F(InterpreterTest, IGetObjectQuickIf) {
+  ScopedObjectAccess soa(Thread::Current());
+  SetUpAllFields(soa);
+  SirtRef<mirror::Object> obj(soa.Self(), all_fields_->AllocObject(soa.Self()));
+  ASSERT_TRUE(obj.get() != NULL);
+  for (int preverified = 0; preverified < 2; ++preverified) {
+    object_field_->SetObject(obj.get(), NULL);
+    EXPECT_EQ(-1, RunIGetQuickIf(soa.Self(), Instruction::IGET_OBJECT_QUICK_IF_EQZ,
+                                 Instruction::IF_EQZ, object_field_, obj.get(), preverified));
+    EXPECT_EQ(1, RunIGetQuickIf(soa.Self(), Instruction::IGET_OBJECT_QUICK_IF_NEZ,
+                                Instruction::IF_NEZ, object_field_, obj.get(), preverified));
+    object_field_->SetObject(obj.get(), obj.get());
+    EXPECT_EQ(1, RunIGetQuickIf(soa.Self(), Instruction::IGET_OBJECT_QUICK_IF_EQZ,
+                                Instruction::IF_EQZ, object_field_, obj.get(), preverified));
+    EXPECT_EQ(-1, RunIGetQuickIf(soa.Self(), Instruction::IGET_OBJECT_QUICK_IF_NEZ,
+                                 Instruction::IF_NEZ, object_field_, obj.get(), preverified));
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+
+    RunIGetQuickIf(soa.Self(), Instruction::IGET_OBJECT_QUICK_IF_NEZ, Instruction::IF_NEZ,
+                   object_field_, NULL, preverified);
+    ExpectPendingException(soa.Self(), "Ljava/lang/NullPointerException;");
+  }
+}
+
+TEST_F(InterpreterTest, Const4AddInt) {
+  ScopedObjectAccess soa(Thread::Current());
+  SetUpAllFields(soa);
+  // const/4 v0, #-3; add-int v1, v0, v2; return v1
+  std::vector<uint16_t> insns;
+  insns.push_back(Instruction::CONST_4_ADD_INT | (0 << 8) | (0xd << 12));
+  insns.push_back(Instruction::ADD_INT | (1 << 8));
+  insns.push_back(0 | (2 << 8));
+  insns.push_back(Instruction::RETURN | (1 << 8));
+  uint32_t vregs[kNumVRegs] = { 0, 0, 45, 0, 0 };
+  mirror::Object* references[kNumVRegs] = { NULL, NULL, NULL, NULL, NULL };
+  for (int preverified = 0; preverified < 2; ++preverified) {
+    EXPECT_EQ(42, Interpret(soa.Self(), insns, preverified, vregs, references).GetI());
+  }
+
+  // The add needn't use the constant: const/4 v0, #7; add-int v1, v2, v2; return v0
+  insns[0] = Instruction::CONST_4_ADD_INT | (0 << 8) | (7 << 12);
+  insns[2] = 2 | (2 << 8);
+  insns[3] = Instruction::RETURN | (0 << 8);
+  for (int preverified = 0; preverified < 2; ++preverified) {
+    EXPECT_EQ(7, Interpret(soa.Self(), insns, preverified, vregs, references).GetI());
+  }
+}
+
+TEST_F(InterpreterTest, AGetAddInt) {
+  ScopedObjectAccess soa(Thread::Current());
+  SetUpAllFields(soa);
+  SirtRef<mirror::IntArray> array(soa.Self(), mirror::IntArray::Alloc(soa.Self(), 2));
+  ASSERT_TRUE(array.get() != NULL);
+  array->Set(0, 7);
+  array->Set(1, 11);
+  // aget v0, v2, v3; add-int v1, v0, v4; return v1
+  std::vector<uint16_t> insns;
+  insns.push_back(Instruction::AGET_ADD_INT | (0 << 8));
+  insns.push_back(2 | (3 << 8));
+  insns.push_back(Instruction::ADD_INT | (1 << 8));
+  insns.push_back(0 | (4 << 8));
+  insns.push_back(Instruction::RETURN | (1 << 8));
+  uint32_t vregs[kNumVRegs] = { 0, 0, 0, 1, 31 };
+  mirror::Object* references[kNumVRegs] = { NULL, NULL, array.get(), NULL, NULL };
+  for (int preverified = 0; preverified < 2; ++preverified) {
+    vregs[3] = 1;
+    references[2] = array.get();
+    EXPECT_EQ(42, Interpret(soa.Self(), insns, preverified, vregs, references).GetI());
+    vregs[3] = 0;
+    EXPECT_EQ(38, Interpret(soa.Self(), insns, preverified, vregs, references).GetI());
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+
+    vregs[3] = 2;
+    Interpret(soa.Self(), insns, preverified, vregs, references);
+    ExpectPendingException(soa.Self(), "Ljava/lang/ArrayIndexOutOfBoundsException;");
+
+    references[2] = NULL;
+    Interpret(soa.Self(), insns, preverified, vregs, references);
+    ExpectPendingException(soa.Self(), "Ljava/lang/NullPointerException;");
+  }
+}
+
+TEST_F(InterpreterTest, InvokeCacheAcrossMovingGc) {
+  TEST_DISABLED_FOR_PORTABLE();
+  ScopedObjectAccess soa(Thread::Current());
+  // Allocate the classes loaded below in the bump pointer space, which the semi-space collector
+  // evacuates on every collection.
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  heap->ChangeCollector(gc::kCollectorTypeSS);
+  jobject jclass_loader = LoadDex("NonStaticLeafMethods");
+  SirtRef<mirror::ClassLoader> class_loader(soa.Self(),
+                                            soa.Decode<mirror::ClassLoader*>(jclass_loader));
+  SirtRef<mirror::Class> klass(soa.Self(),
+                               class_linker_->FindClass("LNonStaticLeafMethods;", class_loader));
+  ASSERT_TRUE(klass.get() != NULL);
+  ASSERT_TRUE(class_linker_->EnsureInitialized(klass, true, true));
+  method_ = klass->FindDirectMethod("<init>", "()V");
+  ASSERT_TRUE(method_ != NULL);
+  mirror::ArtMethod* sum = klass->FindVirtualMethod("sum", "(II)I");
+  ASSERT_TRUE(sum != NULL);
+  SirtRef<mirror::Object> receiver(soa.Self(), klass->AllocObject(soa.Self()));
+  ASSERT_TRUE(receiver.get() != NULL);
+
+  // invoke-virtual {v2, v3, v4}, sum(II)I; move-result v0; return v0
+  std::vector<uint16_t> insns;
+  insns.push_back(Instruction::INVOKE_VIRTUAL | (3 << 12));
+  insns.push_back(sum->GetDexMethodIndex());
+  insns.push_back(2 | (3 << 4) | (4 << 8));
+  insns.push_back(Instruction::MOVE_RESULT | (0 << 8));
+  insns.push_back(Instruction::RETURN | (0 << 8));
+  std::vector<uint32_t> code;
+  const DexFile::CodeItem* code_item = MakeCodeItem(insns, &code);
+  const Instruction* invoke = Instruction::At(code_item->insns_);
+  uint32_t vregs[kNumVRegs] = { 0, 0, 0, 20, 22 };
+  mirror::Object* references[kNumVRegs] = { NULL, NULL, receiver.get(), NULL, NULL };
+
+  InterpreterCache* cache = soa.Self()->GetInterpreterCache();
+  EXPECT_EQ(42, Interpret(soa.Self(), code_item, false, vregs, references).GetI());
+  mirror::Class* old_class = klass.get();
+  EXPECT_EQ(sum, cache->GetMethod(invoke, method_, old_class));
+
+  heap->CollectGarbage(false);
+  // The class moved, and the entry keyed on its old address is gone, so that no class later
+  // allocated there can hit it.
+  ASSERT_NE(old_class, klass.get());
+  EXPECT_EQ(klass.get(), receiver->GetClass());
+  EXPECT_TRUE(cache->GetMethod(invoke, method_, old_class) == NULL);
+
+  references[2] = receiver.get();
+  EXPECT_EQ(42, Interpret(soa.Self(), code_item, false, vregs, references).GetI());
+  EXPECT_EQ(sum, cache->GetMethod(invoke, method_, klass.get()));
+  EXPECT_TRUE(cache->GetMethod(invoke, method_, old_class) == NULL);
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JNI_BATCH_H_
+#define ART_RUNTIME_JNI_BATCH_H_
+
+#include "jni.h"
+
+/*
+ * ART extension to JNI for native code that calls into Java many times in a row, such as an
+ * event loop dispatching to a Java callback. Obtain the table with
+ *
+ *   const JNIBatchInterface* batch;
+ *   vm->GetEnv(reinterpret_cast<void**>(&batch), JNI_BATCH_VERSION);
+ *
+ * BeginBatch moves the calling thread to the runnable state once and opens a local reference
+ * frame; EndBatch pops the frame and returns the thread to native. In between, the calls
+ * below skip the per-call thread state transitions. Regular JNI functions remain usable inside
+ * a batch. The thread gives the GC a chance to suspend it between batched calls, but native
+ * code must not block (or run for long) while a batch is open.
+ *
+ * Every function taking a jmethodID or jfieldID dispatches on the member itself: the object
+ * argument is ignored for static members, and virtual methods are resolved against the
+ * receiver as Call<Type>MethodA would.
+ */
+
+#define JNI_BATCH_VERSION 0x40010001
+
+struct JNIBatchInterface {
+  // Returns JNI_ERR if a batch is already open on this thread or the locals can't be reserved.
+  jint (*BeginBatch)(JNIEnv* env, jint local_capacity);
+  void (*EndBatch)(JNIEnv* env);
+
+  // Deletes all local references created since BeginBatch, keeping the batch open.
+  void (*ReleaseBatchLocals)(JNIEnv* env);
+
+  // Returns the result in the jvalue member matching the method's return type. Reference
+  // results are new local references.
+  jvalue (*CallMethodA)(JNIEnv* env, jobject obj, jmethodID mid, const jvalue* args);
+
+  // Calls 'mid' call_count times. The arguments of call i start at args + i * args_stride.
+  // Results are discarded. Stops at the first call that throws; returns the number of calls
+  // that completed without an exception.
+  jint (*CallMethodBatchA)(JNIEnv* env, jobject obj, jmethodID mid, jint call_count,
+                           const jvalue* args, jint args_stride);
+
+  jvalue (*GetField)(JNIEnv* env, jobject obj, jfieldID fid);
+  void (*SetField)(JNIEnv* env, jobject obj, jfieldID fid, jvalue value);
+};
+
+#endif  // ART_RUNTIME_JNI_BATCH_H_
@@ -18,6 +18,7 @@
 
 #include <dlfcn.h>
 
+#include <algorithm>
 #include <cstdarg>
 #include <utility>
 #include <vector>
@@ -29,10 +30,13 @@
 #include "base/stringpiece.h"
 #include "class_linker.h"
 #include "dex_file-inl.h"
+#include "elf_file.h"
+#include "entrypoints/entrypoint_utils.h"
 #include "gc/accounting/card_table-inl.h"
 #include "interpreter/interpreter.h"
 #include "invoke_arg_array_builder.h"
 #include "jni.h"
+#include "jni_batch.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
@@ -41,6 +45,7 @@
 #include "mirror/object_array-inl.h"
 #include "mirror/throwable.h"
 #include "object_utils.h"
+#include "os.h"
 #include "runtime.h"
 #include "safe_map.h"
 #include "scoped_thread_state_change.h"
@@ -79,11 +84,13 @@ static const size_t kLocalsMax = 512;  // Arbitrary sanity check.
 static const size_t kPinTableInitial = 16;  // Arbitrary.
 static const size_t kPinTableMax = 1024;  // Arbitrary sanity check.
 
-static size_t gGlobalsInitial = 512;  // Arbitrary.
-static size_t gGlobalsMax = 51200;  // Arbitrary sanity check. (Must fit in 16 bits.)
+// The global tables can hold as many references as an IndirectRef can address; -Xjnigreflimit
+// sets the size at which they start warning.
+static const size_t kGlobalsInitial = 512;  // Arbitrary.
+static const size_t kGlobalsMax = kIRTMaxEntries;
 
 static const size_t kWeakGlobalsInitial = 16;  // Arbitrary.
-static const size_t kWeakGlobalsMax = 51200;  // Arbitrary sanity check. (Must fit in 16 bits.)
+static const size_t kWeakGlobalsMax = kIRTMaxEntries;
 
 static jweak AddWeakGlobalReference(ScopedObjectAccess& soa, Object* obj)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -455,18 +462,134 @@ static jint JII_AttachCurrentThread(JavaVM* vm, JNIEnv** p_env, void* raw_args,
   }
 }
 
+// Checks the ELF header of file, and the ranges of its program and section headers, against what
+// ElfFile expects of a shared library before it is opened with it: ElfFile treats any mismatch as
+// a fatal error, while a library it can't parse is merely left unindexed.
+static bool IsIndexableElfFile(File* file, std::string* error_msg) {
+  int64_t length = file->GetLength();
+  llvm::ELF::Elf32_Ehdr header;
+  if (length < static_cast<int64_t>(sizeof(header)) ||
+      file->Read(reinterpret_cast<char*>(&header), sizeof(header), 0) != sizeof(header)) {
+    *error_msg = "too short for an ELF header";
+    return false;
+  }
+  if (memcmp(header.e_ident, llvm::ELF::ElfMagic, strlen(llvm::ELF::ElfMagic)) != 0) {
+    *error_msg = "no ELF magic";
+    return false;
+  }
+  if (header.e_ident[llvm::ELF::EI_CLASS] != llvm::ELF::ELFCLASS32 ||
+      header.e_ident[llvm::ELF::EI_DATA] != llvm::ELF::ELFDATA2LSB) {
+    *error_msg = "not a 32-bit little-endian ELF file";
+    return false;
+  }
+  if (header.e_ident[llvm::ELF::EI_VERSION] != llvm::ELF::EV_CURRENT ||
+      header.e_version != llvm::ELF::EV_CURRENT) {
+    *error_msg = "unknown ELF version";
+    return false;
+  }
+  if (header.e_type != llvm::ELF::ET_DYN || header.e_entry != 0) {
+    *error_msg = "not a shared library without an entry point";
+    return false;
+  }
+  uint64_t program_headers_end = static_cast<uint64_t>(header.e_phoff) +
+      static_cast<uint64_t>(header.e_phnum) * header.e_phentsize;
+  if (header.e_ehsize == 0 || header.e_phoff == 0 || header.e_phnum == 0 ||
+      header.e_phentsize != sizeof(llvm::ELF::Elf32_Phdr) ||
+      program_headers_end > static_cast<uint64_t>(length)) {
+    *error_msg = "program headers missing or out of range";
+    return false;
+  }
+  uint64_t section_headers_end = static_cast<uint64_t>(header.e_shoff) +
+      static_cast<uint64_t>(header.e_shnum) * header.e_shentsize;
+  if (header.e_shoff == 0 || header.e_shnum == 0 ||
+      header.e_shentsize != sizeof(llvm::ELF::Elf32_Shdr) || header.e_shstrndx == 0 ||
+      header.e_shstrndx >= header.e_shnum || section_headers_end > static_cast<uint64_t>(length)) {
+    *error_msg = "section headers stripped or out of range";
+    return false;
+  }
+  for (llvm::ELF::Elf32_Half i = 0; i < header.e_shnum; ++i) {
+    llvm::ELF::Elf32_Shdr section_header;
+    int64_t offset = header.e_shoff + i * sizeof(section_header);
+    if (file->Read(reinterpret_cast<char*>(&section_header), sizeof(section_header), offset) !=
+        sizeof(section_header)) {
+      *error_msg = "failed to read section headers";
+      return false;
+    }
+    if (section_header.sh_type != llvm::ELF::SHT_NOBITS &&
+        static_cast<uint64_t>(section_header.sh_offset) + section_header.sh_size >
+            static_cast<uint64_t>(length)) {
+      *error_msg = StringPrintf("section %d out of range", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BuildJniSymbolIndex(const std::string& path, std::vector<uint32_t>* hashes) {
+  UniquePtr<File> file(OS::OpenFileForReading(path.c_str()));
+  if (file.get() == NULL) {
+    return false;
+  }
+  std::string error_msg;
+  if (!IsIndexableElfFile(file.get(), &error_msg)) {
+    VLOG(jni) << "[Not indexing JNI symbols of \"" << path << "\": " << error_msg << "]";
+    return false;
+  }
+  UniquePtr<ElfFile> elf_file(ElfFile::Open(file.get(), false, false, &error_msg));
+  if (elf_file.get() == NULL) {
+    VLOG(jni) << "[Not indexing JNI symbols of \"" << path << "\": " << error_msg << "]";
+    return false;
+  }
+  llvm::ELF::Elf32_Shdr* dynsym = elf_file->FindSectionByType(llvm::ELF::SHT_DYNSYM);
+  if (dynsym == NULL || dynsym->sh_entsize != sizeof(llvm::ELF::Elf32_Sym) ||
+      dynsym->sh_link >= elf_file->GetSectionHeaderNum()) {
+    return false;
+  }
+  // The names are read in place, so the string table must end with a terminator.
+  llvm::ELF::Elf32_Shdr& dynstr = elf_file->GetSectionHeader(dynsym->sh_link);
+  if (dynstr.sh_type != llvm::ELF::SHT_STRTAB || dynstr.sh_size == 0 ||
+      elf_file->Begin()[dynstr.sh_offset + dynstr.sh_size - 1] != '\0') {
+    return false;
+  }
+  for (llvm::ELF::Elf32_Word i = 0; i < elf_file->GetSymbolNum(*dynsym); ++i) {
+    llvm::ELF::Elf32_Sym& symbol = elf_file->GetSymbol(llvm::ELF::SHT_DYNSYM, i);
+    if (symbol.st_shndx == llvm::ELF::SHN_UNDEF || symbol.st_name >= dynstr.sh_size) {
+      continue;  // Imported, not defined by this library.
+    }
+    const char* name = elf_file->GetString(dynstr, symbol.st_name);
+    if (name != NULL && strncmp(name, "Java_", 5) == 0) {
+      hashes->push_back(ElfFile::ElfHash(name));
+    }
+  }
+  std::sort(hashes->begin(), hashes->end());
+  hashes->erase(std::unique(hashes->begin(), hashes->end()), hashes->end());
+  VLOG(jni) << "[Indexed " << hashes->size() << " JNI symbols in \"" << path << "\"]";
+  return true;
+}
+
 class SharedLibrary {
  public:
   SharedLibrary(const std::string& path, void* handle, Object* class_loader)
       : path_(path),
         handle_(handle),
         class_loader_(class_loader),
+        has_jni_symbol_index_(false),
         jni_on_load_lock_("JNI_OnLoad lock"),
         jni_on_load_cond_("JNI_OnLoad condition variable", jni_on_load_lock_),
         jni_on_load_thread_id_(Thread::Current()->GetThreadId()),
         jni_on_load_result_(kPending) {
   }
 
+  // Takes ownership of the contents of an index built by BuildJniSymbolIndex.
+  void SetJniSymbolIndex(std::vector<uint32_t>* hashes) {
+    jni_symbol_hashes_.swap(*hashes);
+    has_jni_symbol_index_ = true;
+  }
+
+  bool HasJniSymbolIndex() const {
+    return has_jni_symbol_index_;
+  }
+
   Object* GetClassLoader() {
     return class_loader_;
   }
@@ -523,6 +646,16 @@ class SharedLibrary {
     return dlsym(handle_, symbol_name.c_str());
   }
 
+  // As FindSymbol, but symbols whose hash isn't in the JNI symbol index are known to be missing
+  // without asking dlsym.
+  void* FindJniSymbol(const std::string& symbol_name, uint32_t hash) {
+    if (has_jni_symbol_index_ &&
+        !std::binary_search(jni_symbol_hashes_.begin(), jni_symbol_hashes_.end(), hash)) {
+      return NULL;
+    }
+    return FindSymbol(symbol_name);
+  }
+
  private:
   enum JNI_OnLoadState {
     kPending,
@@ -539,6 +672,10 @@ class SharedLibrary {
   // The ClassLoader this library is associated with.
   Object* class_loader_;
 
+  // Sorted ELF hashes of the JNI symbols defined by the library, valid if has_jni_symbol_index_.
+  std::vector<uint32_t> jni_symbol_hashes_;
+  bool has_jni_symbol_index_;
+
   // Guards remaining items.
   Mutex jni_on_load_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   // Wait for JNI_OnLoad in other thread.
@@ -588,7 +725,10 @@ class Libraries {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     std::string jni_short_name(JniShortName(m));
     std::string jni_long_name(JniLongName(m));
+    uint32_t jni_short_hash = ElfFile::ElfHash(jni_short_name.c_str());
+    uint32_t jni_long_hash = ElfFile::ElfHash(jni_long_name.c_str());
     const ClassLoader* declaring_class_loader = m->GetDeclaringClass()->GetClassLoader();
+    bool skipped_indexed_library = false;
     for (const auto& lib : libraries_) {
       SharedLibrary* library = lib.second;
       if (library->GetClassLoader() != declaring_class_loader) {
@@ -596,15 +736,35 @@ class Libraries {
         continue;
       }
       // Try the short name then the long name...
-      void* fn = library->FindSymbol(jni_short_name);
+      void* fn = library->FindJniSymbol(jni_short_name, jni_short_hash);
       if (fn == NULL) {
-        fn = library->FindSymbol(jni_long_name);
+        fn = library->FindJniSymbol(jni_long_name, jni_long_hash);
       }
       if (fn != NULL) {
         VLOG(jni) << "[Found native code for " << PrettyMethod(m)
                   << " in \"" << library->GetPath() << "\"]";
         return fn;
       }
+      skipped_indexed_library |= library->HasJniSymbolIndex();
+    }
+    if (skipped_indexed_library) {
+      // dlsym also searches the dependencies of a library, which the index doesn't cover. Fall
+      // back to asking dlsym before giving up.
+      for (const auto& lib : libraries_) {
+        SharedLibrary* library = lib.second;
+        if (library->GetClassLoader() != declaring_class_loader || !library->HasJniSymbolIndex()) {
+          continue;
+        }
+        void* fn = library->FindSymbol(jni_short_name);
+        if (fn == NULL) {
+          fn = library->FindSymbol(jni_long_name);
+        }
+        if (fn != NULL) {
+          VLOG(jni) << "[Found native code for " << PrettyMethod(m)
+                    << " in a dependency of \"" << library->GetPath() << "\"]";
+          return fn;
+        }
+      }
     }
     detail += "No implementation found for ";
     detail += PrettyMethod(m);
@@ -2038,11 +2198,37 @@ class JNI {
   }
 
   static const jchar* GetStringCritical(JNIEnv* env, jstring java_string, jboolean* is_copy) {
-    return GetStringChars(env, java_string, is_copy);
+    CHECK_NON_NULL_ARGUMENT(GetStringCritical, java_string);
+    ScopedObjectAccess soa(env);
+    String* s = soa.Decode<String*>(java_string);
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    if (heap->IsMovableObject(s->GetCharArray())) {
+      heap->IncrementDisableMovingGC(soa.Self());
+      // Re-decode in case the object moved since IncrementDisableMovingGC waits for GC to complete.
+      s = soa.Decode<String*>(java_string);
+      if (heap->IsMovableObject(s->GetCharArray())) {
+        heap->PinMovableObject(soa.Self(), s->GetCharArray());
+      } else {
+        heap->DecrementDisableMovingGC(soa.Self());
+      }
+    }
+    CharArray* chars = s->GetCharArray();
+    PinPrimitiveArray(soa, chars);
+    if (is_copy != nullptr) {
+      *is_copy = JNI_FALSE;
+    }
+    return chars->GetData() + s->GetOffset();
   }
 
   static void ReleaseStringCritical(JNIEnv* env, jstring java_string, const jchar* chars) {
-    return ReleaseStringChars(env, java_string, chars);
+    CHECK_NON_NULL_ARGUMENT(ReleaseStringCritical, java_string);
+    ScopedObjectAccess soa(env);
+    CharArray* char_array = soa.Decode<String*>(java_string)->GetCharArray();
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    if (heap->IsMovableObject(char_array)) {
+      heap->DecrementDisableMovingGC(soa.Self());
+    }
+    UnpinPrimitiveArray(soa, char_array);
   }
 
   static const char* GetStringUTFChars(JNIEnv* env, jstring java_string, jboolean* is_copy) {
@@ -2171,9 +2357,14 @@ class JNI {
     Array* array = soa.Decode<Array*>(java_array);
     gc::Heap* heap = Runtime::Current()->GetHeap();
     if (heap->IsMovableObject(array)) {
-      heap->IncrementDisableGC(soa.Self());
-      // Re-decode in case the object moved since IncrementDisableGC waits for GC to complete.
+      heap->IncrementDisableMovingGC(soa.Self());
+      // Re-decode in case the object moved since IncrementDisableMovingGC waits for GC to complete.
       array = soa.Decode<Array*>(java_array);
+      if (heap->IsMovableObject(array)) {
+        heap->PinMovableObject(soa.Self(), array);
+      } else {
+        heap->DecrementDisableMovingGC(soa.Self());
+      }
     }
     PinPrimitiveArray(soa, array);
     if (is_copy != nullptr) {
@@ -2615,7 +2806,7 @@ class JNI {
     VLOG(heap) << "Release primitive array " << env << " array_data " << array_data
                << " elements " << reinterpret_cast<void*>(elements);
     if (!is_copy && heap->IsMovableObject(array)) {
-      heap->DecrementDisableGC(soa.Self());
+      heap->DecrementDisableMovingGC(soa.Self());
     }
     // Don't need to copy if we had a direct pointer.
     if (mode != JNI_ABORT && is_copy) {
@@ -2897,6 +3088,177 @@ const JNINativeInterface gJniNativeInterface = {
   JNI::GetObjectRefType,
 };
 
+#define CHECK_IN_BATCH(fn, env, result) \
+  if (UNLIKELY(!static_cast<JNIEnvExt*>(env)->in_batch)) { \
+    JniAbortF(#fn, "called outside of a JNI batch"); \
+    return result; \
+  }
+
+// Implementation of the JNIBatchInterface extension. The thread is already runnable inside a
+// batch, so the ScopedObjectAccess instances below don't transition.
+class JNIBatch {
+ public:
+  static jint BeginBatch(JNIEnv* env, jint local_capacity) NO_THREAD_SAFETY_ANALYSIS {
+    JNIEnvExt* ext = static_cast<JNIEnvExt*>(env);
+    if (ext->in_batch) {
+      JniAbortF("BeginBatch", "JNI batch already in progress");
+      return JNI_ERR;
+    }
+    if (JNI::EnsureLocalCapacity(env, local_capacity, "BeginBatch") != JNI_OK) {
+      return JNI_ERR;
+    }
+    ext->self->TransitionFromSuspendedToRunnable();
+    ext->PushFrame(local_capacity);
+    ext->in_batch = true;
+    return JNI_OK;
+  }
+
+  static void EndBatch(JNIEnv* env) NO_THREAD_SAFETY_ANALYSIS {
+    CHECK_IN_BATCH(EndBatch, env, );
+    JNIEnvExt* ext = static_cast<JNIEnvExt*>(env);
+    ext->PopFrame();
+    ext->in_batch = false;
+    ext->self->TransitionFromRunnableToSuspended(kNative);
+  }
+
+  static void ReleaseBatchLocals(JNIEnv* env) {
+    CHECK_IN_BATCH(ReleaseBatchLocals, env, );
+    JNIEnvExt* ext = static_cast<JNIEnvExt*>(env);
+    ext->locals.SetSegmentState(ext->local_ref_cookie);
+  }
+
+  static jvalue CallMethodA(JNIEnv* env, jobject obj, jmethodID mid, const jvalue* args) {
+    jvalue result;
+    result.j = 0;
+    CHECK_IN_BATCH(CallMethodA, env, result);
+    CHECK_NON_NULL_ARGUMENT(CallMethodA, mid);
+    ScopedObjectAccess soa(env);
+    ArtMethod* method = soa.DecodeMethod(mid);
+    MethodHelper mh(method);
+    JValue value(Invoke(soa, obj, method, mh, args));
+    result = ToJValue(soa, mh.GetShorty()[0], value);
+    CheckSuspend(soa.Self());
+    return result;
+  }
+
+  static jint CallMethodBatchA(JNIEnv* env, jobject obj, jmethodID mid, jint call_count,
+                               const jvalue* args, jint args_stride) {
+    CHECK_IN_BATCH(CallMethodBatchA, env, 0);
+    CHECK_NON_NULL_ARGUMENT(CallMethodBatchA, mid);
+    ScopedObjectAccess soa(env);
+    ArtMethod* method = soa.DecodeMethod(mid);
+    MethodHelper mh(method);
+    for (jint i = 0; i < call_count; ++i) {
+      Invoke(soa, obj, method, mh, args + i * args_stride);
+      if (soa.Self()->IsExceptionPending()) {
+        return i;
+      }
+      // Nothing decoded is kept across this, so the GC is free to move the receiver.
+      CheckSuspend(soa.Self());
+    }
+    return call_count;
+  }
+
+  static jvalue GetField(JNIEnv* env, jobject obj, jfieldID fid) {
+    jvalue result;
+    result.j = 0;
+    CHECK_IN_BATCH(GetField, env, result);
+    CHECK_NON_NULL_ARGUMENT(GetField, fid);
+    ScopedObjectAccess soa(env);
+    ArtField* f = soa.DecodeField(fid);
+    Object* o = f->IsStatic() ? f->GetDeclaringClass() : soa.Decode<Object*>(obj);
+    switch (FieldHelper(f).GetTypeAsPrimitiveType()) {
+      case Primitive::kPrimNot:
+        result.l = soa.AddLocalReference<jobject>(f->GetObject(o));
+        break;
+      case Primitive::kPrimBoolean: result.z = f->GetBoolean(o); break;
+      case Primitive::kPrimByte:    result.b = f->GetByte(o); break;
+      case Primitive::kPrimChar:    result.c = f->GetChar(o); break;
+      case Primitive::kPrimShort:   result.s = f->GetShort(o); break;
+      case Primitive::kPrimInt:     result.i = f->GetInt(o); break;
+      case Primitive::kPrimLong:    result.j = f->GetLong(o); break;
+      case Primitive::kPrimFloat:   result.f = f->GetFloat(o); break;
+      case Primitive::kPrimDouble:  result.d = f->GetDouble(o); break;
+      case Primitive::kPrimVoid:
+        LOG(FATAL) << "Unexpected void field " << PrettyField(f);
+        break;
+    }
+    return result;
+  }
+
+  static void SetField(JNIEnv* env, jobject obj, jfieldID fid, jvalue value) {
+    CHECK_IN_BATCH(SetField, env, );
+    CHECK_NON_NULL_ARGUMENT(SetField, fid);
+    ScopedObjectAccess soa(env);
+    ArtField* f = soa.DecodeField(fid);
+    Object* o = f->IsStatic() ? f->GetDeclaringClass() : soa.Decode<Object*>(obj);
+    switch (FieldHelper(f).GetTypeAsPrimitiveType()) {
+      case Primitive::kPrimNot:     f->SetObject(o, soa.Decode<Object*>(value.l)); break;
+      case Primitive::kPrimBoolean: f->SetBoolean(o, value.z); break;
+      case Primitive::kPrimByte:    f->SetByte(o, value.b); break;
+      case Primitive::kPrimChar:    f->SetChar(o, value.c); break;
+      case Primitive::kPrimShort:   f->SetShort(o, value.s); break;
+      case Primitive::kPrimInt:     f->SetInt(o, value.i); break;
+      case Primitive::kPrimLong:    f->SetLong(o, value.j); break;
+      case Primitive::kPrimFloat:   f->SetFloat(o, value.f); break;
+      case Primitive::kPrimDouble:  f->SetDouble(o, value.d); break;
+      case Primitive::kPrimVoid:
+        LOG(FATAL) << "Unexpected void field " << PrettyField(f);
+        break;
+    }
+  }
+
+ private:
+  static JValue Invoke(const ScopedObjectAccess& soa, jobject obj, ArtMethod* method,
+                       MethodHelper& mh, const jvalue* args)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    Object* receiver = NULL;
+    if (!method->IsStatic()) {
+      receiver = soa.Decode<Object*>(obj);
+      method = FindVirtualMethod(receiver, method);
+      mh.ChangeMethod(method);
+    }
+    JValue result;
+    ArgArray arg_array(mh.GetShorty(), mh.GetShortyLength());
+    arg_array.BuildArgArray(soa, receiver, const_cast<jvalue*>(args));
+    InvokeWithArgArray(soa, method, &arg_array, &result, mh.GetShorty()[0]);
+    return result;
+  }
+
+  static jvalue ToJValue(const ScopedObjectAccess& soa, char type, const JValue& value)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    jvalue result;
+    result.j = 0;
+    switch (type) {
+      case 'L': result.l = soa.AddLocalReference<jobject>(value.GetL()); break;
+      case 'Z': result.z = value.GetZ(); break;
+      case 'B': result.b = value.GetB(); break;
+      case 'C': result.c = value.GetC(); break;
+      case 'S': result.s = value.GetS(); break;
+      case 'I': result.i = value.GetI(); break;
+      case 'J': result.j = value.GetJ(); break;
+      case 'F': result.f = value.GetF(); break;
+      case 'D': result.d = value.GetD(); break;
+      case 'V': break;
+      default:
+        LOG(FATAL) << "Unexpected return type " << type;
+    }
+    return result;
+  }
+};
+
+#undef CHECK_IN_BATCH
+
+const JNIBatchInterface gJniBatchInterface = {
+  JNIBatch::BeginBatch,
+  JNIBatch::EndBatch,
+  JNIBatch::ReleaseBatchLocals,
+  JNIBatch::CallMethodA,
+  JNIBatch::CallMethodBatchA,
+  JNIBatch::GetField,
+  JNIBatch::SetField,
+};
+
 JNIEnvExt::JNIEnvExt(Thread* self, JavaVMExt* vm)
     : self(self),
       vm(vm),
@@ -2904,6 +3266,7 @@ JNIEnvExt::JNIEnvExt(Thread* self, JavaVMExt* vm)
       locals(kLocalsInitial, kLocalsMax, kLocal),
       check_jni(false),
       critical(false),
+      in_batch(false),
       monitors("monitors", kMonitorsInitial, kMonitorsMax) {
   functions = unchecked_functions = &gJniNativeInterface;
   if (vm->check_jni) {
@@ -3036,6 +3399,14 @@ class JII {
     // GetEnv always returns a JNIEnv* for the most current supported JNI version,
     // and unlike other calls that take a JNI version doesn't care if you supply
     // JNI_VERSION_1_1, which we don't otherwise support.
+    if (version == JNI_BATCH_VERSION) {
+      // The batch extension table is shared by all threads; see jni_batch.h.
+      if (env == NULL) {
+        return JNI_ERR;
+      }
+      *env = const_cast<JNIBatchInterface*>(&gJniBatchInterface);
+      return JNI_OK;
+    }
     if (IsBadJniVersion(version) && version != JNI_VERSION_1_1) {
       LOG(ERROR) << "Bad JNI version passed to GetEnv: " << version;
       return JNI_EVERSION;
@@ -3075,11 +3446,12 @@ JavaVMExt::JavaVMExt(Runtime* runtime, Runtime::ParsedOptions* options)
       pins_lock("JNI pin table lock", kPinTableLock),
       pin_table("pin table", kPinTableInitial, kPinTableMax),
       globals_lock("JNI global reference table lock"),
-      globals(gGlobalsInitial, gGlobalsMax, kGlobal),
+      globals(kGlobalsInitial, kGlobalsMax, kGlobal, options->jni_globals_soft_limit_),
       libraries_lock("JNI shared libraries map lock", kLoadLibraryLock),
       libraries(new Libraries),
       weak_globals_lock_("JNI weak global reference table lock"),
-      weak_globals_(kWeakGlobalsInitial, kWeakGlobalsMax, kWeakGlobal),
+      weak_globals_(kWeakGlobalsInitial, kWeakGlobalsMax, kWeakGlobal,
+                    options->jni_globals_soft_limit_),
       allow_new_weak_globals_(true),
       weak_globals_add_condition_("weak globals add condition", weak_globals_lock_) {
   functions = unchecked_functions = &gJniInvokeInterface;
@@ -3233,6 +3605,10 @@ bool JavaVMExt::LoadNativeLibrary(const std::string& path, ClassLoader* class_lo
   // want to switch from kRunnable while it executes.  This allows the GC to ignore us.
   self->TransitionFromRunnableToSuspended(kWaitingForJniOnLoad);
   void* handle = dlopen(path.empty() ? NULL : path.c_str(), RTLD_LAZY);
+  // Index the JNI symbols while still suspended, reading the symbol table touches the file.
+  std::vector<uint32_t> jni_symbol_hashes;
+  bool has_jni_symbol_index =
+      handle != NULL && !path.empty() && BuildJniSymbolIndex(path, &jni_symbol_hashes);
   self->TransitionFromSuspendedToRunnable();
 
   VLOG(jni) << "[Call to dlopen(\"" << path << "\", RTLD_LAZY) returned " << handle << "]";
@@ -3251,6 +3627,9 @@ bool JavaVMExt::LoadNativeLibrary(const std::string& path, ClassLoader* class_lo
     library = libraries->Get(path);
     if (library == NULL) {  // We won race to get libraries_lock
       library = new SharedLibrary(path, handle, class_loader);
+      if (has_jni_symbol_index) {
+        library->SetJniSymbolIndex(&jni_symbol_hashes);
+      }
       libraries->Put(path, library);
       created_library = true;
     }
@@ -3365,6 +3744,34 @@ void JavaVMExt::VisitRoots(RootVisitor* visitor, void* arg) {
   // The weak_globals table is visited by the GC itself (because it mutates the table).
 }
 
+uint32_t GetNativeMethodOptimizationFlags(const DexFile& dex_file, uint16_t class_def_idx,
+                                          uint32_t method_idx, uint32_t access_flags) {
+  static const char* kFastNativeDescriptor = "Ldalvik/annotation/optimization/FastNative;";
+  static const char* kCriticalNativeDescriptor = "Ldalvik/annotation/optimization/CriticalNative;";
+  if ((access_flags & kAccNative) == 0) {
+    return 0;
+  }
+  const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
+  if (class_def.annotations_off_ == 0) {
+    return 0;
+  }
+  if (dex_file.IsMethodAnnotationPresent(class_def, method_idx, kCriticalNativeDescriptor)) {
+    // Without a JNIEnv* there is no way to pass or return references, and no way to lock.
+    const char* shorty = dex_file.GetMethodShorty(dex_file.GetMethodId(method_idx));
+    bool is_valid = (access_flags & (kAccStatic | kAccSynchronized)) == kAccStatic &&
+        strchr(shorty, 'L') == NULL;
+    if (is_valid) {
+      return kAccCriticalNative;
+    }
+    LOG(WARNING) << "Ignoring @CriticalNative on " << PrettyMethod(method_idx, dex_file)
+                 << ": method must be static, unsynchronized and take and return primitives only";
+  }
+  if (dex_file.IsMethodAnnotationPresent(class_def, method_idx, kFastNativeDescriptor)) {
+    return kAccFastNative;
+  }
+  return 0;
+}
+
 void RegisterNativeMethods(JNIEnv* env, const char* jni_class_name, const JNINativeMethod* methods,
                            jint method_count) {
   ScopedLocalRef<jclass> c(env, env->FindClass(jni_class_name));
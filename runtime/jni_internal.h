@@ -28,6 +28,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #ifndef NATIVE_METHOD
 #define NATIVE_METHOD(className, functionName, signature) \
@@ -43,6 +44,7 @@ namespace mirror {
   class ClassLoader;
 }  // namespace mirror
 class ArgArray;
+class DexFile;
 union JValue;
 class Libraries;
 class ScopedObjectAccess;
@@ -61,6 +63,18 @@ void InvokeWithArgArray(const ScopedObjectAccess& soa, mirror::ArtMethod* method
 
 int ThrowNewException(JNIEnv* env, jclass exception_class, const char* msg, jobject cause);
 
+// Returns the kAccFastNative/kAccCriticalNative bits requested by @FastNative or @CriticalNative
+// annotations on the given native method. Both the class linker and the JNI compiler use this so
+// that the compiled stub and the runtime agree on the calling convention.
+uint32_t GetNativeMethodOptimizationFlags(const DexFile& dex_file, uint16_t class_def_idx,
+                                          uint32_t method_idx, uint32_t access_flags);
+
+// Reads the dynamic symbol table of the library at path and records the ELF hashes of the JNI
+// symbols ("Java_...") it defines, sorted. Returns false if the library can't be parsed, e.g. it is
+// not a 32-bit little-endian shared library or its section headers are stripped, in which case
+// lookups in it always go to dlsym.
+bool BuildJniSymbolIndex(const std::string& path, std::vector<uint32_t>* hashes);
+
 class JavaVMExt : public JavaVM {
  public:
   JavaVMExt(Runtime* runtime, Runtime::ParsedOptions* options);
@@ -185,6 +199,9 @@ struct JNIEnvExt : public JNIEnv {
   // How many nested "critical" JNI calls are we in?
   int critical;
 
+  // Whether a JNIBatchInterface batch is open, keeping the thread runnable.
+  bool in_batch;
+
   // Entered JNI monitors, for bulk exit on thread detach.
   ReferenceTable monitors;
 
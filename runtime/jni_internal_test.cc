@@ -21,7 +21,9 @@
 #include <cmath>
 
 #include "common_test.h"
+#include "elf_file.h"
 #include "invoke_arg_array_builder.h"
+#include "jni_batch.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object_array-inl.h"
@@ -1375,8 +1377,7 @@ TEST_F(JniInternalTest, GetStringCritical_ReleaseStringCritical) {
 
   jboolean is_copy = JNI_FALSE;
   chars = env_->GetStringCritical(s, &is_copy);
-  // TODO: Fix GetStringCritical to use the same mechanism as GetPrimitiveArrayElementsCritical.
-  EXPECT_EQ(JNI_TRUE, is_copy);
+  EXPECT_EQ(JNI_FALSE, is_copy);
   EXPECT_EQ(expected[0], chars[0]);
   EXPECT_EQ(expected[1], chars[1]);
   EXPECT_EQ(expected[2], chars[2]);
@@ -1588,6 +1589,82 @@ TEST_F(JniInternalTest, PushLocalFrame_PopLocalFrame) {
   EXPECT_EQ(JNIInvalidRefType, env_->GetObjectRefType(inner2));
 }
 
+TEST_F(JniInternalTest, JniBatch) {
+  JNIBatchInterface* batch = NULL;
+  ASSERT_EQ(JNI_OK, vm_->GetEnv(reinterpret_cast<void**>(&batch), JNI_BATCH_VERSION));
+  ASSERT_TRUE(batch != NULL);
+
+  jclass c = env_->FindClass("java/lang/String");
+  ASSERT_TRUE(c != NULL);
+  jfieldID count = env_->GetFieldID(c, "count", "I");
+  ASSERT_TRUE(count != NULL);
+  jstring s = env_->NewStringUTF("poop");
+  ASSERT_TRUE(s != NULL);
+
+  ASSERT_EQ(JNI_OK, batch->BeginBatch(env_, 4));
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  EXPECT_EQ(4, batch->GetField(env_, s, count).i);
+  // Regular JNI functions can be mixed in, and their locals are released with the batch's.
+  jobject inner = env_->NewLocalRef(s);
+  EXPECT_EQ(JNILocalRefType, env_->GetObjectRefType(inner));
+  batch->ReleaseBatchLocals(env_);
+  EXPECT_EQ(JNIInvalidRefType, env_->GetObjectRefType(inner));
+  batch->EndBatch(env_);
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+  EXPECT_EQ(JNILocalRefType, env_->GetObjectRefType(s));
+}
+
+TEST_F(JniInternalTest, JniBatch_Invoke) {
+  TEST_DISABLED_FOR_PORTABLE();
+  JNIBatchInterface* batch = NULL;
+  ASSERT_EQ(JNI_OK, vm_->GetEnv(reinterpret_cast<void**>(&batch), JNI_BATCH_VERSION));
+  ASSERT_TRUE(batch != NULL);
+
+  Thread* self = Thread::Current();
+  {
+    ScopedObjectAccess soa(self);
+    jobject jclass_loader = LoadDex("StaticLeafMethods");
+    SirtRef<mirror::ClassLoader>
+        class_loader(self, soa.Decode<mirror::ClassLoader*>(jclass_loader));
+    CompileDirectMethod(class_loader, "StaticLeafMethods", "sum", "(II)I");
+    CompileDirectMethod(class_loader, "StaticLeafMethods", "add", "(I)V");
+  }
+  // Start the runtime so that the batched calls are really invoked.
+  self->TransitionFromSuspendedToRunnable();
+  bool started = runtime_->Start();
+  CHECK(started);
+
+  jclass c = env_->FindClass("StaticLeafMethods");
+  ASSERT_TRUE(c != NULL);
+  jmethodID sum = env_->GetStaticMethodID(c, "sum", "(II)I");
+  ASSERT_TRUE(sum != NULL);
+  jmethodID add = env_->GetStaticMethodID(c, "add", "(I)V");
+  ASSERT_TRUE(add != NULL);
+  jfieldID total = env_->GetStaticFieldID(c, "total", "I");
+  ASSERT_TRUE(total != NULL);
+
+  ASSERT_EQ(JNI_OK, batch->BeginBatch(env_, 4));
+  jvalue args[3];
+  args[0].i = 2;
+  args[1].i = 3;
+  EXPECT_EQ(5, batch->CallMethodA(env_, NULL, sum, args).i);
+  EXPECT_FALSE(env_->ExceptionCheck());
+  // One argument per call.
+  args[0].i = 10;
+  args[1].i = 20;
+  args[2].i = 30;
+  EXPECT_EQ(3, batch->CallMethodBatchA(env_, NULL, add, 3, args, 1));
+  EXPECT_FALSE(env_->ExceptionCheck());
+  EXPECT_EQ(60, batch->GetField(env_, NULL, total).i);
+  jvalue value;
+  value.i = 100;
+  batch->SetField(env_, NULL, total, value);
+  EXPECT_EQ(1, batch->CallMethodBatchA(env_, NULL, add, 1, args, 1));
+  batch->EndBatch(env_);
+  EXPECT_EQ(kNative, self->GetState());
+  EXPECT_EQ(110, env_->GetStaticIntField(c, total));
+}
+
 TEST_F(JniInternalTest, NewGlobalRef_NULL) {
   EXPECT_TRUE(env_->NewGlobalRef(NULL) == NULL);
 }
@@ -1954,6 +2031,63 @@ TEST_F(JniInternalTest, MonitorEnterExit) {
   }
 }
 
+// Writes header, followed by an empty program header, to a file and indexes its JNI symbols.
+static bool BuildJniSymbolIndexForHeader(const llvm::ELF::Elf32_Ehdr& header) {
+  ScratchFile file;
+  llvm::ELF::Elf32_Phdr program_header;
+  memset(&program_header, 0, sizeof(program_header));
+  CHECK(file.GetFile()->WriteFully(&header, sizeof(header)));
+  CHECK(file.GetFile()->WriteFully(&program_header, sizeof(program_header)));
+  std::vector<uint32_t> hashes;
+  bool indexed = BuildJniSymbolIndex(file.GetFilename(), &hashes);
+  EXPECT_TRUE(indexed || hashes.empty());
+  return indexed;
+}
+
+TEST_F(JniInternalTest, JniSymbolIndexSkipsUnsupportedLibraries) {
+  // The header of a 32-bit little-endian shared library whose section headers are stripped.
+  llvm::ELF::Elf32_Ehdr header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.e_ident, llvm::ELF::ElfMagic, strlen(llvm::ELF::ElfMagic));
+  header.e_ident[llvm::ELF::EI_CLASS] = llvm::ELF::ELFCLASS32;
+  header.e_ident[llvm::ELF::EI_DATA] = llvm::ELF::ELFDATA2LSB;
+  header.e_ident[llvm::ELF::EI_VERSION] = llvm::ELF::EV_CURRENT;
+  header.e_type = llvm::ELF::ET_DYN;
+  header.e_version = llvm::ELF::EV_CURRENT;
+  header.e_ehsize = sizeof(header);
+  header.e_phoff = sizeof(header);
+  header.e_phentsize = sizeof(llvm::ELF::Elf32_Phdr);
+  header.e_phnum = 1;
+  EXPECT_FALSE(BuildJniSymbolIndexForHeader(header));
+
+  // Section headers past the end of the file.
+  llvm::ELF::Elf32_Ehdr truncated(header);
+  truncated.e_shoff = sizeof(header) + sizeof(llvm::ELF::Elf32_Phdr);
+  truncated.e_shentsize = sizeof(llvm::ELF::Elf32_Shdr);
+  truncated.e_shnum = 16;
+  truncated.e_shstrndx = 1;
+  EXPECT_FALSE(BuildJniSymbolIndexForHeader(truncated));
+
+  // Libraries ElfFile can't read: ELF64, big-endian or with an entry point.
+  llvm::ELF::Elf32_Ehdr elf64(truncated);
+  elf64.e_ident[llvm::ELF::EI_CLASS] = llvm::ELF::ELFCLASS64;
+  EXPECT_FALSE(BuildJniSymbolIndexForHeader(elf64));
+  llvm::ELF::Elf32_Ehdr big_endian(truncated);
+  big_endian.e_ident[llvm::ELF::EI_DATA] = llvm::ELF::ELFDATA2MSB;
+  EXPECT_FALSE(BuildJniSymbolIndexForHeader(big_endian));
+  llvm::ELF::Elf32_Ehdr with_entry(truncated);
+  with_entry.e_entry = 0x1000;
+  EXPECT_FALSE(BuildJniSymbolIndexForHeader(with_entry));
+
+  // Not ELF at all.
+  llvm::ELF::Elf32_Ehdr not_elf(truncated);
+  not_elf.e_ident[llvm::ELF::EI_MAG0] = 'X';
+  EXPECT_FALSE(BuildJniSymbolIndexForHeader(not_elf));
+
+  std::vector<uint32_t> hashes;
+  EXPECT_FALSE(BuildJniSymbolIndex(android_data_ + "/does-not-exist.so", &hashes));
+}
+
 TEST_F(JniInternalTest, DetachCurrentThread) {
   CleanUpJniEnv();  // cleanup now so TearDown won't have junk from wrong JNIEnv
   jint ok = vm_->DetachCurrentThread();
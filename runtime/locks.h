@@ -61,6 +61,7 @@ enum LockLevel {
   kMonitorLock,
   kHeapBitmapLock,
   kMutatorLock,
+  kAppImageLock,
   kZygoteCreationLock,
 
   kLockLevelCount  // Must come last.
@@ -316,8 +316,9 @@ extern "C" void art_work_around_app_jni_bugs(JNIEnv*, jobject);
 void ArtMethod::RegisterNative(Thread* self, const void* native_method, bool is_fast) {
   DCHECK(Thread::Current() == self);
   CHECK(IsNative()) << PrettyMethod(this);
-  CHECK(!IsFastNative()) << PrettyMethod(this);
   CHECK(native_method != NULL) << PrettyMethod(this);
+  // The fast flag is sticky: it may also have been set when loading a method annotated with
+  // @FastNative, in which case the compiled JNI stub already relies on it.
   if (!self->GetJniEnv()->vm->work_around_app_jni_bugs) {
     if (is_fast) {
       SetAccessFlags(GetAccessFlags() | kAccFastNative);
@@ -339,7 +340,7 @@ void ArtMethod::RegisterNative(Thread* self, const void* native_method, bool is_
 }
 
 void ArtMethod::UnregisterNative(Thread* self) {
-  CHECK(IsNative() && !IsFastNative()) << PrettyMethod(this);
+  CHECK(IsNative()) << PrettyMethod(this);
   // restore stub to lookup native pointer via dlsym
   RegisterNative(self, GetJniDlsymLookupStub(), false);
 }
@@ -117,6 +117,12 @@ class MANAGED ArtMethod : public Object {
     return (GetAccessFlags() & kAccFastNative) != 0;
   }
 
+  // A static native with only primitive arguments that is called without a JNIEnv* or jclass and
+  // without leaving the Runnable state.
+  bool IsCriticalNative() const {
+    return (GetAccessFlags() & kAccCriticalNative) != 0;
+  }
+
   bool IsAbstract() const {
     return (GetAccessFlags() & kAccAbstract) != 0;
   }
@@ -35,6 +35,7 @@
 #include "object-inl.h"
 #include "object_array-inl.h"
 #include "sirt_ref.h"
+#include "stack.h"
 #include "UniquePtr.h"
 
 namespace art {
@@ -86,6 +87,11 @@ TEST_F(ObjectTest, AsmConstants) {
 
   EXPECT_EQ(METHOD_DEX_CACHE_METHODS_OFFSET, ArtMethod::DexCacheResolvedMethodsOffset().Int32Value());
   EXPECT_EQ(METHOD_CODE_OFFSET, ArtMethod::EntryPointFromCompiledCodeOffset().Int32Value());
+
+  EXPECT_EQ(SHADOWFRAME_NUMBER_OF_VREGS_OFFSET,
+            static_cast<int>(ShadowFrame::NumberOfVRegsOffset()));
+  EXPECT_EQ(SHADOWFRAME_DEX_PC_OFFSET, static_cast<int>(ShadowFrame::DexPCOffset()));
+  EXPECT_EQ(SHADOWFRAME_VREGS_OFFSET, static_cast<int>(ShadowFrame::VRegsOffset()));
 }
 
 TEST_F(ObjectTest, IsInSamePackage) {
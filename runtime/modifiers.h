@@ -47,6 +47,7 @@ static const uint32_t kAccDeclaredSynchronized = 0x00020000;  // method (dex onl
 static const uint32_t kAccClassIsProxy = 0x00040000;  // class (dex only)
 static const uint32_t kAccPreverified = 0x00080000;  // method (dex only)
 static const uint32_t kAccFastNative = 0x0080000;  // method (dex only)
+static const uint32_t kAccCriticalNative = 0x00100000;  // method (runtime)
 
 // Special runtime-only flags.
 // Note: if only kAccClassIsReference is set, we have a soft reference.
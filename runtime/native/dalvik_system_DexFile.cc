@@ -20,6 +20,7 @@
 #include "class_linker.h"
 #include "common_throws.h"
 #include "dex_file-inl.h"
+#include "gc/heap.h"
 #include "gc/space/image_space.h"
 #include "gc/space/space-inl.h"
 #include "image.h"
@@ -165,12 +166,20 @@ static jclass DexFile_defineClassNative(JNIEnv* env, jclass, jstring javaName, j
     VLOG(class_linker) << "Failed to find dex_class_def";
     return NULL;
   }
-  ScopedObjectAccess soa(env);
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  // Installing an app image suspends all threads, so it is done before becoming runnable.
+  bool from_app_image = class_linker->InstallAppImage(*dex_file, javaLoader);
+  ScopedObjectAccess soa(env);
   class_linker->RegisterDexFile(*dex_file);
   SirtRef<mirror::ClassLoader> class_loader(soa.Self(), soa.Decode<mirror::ClassLoader*>(javaLoader));
-  mirror::Class* result = class_linker->DefineClass(descriptor.c_str(), class_loader, *dex_file,
-                                                    *dex_class_def);
+  mirror::Class* result = NULL;
+  if (from_app_image) {
+    result = class_linker->LookupClass(descriptor.c_str(), class_loader.get());
+  }
+  if (result == NULL) {
+    result = class_linker->DefineClass(descriptor.c_str(), class_loader, *dex_file,
+                                       *dex_class_def);
+  }
   VLOG(class_linker) << "DexFile_defineClassNative returning " << result;
   return soa.AddLocalReference<jclass>(result);
 }
@@ -273,30 +282,23 @@ static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename
     return JNI_TRUE;
   }
 
-  for (const auto& space : runtime->GetHeap()->GetContinuousSpaces()) {
-    if (space->IsImageSpace()) {
-      // TODO: Ensure this works with multiple image spaces.
-      const ImageHeader& image_header = space->AsImageSpace()->GetImageHeader();
-      if (oat_file->GetOatHeader().GetImageFileLocationOatChecksum() !=
-          image_header.GetOatChecksum()) {
-        if (kDebugLogging) {
-          ScopedObjectAccess soa(env);
-          LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
-              << " has out-of-date oat checksum compared to "
-              << image_header.GetImageRoot(ImageHeader::kOatLocation)->AsString()->ToModifiedUtf8();
-        }
-        return JNI_TRUE;
+  gc::Heap* heap = runtime->GetHeap();
+  if (heap->HasImageSpace()) {
+    if (oat_file->GetOatHeader().GetImageFileLocationOatChecksum() !=
+        heap->GetBootImageChecksum()) {
+      if (kDebugLogging) {
+        LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
+            << " has out-of-date oat checksum compared to the boot image";
       }
-      if (oat_file->GetOatHeader().GetImageFileLocationOatDataBegin()
-          != reinterpret_cast<uint32_t>(image_header.GetOatDataBegin())) {
-        if (kDebugLogging) {
-          ScopedObjectAccess soa(env);
-          LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
-              << " has out-of-date oat begin compared to "
-              << image_header.GetImageRoot(ImageHeader::kOatLocation)->AsString()->ToModifiedUtf8();
-        }
-        return JNI_TRUE;
+      return JNI_TRUE;
+    }
+    if (oat_file->GetOatHeader().GetImageFileLocationOatDataBegin() !=
+        heap->GetBootImageOatDataBegin()) {
+      if (kDebugLogging) {
+        LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
+            << " has out-of-date oat begin compared to the boot image";
       }
+      return JNI_TRUE;
     }
   }
 
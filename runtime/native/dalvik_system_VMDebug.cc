@@ -20,6 +20,7 @@
 #include "class_linker.h"
 #include "common_throws.h"
 #include "debugger.h"
+#include "gc/heap_histogram.h"
 #include "gc/space/bump_pointer_space.h"
 #include "gc/space/dlmalloc_space.h"
 #include "gc/space/large_object_space.h"
@@ -27,6 +28,7 @@
 #include "hprof/hprof.h"
 #include "jni_internal.h"
 #include "mirror/class.h"
+#include "ScopedLocalRef.h"
 #include "ScopedUtfChars.h"
 #include "scoped_thread_state_change.h"
 #include "toStringArray.h"
@@ -241,6 +243,19 @@ static jlong VMDebug_countInstancesOfClass(JNIEnv* env, jclass, jclass javaClass
   return count;
 }
 
+// Returns the histogram of the whole heap in the compact form of gc::HeapHistogram::Encode.
+static jbyteArray VMDebug_getHeapHistogram(JNIEnv* env, jclass) {
+  gc::HeapHistogram histogram;
+  Runtime::Current()->GetHeap()->ComputeHistogram(&histogram);
+  std::vector<uint8_t> data;
+  histogram.Encode(&data);
+  jbyteArray result = env->NewByteArray(data.size());
+  if (result != NULL && !data.empty()) {
+    env->SetByteArrayRegion(result, 0, data.size(), reinterpret_cast<const jbyte*>(&data[0]));
+  }
+  return result;
+}
+
 // We export the VM internal per-heap-space size/alloc/free metrics
 // for the zygote space, alloc space (application heap), and the large
 // object space for dumpsys meminfo. The other memory region data such
@@ -334,8 +349,27 @@ static JNINativeMethod gMethods[] = {
   NATIVE_METHOD(VMDebug, threadCpuTimeNanos, "()J"),
 };
 
+// Natives that only newer class libraries declare. Registering a native without a declaration
+// aborts, so they are registered only if VMDebug declares them.
+static JNINativeMethod gOptionalMethods[] = {
+  NATIVE_METHOD(VMDebug, getHeapHistogram, "()[B"),
+};
+
 void register_dalvik_system_VMDebug(JNIEnv* env) {
   REGISTER_NATIVE_METHODS("dalvik/system/VMDebug");
+  ScopedLocalRef<jclass> c(env, env->FindClass("dalvik/system/VMDebug"));
+  for (size_t i = 0; i < arraysize(gOptionalMethods); ++i) {
+    bool declared;
+    {
+      ScopedObjectAccess soa(env);
+      mirror::Class* klass = soa.Decode<mirror::Class*>(c.get());
+      declared = klass->FindDirectMethod(gOptionalMethods[i].name,
+                                         gOptionalMethods[i].signature) != NULL;
+    }
+    if (declared) {
+      RegisterNativeMethods(env, "dalvik/system/VMDebug", &gOptionalMethods[i], 1);
+    }
+  }
 }
 
 }  // namespace art
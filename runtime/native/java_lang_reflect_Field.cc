@@ -27,18 +27,34 @@
 
 namespace art {
 
-static bool GetFieldValue(const ScopedFastNativeObjectAccess& soa, mirror::Object* o,
-                          mirror::ArtField* f, JValue& value, bool allow_references)
+// Ensures the field's declaring class is initialized, updating 'o' should initialization move it.
+// Already initialized classes, the common case, don't need the SIRT round trip.
+static bool EnsureDeclaringClassInitialized(const ScopedFastNativeObjectAccess& soa,
+                                            mirror::ArtField* f, mirror::Object*& o)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  DCHECK_EQ(value.GetJ(), 0LL);
   CHECK(!kMovingFields);
+  mirror::Class* declaring_class = f->GetDeclaringClass();
+  if (LIKELY(declaring_class->IsInitialized())) {
+    return true;
+  }
   SirtRef<mirror::Object> sirt_obj(soa.Self(), o);
-  SirtRef<mirror::Class> sirt_klass(soa.Self(), f->GetDeclaringClass());
+  SirtRef<mirror::Class> sirt_klass(soa.Self(), declaring_class);
   if (!Runtime::Current()->GetClassLinker()->EnsureInitialized(sirt_klass, true, true)) {
     return false;
   }
   o = sirt_obj.get();
-  switch (FieldHelper(f).GetTypeAsPrimitiveType()) {
+  return true;
+}
+
+static bool GetFieldValue(const ScopedFastNativeObjectAccess& soa, mirror::Object* o,
+                          mirror::ArtField* f, Primitive::Type field_type, JValue& value,
+                          bool allow_references)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  DCHECK_EQ(value.GetJ(), 0LL);
+  if (!EnsureDeclaringClassInitialized(soa, f, o)) {
+    return false;
+  }
+  switch (field_type) {
   case Primitive::kPrimBoolean:
     value.SetZ(f->GetBoolean(o));
     return true;
@@ -105,12 +121,12 @@ static jobject Field_get(JNIEnv* env, jobject javaField, jobject javaObj) {
   }
 
   // Get the field's value, boxing if necessary.
+  Primitive::Type field_type = FieldHelper(f).GetTypeAsPrimitiveType();
   JValue value;
-  if (!GetFieldValue(soa, o, f, value, true)) {
+  if (!GetFieldValue(soa, o, f, field_type, value, true)) {
     return NULL;
   }
-  return
-      soa.AddLocalReference<jobject>(BoxPrimitive(FieldHelper(f).GetTypeAsPrimitiveType(), value));
+  return soa.AddLocalReference<jobject>(BoxPrimitive(field_type, value));
 }
 
 static JValue GetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj,
@@ -123,17 +139,19 @@ static JValue GetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj,
   }
 
   // Read the value.
+  Primitive::Type field_type = FieldHelper(f).GetTypeAsPrimitiveType();
   JValue field_value;
-  if (!GetFieldValue(soa, o, f, field_value, false)) {
+  if (!GetFieldValue(soa, o, f, field_type, field_value, false)) {
     return JValue();
   }
 
   // Widen it if necessary (and possible).
+  Primitive::Type dst_type = Primitive::GetType(dst_descriptor);
+  if (LIKELY(field_type == dst_type)) {
+    return field_value;
+  }
   JValue wide_value;
-  mirror::Class* dst_type =
-      Runtime::Current()->GetClassLinker()->FindPrimitiveClass(dst_descriptor);
-  if (!ConvertPrimitiveValue(NULL, false, FieldHelper(f).GetTypeAsPrimitiveType(),
-                             dst_type->GetPrimitiveType(), field_value, wide_value)) {
+  if (!ConvertPrimitiveValue(NULL, false, field_type, dst_type, field_value, wide_value)) {
     return JValue();
   }
   return wide_value;
@@ -172,16 +190,13 @@ static jshort Field_getShort(JNIEnv* env, jobject javaField, jobject javaObj) {
 }
 
 static void SetFieldValue(ScopedFastNativeObjectAccess& soa, mirror::Object* o,
-                          mirror::ArtField* f, const JValue& new_value, bool allow_references)
+                          mirror::ArtField* f, Primitive::Type field_type,
+                          const JValue& new_value, bool allow_references)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  CHECK(!kMovingFields);
-  SirtRef<mirror::Object> sirt_obj(soa.Self(), o);
-  SirtRef<mirror::Class> sirt_klass(soa.Self(), f->GetDeclaringClass());
-  if (!Runtime::Current()->GetClassLinker()->EnsureInitialized(sirt_klass, true, true)) {
+  if (!EnsureDeclaringClassInitialized(soa, f, o)) {
     return;
   }
-  o = sirt_obj.get();
-  switch (FieldHelper(f).GetTypeAsPrimitiveType()) {
+  switch (field_type) {
   case Primitive::kPrimBoolean:
     f->SetBoolean(o, new_value.GetZ());
     break;
@@ -230,11 +245,17 @@ static void Field_set(JNIEnv* env, jobject javaField, jobject javaObj, jobject j
   ScopedFastNativeObjectAccess soa(env);
   mirror::ArtField* f = soa.DecodeField(env->FromReflectedField(javaField));
 
-  // Unbox the value, if necessary.
+  // Unbox the value, if necessary. Boxes that exactly match a primitive field's type are read
+  // directly; anything else goes through the general conversion that resolves the field's type.
+  FieldHelper fh(f);
+  Primitive::Type field_type = fh.GetTypeAsPrimitiveType();
   mirror::Object* boxed_value = soa.Decode<mirror::Object*>(javaValue);
   JValue unboxed_value;
-  if (!UnboxPrimitiveForField(boxed_value, FieldHelper(f).GetType(), unboxed_value, f)) {
-    return;
+  if (field_type == Primitive::kPrimNot ||
+      !UnboxExactPrimitive(boxed_value, field_type, unboxed_value)) {
+    if (!UnboxPrimitiveForField(boxed_value, fh.GetType(), unboxed_value, f)) {
+      return;
+    }
   }
 
   // Check that the receiver is non-null and an instance of the field's declaring class.
@@ -243,7 +264,7 @@ static void Field_set(JNIEnv* env, jobject javaField, jobject javaObj, jobject j
     return;
   }
 
-  SetFieldValue(soa, o, f, unboxed_value, true);
+  SetFieldValue(soa, o, f, field_type, unboxed_value, true);
 }
 
 static void SetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj, char src_descriptor,
@@ -254,23 +275,23 @@ static void SetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj, c
   if (!CheckReceiver(soa, javaObj, f, o)) {
     return;
   }
-  FieldHelper fh(f);
-  if (!fh.IsPrimitiveType()) {
+  Primitive::Type field_type = FieldHelper(f).GetTypeAsPrimitiveType();
+  if (field_type == Primitive::kPrimNot) {
     ThrowIllegalArgumentException(NULL, StringPrintf("Not a primitive field: %s",
                                                      PrettyField(f).c_str()).c_str());
     return;
   }
 
   // Widen the value if necessary (and possible).
-  JValue wide_value;
-  mirror::Class* src_type = Runtime::Current()->GetClassLinker()->FindPrimitiveClass(src_descriptor);
-  if (!ConvertPrimitiveValue(NULL, false, src_type->GetPrimitiveType(), fh.GetTypeAsPrimitiveType(),
-                             new_value, wide_value)) {
+  Primitive::Type src_type = Primitive::GetType(src_descriptor);
+  JValue wide_value(new_value);
+  if (UNLIKELY(src_type != field_type) &&
+      !ConvertPrimitiveValue(NULL, false, src_type, field_type, new_value, wide_value)) {
     return;
   }
 
   // Write the value.
-  SetFieldValue(soa, o, f, wide_value, false);
+  SetFieldValue(soa, o, f, field_type, wide_value, false);
 }
 
 static void Field_setBoolean(JNIEnv* env, jobject javaField, jobject javaObj, jboolean z) {
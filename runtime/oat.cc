@@ -22,7 +22,7 @@
 namespace art {
 
 const uint8_t OatHeader::kOatMagic[] = { 'o', 'a', 't', '\n' };
-const uint8_t OatHeader::kOatVersion[] = { '0', '1', '2', '\0' };
+const uint8_t OatHeader::kOatVersion[] = { '0', '1', '6', '\0' };
 
 OatHeader::OatHeader() {
   memset(this, 0, sizeof(*this));
@@ -351,4 +351,23 @@ OatMethodOffsets::OatMethodOffsets(uint32_t code_offset,
 
 OatMethodOffsets::~OatMethodOffsets() {}
 
+OatDexCacheTable::OatDexCacheTable()
+  : num_strings_(0),
+    num_types_(0),
+    num_methods_(0),
+    num_fields_(0)
+{}
+
+OatDexCacheTable::OatDexCacheTable(uint32_t num_strings,
+                                   uint32_t num_types,
+                                   uint32_t num_methods,
+                                   uint32_t num_fields)
+  : num_strings_(num_strings),
+    num_types_(num_types),
+    num_methods_(num_methods),
+    num_fields_(num_fields)
+{}
+
+OatDexCacheTable::~OatDexCacheTable() {}
+
 }  // namespace art
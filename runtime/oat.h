@@ -151,6 +151,39 @@ class PACKED(4) OatMethodOffsets {
   uint32_t gc_map_offset_;
 };
 
+// Dex cache entries of an OatDexFile that resolve to objects of the boot image the oat file was
+// compiled against. The counts are followed by (dex index, object address) pairs: num_strings_
+// strings, then num_types_ types, num_methods_ methods and num_fields_ fields.
+class PACKED(4) OatDexCacheTable {
+ public:
+  OatDexCacheTable();
+
+  OatDexCacheTable(uint32_t num_strings,
+                   uint32_t num_types,
+                   uint32_t num_methods,
+                   uint32_t num_fields);
+
+  ~OatDexCacheTable();
+
+  uint32_t NumEntries() const {
+    return num_strings_ + num_types_ + num_methods_ + num_fields_;
+  }
+
+  // Size of the table including its entries.
+  size_t SizeOf() const {
+    return sizeof(*this) + NumEntries() * 2 * sizeof(uint32_t);
+  }
+
+  const uint32_t* GetEntries() const {
+    return reinterpret_cast<const uint32_t*>(this + 1);
+  }
+
+  uint32_t num_strings_;
+  uint32_t num_types_;
+  uint32_t num_methods_;
+  uint32_t num_fields_;
+};
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_OAT_H_
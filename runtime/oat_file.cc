@@ -278,6 +278,15 @@ bool OatFile::Setup(std::string* error_msg) {
       return false;
     }
 
+    uint32_t dex_cache_table_offset = *reinterpret_cast<const uint32_t*>(oat);
+    oat += sizeof(dex_cache_table_offset);
+    if (UNLIKELY(oat > End())) {
+      *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' truncated "
+                                " after dex cache table offset", GetLocation().c_str(), i,
+                                dex_file_location.c_str());
+      return false;
+    }
+
     const uint8_t* dex_file_pointer = Begin() + dex_file_offset;
     if (UNLIKELY(!DexFile::IsMagicValid(dex_file_pointer))) {
       *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with invalid "
@@ -302,11 +311,40 @@ bool OatFile::Setup(std::string* error_msg) {
       return false;
     }
 
+    const OatDexCacheTable* dex_cache_table = NULL;
+    if (dex_cache_table_offset != 0U) {
+      dex_cache_table = reinterpret_cast<const OatDexCacheTable*>(Begin() + dex_cache_table_offset);
+      if (UNLIKELY(dex_cache_table_offset + sizeof(OatDexCacheTable) > Size() ||
+                   dex_cache_table_offset + dex_cache_table->SizeOf() > Size())) {
+        *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with truncated "
+                                  " dex cache table", GetLocation().c_str(), i,
+                                  dex_file_location.c_str());
+        return false;
+      }
+      // The indexes are used unchecked when a dex cache is preloaded from the table.
+      const uint32_t limits[] = { header->string_ids_size_, header->type_ids_size_,
+                                  header->method_ids_size_, header->field_ids_size_ };
+      const uint32_t counts[] = { dex_cache_table->num_strings_, dex_cache_table->num_types_,
+                                  dex_cache_table->num_methods_, dex_cache_table->num_fields_ };
+      const uint32_t* entry = dex_cache_table->GetEntries();
+      for (size_t kind = 0; kind < arraysize(counts); ++kind) {
+        for (uint32_t j = 0; j < counts[kind]; ++j, entry += 2) {
+          if (UNLIKELY(entry[0] >= limits[kind])) {
+            *error_msg = StringPrintf("In oat file '%s' found OatDexFile #%zd for '%s' with dex "
+                                      "cache table index %u >= %u", GetLocation().c_str(), i,
+                                      dex_file_location.c_str(), entry[0], limits[kind]);
+            return false;
+          }
+        }
+      }
+    }
+
     oat_dex_files_.Put(dex_file_location, new OatDexFile(this,
                                                          dex_file_location,
                                                          dex_file_checksum,
                                                          dex_file_pointer,
-                                                         methods_offsets_pointer));
+                                                         methods_offsets_pointer,
+                                                         dex_cache_table));
   }
   return true;
 }
@@ -362,12 +400,14 @@ OatFile::OatDexFile::OatDexFile(const OatFile* oat_file,
                                 const std::string& dex_file_location,
                                 uint32_t dex_file_location_checksum,
                                 const byte* dex_file_pointer,
-                                const uint32_t* oat_class_offsets_pointer)
+                                const uint32_t* oat_class_offsets_pointer,
+                                const OatDexCacheTable* dex_cache_table)
     : oat_file_(oat_file),
       dex_file_location_(dex_file_location),
       dex_file_location_checksum_(dex_file_location_checksum),
       dex_file_pointer_(dex_file_pointer),
-      oat_class_offsets_pointer_(oat_class_offsets_pointer) {}
+      oat_class_offsets_pointer_(oat_class_offsets_pointer),
+      dex_cache_table_(dex_cache_table) {}
 
 OatFile::OatDexFile::~OatDexFile() {}
 
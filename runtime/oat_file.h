@@ -205,6 +205,11 @@ class OatFile {
     // Returns the OatClass for the class specified by the given DexFile class_def_index.
     const OatClass* GetOatClass(uint16_t class_def_index) const;
 
+    // Returns the dex cache entries resolved to boot image objects at compile time, or NULL.
+    const OatDexCacheTable* GetDexCacheTable() const {
+      return dex_cache_table_;
+    }
+
     ~OatDexFile();
 
    private:
@@ -212,13 +217,15 @@ class OatFile {
                const std::string& dex_file_location,
                uint32_t dex_file_checksum,
                const byte* dex_file_pointer,
-               const uint32_t* oat_class_offsets_pointer);
+               const uint32_t* oat_class_offsets_pointer,
+               const OatDexCacheTable* dex_cache_table);
 
     const OatFile* oat_file_;
     std::string dex_file_location_;
     uint32_t dex_file_location_checksum_;
     const byte* dex_file_pointer_;
     const uint32_t* oat_class_offsets_pointer_;
+    const OatDexCacheTable* dex_cache_table_;
 
     friend class OatFile;
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "page_in_profile.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "mem_map.h"
+#include "os.h"
+#include "thread-inl.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+PageInProfile::PageInProfile(const std::string& profile_file, uint64_t record_delay_ms)
+    : profile_file_(profile_file),
+      record_delay_ms_(record_delay_ms),
+      prefetched_bytes_(0),
+      prefetch_thread_started_(false),
+      recorder_thread_started_(false),
+      lock_("page-in profile lock"),
+      cond_("page-in profile condition variable", lock_),
+      needs_recording_(true),
+      shutting_down_(false) {
+  if (!OS::FileExists(profile_file_.c_str())) {
+    VLOG(startup) << "No page-in profile '" << profile_file_ << "', recording one";
+    return;
+  }
+  bool stale = false;
+  std::string error_msg;
+  if (!Load(&stale, &error_msg)) {
+    LOG(WARNING) << error_msg;
+    return;
+  }
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    needs_recording_ = stale;
+  }
+  if (!files_.empty()) {
+    CHECK_PTHREAD_CALL(pthread_create, (&prefetch_pthread_, NULL, &RunPrefetchThread, this),
+                       "page-in profile prefetch thread");
+    prefetch_thread_started_ = true;
+  }
+}
+
+PageInProfile::~PageInProfile() {
+  {
+    Thread* self = Thread::Current();
+    MutexLock mu(self, lock_);
+    shutting_down_ = true;
+    cond_.Broadcast(self);
+  }
+  if (recorder_thread_started_) {
+    CHECK_PTHREAD_CALL(pthread_join, (recorder_pthread_, NULL), "page-in profile shutdown");
+  }
+  WaitForPrefetch();
+}
+
+bool PageInProfile::IsProfiledFile(const std::string& path) {
+  return EndsWith(path, ".art") || EndsWith(path, ".oat") || EndsWith(path, ".odex") ||
+      EndsWith(path, ".dex") || EndsWith(path, ".jar") || EndsWith(path, ".apk");
+}
+
+void PageInProfile::MergeRanges(ProfiledFile* file) {
+  std::vector<std::pair<uint64_t, uint64_t> >& ranges = file->ranges;
+  std::sort(ranges.begin(), ranges.end());
+  size_t merged = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (merged != 0 && ranges[merged - 1].first + ranges[merged - 1].second >= ranges[i].first) {
+      uint64_t end = std::max(ranges[merged - 1].first + ranges[merged - 1].second,
+                              ranges[i].first + ranges[i].second);
+      ranges[merged - 1].second = end - ranges[merged - 1].first;
+    } else {
+      ranges[merged++] = ranges[i];
+    }
+  }
+  ranges.resize(merged);
+}
+
+bool PageInProfile::Load(bool* stale, std::string* error_msg) {
+  std::string contents;
+  if (!ReadFileToString(profile_file_, &contents)) {
+    *error_msg = StringPrintf("Failed to read page-in profile '%s'", profile_file_.c_str());
+    return false;
+  }
+  std::vector<std::string> lines;
+  Split(contents, '\n', lines);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    uint64_t size;
+    uint64_t offset;
+    uint64_t length;
+    int path_index = 0;
+    if (sscanf(lines[i].c_str(), "%" SCNu64 " %" SCNu64 " %" SCNu64 " %n",
+               &size, &offset, &length, &path_index) != 3 ||
+        path_index == 0 || lines[i][path_index] == '\0' ||
+        !IsAligned<kPageSize>(offset) || length == 0 || offset + length > size) {
+      *error_msg = StringPrintf("Malformed line %zd of page-in profile '%s': '%s'", i + 1,
+                                profile_file_.c_str(), lines[i].c_str());
+      files_.clear();
+      return false;
+    }
+    std::string path(lines[i].substr(path_index));
+    ProfiledFiles::iterator it = files_.find(path);
+    if (it == files_.end()) {
+      ProfiledFile file;
+      file.size = size;
+      files_.Put(path, file);
+      it = files_.find(path);
+    } else if (it->second.size != size) {
+      *error_msg = StringPrintf("Page-in profile '%s' records two sizes for '%s'",
+                                profile_file_.c_str(), path.c_str());
+      files_.clear();
+      return false;
+    }
+    it->second.ranges.push_back(std::make_pair(offset, length));
+  }
+  // A file that was rewritten since the profile was recorded, for example by dex2oat, makes its
+  // ranges meaningless. Drop it and record the profile again.
+  for (ProfiledFiles::iterator it = files_.begin(); it != files_.end(); ) {
+    struct stat sbuf;
+    if (stat(it->first.c_str(), &sbuf) != 0 ||
+        static_cast<uint64_t>(sbuf.st_size) != it->second.size) {
+      VLOG(startup) << "Page-in profile entries for '" << it->first << "' are out of date";
+      *stale = true;
+      files_.erase(it++);
+    } else {
+      MergeRanges(&it->second);
+      ++it;
+    }
+  }
+  return true;
+}
+
+void* PageInProfile::RunPrefetchThread(void* arg) {
+  reinterpret_cast<PageInProfile*>(arg)->Prefetch();
+  return NULL;
+}
+
+void PageInProfile::Prefetch() {
+  uint64_t start_ns = NanoTime();
+  for (ProfiledFiles::const_iterator it = files_.begin(); it != files_.end(); ++it) {
+    const std::string& path = it->first;
+    UniquePtr<File> file(OS::OpenFileForReading(path.c_str()));
+    if (file.get() == NULL) {
+      continue;
+    }
+    // Mapping the whole file lets one madvise per range start reading it into the page cache,
+    // where it stays for the mappings the runtime makes itself.
+    std::string error_msg;
+    UniquePtr<MemMap> map(MemMap::MapFile(it->second.size, PROT_READ, MAP_PRIVATE, file->Fd(), 0,
+                                          path.c_str(), &error_msg));
+    if (map.get() == NULL) {
+      LOG(WARNING) << "Failed to map '" << path << "' to read it ahead: " << error_msg;
+      continue;
+    }
+    const std::vector<std::pair<uint64_t, uint64_t> >& ranges = it->second.ranges;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      if (ranges[i].first >= map->Size()) {
+        break;
+      }
+      size_t length = std::min(ranges[i].second, map->Size() - ranges[i].first);
+      if (madvise(map->Begin() + ranges[i].first, length, MADV_WILLNEED) == -1) {
+        PLOG(WARNING) << "madvise failed on '" << path << "'";
+        break;
+      }
+      prefetched_bytes_ += length;
+    }
+  }
+  VLOG(startup) << "Read ahead " << PrettySize(prefetched_bytes_) << " of " << files_.size()
+                << " files from page-in profile '" << profile_file_ << "' in "
+                << PrettyDuration(NanoTime() - start_ns);
+}
+
+uint64_t PageInProfile::WaitForPrefetch() {
+  if (prefetch_thread_started_) {
+    CHECK_PTHREAD_CALL(pthread_join, (prefetch_pthread_, NULL), "page-in profile prefetch");
+    prefetch_thread_started_ = false;
+  }
+  return prefetched_bytes_;
+}
+
+bool PageInProfile::NeedsRecording() {
+  MutexLock mu(Thread::Current(), lock_);
+  return needs_recording_;
+}
+
+void PageInProfile::StartRecording() {
+  if (!NeedsRecording()) {
+    return;
+  }
+  CHECK(!recorder_thread_started_);
+  CHECK_PTHREAD_CALL(pthread_create, (&recorder_pthread_, NULL, &RunRecorderThread, this),
+                     "page-in profile recorder thread");
+  recorder_thread_started_ = true;
+}
+
+void PageInProfile::PreZygoteFork() {
+  WaitForPrefetch();
+  if (NeedsRecording()) {
+    std::string error_msg;
+    if (!Record(&error_msg)) {
+      LOG(WARNING) << error_msg;
+    }
+  }
+}
+
+void* PageInProfile::RunRecorderThread(void* arg) {
+  reinterpret_cast<PageInProfile*>(arg)->RunRecorder();
+  return NULL;
+}
+
+void PageInProfile::RunRecorder() {
+  // Not attached to the runtime, so self is NULL.
+  Thread* self = Thread::Current();
+  uint64_t deadline_ms = MilliTime() + record_delay_ms_;
+  {
+    MutexLock mu(self, lock_);
+    while (!shutting_down_) {
+      uint64_t now_ms = MilliTime();
+      if (now_ms >= deadline_ms) {
+        break;
+      }
+      cond_.TimedWait(self, deadline_ms - now_ms, 0);
+    }
+  }
+  std::string error_msg;
+  if (!Record(&error_msg)) {
+    LOG(WARNING) << error_msg;
+  }
+}
+
+bool PageInProfile::Record(std::string* error_msg) {
+  {
+    // Whatever the outcome, record at most once per process.
+    MutexLock mu(Thread::Current(), lock_);
+    needs_recording_ = false;
+  }
+  uint64_t start_ns = NanoTime();
+  std::string maps;
+  if (!ReadFileToString("/proc/self/maps", &maps)) {
+    *error_msg = StringPrintf("Failed to read /proc/self/maps: %s", strerror(errno));
+    return false;
+  }
+  std::vector<std::string> lines;
+  Split(maps, '\n', lines);
+  ProfiledFiles files;
+  std::vector<unsigned char> residency;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    // Each line reads "<begin>-<end> <perms> <offset> <dev> <inode> <path>".
+    uintptr_t begin;
+    uintptr_t end;
+    uint64_t offset;
+    int path_index = 0;
+    if (sscanf(lines[i].c_str(), "%" SCNxPTR "-%" SCNxPTR " %*s %" SCNx64 " %*s %*s %n",
+               &begin, &end, &offset, &path_index) != 3 || path_index == 0) {
+      continue;
+    }
+    std::string path(lines[i].substr(path_index));
+    if (!IsProfiledFile(path)) {
+      continue;
+    }
+    struct stat sbuf;
+    if (stat(path.c_str(), &sbuf) != 0) {
+      continue;
+    }
+    uint64_t file_size = sbuf.st_size;
+    size_t num_pages = (end - begin) / kPageSize;
+    residency.resize(num_pages);
+    if (mincore(reinterpret_cast<void*>(begin), end - begin, &residency[0]) == -1) {
+      PLOG(WARNING) << "mincore failed on mapping of '" << path << "'";
+      continue;
+    }
+    ProfiledFiles::iterator it = files.find(path);
+    if (it == files.end()) {
+      ProfiledFile file;
+      file.size = file_size;
+      files.Put(path, file);
+      it = files.find(path);
+    }
+    for (size_t page = 0; page < num_pages; ++page) {
+      uint64_t page_offset = offset + page * kPageSize;
+      if (page_offset >= file_size) {
+        break;
+      }
+      if ((residency[page] & 1) != 0) {
+        uint64_t length = std::min(static_cast<uint64_t>(kPageSize), file_size - page_offset);
+        it->second.ranges.push_back(std::make_pair(page_offset, length));
+      }
+    }
+  }
+
+  std::string contents;
+  uint64_t recorded_bytes = 0;
+  for (ProfiledFiles::iterator it = files.begin(); it != files.end(); ++it) {
+    MergeRanges(&it->second);
+    const std::vector<std::pair<uint64_t, uint64_t> >& ranges = it->second.ranges;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      StringAppendF(&contents, "%" PRIu64 " %" PRIu64 " %" PRIu64 " %s\n", it->second.size,
+                    ranges[i].first, ranges[i].second, it->first.c_str());
+      recorded_bytes += ranges[i].second;
+    }
+  }
+
+  // Write a private file and rename it so that concurrent starts never read a partial profile.
+  std::string temp_file(StringPrintf("%s.%d", profile_file_.c_str(), getpid()));
+  UniquePtr<File> file(OS::CreateEmptyFile(temp_file.c_str()));
+  if (file.get() == NULL) {
+    *error_msg = StringPrintf("Failed to create page-in profile '%s': %s", temp_file.c_str(),
+                              strerror(errno));
+    return false;
+  }
+  if (!file->WriteFully(contents.data(), contents.size()) || file->Close() != 0) {
+    *error_msg = StringPrintf("Failed to write page-in profile '%s': %s", temp_file.c_str(),
+                              strerror(errno));
+    unlink(temp_file.c_str());
+    return false;
+  }
+  if (rename(temp_file.c_str(), profile_file_.c_str()) != 0) {
+    *error_msg = StringPrintf("Failed to rename '%s' to '%s': %s", temp_file.c_str(),
+                              profile_file_.c_str(), strerror(errno));
+    unlink(temp_file.c_str());
+    return false;
+  }
+  VLOG(startup) << "Recorded " << PrettySize(recorded_bytes) << " of " << files.size()
+                << " files to page-in profile '" << profile_file_ << "' in "
+                << PrettyDuration(NanoTime() - start_ns);
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_PAGE_IN_PROFILE_H_
+#define ART_RUNTIME_PAGE_IN_PROFILE_H_
+
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+#include "base/mutex.h"
+#include "safe_map.h"
+
+namespace art {
+
+/*
+ * Records which pages of the image, oat and dex file mappings are resident once the runtime has
+ * started, and on the next start reads exactly those file ranges ahead on a background thread, so
+ * that the page faults of a cold start hit the page cache instead of storage.
+ *
+ * The profile is a text file of "<file size> <offset> <length> <path>" lines. It is only recorded
+ * when it is missing or names a file whose size has changed: sampling after a replay would also
+ * see every page the replay brought in.
+ */
+class PageInProfile {
+ public:
+  static const uint64_t kDefaultRecordDelayMs = 5000;
+
+  // Loads the profile and, if it is usable, starts reading its ranges ahead.
+  PageInProfile(const std::string& profile_file, uint64_t record_delay_ms);
+  ~PageInProfile();
+
+  // Starts a thread recording the profile after the delay, or at shutdown if that comes first.
+  void StartRecording() LOCKS_EXCLUDED(lock_);
+
+  // No thread may outlive the fork, so the zygote waits for the read ahead and records its
+  // profile synchronously.
+  void PreZygoteFork() LOCKS_EXCLUDED(lock_);
+
+  // Samples the profiled mappings of this process with mincore and writes the profile.
+  bool Record(std::string* error_msg) LOCKS_EXCLUDED(lock_);
+
+  bool NeedsRecording() LOCKS_EXCLUDED(lock_);
+
+  // Waits for the read ahead thread and returns the number of bytes it read ahead.
+  uint64_t WaitForPrefetch();
+
+  // Whether mappings of the given file are worth recording.
+  static bool IsProfiledFile(const std::string& path);
+
+ private:
+  struct ProfiledFile {
+    uint64_t size;
+    // Sorted, non-overlapping (offset, length) pairs.
+    std::vector<std::pair<uint64_t, uint64_t> > ranges;
+  };
+  typedef SafeMap<std::string, ProfiledFile> ProfiledFiles;
+
+  // Parses the profile, dropping the files that are missing or have changed size.
+  bool Load(bool* stale, std::string* error_msg);
+  void Prefetch();
+  void RunRecorder() LOCKS_EXCLUDED(lock_);
+  static void* RunPrefetchThread(void* arg);
+  static void* RunRecorderThread(void* arg);
+  static void MergeRanges(ProfiledFile* file);
+
+  const std::string profile_file_;
+  const uint64_t record_delay_ms_;
+
+  // Written before the read ahead thread starts and not modified afterwards.
+  ProfiledFiles files_;
+  uint64_t prefetched_bytes_;
+  pthread_t prefetch_pthread_;
+  bool prefetch_thread_started_;
+
+  pthread_t recorder_pthread_;
+  bool recorder_thread_started_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+  bool needs_recording_ GUARDED_BY(lock_);
+  bool shutting_down_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(PageInProfile);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_PAGE_IN_PROFILE_H_
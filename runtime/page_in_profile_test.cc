@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "page_in_profile.h"
+
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "common_test.h"
+#include "mem_map.h"
+#include "os.h"
+
+namespace art {
+
+class PageInProfileTest : public CommonTest {
+ protected:
+  static void WritePages(const std::string& filename, size_t num_pages) {
+    UniquePtr<File> file(OS::CreateEmptyFile(filename.c_str()));
+    ASSERT_TRUE(file.get() != NULL);
+    std::vector<byte> contents(num_pages * kPageSize, 42);
+    ASSERT_TRUE(file->WriteFully(&contents[0], contents.size()));
+    ASSERT_EQ(0, file->Close());
+  }
+};
+
+TEST_F(PageInProfileTest, IsProfiledFile) {
+  EXPECT_TRUE(PageInProfile::IsProfiledFile("/system/framework/boot.art"));
+  EXPECT_TRUE(PageInProfile::IsProfiledFile("/data/dalvik-cache/data@app@Foo.apk@classes.dex"));
+  EXPECT_TRUE(PageInProfile::IsProfiledFile("/system/framework/core-libart.jar"));
+  EXPECT_FALSE(PageInProfile::IsProfiledFile("/system/lib/libart.so"));
+  EXPECT_FALSE(PageInProfile::IsProfiledFile(""));
+}
+
+TEST_F(PageInProfileTest, RecordAndReplay) {
+  std::string dex_location(dalvik_cache_ + "/page_in_profile_test.dex");
+  std::string profile_location(dalvik_cache_ + "/page_in_profile_test.txt");
+  WritePages(dex_location, 3);
+
+  {
+    UniquePtr<File> file(OS::OpenFileForReading(dex_location.c_str()));
+    ASSERT_TRUE(file.get() != NULL);
+    std::string error_msg;
+    UniquePtr<MemMap> map(MemMap::MapFile(3 * kPageSize, PROT_READ, MAP_PRIVATE, file->Fd(), 0,
+                                          dex_location.c_str(), &error_msg));
+    ASSERT_TRUE(map.get() != NULL) << error_msg;
+    EXPECT_EQ(42, map->Begin()[2 * kPageSize]);
+
+    PageInProfile profile(profile_location, 0);
+    EXPECT_TRUE(profile.NeedsRecording());
+    EXPECT_EQ(0U, profile.WaitForPrefetch());
+    ASSERT_TRUE(profile.Record(&error_msg)) << error_msg;
+    EXPECT_FALSE(profile.NeedsRecording());
+  }
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(profile_location, &contents));
+  std::string expected(StringPrintf("%d 0 %d %s\n", 3 * kPageSize, 3 * kPageSize,
+                                    dex_location.c_str()));
+  EXPECT_NE(std::string::npos, contents.find(expected)) << contents;
+
+  {
+    PageInProfile profile(profile_location, 0);
+    EXPECT_FALSE(profile.NeedsRecording());
+    EXPECT_GE(profile.WaitForPrefetch(), 3U * kPageSize);
+  }
+
+  // Rewriting a profiled file makes the profile out of date.
+  WritePages(dex_location, 4);
+  {
+    PageInProfile profile(profile_location, 0);
+    EXPECT_TRUE(profile.NeedsRecording());
+  }
+}
+
+TEST_F(PageInProfileTest, MalformedProfile) {
+  std::string profile_location(dalvik_cache_ + "/page_in_profile_test.txt");
+  UniquePtr<File> file(OS::CreateEmptyFile(profile_location.c_str()));
+  ASSERT_TRUE(file.get() != NULL);
+  std::string contents("4096 1 4096 /system/framework/boot.oat\n");
+  ASSERT_TRUE(file->WriteFully(contents.data(), contents.size()));
+  ASSERT_EQ(0, file->Close());
+
+  PageInProfile profile(profile_location, 0);
+  EXPECT_TRUE(profile.NeedsRecording());
+  EXPECT_EQ(0U, profile.WaitForPrefetch());
+}
+
+}  // namespace art
@@ -115,6 +115,31 @@ class Primitive {
     }
   }
 
+  // Returns the descriptor of the java.lang class used to box values of the given type.
+  static const char* BoxedDescriptor(Type type) {
+    switch (type) {
+      case kPrimBoolean:
+        return "Ljava/lang/Boolean;";
+      case kPrimByte:
+        return "Ljava/lang/Byte;";
+      case kPrimChar:
+        return "Ljava/lang/Character;";
+      case kPrimShort:
+        return "Ljava/lang/Short;";
+      case kPrimInt:
+        return "Ljava/lang/Integer;";
+      case kPrimFloat:
+        return "Ljava/lang/Float;";
+      case kPrimLong:
+        return "Ljava/lang/Long;";
+      case kPrimDouble:
+        return "Ljava/lang/Double;";
+      default:
+        LOG(FATAL) << "Boxed descriptor of invalid type " << static_cast<int>(type);
+        return NULL;
+    }
+  }
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(Primitive);
 };
@@ -33,6 +33,67 @@
 
 namespace art {
 
+// Unboxes 'objects' straight into 'arg_array' as directed by the method's shorty, so that a
+// reflective call needs neither an intermediate jvalue[] nor local references for its arguments.
+// Reference parameter types must already be resolved, see InvokeMethod.
+static bool BuildArgArrayFromObjectArray(mirror::ArtMethod* m, MethodHelper& mh,
+                                         mirror::Object* receiver,
+                                         mirror::ObjectArray<mirror::Object>* objects,
+                                         ArgArray* arg_array)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const DexFile::TypeList* classes = mh.GetParameterTypeList();
+  const char* shorty = mh.GetShorty();
+  uint32_t shorty_len = mh.GetShortyLength();
+  // Set receiver if non-null (method is not static)
+  if (receiver != NULL) {
+    arg_array->Append(reinterpret_cast<int32_t>(receiver));
+  }
+  for (uint32_t i = 1, args_offset = 0; i < shorty_len; ++i, ++args_offset) {
+    mirror::Object* arg = objects->Get(args_offset);
+    JValue value;
+    if (shorty[i] == 'L') {
+      if (arg != NULL) {
+        mirror::Class* dst_class =
+            mh.GetClassFromTypeIdx(classes->GetTypeItem(args_offset).type_idx_);
+        if (!UnboxPrimitiveForArgument(arg, dst_class, value, m, args_offset)) {
+          return false;
+        }
+      }
+      arg_array->Append(reinterpret_cast<int32_t>(arg));
+      continue;
+    }
+    if (!UnboxExactPrimitive(arg, Primitive::GetType(shorty[i]), value)) {
+      mirror::Class* dst_class = Runtime::Current()->GetClassLinker()->FindPrimitiveClass(shorty[i]);
+      if (!UnboxPrimitiveForArgument(arg, dst_class, value, m, args_offset)) {
+        return false;
+      }
+    }
+    switch (shorty[i]) {
+      case 'Z':
+        arg_array->Append(value.GetZ());
+        break;
+      case 'B':
+        arg_array->Append(value.GetB());
+        break;
+      case 'C':
+        arg_array->Append(value.GetC());
+        break;
+      case 'S':
+        arg_array->Append(value.GetS());
+        break;
+      case 'I':
+      case 'F':
+        arg_array->Append(value.GetI());
+        break;
+      case 'D':
+      case 'J':
+        arg_array->AppendWide(value.GetJ());
+        break;
+    }
+  }
+  return true;
+}
+
 jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject javaReceiver,
                      jobject javaArgs) {
   jmethodID mid = soa.Env()->FromReflectedMethod(javaMethod);
@@ -47,17 +108,15 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
     declaring_class = sirt_c.get();
   }
 
-  mirror::Object* receiver = NULL;
   if (!m->IsStatic()) {
     // Check that the receiver is non-null and an instance of the field's declaring class.
-    receiver = soa.Decode<mirror::Object*>(javaReceiver);
+    mirror::Object* receiver = soa.Decode<mirror::Object*>(javaReceiver);
     if (!VerifyObjectInClass(receiver, declaring_class)) {
       return NULL;
     }
 
     // Find the actual implementation of the virtual method.
     m = receiver->GetClass()->FindVirtualMethodForVirtualOrInterface(m);
-    mid = soa.EncodeMethod(m);
   }
 
   // Get our arrays of arguments and their types, and check they're the same size.
@@ -74,22 +133,25 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
     return NULL;
   }
 
-  // Translate javaArgs to a jvalue[].
-  UniquePtr<jvalue[]> args(new jvalue[arg_count]);
-  JValue* decoded_args = reinterpret_cast<JValue*>(args.get());
-  for (uint32_t i = 0; i < arg_count; ++i) {
-    mirror::Object* arg = objects->Get(i);
-    mirror::Class* dst_class = mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_);
-    if (!UnboxPrimitiveForArgument(arg, dst_class, decoded_args[i], m, i)) {
+  // Resolve the reference parameter types up front: resolution may suspend, and the arguments
+  // are marshalled below as raw pointers.
+  const char* shorty = mh.GetShorty();
+  for (uint32_t i = 0; i < classes_size; ++i) {
+    if (shorty[i + 1] == 'L' &&
+        mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_) == NULL) {
       return NULL;
     }
-    if (!dst_class->IsPrimitive()) {
-      args[i].l = soa.AddLocalReference<jobject>(arg);
-    }
   }
 
-  // Invoke the method.
-  JValue value(InvokeWithJValues(soa, javaReceiver, mid, args.get()));
+  // Unbox javaArgs directly into the argument array and invoke the method.
+  ArgArray arg_array(shorty, mh.GetShortyLength());
+  mirror::Object* receiver = m->IsStatic() ? NULL : soa.Decode<mirror::Object*>(javaReceiver);
+  objects = soa.Decode<mirror::ObjectArray<mirror::Object>*>(javaArgs);
+  if (!BuildArgArrayFromObjectArray(m, mh, receiver, objects, &arg_array)) {
+    return NULL;
+  }
+  JValue value;
+  InvokeWithArgArray(soa, m, &arg_array, &value, shorty[0]);
 
   // Wrap any exception with "Ljava/lang/reflect/InvocationTargetException;" and return early.
   if (soa.Self()->IsExceptionPending()) {
@@ -102,8 +164,9 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
     return NULL;
   }
 
-  // Box if necessary and return.
-  return soa.AddLocalReference<jobject>(BoxPrimitive(mh.GetReturnType()->GetPrimitiveType(), value));
+  // Box if necessary and return. The shorty is enough to pick the box type, so there is no need
+  // to resolve the return type.
+  return soa.AddLocalReference<jobject>(BoxPrimitive(Primitive::GetType(shorty[0]), value));
 }
 
 bool VerifyObjectInClass(mirror::Object* o, mirror::Class* c) {
@@ -369,6 +432,49 @@ static bool UnboxPrimitive(const ThrowLocation* throw_location, mirror::Object*
                                boxed_value, unboxed_value);
 }
 
+bool UnboxExactPrimitive(mirror::Object* o, Primitive::Type dst_type, JValue& unboxed_value) {
+  DCHECK_NE(dst_type, Primitive::kPrimNot);
+  if (UNLIKELY(o == NULL)) {
+    return false;
+  }
+  // The box classes all live in the boot class path, so anything else can be rejected without
+  // looking at the descriptor.
+  mirror::Class* klass = o->GetClass();
+  if (klass->GetClassLoader() != NULL || klass->IsArrayClass() ||
+      strcmp(ClassHelper(klass).GetDescriptor(), Primitive::BoxedDescriptor(dst_type)) != 0) {
+    return false;
+  }
+  mirror::ArtField* primitive_field = klass->GetIFields()->Get(0);
+  switch (dst_type) {
+    case Primitive::kPrimBoolean:
+      unboxed_value.SetZ(primitive_field->GetBoolean(o));
+      return true;
+    case Primitive::kPrimByte:
+      unboxed_value.SetB(primitive_field->GetByte(o));
+      return true;
+    case Primitive::kPrimChar:
+      unboxed_value.SetC(primitive_field->GetChar(o));
+      return true;
+    case Primitive::kPrimShort:
+      unboxed_value.SetS(primitive_field->GetShort(o));
+      return true;
+    case Primitive::kPrimInt:
+      unboxed_value.SetI(primitive_field->GetInt(o));
+      return true;
+    case Primitive::kPrimFloat:
+      unboxed_value.SetF(primitive_field->GetFloat(o));
+      return true;
+    case Primitive::kPrimLong:
+      unboxed_value.SetJ(primitive_field->GetLong(o));
+      return true;
+    case Primitive::kPrimDouble:
+      unboxed_value.SetD(primitive_field->GetDouble(o));
+      return true;
+    default:
+      return false;
+  }
+}
+
 bool UnboxPrimitiveForArgument(mirror::Object* o, mirror::Class* dst_class, JValue& unboxed_value,
                                mirror::ArtMethod* m, size_t index) {
   CHECK(m != NULL);
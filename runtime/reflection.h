@@ -42,6 +42,11 @@ bool UnboxPrimitiveForField(mirror::Object* o, mirror::Class* dst_class, JValue&
 bool UnboxPrimitiveForResult(const ThrowLocation& throw_location, mirror::Object* o,
                              mirror::Class* dst_class, JValue& unboxed_value)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+// Unboxes 'o' if it is exactly the box type of 'dst_type'. Returns false without throwing when
+// a widening conversion or an error report is needed, in which case callers should fall back to
+// the UnboxPrimitiveFor* routines above.
+bool UnboxExactPrimitive(mirror::Object* o, Primitive::Type dst_type, JValue& unboxed_value)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
 bool ConvertPrimitiveValue(const ThrowLocation* throw_location, bool unbox_for_result,
                            Primitive::Type src_class, Primitive::Type dst_class,
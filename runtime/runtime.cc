@@ -28,6 +28,7 @@
 #include <limits>
 #include <vector>
 
+#include "alloc_sampler.h"
 #include "arch/arm/registers_arm.h"
 #include "arch/mips/registers_mips.h"
 #include "arch/x86/registers_x86.h"
@@ -51,6 +52,7 @@
 #include "mirror/throwable.h"
 #include "monitor.h"
 #include "oat_file.h"
+#include "page_in_profile.h"
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
 #include "signal_catcher.h"
@@ -82,6 +84,8 @@ Runtime::Runtime()
       intern_table_(NULL),
       class_linker_(NULL),
       signal_catcher_(NULL),
+      page_in_profile_(NULL),
+      alloc_sampler_(NULL),
       java_vm_(NULL),
       pre_allocated_OutOfMemoryError_(NULL),
       resolution_method_(NULL),
@@ -104,7 +108,8 @@ Runtime::Runtime()
       use_compile_time_class_path_(false),
       main_thread_group_(NULL),
       system_thread_group_(NULL),
-      system_class_loader_(NULL) {
+      system_class_loader_(NULL),
+      forked_heap_dump_(false) {
   for (int i = 0; i < Runtime::kLastCalleeSaveType; i++) {
     callee_save_methods_[i] = NULL;
   }
@@ -128,6 +133,13 @@ Runtime::~Runtime() {
     shutting_down_ = true;
   }
   Trace::Shutdown();
+  if (alloc_sampler_ != NULL) {
+    ScopedObjectAccess soa(self);
+    std::string error_msg;
+    if (!alloc_sampler_->Write(&error_msg)) {
+      LOG(ERROR) << error_msg;
+    }
+  }
 
   // Make sure to let the GC complete if it is running.
   heap_->WaitForGcToComplete(self);
@@ -136,9 +148,11 @@ Runtime::~Runtime() {
   // Make sure our internal threads are dead before we start tearing down things they're using.
   Dbg::StopJdwp();
   delete signal_catcher_;
+  delete page_in_profile_;
 
   // Make sure all other non-daemon threads have terminated, and all daemon threads are suspended.
   delete thread_list_;
+  delete alloc_sampler_;
   delete monitor_list_;
   delete class_linker_;
   delete heap_;
@@ -239,6 +253,9 @@ void Runtime::Abort() {
 }
 
 bool Runtime::PreZygoteFork() {
+  if (page_in_profile_ != NULL) {
+    page_in_profile_->PreZygoteFork();
+  }
   heap_->PreZygoteFork();
   return true;
 }
@@ -349,6 +366,7 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   }
   // -Xcheck:jni is off by default for regular builds but on by default in debug builds.
   parsed->check_jni_ = kIsDebugBuild;
+  parsed->jni_globals_soft_limit_ = 51200;
 
   parsed->heap_initial_size_ = gc::Heap::kDefaultInitialSize;
   parsed->heap_maximum_size_ = gc::Heap::kDefaultMaximumSize;
@@ -356,6 +374,7 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->heap_max_free_ = gc::Heap::kDefaultMaxFree;
   parsed->heap_target_utilization_ = gc::Heap::kDefaultTargetUtilization;
   parsed->heap_growth_limit_ = 0;  // 0 means no growth limit .
+  parsed->app_image_reservation_ = 0;  // 0 means no app images.
   // Default to number of processors minus one since the main GC thread also does work.
   parsed->parallel_gc_threads_ = sysconf(_SC_NPROCESSORS_CONF) - 1;
   // Only the main GC thread, no workers.
@@ -375,6 +394,7 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->long_pause_log_threshold_ = gc::Heap::kDefaultLongPauseLogThreshold;
   parsed->long_gc_log_threshold_ = gc::Heap::kDefaultLongGCLogThreshold;
   parsed->dump_gc_performance_on_shutdown_ = false;
+  parsed->forked_heap_dump_ = false;
   parsed->ignore_max_footprint_ = false;
 
   parsed->lock_profiling_threshold_ = 0;
@@ -404,10 +424,15 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
 //  gLogVerbosity.third_party_jni = true;  // TODO: don't check this in!
 //  gLogVerbosity.threads = true;  // TODO: don't check this in!
 
+  parsed->page_in_profile_delay_ms_ = PageInProfile::kDefaultRecordDelayMs;
+
   parsed->method_trace_ = false;
   parsed->method_trace_file_ = "/data/method-trace-file.bin";
   parsed->method_trace_file_size_ = 10 * MB;
 
+  parsed->alloc_sample_interval_ = 0;
+  parsed->alloc_sample_file_ = "/data/alloc-samples.txt";
+
   for (size_t i = 0; i < options.size(); ++i) {
     const std::string option(options[i].first);
     if (true && options[0].first == "-Xzygote") {
@@ -472,6 +497,18 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
         return NULL;
       }
       parsed->heap_growth_limit_ = size;
+    } else if (StartsWith(option, "-XX:AppImageReservation=")) {
+      size_t size = ParseMemoryOption(option.substr(strlen("-XX:AppImageReservation=")).c_str(),
+                                      kPageSize);
+      if (size == 0) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        // TODO: usage
+        LOG(FATAL) << "Failed to parse " << option;
+        return NULL;
+      }
+      parsed->app_image_reservation_ = size;
     } else if (StartsWith(option, "-XX:HeapMinFree=")) {
       size_t size = ParseMemoryOption(option.substr(strlen("-XX:HeapMinFree=")).c_str(), 1024);
       if (size == 0) {
@@ -537,6 +574,8 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
               ParseMemoryOption(option.substr(strlen("-XX:LongGCLogThreshold")).c_str(), 1024);
     } else if (option == "-XX:DumpGCPerformanceOnShutdown") {
       parsed->dump_gc_performance_on_shutdown_ = true;
+    } else if (option == "-XX:ForkedHeapDump") {
+      parsed->forked_heap_dump_ = true;
     } else if (option == "-XX:IgnoreMaxFootprint") {
       parsed->ignore_max_footprint_ = true;
     } else if (option == "-XX:LowMemoryMode") {
@@ -601,11 +640,16 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
         }
       }
     } else if (StartsWith(option, "-Xjnigreflimit:")) {
-      // Silently ignored for backwards compatibility.
+      // Global reference tables warn rather than abort when they reach this size.
+      parsed->jni_globals_soft_limit_ = ParseIntegerOrDie(option);
     } else if (StartsWith(option, "-Xlockprofthreshold:")) {
       parsed->lock_profiling_threshold_ = ParseIntegerOrDie(option);
     } else if (StartsWith(option, "-Xstacktracefile:")) {
       parsed->stack_trace_file_ = option.substr(strlen("-Xstacktracefile:"));
+    } else if (StartsWith(option, "-Xpageinprofile:")) {
+      parsed->page_in_profile_file_ = option.substr(strlen("-Xpageinprofile:"));
+    } else if (StartsWith(option, "-Xpageinprofiledelay:")) {
+      parsed->page_in_profile_delay_ms_ = ParseIntegerOrDie(option);
     } else if (option == "sensitiveThread") {
       parsed->hook_is_sensitive_thread_ = reinterpret_cast<bool (*)()>(const_cast<void*>(options[i].second));
     } else if (option == "vfprintf") {
@@ -625,6 +669,20 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
       parsed->method_trace_file_ = option.substr(strlen("-Xmethod-trace-file:"));
     } else if (StartsWith(option, "-Xmethod-trace-file-size:")) {
       parsed->method_trace_file_size_ = ParseIntegerOrDie(option);
+    } else if (StartsWith(option, "-Xalloc-sample-interval:")) {
+      size_t size =
+          ParseMemoryOption(option.substr(strlen("-Xalloc-sample-interval:")).c_str(), 1);
+      if (size == 0) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        // TODO: usage
+        LOG(FATAL) << "Failed to parse " << option;
+        return NULL;
+      }
+      parsed->alloc_sample_interval_ = size;
+    } else if (StartsWith(option, "-Xalloc-sample-file:")) {
+      parsed->alloc_sample_file_ = option.substr(strlen("-Xalloc-sample-file:"));
     } else if (option == "-Xprofile:threadcpuclock") {
       Trace::SetDefaultClockSource(kProfilerClockSourceThreadCpu);
     } else if (option == "-Xprofile:wallclock") {
@@ -779,6 +837,11 @@ bool Runtime::Start() {
 
   finished_starting_ = true;
 
+  // The zygote records its profile before it first forks instead.
+  if (page_in_profile_ != NULL && !is_zygote_) {
+    page_in_profile_->StartRecording();
+  }
+
   return true;
 }
 
@@ -827,6 +890,10 @@ bool Runtime::InitZygote() {
 void Runtime::DidForkFromZygote() {
   is_zygote_ = false;
 
+  if (alloc_sampler_ != NULL) {
+    alloc_sampler_->Reset();
+  }
+
   // Create the thread pool.
   heap_->CreateThreadPool();
 
@@ -905,6 +972,12 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   default_stack_size_ = options->stack_size_;
   stack_trace_file_ = options->stack_trace_file_;
 
+  // Start reading ahead before the heap maps the boot image and its oat files.
+  if (!options->page_in_profile_file_.empty()) {
+    page_in_profile_ = new PageInProfile(options->page_in_profile_file_,
+                                         options->page_in_profile_delay_ms_);
+  }
+
   max_spins_before_thin_lock_inflation_ = options->max_spins_before_thin_lock_inflation_;
 
   monitor_list_ = new MonitorList;
@@ -930,9 +1003,11 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
                        options->long_pause_log_threshold_,
                        options->long_gc_log_threshold_,
                        options->ignore_max_footprint_,
-                       options->use_tlab_);
+                       options->use_tlab_,
+                       options->app_image_reservation_);
 
   dump_gc_performance_on_shutdown_ = options->dump_gc_performance_on_shutdown_;
+  forked_heap_dump_ = options->forked_heap_dump_;
 
   BlockSignals();
   InitPlatformSignalHandlers();
@@ -975,6 +1050,12 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
                  false, false, 0);
   }
 
+  if (options->alloc_sample_interval_ != 0) {
+    alloc_sampler_ = new AllocationSampler(options->alloc_sample_interval_,
+                                           options->alloc_sample_file_);
+    GetInstrumentation()->InstrumentQuickAllocEntryPoints();
+  }
+
   // Pre-allocate an OutOfMemoryError for the double-OOME case.
   self->ThrowNewException(ThrowLocation(), "Ljava/lang/OutOfMemoryError;",
                           "OutOfMemoryError thrown while trying to throw OutOfMemoryError; no stack available");
@@ -1082,6 +1163,9 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   GetInternTable()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
+  if (alloc_sampler_ != NULL) {
+    alloc_sampler_->DumpForSigQuit(os);
+  }
   os << "\n";
 
   thread_list_->DumpForSigQuit(os);
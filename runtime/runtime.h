@@ -55,12 +55,14 @@ namespace mirror {
 namespace verifier {
 class MethodVerifier;
 }
+class AllocationSampler;
 class ClassLinker;
 class CompilerCallbacks;
 class DexFile;
 class InternTable;
 struct JavaVMExt;
 class MonitorList;
+class PageInProfile;
 class SignalCatcher;
 class ThreadList;
 class Trace;
@@ -101,6 +103,7 @@ class Runtime {
     std::string image_;
     bool check_jni_;
     std::string jni_trace_;
+    size_t jni_globals_soft_limit_;
     CompilerCallbacks* compiler_callbacks_;
     bool is_zygote_;
     bool interpreter_only_;
@@ -109,10 +112,12 @@ class Runtime {
     size_t long_pause_log_threshold_;
     size_t long_gc_log_threshold_;
     bool dump_gc_performance_on_shutdown_;
+    bool forked_heap_dump_;
     bool ignore_max_footprint_;
     size_t heap_initial_size_;
     size_t heap_maximum_size_;
     size_t heap_growth_limit_;
+    size_t app_image_reservation_;
     size_t heap_min_free_;
     size_t heap_max_free_;
     double heap_target_utilization_;
@@ -124,9 +129,13 @@ class Runtime {
     bool low_memory_mode_;
     size_t lock_profiling_threshold_;
     std::string stack_trace_file_;
+    std::string page_in_profile_file_;
+    uint64_t page_in_profile_delay_ms_;
     bool method_trace_;
     std::string method_trace_file_;
     size_t method_trace_file_size_;
+    size_t alloc_sample_interval_;
+    std::string alloc_sample_file_;
     bool (*hook_is_sensitive_thread_)();
     jint (*hook_vfprintf_)(FILE* stream, const char* format, va_list ap);
     void (*hook_exit_)(jint status);
@@ -164,6 +173,15 @@ class Runtime {
     return is_explicit_gc_disabled_;
   }
 
+  // Whether hprof file dumps are written by a forked child instead of with the world suspended.
+  bool UseForkedHeapDump() const {
+    return forked_heap_dump_;
+  }
+
+  void SetForkedHeapDump(bool forked_heap_dump) {
+    forked_heap_dump_ = forked_heap_dump;
+  }
+
 #ifdef ART_SEA_IR_MODE
   bool IsSeaIRMode() const {
     return sea_ir_mode_;
@@ -263,7 +281,7 @@ class Runtime {
   void DetachCurrentThread() LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   void DumpForSigQuit(std::ostream& os)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void DumpLockHolders(std::ostream& os);
 
   ~Runtime();
@@ -284,6 +302,10 @@ class Runtime {
     return default_stack_size_;
   }
 
+  AllocationSampler* GetAllocationSampler() const {
+    return alloc_sampler_;
+  }
+
   gc::Heap* GetHeap() const {
     return heap_;
   }
@@ -522,6 +544,12 @@ class Runtime {
   SignalCatcher* signal_catcher_;
   std::string stack_trace_file_;
 
+  // Reads the startup pages of mapped files ahead, or records them. NULL unless requested.
+  PageInProfile* page_in_profile_;
+
+  // Samples allocations with their stacks. NULL unless requested.
+  AllocationSampler* alloc_sampler_;
+
   JavaVMExt* java_vm_;
 
   mirror::Throwable* pre_allocated_OutOfMemoryError_;
@@ -584,6 +612,8 @@ class Runtime {
   // If true, then we dump the GC cumulative timings on shutdown.
   bool dump_gc_performance_on_shutdown_;
 
+  bool forked_heap_dump_;
+
   DISALLOW_COPY_AND_ASSIGN(Runtime);
 };
 
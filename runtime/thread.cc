@@ -43,6 +43,7 @@
 #include "gc/accounting/card_table-inl.h"
 #include "gc/heap.h"
 #include "gc/space/space.h"
+#include "interpreter/interpreter_cache.h"
 #include "invoke_arg_array_builder.h"
 #include "jni_internal.h"
 #include "mirror/art_field-inl.h"
@@ -932,7 +933,9 @@ Thread::Thread(bool daemon)
       thread_local_start_(nullptr),
       thread_local_pos_(nullptr),
       thread_local_end_(nullptr),
-      thread_local_objects_(0) {
+      thread_local_objects_(0),
+      interpreter_cache_(NULL),
+      alloc_sample_bytes_left_(0) {
   CHECK_EQ((sizeof(Thread) % 4), 0U) << sizeof(Thread);
   state_and_flags_.as_struct.flags = 0;
   state_and_flags_.as_struct.state = kNative;
@@ -1031,12 +1034,24 @@ Thread::~Thread() {
   delete instrumentation_stack_;
   delete name_;
   delete stack_trace_sample_;
+  delete interpreter_cache_;
 
   Runtime::Current()->GetHeap()->RevokeThreadLocalBuffers(this);
 
   TearDownAlternateSignalStack();
 }
 
+void Thread::AllocateInterpreterCache() {
+  DCHECK(interpreter_cache_ == NULL);
+  interpreter_cache_ = new interpreter::InterpreterCache;
+}
+
+void Thread::ClearInterpreterCache() {
+  if (interpreter_cache_ != NULL) {
+    interpreter_cache_->Clear();
+  }
+}
+
 void Thread::HandleUncaughtExceptions(ScopedObjectAccess& soa) {
   if (!IsExceptionPending()) {
     return;
@@ -1618,6 +1633,9 @@ static const EntryPointInfo gThreadEntryPointInfo[] = {
   QUICK_ENTRY_POINT_INFO(pJniMethodEndSynchronized),
   QUICK_ENTRY_POINT_INFO(pJniMethodEndWithReference),
   QUICK_ENTRY_POINT_INFO(pJniMethodEndWithReferenceSynchronized),
+  QUICK_ENTRY_POINT_INFO(pJniMethodFastStart),
+  QUICK_ENTRY_POINT_INFO(pJniMethodFastEnd),
+  QUICK_ENTRY_POINT_INFO(pJniMethodFastEndWithReference),
   QUICK_ENTRY_POINT_INFO(pLockObject),
   QUICK_ENTRY_POINT_INFO(pUnlockObject),
   QUICK_ENTRY_POINT_INFO(pCmpgDouble),
@@ -1644,6 +1662,7 @@ static const EntryPointInfo gThreadEntryPointInfo[] = {
   QUICK_ENTRY_POINT_INFO(pMemcmp16),
   QUICK_ENTRY_POINT_INFO(pStringCompareTo),
   QUICK_ENTRY_POINT_INFO(pMemcpy),
+  QUICK_ENTRY_POINT_INFO(pMemcpySwapped),
   QUICK_ENTRY_POINT_INFO(pQuickImtConflictTrampoline),
   QUICK_ENTRY_POINT_INFO(pQuickResolutionTrampoline),
   QUICK_ENTRY_POINT_INFO(pQuickToInterpreterBridge),
@@ -55,6 +55,9 @@ namespace mirror {
   class StaticStorageBase;
   class Throwable;
 }  // namespace mirror
+namespace interpreter {
+  class InterpreterCache;
+}  // namespace interpreter
 class BaseMutex;
 class ClassLinker;
 class Closure;
@@ -528,6 +531,18 @@ class PACKED(4) Thread {
     return instrumentation_stack_;
   }
 
+  // Lazily allocated since most threads never run interpreted code.
+  interpreter::InterpreterCache* GetInterpreterCache() {
+    if (UNLIKELY(interpreter_cache_ == NULL)) {
+      AllocateInterpreterCache();
+    }
+    return interpreter_cache_;
+  }
+
+  // Drops the entries of the interpreter cache. Called by moving collections with all threads
+  // suspended, since entries are keyed on receiver classes, which may move.
+  void ClearInterpreterCache();
+
   std::vector<mirror::ArtMethod*>* GetStackTraceSample() const {
     return stack_trace_sample_;
   }
@@ -815,6 +830,16 @@ class PACKED(4) Thread {
   void* rosalloc_runs_[kRosAllocNumOfSizeBrackets];
 
  private:
+  void AllocateInterpreterCache();
+
+  // Inline cache of the interpreter, see GetInterpreterCache.
+  interpreter::InterpreterCache* interpreter_cache_;
+
+  // Bytes left for this thread to allocate before the allocation sampler takes its next sample,
+  // or 0 before its first sampled allocation.
+  size_t alloc_sample_bytes_left_;
+
+  friend class AllocationSampler;  // For alloc_sample_bytes_left_.
   friend class Dbg;  // F or SetStateUnsafe.
   friend class Monitor;
   friend class MonitorInfo;
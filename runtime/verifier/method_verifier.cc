@@ -1580,7 +1580,8 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       break;
 
       /* could be boolean, int, float, or a null reference */
-    case Instruction::CONST_4: {
+    case Instruction::CONST_4:
+    case Instruction::CONST_4_ADD_INT: {
       int32_t val = static_cast<int32_t>(inst->VRegB_11n() << 28) >> 28;
       work_line_->SetRegisterType(inst->VRegA_11n(), reg_types_.FromCat1Const(val, true));
       break;
@@ -1988,6 +1989,7 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       VerifyAGet(inst, reg_types_.Short(), true);
       break;
     case Instruction::AGET:
+    case Instruction::AGET_ADD_INT:
       VerifyAGet(inst, reg_types_.Integer(), true);
       break;
     case Instruction::AGET_WIDE:
@@ -2528,14 +2530,19 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       break;
     // Note: the following instructions encode offsets derived from class linking.
     // As such they use Class*/Field*/AbstractMethod* as these offsets only have
-    // meaning if the class linking and resolution were successful.
+    // meaning if the class linking and resolution were successful. Superinstructions only
+    // rewrite the first opcode of their pair and are verified as that instruction.
     case Instruction::IGET_QUICK:
+    case Instruction::IGET_QUICK_IF_EQZ:
+    case Instruction::IGET_QUICK_IF_NEZ:
       VerifyIGetQuick(inst, reg_types_.Integer(), true);
       break;
     case Instruction::IGET_WIDE_QUICK:
       VerifyIGetQuick(inst, reg_types_.LongLo(), true);
       break;
     case Instruction::IGET_OBJECT_QUICK:
+    case Instruction::IGET_OBJECT_QUICK_IF_EQZ:
+    case Instruction::IGET_OBJECT_QUICK_IF_NEZ:
       VerifyIGetQuick(inst, reg_types_.JavaLangObject(false), false);
       break;
     case Instruction::IPUT_QUICK:
@@ -2574,12 +2581,6 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
     case Instruction::UNUSED_43:
     case Instruction::UNUSED_79:
     case Instruction::UNUSED_7A:
-    case Instruction::UNUSED_EB:
-    case Instruction::UNUSED_EC:
-    case Instruction::UNUSED_ED:
-    case Instruction::UNUSED_EE:
-    case Instruction::UNUSED_EF:
-    case Instruction::UNUSED_F0:
     case Instruction::UNUSED_F1:
     case Instruction::UNUSED_F2:
     case Instruction::UNUSED_F3:
@@ -3623,12 +3624,13 @@ static mirror::ArtField* FindInstanceFieldWithOffset(const mirror::Class* klass,
 // if it cannot be found.
 mirror::ArtField* MethodVerifier::GetQuickFieldAccess(const Instruction* inst,
                                                    RegisterLine* reg_line) {
-  DCHECK(inst->Opcode() == Instruction::IGET_QUICK ||
-         inst->Opcode() == Instruction::IGET_WIDE_QUICK ||
-         inst->Opcode() == Instruction::IGET_OBJECT_QUICK ||
-         inst->Opcode() == Instruction::IPUT_QUICK ||
-         inst->Opcode() == Instruction::IPUT_WIDE_QUICK ||
-         inst->Opcode() == Instruction::IPUT_OBJECT_QUICK);
+  Instruction::Code opcode = Instruction::UnfusedOpcode(inst->Opcode());
+  DCHECK(opcode == Instruction::IGET_QUICK ||
+         opcode == Instruction::IGET_WIDE_QUICK ||
+         opcode == Instruction::IGET_OBJECT_QUICK ||
+         opcode == Instruction::IPUT_QUICK ||
+         opcode == Instruction::IPUT_WIDE_QUICK ||
+         opcode == Instruction::IPUT_OBJECT_QUICK);
   const RegType& object_type = reg_line->GetRegisterType(inst->VRegB_22c());
   mirror::Class* object_class = NULL;
   if (!object_type.IsUnresolvedTypes()) {
@@ -27,6 +27,7 @@
 #include "base/stringprintf.h"
 #include "base/unix_file/fd_file.h"
 #include "UniquePtr.h"
+#include "utils.h"
 
 namespace art {
 
@@ -38,6 +39,19 @@ uint32_t ZipEntry::GetCrc32() {
   return zip_entry_->crc32;
 }
 
+off64_t ZipEntry::GetDataOffset() {
+  return zip_entry_->offset;
+}
+
+bool ZipEntry::IsUncompressed() {
+  return zip_entry_->method == kCompressStored;
+}
+
+bool ZipEntry::IsAlignedTo(size_t alignment) {
+  DCHECK(IsPowerOfTwo(alignment)) << alignment;
+  return (GetDataOffset() & (alignment - 1)) == 0;
+}
+
 
 bool ZipEntry::ExtractToFile(File& file, std::string* error_msg) {
   const int32_t error = ExtractEntryToFile(handle_, zip_entry_, file.Fd());
@@ -71,6 +85,39 @@ MemMap* ZipEntry::ExtractToMemMap(const char* entry_filename, std::string* error
   return map.release();
 }
 
+MemMap* ZipEntry::MapDirectlyFromFile(const char* zip_filename, const char* entry_filename,
+                                      std::string* error_msg) {
+  CHECK(IsUncompressed()) << entry_filename;
+  CHECK_EQ(zip_entry_->compressed_length, zip_entry_->uncompressed_length) << entry_filename;
+  std::string name(entry_filename);
+  name += " mapped directly in ";
+  name += zip_filename;
+  // MemMap takes care of the data not starting on a page boundary.
+  UniquePtr<MemMap> map(MemMap::MapFileAtAddress(NULL, GetUncompressedLength(), PROT_READ,
+                                                 MAP_PRIVATE, GetFileDescriptor(handle_),
+                                                 GetDataOffset(), false, name.c_str(),
+                                                 error_msg));
+  if (map.get() == nullptr) {
+    DCHECK(!error_msg->empty());
+    return nullptr;
+  }
+  return map.release();
+}
+
+MemMap* ZipEntry::MapDirectlyOrExtract(const char* zip_filename, const char* entry_filename,
+                                       size_t alignment, std::string* error_msg) {
+  if (IsUncompressed() && IsAlignedTo(alignment)) {
+    MemMap* map = MapDirectlyFromFile(zip_filename, entry_filename, error_msg);
+    if (map != nullptr) {
+      return map;
+    }
+    LOG(WARNING) << "Falling back to extracting '" << entry_filename << "' from '" << zip_filename
+                 << "': " << *error_msg;
+    error_msg->clear();
+  }
+  return ExtractToMemMap(entry_filename, error_msg);
+}
+
 static void SetCloseOnExec(int fd) {
   // This dance is more portable than Linux's O_CLOEXEC open(2) flag.
   int flags = fcntl(fd, F_GETFD);
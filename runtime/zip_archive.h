@@ -40,9 +40,24 @@ class ZipEntry {
   bool ExtractToFile(File& file, std::string* error_msg);
   MemMap* ExtractToMemMap(const char* entry_filename, std::string* error_msg);
 
+  // Maps a stored entry read-only straight from the zip file, so its pages are clean and shared
+  // through the page cache rather than inflated into private memory.
+  MemMap* MapDirectlyFromFile(const char* zip_filename, const char* entry_filename,
+                              std::string* error_msg);
+
+  // Maps the entry directly if it is stored uncompressed at an offset aligned to 'alignment',
+  // otherwise extracts it into memory.
+  MemMap* MapDirectlyOrExtract(const char* zip_filename, const char* entry_filename,
+                               size_t alignment, std::string* error_msg);
+
   uint32_t GetUncompressedLength();
   uint32_t GetCrc32();
 
+  // Offset of the entry's data from the start of the zip file.
+  off64_t GetDataOffset();
+  bool IsUncompressed();
+  bool IsAlignedTo(size_t alignment);
+
  private:
   ZipEntry(ZipArchiveHandle handle,
            ::ZipEntry* zip_entry) : handle_(handle), zip_entry_(zip_entry) {}
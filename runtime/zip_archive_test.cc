@@ -27,7 +27,67 @@
 
 namespace art {
 
-class ZipArchiveTest : public CommonTest {};
+class ZipArchiveTest : public CommonTest {
+ protected:
+  static void Append16(std::vector<uint8_t>* out, uint16_t value) {
+    out->push_back(value & 0xff);
+    out->push_back(value >> 8);
+  }
+
+  static void Append32(std::vector<uint8_t>* out, uint32_t value) {
+    Append16(out, value & 0xffff);
+    Append16(out, value >> 16);
+  }
+
+  // Writes a zip archive holding a single stored entry whose local header carries
+  // 'extra_length' bytes of padding, which decides the offset of the entry's data.
+  static void WriteStoredZip(File* file, const std::string& name,
+                             const std::vector<uint8_t>& contents, uint16_t extra_length) {
+    uint32_t crc = crc32(crc32(0L, Z_NULL, 0), &contents[0], contents.size());
+    std::vector<uint8_t> zip;
+    Append32(&zip, 0x04034b50);  // Local file header signature.
+    Append16(&zip, 10);  // Version needed to extract.
+    Append16(&zip, 0);  // Flags.
+    Append16(&zip, 0);  // Stored.
+    Append32(&zip, 0);  // Modification time and date.
+    Append32(&zip, crc);
+    Append32(&zip, contents.size());
+    Append32(&zip, contents.size());
+    Append16(&zip, name.size());
+    Append16(&zip, extra_length);
+    zip.insert(zip.end(), name.begin(), name.end());
+    zip.resize(zip.size() + extra_length, 0);
+    zip.insert(zip.end(), contents.begin(), contents.end());
+    uint32_t central_directory_offset = zip.size();
+    Append32(&zip, 0x02014b50);  // Central directory file header signature.
+    Append16(&zip, 10);  // Version made by.
+    Append16(&zip, 10);  // Version needed to extract.
+    Append16(&zip, 0);  // Flags.
+    Append16(&zip, 0);  // Stored.
+    Append32(&zip, 0);  // Modification time and date.
+    Append32(&zip, crc);
+    Append32(&zip, contents.size());
+    Append32(&zip, contents.size());
+    Append16(&zip, name.size());
+    Append16(&zip, 0);  // Extra field length.
+    Append16(&zip, 0);  // Comment length.
+    Append16(&zip, 0);  // Disk number start.
+    Append16(&zip, 0);  // Internal attributes.
+    Append32(&zip, 0);  // External attributes.
+    Append32(&zip, 0);  // Offset of the local header.
+    zip.insert(zip.end(), name.begin(), name.end());
+    uint32_t central_directory_size = zip.size() - central_directory_offset;
+    Append32(&zip, 0x06054b50);  // End of central directory signature.
+    Append16(&zip, 0);  // Number of this disk.
+    Append16(&zip, 0);  // Disk with the central directory.
+    Append16(&zip, 1);  // Entries on this disk.
+    Append16(&zip, 1);  // Total entries.
+    Append32(&zip, central_directory_size);
+    Append32(&zip, central_directory_offset);
+    Append16(&zip, 0);  // Comment length.
+    ASSERT_TRUE(file->WriteFully(&zip[0], zip.size()));
+  }
+};
 
 TEST_F(ZipArchiveTest, FindAndExtract) {
   std::string error_msg;
@@ -62,4 +122,40 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+TEST_F(ZipArchiveTest, MapDirectlyOrExtract) {
+  std::vector<uint8_t> contents(3 * kPageSize);
+  for (size_t i = 0; i < contents.size(); ++i) {
+    contents[i] = i * 7;
+  }
+  ScratchFile tmp;
+  // The data follows the 30 byte local header, the name and the padding, at offset 44.
+  WriteStoredZip(tmp.GetFile(), "classes.dex", contents, 3);
+
+  std::string error_msg;
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(tmp.GetFilename().c_str(), &error_msg));
+  ASSERT_TRUE(zip_archive.get() != NULL) << error_msg;
+  UniquePtr<ZipEntry> zip_entry(zip_archive->Find("classes.dex", &error_msg));
+  ASSERT_TRUE(zip_entry.get() != NULL) << error_msg;
+  EXPECT_TRUE(zip_entry->IsUncompressed());
+  EXPECT_EQ(44, zip_entry->GetDataOffset());
+  EXPECT_TRUE(zip_entry->IsAlignedTo(4));
+  EXPECT_FALSE(zip_entry->IsAlignedTo(8));
+
+  // Word aligned stored data is mapped read-only from the file.
+  UniquePtr<MemMap> map(zip_entry->MapDirectlyOrExtract(tmp.GetFilename().c_str(), "classes.dex",
+                                                        4, &error_msg));
+  ASSERT_TRUE(map.get() != NULL) << error_msg;
+  EXPECT_EQ(PROT_READ, map->GetProtect());
+  ASSERT_EQ(contents.size(), map->Size());
+  EXPECT_EQ(0, memcmp(&contents[0], map->Begin(), contents.size()));
+
+  // Data that is not aligned as requested is extracted instead.
+  map.reset(zip_entry->MapDirectlyOrExtract(tmp.GetFilename().c_str(), "classes.dex", 8,
+                                            &error_msg));
+  ASSERT_TRUE(map.get() != NULL) << error_msg;
+  EXPECT_EQ(PROT_READ | PROT_WRITE, map->GetProtect());
+  ASSERT_EQ(contents.size(), map->Size());
+  EXPECT_EQ(0, memcmp(&contents[0], map->Begin(), contents.size()));
+}
+
 }  // namespace art
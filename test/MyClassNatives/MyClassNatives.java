@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+import dalvik.annotation.optimization.CriticalNative;
+import dalvik.annotation.optimization.FastNative;
+
 class MyClassNatives {
     native void throwException();
     native void foo();
@@ -40,4 +43,11 @@ class MyClassNatives {
 
     native void instanceMethodThatShouldTakeClass(int i, Class c);
     static native void staticMethodThatShouldTakeClass(int i, Class c);
+
+    @FastNative
+    native int fastFooII(int x, int y);
+    @CriticalNative
+    static native int criticalFooII(int x, int y);
+    @CriticalNative
+    static native long criticalFooIJD(int x, long y, double z);
 }
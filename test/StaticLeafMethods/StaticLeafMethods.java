@@ -15,8 +15,13 @@
  */
 
 class StaticLeafMethods {
+    static int total;
+
     static void nop() {
     }
+    static void add(int x) {
+        total += x;
+    }
     static byte identity(byte x) {
         return x;
     }